@@ -20,6 +20,8 @@
 #include "utils/timeutil.h" //for getRealTime()
 #include "utils/progress.h" //for progress_display
 #include "alignmentsummary.h"
+#include "alignmentcolumns.h"
+#include "utils/mappedfile.h"
 
 #include <Eigen/LU>
 #ifdef USE_BOOST
@@ -531,9 +533,15 @@ Alignment::Alignment(char *filename, char *sequence_type, InputType &intype, str
     double readStart = getRealTime();
     cout << "Reading alignment file " << filename << " ... ";
     intype = detectInputFile(filename);
+    // PoMo counts files set up more than the patterns
+    bool use_cache = Params::getInstance().aln_cache && intype != IN_COUNTS;
+    bool cache_loaded = false;
 
     try {
-        if (intype == IN_NEXUS) {
+        if (use_cache && readCache(filename, sequence_type, intype)) {
+            cout << "Alignment patterns loaded from " << filename << ".alncache" << endl;
+            cache_loaded = true;
+        } else if (intype == IN_NEXUS) {
             cout << "Nexus format detected" << endl;
             readNexus(filename);
         } else if (intype == IN_FASTA) {
@@ -571,6 +579,9 @@ Alignment::Alignment(char *filename, char *sequence_type, InputType &intype, str
     {
         outError("Alignment must have at least 3 sequences");
     }
+    if (use_cache && !cache_loaded) {
+        writeCache(filename, sequence_type, intype);
+    }
     double constCountStart = getRealTime();
     countConstSite();
     if (verbose_mode >= VB_MED) {
@@ -1294,40 +1305,42 @@ void Alignment::regroupSitePattern(int groups, IntVector& site_group)
 	@return the data type of the input sequences
 */
 SeqType Alignment::detectSequenceType(StrVector &sequences) {
+    vector<size_t> char_count;
+    StrVectorColumns(sequences).countCharacters(char_count);
+    return detectSequenceType(char_count);
+}
+
+SeqType Alignment::detectSequenceType(vector<size_t> &char_count) {
     size_t num_nuc   = 0;
     size_t num_ungap = 0;
     size_t num_bin   = 0;
     size_t num_alpha = 0;
     size_t num_digit = 0;
     double detectStart = getRealTime();
-    size_t sequenceCount = sequences.size();
-#ifdef _OPENMP
-#pragma omp parallel for reduction(+:num_nuc,num_ungap,num_bin,num_alpha,num_digit)
-#endif
-    for (size_t seqNum = 0; seqNum < sequenceCount; ++seqNum) {
-        auto start = sequences.at(seqNum).data();
-        auto stop  = start + sequences.at(seqNum).size();
-        for (auto i = start; i!=stop; ++i) {
-            if ((*i) == 'A' || (*i) == 'C' || (*i) == 'G' || (*i) == 'T' || (*i) == 'U') {
-                ++num_nuc;
-                ++num_ungap;
-                continue;
-            }
-            if ((*i)=='?' || (*i)=='-' || (*i) == '.' ) {
-                continue;
-            }
-            if (*i != 'N' && *i != 'X' &&  (*i) != '~') {
-                num_ungap++;
-                if (isdigit(*i)) {
-                    num_digit++;
-                    if ((*i) == '0' || (*i) == '1') {
-                        num_bin++;
-                    }
+    for (int ch = 0; ch < NUM_CHAR; ++ch) {
+        size_t count = char_count[ch];
+        if (!count) {
+            continue;
+        }
+        if (ch == 'A' || ch == 'C' || ch == 'G' || ch == 'T' || ch == 'U') {
+            num_nuc   += count;
+            num_ungap += count;
+            continue;
+        }
+        if (ch == '?' || ch == '-' || ch == '.' ) {
+            continue;
+        }
+        if (ch != 'N' && ch != 'X' && ch != '~') {
+            num_ungap += count;
+            if (isdigit(ch)) {
+                num_digit += count;
+                if (ch == '0' || ch == '1') {
+                    num_bin += count;
                 }
             }
-            if (isalpha(*i)) {
-                num_alpha++;
-            }
+        }
+        if (isalpha(ch)) {
+            num_alpha += count;
         }
     }
     if (verbose_mode >= VB_MED) {
@@ -1669,11 +1682,10 @@ void Alignment::initCodon(char *gene_code_id) {
 //	cout << "num_states = " << num_states << endl;
 }
 
-int getMorphStates(StrVector &sequences) {
+int getMorphStates(vector<size_t> &char_count) {
 	char maxstate = 0;
-	for (StrVector::iterator it = sequences.begin(); it != sequences.end(); it++)
-		for (string::iterator pos = it->begin(); pos != it->end(); pos++)
-			if ((*pos) > maxstate && isalnum(*pos)) maxstate = *pos;
+	for (int ch = 1; ch < 128; ch++)
+		if (char_count[ch] && isalnum(ch)) maxstate = ch;
 	if (maxstate >= '0' && maxstate <= '9') return (maxstate - '0' + 1);
 	if (maxstate >= 'A' && maxstate <= 'V') return (maxstate - 'A' + 11);
 	return 0;
@@ -1723,6 +1735,31 @@ string Alignment::getSeqTypeStr(SeqType sequence_type) {
 }
 
 int Alignment::buildPattern(StrVector &sequences, char *sequence_type, int nseq, int nsite) {
+    ostringstream err_str;
+    /* now check that all sequences have the same length */
+    for (int seq_id = 0; seq_id < nseq; seq_id ++) {
+        if (sequences[seq_id].length() != nsite) {
+            err_str << "Sequence " << seq_names[seq_id] << " contains ";
+            if (sequences[seq_id].length() < nsite)
+                err_str << "not enough";
+            else
+                err_str << "too many";
+
+            err_str << " characters (" << sequences[seq_id].length() << ")\n";
+        }
+    }
+
+    if (err_str.str() != "")
+        throw err_str.str();
+
+    StrVectorColumns columns(sequences);
+    return buildPattern(columns, sequence_type, nseq, nsite);
+}
+
+/** number of characters of a block of sites loaded by buildPattern */
+const size_t PATTERN_BLOCK_SIZE = 1 << 26;
+
+int Alignment::buildPattern(AlignmentColumns &columns, char *sequence_type, int nseq, int nsite) {
     int seq_id;
     ostringstream err_str;
     codon_table = NULL;
@@ -1752,24 +1789,10 @@ int Alignment::buildPattern(StrVector &sequences, char *sequence_type, int nseq,
         cout.precision(6);
         cout << "Duplicate sequence name check took " << (getRealTime()-seqCheckStart) << " seconds." << endl;
     }
-    /* now check that all sequences have the same length */
-    for (seq_id = 0; seq_id < nseq; seq_id ++) {
-        if (sequences[seq_id].length() != nsite) {
-            err_str << "Sequence " << seq_names[seq_id] << " contains ";
-            if (sequences[seq_id].length() < nsite)
-                err_str << "not enough";
-            else
-                err_str << "too many";
-
-            err_str << " characters (" << sequences[seq_id].length() << ")\n";
-        }
-    }
-
-    if (err_str.str() != "")
-        throw err_str.str();
-
     /* now check data type */
-    seq_type = detectSequenceType(sequences);
+    vector<size_t> char_count;
+    columns.countCharacters(char_count);
+    seq_type = detectSequenceType(char_count);
     switch (seq_type) {
     case SEQ_BINARY:
         num_states = 2;
@@ -1784,7 +1807,7 @@ int Alignment::buildPattern(StrVector &sequences, char *sequence_type, int nseq,
         cout << "Alignment most likely contains protein sequences" << endl;
         break;
     case SEQ_MORPH:
-        num_states = getMorphStates(sequences);
+        num_states = getMorphStates(char_count);
         if (num_states < 2 || num_states > 32) throw "Invalid number of states.";
         cout << "Alignment most likely contains " << num_states << "-state morphological data" << endl;
         break;
@@ -1816,7 +1839,7 @@ int Alignment::buildPattern(StrVector &sequences, char *sequence_type, int nseq,
             nt2aa = true;
             cout << "Translating to amino-acid sequences with genetic code " << &sequence_type[5] << " ..." << endl;
         } else if (strcmp(sequence_type, "NUM") == 0 || strcmp(sequence_type, "MORPH") == 0) {
-            num_states = getMorphStates(sequences);
+            num_states = getMorphStates(char_count);
             if (num_states < 2 || num_states > 32) throw "Invalid number of states";
             user_seq_type = SEQ_MORPH;
         } else if (strcmp(sequence_type, "TINA") == 0 || strcmp(sequence_type, "MULTI") == 0) {
@@ -1858,22 +1881,36 @@ int Alignment::buildPattern(StrVector &sequences, char *sequence_type, int nseq,
     clear();
     pattern_index.clear();
     int num_error = 0;
+    // blocks of sites are loaded from the columns, the size of a block is a multiple of step
+    int block_sites = max((size_t)step, PATTERN_BLOCK_SIZE / max(nseq, 1) / step * step);
+    int block_end = 0;
+    const char *column = NULL, *column2 = NULL, *column3 = NULL;
     
     progress_display progress(nsite, "Constructing alignment", "examined", "site");
     for (site = 0; site < nsite; site+=step) {
+        if (site >= block_end) {
+            int count = min(block_sites, nsite - site);
+            columns.loadColumns(site, count);
+            block_end = site + count;
+        }
+        column = columns.getColumn(site);
+        if (seq_type == SEQ_CODON || nt2aa) {
+            column2 = columns.getColumn(site+1);
+            column3 = columns.getColumn(site+2);
+        }
         for (seq = 0; seq < nseq; seq++) {
-            //char state = convertState(sequences[seq][site], seq_type);
-            char state = char_to_state[(int)(sequences[seq][site])];
+            //char state = convertState(column[seq], seq_type);
+            char state = char_to_state[(int)(column[seq])];
             if (seq_type == SEQ_CODON || nt2aa) {
             	// special treatment for codon
-            	char state2 = char_to_state[(int)(sequences[seq][site+1])];
-            	char state3 = char_to_state[(int)(sequences[seq][site+2])];
+            	char state2 = char_to_state[(int)(column2[seq])];
+            	char state3 = char_to_state[(int)(column3[seq])];
             	if (state < 4 && state2 < 4 && state3 < 4) {
 //            		state = non_stop_codon[state*16 + state2*4 + state3];
             		state = state*16 + state2*4 + state3;
             		if (genetic_code[(int)state] == '*') {
                         err_str << "Sequence " << seq_names[seq] << " has stop codon " <<
-                        		sequences[seq][site] << sequences[seq][site+1] << sequences[seq][site+2] <<
+                        		column[seq] << column2[seq] << column3[seq] <<
                         		" at site " << site+1 << endl;
                         num_error++;
                         state = STATE_UNKNOWN;
@@ -1888,7 +1925,7 @@ int Alignment::buildPattern(StrVector &sequences, char *sequence_type, int nseq,
             		if (state != STATE_UNKNOWN || state2 != STATE_UNKNOWN || state3 != STATE_UNKNOWN) {
             			ostringstream warn_str;
                         warn_str << "Sequence " << seq_names[seq] << " has ambiguous character " <<
-                        		sequences[seq][site] << sequences[seq][site+1] << sequences[seq][site+2] <<
+                        		column[seq] << column2[seq] << column3[seq] <<
                         		" at site " << site+1;
                         outWarning(warn_str.str());
             		}
@@ -1897,9 +1934,9 @@ int Alignment::buildPattern(StrVector &sequences, char *sequence_type, int nseq,
             }
             if (state == STATE_INVALID) {
                 if (num_error < 100) {
-                    err_str << "Sequence " << seq_names[seq] << " has invalid character " << sequences[seq][site];
+                    err_str << "Sequence " << seq_names[seq] << " has invalid character " << column[seq];
                     if (seq_type == SEQ_CODON)
-                        err_str << sequences[seq][site+1] << sequences[seq][site+2];
+                        err_str << column2[seq] << column3[seq];
                     err_str << " at site " << site+1 << endl;
                 } else if (num_error == 100)
                     err_str << "...many more..." << endl;
@@ -2026,6 +2063,18 @@ void Alignment::doReadPhylip(char *filename, char *sequence_type, StrVector &seq
 }
 
 int Alignment::readPhylip(char *filename, char *sequence_type) {
+    bool tina_state = (sequence_type && (strcmp(sequence_type,"TINA") == 0 || strcmp(sequence_type,"MULTI") == 0));
+    if (!tina_state) {
+        // read patterns straight from the file, without keeping all sequences in memory
+        StreamedColumns columns;
+        if (columns.readPhylip(filename)) {
+            seq_names = columns.getSeqNames();
+            num_states = 0;
+            return buildPattern(columns, sequence_type, columns.getNSeq(), columns.getNSite());
+        }
+        seq_names.clear();
+    }
+
     StrVector sequences;
     int nseq = 0, nsite = 0;
     
@@ -2153,6 +2202,14 @@ void Alignment::doReadFasta(char *filename, char *sequence_type, StrVector &sequ
     in.close();
 
     // now try to cut down sequence name if possible
+    shortenSeqNames();
+    
+    nseq = seq_names.size();
+    nsite = sequences.front().length();
+    
+}
+
+void Alignment::shortenSeqNames() {
     int i, step = 0;
     StrVector new_seq_names, remain_seq_names;
     new_seq_names.resize(seq_names.size());
@@ -2194,13 +2251,21 @@ void Alignment::doReadFasta(char *filename, char *sequence_type, StrVector &sequ
     }
 
     seq_names = new_seq_names;
-    
-    nseq = seq_names.size();
-    nsite = sequences.front().length();
-    
 }
 
 int Alignment::readFasta(char *filename, char *sequence_type) {
+    {
+        // read patterns straight from the file, without keeping all sequences in memory
+        StreamedColumns columns;
+        if (columns.readFasta(filename)) {
+            seq_names = columns.getSeqNames();
+            // now try to cut down sequence name if possible
+            shortenSeqNames();
+            return buildPattern(columns, sequence_type, columns.getNSeq(), columns.getNSite());
+        }
+        seq_names.clear();
+    }
+
     StrVector sequences;
     int nseq = 0;
     int nsite = 0;
@@ -2397,6 +2462,236 @@ int Alignment::readMSF(char *filename, char *sequence_type) {
     return buildPattern(sequences, sequence_type, nseq, nsite);
 }
 
+/** first bytes of an alignment cache file */
+const char ALN_CACHE_MAGIC[8] = "IQALNCH";
+
+/** increase whenever the layout of the cache file changes */
+const uint32_t ALN_CACHE_VERSION = 1;
+
+/** written in native byte order, to reject caches written on another architecture */
+const uint32_t ALN_CACHE_BYTE_ORDER = 0x01020304;
+
+/**
+    header of an alignment cache file, followed by the sequence type string,
+    the sequence names, the patterns and site_pattern
+*/
+struct AlnCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    /** size and modification time of the alignment file the cache was built from */
+    uint64_t source_size;
+    int64_t source_mtime;
+    /** reader options the patterns depend on */
+    int32_t intype;
+    int32_t sequential;
+    int32_t seq_type;
+    int32_t num_states;
+    int32_t state_unknown;
+    int32_t nseq;
+    int32_t nsite;
+    int32_t npattern;
+    /** bytes per state in the patterns, 1 if all states fit in a byte, otherwise sizeof(StateType) */
+    int32_t state_bytes;
+    int32_t reserved;
+};
+
+/** fixed part of a pattern in the cache file, followed by nseq states of state_bytes each */
+struct AlnCachePattern {
+    int32_t frequency;
+    int32_t flag;
+    int32_t num_chars;
+    int32_t const_char;
+};
+
+/**
+    fill the header fields identifying the alignment file and the reader options
+    @return false if the alignment file cannot be accessed
+*/
+static bool initAlnCacheHeader(AlnCacheHeader &header, const char *filename, InputType intype) {
+    struct stat file_stat;
+    if (stat(filename, &file_stat) != 0) {
+        return false;
+    }
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, ALN_CACHE_MAGIC, sizeof(header.magic));
+    header.version      = ALN_CACHE_VERSION;
+    header.byte_order   = ALN_CACHE_BYTE_ORDER;
+    header.source_size  = file_stat.st_size;
+    header.source_mtime = file_stat.st_mtime;
+    header.intype       = intype;
+    header.sequential   = Params::getInstance().phylip_sequential_format;
+    return true;
+}
+
+/** sequential reader of a mapped cache file, failing instead of reading past its end */
+class AlnCacheReader {
+public:
+    AlnCacheReader(const char *data, size_t size): pos(data), end(data + size) {}
+
+    bool read(void *value, size_t size) {
+        if ((size_t)(end - pos) < size) {
+            return false;
+        }
+        memcpy(value, pos, size);
+        pos += size;
+        return true;
+    }
+
+    bool readString(string &str) {
+        uint32_t len;
+        if (!read(&len, sizeof(len)) || (size_t)(end - pos) < len) {
+            return false;
+        }
+        str.assign(pos, len);
+        pos += len;
+        return true;
+    }
+
+    bool atEnd() const { return pos == end; }
+
+private:
+    const char *pos;
+    const char *end;
+};
+
+static void writeAlnCacheString(ostream &out, const string &str) {
+    uint32_t len = str.length();
+    out.write((const char*)&len, sizeof(len));
+    out.write(str.data(), len);
+}
+
+bool Alignment::readCache(const char *filename, char *sequence_type, InputType intype) {
+    string cache_file = string(filename) + ".alncache";
+    AlnCacheHeader expected, header;
+    MappedFile mapped;
+    if (!initAlnCacheHeader(expected, filename, intype) || !mapped.open(cache_file.c_str())) {
+        return false;
+    }
+    AlnCacheReader in(mapped.data(), mapped.size());
+    string cached_type;
+    if (!in.read(&header, sizeof(header)) || memcmp(&header, &expected, offsetof(AlnCacheHeader, seq_type)) != 0
+        || !in.readString(cached_type) || cached_type != (sequence_type ? sequence_type : "")) {
+        return false;
+    }
+    int nseq = header.nseq;
+    StrVector names(nseq);
+    for (int seq = 0; seq < nseq; seq++) {
+        if (!in.readString(names[seq])) {
+            return false;
+        }
+    }
+    if (header.state_bytes != 1 && header.state_bytes != sizeof(StateType)) {
+        return false;
+    }
+    vector<Pattern> patterns(header.npattern);
+    vector<uint8_t> packed(nseq);
+    for (auto &pat : patterns) {
+        AlnCachePattern info;
+        pat.resize(nseq);
+        if (!in.read(&info, sizeof(info))) {
+            return false;
+        }
+        if (header.state_bytes == 1) {
+            if (!in.read(packed.data(), nseq)) {
+                return false;
+            }
+            copy(packed.begin(), packed.end(), pat.begin());
+        } else if (!in.read(pat.data(), sizeof(StateType) * nseq)) {
+            return false;
+        }
+        pat.frequency  = info.frequency;
+        pat.flag       = info.flag;
+        pat.num_chars  = info.num_chars;
+        pat.const_char = info.const_char;
+    }
+    IntVector sites(header.nsite);
+    if (!in.read(sites.data(), sizeof(int) * header.nsite) || !in.atEnd()) {
+        return false;
+    }
+
+    codon_table    = NULL;
+    genetic_code   = NULL;
+    non_stop_codon = NULL;
+    if (sequence_type && (strncmp(sequence_type, "CODON", 5) == 0 || strncmp(sequence_type, "NT2AA", 5) == 0)) {
+        // this also sets num_states, overridden below for NT2AA
+        initCodon(&sequence_type[5]);
+    }
+    seq_type      = (SeqType)header.seq_type;
+    num_states    = header.num_states;
+    STATE_UNKNOWN = header.state_unknown;
+    seq_names.swap(names);
+    site_pattern.swap(sites);
+    vector<Pattern>::swap(patterns);
+    pattern_index.clear();
+    for (int ptn = 0; ptn < header.npattern; ptn++) {
+        pattern_index[at(ptn)] = ptn;
+    }
+    return true;
+}
+
+void Alignment::writeCache(const char *filename, char *sequence_type, InputType intype) {
+    string cache_file = string(filename) + ".alncache";
+    // written under another name first, so that a concurrent run never sees a partial cache
+    string tmp_file = cache_file + ".tmp";
+    AlnCacheHeader header;
+    if (!initAlnCacheHeader(header, filename, intype)) {
+        return;
+    }
+    int nseq = getNSeq();
+    header.seq_type      = seq_type;
+    header.num_states    = num_states;
+    header.state_unknown = STATE_UNKNOWN;
+    header.nseq          = nseq;
+    header.nsite         = site_pattern.size();
+    header.npattern      = size();
+    header.state_bytes   = 1;
+    for (auto &pat : *this) {
+        if (*max_element(pat.begin(), pat.end()) > 255) {
+            header.state_bytes = sizeof(StateType);
+            break;
+        }
+    }
+    vector<uint8_t> packed(nseq);
+    try {
+        ofstream out;
+        out.exceptions(ios::failbit | ios::badbit);
+        out.open(tmp_file.c_str(), ios::out | ios::binary);
+        out.write((const char*)&header, sizeof(header));
+        writeAlnCacheString(out, sequence_type ? sequence_type : "");
+        for (auto &name : seq_names) {
+            writeAlnCacheString(out, name);
+        }
+        for (auto &pat : *this) {
+            AlnCachePattern info;
+            info.frequency  = pat.frequency;
+            info.flag       = pat.flag;
+            info.num_chars  = pat.num_chars;
+            info.const_char = pat.const_char;
+            out.write((const char*)&info, sizeof(info));
+            if (header.state_bytes == 1) {
+                copy(pat.begin(), pat.end(), packed.begin());
+                out.write((const char*)packed.data(), nseq);
+            } else {
+                out.write((const char*)pat.data(), sizeof(StateType) * nseq);
+            }
+        }
+        out.write((const char*)site_pattern.data(), sizeof(int) * site_pattern.size());
+        out.close();
+    } catch (ios::failure) {
+        outWarning("Could not write alignment cache " + cache_file);
+        remove(tmp_file.c_str());
+        return;
+    }
+    remove(cache_file.c_str());
+    if (rename(tmp_file.c_str(), cache_file.c_str()) != 0) {
+        outWarning("Could not write alignment cache " + cache_file);
+        remove(tmp_file.c_str());
+        return;
+    }
+    cout << "Alignment patterns cached in " << cache_file << endl;
+}
+
 // TODO: Use outWarning to print warnings.
 int Alignment::readCountsFormat(char* filename, char* sequence_type) {
     int npop = 0;                // Number of populations.
@@ -4300,6 +4595,40 @@ void Alignment::printDist(const char *file_name, double *dist_mat) {
     }
 }
 
+void Alignment::printDist(ostream &out, const float *dist_lower) {
+    size_t nseqs = getNSeq();
+    int max_len = getMaxSeqNameLength();
+    if (max_len < 10) max_len = 10;
+    out << nseqs << endl;
+    out.precision(max((int)ceil(-log10(Params::getInstance().min_branch_length))+1, 6));
+    out << fixed;
+    for (size_t seq1 = 0; seq1 < nseqs; ++seq1)  {
+        out.width(max_len);
+        out << left << getSeqName(seq1) << " ";
+        const float *row = dist_lower + seq1*(seq1-1)/2;
+        for (size_t seq2 = 0; seq2 < seq1; ++seq2) {
+            out << (double)row[seq2] << " ";
+        }
+        out << 0.0 << " ";
+        for (size_t seq2 = seq1+1; seq2 < nseqs; ++seq2) {
+            out << (double)dist_lower[seq2*(seq2-1)/2 + seq1] << " ";
+        }
+        out << endl;
+    }
+}
+
+void Alignment::printDist(const char *file_name, const float *dist_lower) {
+    try {
+        ofstream out;
+        out.exceptions(ios::failbit | ios::badbit);
+        out.open(file_name);
+        printDist(out, dist_lower);
+        out.close();
+    } catch (ios::failure) {
+        outError(ERR_WRITE_OUTPUT, file_name);
+    }
+}
+
 double Alignment::readDist(istream &in, double *dist_mat) {
     double longest_dist = 0.0;
     size_t nseqs;
@@ -24,6 +24,8 @@ const double MIN_FREQUENCY_DIFF     = 0.00001;
 const int NUM_CHAR = 256;
 typedef bitset<NUM_CHAR> StateBitset;
 
+class AlignmentColumns;
+
 /** class storing results of symmetry tests */
 class SymTestResult {
 public:
@@ -200,6 +202,15 @@ public:
     int readNexus(char *filename);
 
     int buildPattern(StrVector &sequences, char *sequence_type, int nseq, int nsite);
+
+    /**
+            build the site patterns from the columns of the alignment, one block of sites at a time
+            @param columns the alignment columns
+            @param sequence_type type of the sequence, either "BIN", "DNA", "AA", or NULL
+            @param nseq, nsite
+            @return 1 on success
+     */
+    int buildPattern(AlignmentColumns &columns, char *sequence_type, int nseq, int nsite);
     
     /**
             do-read the alignment in PHYLIP format (interleaved)
@@ -241,6 +252,11 @@ public:
      */
     void doReadFasta(char *filename, char *sequence_type, StrVector &sequences, int &nseq, int &nsite);
 
+    /**
+            cut sequence names read from a FASTA file at white spaces, as long as they stay unique
+     */
+    void shortenSeqNames();
+
     /**
             read the alignment in FASTA format
             @param filename file name
@@ -293,6 +309,23 @@ public:
      */
     int readMSF(char *filename, char *sequence_type);
 
+    /**
+            read the site patterns of an alignment from its binary cache file (see --aln-cache)
+            @param filename alignment file name, the cache is filename + ".alncache"
+            @param sequence_type type of the sequence as passed to the readers, or NULL
+            @param intype detected format of the alignment file
+            @return false if there is no cache or it is stale, e.g. the alignment file changed
+     */
+    bool readCache(const char *filename, char *sequence_type, InputType intype);
+
+    /**
+            write the site patterns to the binary cache file of the alignment
+            @param filename alignment file name, the cache is filename + ".alncache"
+            @param sequence_type type of the sequence as passed to the readers, or NULL
+            @param intype detected format of the alignment file
+     */
+    void writeCache(const char *filename, char *sequence_type, InputType intype);
+
     /**
             extract the alignment from a nexus data block, called by readNexus()
             @param data_block data block of nexus file
@@ -337,6 +370,12 @@ public:
      ****************************************************************************/
     SeqType detectSequenceType(StrVector &sequences);
 
+    /**
+            detect the sequence type from the number of occurrences of every character
+            @param char_count number of occurrences, indexed by (unsigned char)
+     */
+    SeqType detectSequenceType(vector<size_t> &char_count);
+
     void computeUnknownState();
 
     void buildStateMap(char *map, SeqType seq_type);
@@ -719,6 +758,20 @@ public:
      */
     void printDist(ostream &out, double *dist_mat);
 
+    /**
+            write a lower-triangle distance matrix into a file in (square) PHYLIP distance format
+            @param file_name distance file name
+            @param dist_lower distances below the diagonal, row by row (see PhyloTree::dist_lower)
+     */
+    void printDist(const char *file_name, const float *dist_lower);
+
+    /**
+            write a lower-triangle distance matrix into a stream in (square) PHYLIP distance format
+            @param out output stream
+            @param dist_lower distances below the diagonal, row by row (see PhyloTree::dist_lower)
+     */
+    void printDist(ostream &out, const float *dist_lower);
+
     /**
             read distance matrix from a file in PHYLIP distance format
             @param file_name distance file name
@@ -0,0 +1,366 @@
+//
+//  alignmentcolumns.cpp
+//  alignment
+//
+
+#include "alignmentcolumns.h"
+#include "alignment.h"
+#include "utils/progress.h"
+
+/** number of sequences extracted by a thread at a time, so that threads write to different cache lines */
+const int COLUMN_SEQ_CHUNK = 64;
+
+/** size of the buffers holding the characters of unmapped input, and of the mapped input released at a time */
+const size_t SEQ_BUFFER_SIZE = 1 << 24;
+
+AlignmentColumns::AlignmentColumns(): nseq(0), nsite(0), block_start(0) {
+}
+
+void AlignmentColumns::resizeBlock(int start, int count) {
+    block_start = start;
+    block.resize((size_t)count * nseq);
+}
+
+StrVectorColumns::StrVectorColumns(StrVector &sequences): sequences(sequences) {
+    nseq  = sequences.size();
+    nsite = nseq ? sequences[0].length() : 0;
+}
+
+void StrVectorColumns::loadColumns(int start, int count) {
+    resizeBlock(start, count);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static, COLUMN_SEQ_CHUNK)
+#endif
+    for (int seq = 0; seq < nseq; seq++) {
+        const char *chars = sequences[seq].data() + start;
+        char *out = &block[seq];
+        for (int i = 0; i < count; i++) {
+            out[(size_t)i * nseq] = chars[i];
+        }
+    }
+}
+
+void StrVectorColumns::countCharacters(vector<size_t> &char_count) {
+    char_count.assign(NUM_CHAR, 0);
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+        vector<size_t> thread_count(NUM_CHAR, 0);
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+        for (int seq = 0; seq < nseq; seq++) {
+            for (auto ch : sequences[seq]) {
+                thread_count[(unsigned char)ch]++;
+            }
+        }
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+        for (int i = 0; i < NUM_CHAR; i++) {
+            char_count[i] += thread_count[i];
+        }
+    }
+}
+
+StreamedColumns::StreamedColumns(): is_mapped(false), map_pos(NULL), map_released(NULL), gz_in(NULL),
+    line_num(0), buffer_used(0), buffer_capacity(0) {
+    char_count.resize(NUM_CHAR, 0);
+}
+
+StreamedColumns::~StreamedColumns() {
+    closeInput();
+    for (auto buffer : buffers) {
+        delete [] buffer;
+    }
+}
+
+void StreamedColumns::openInput(const char *filename) {
+    line_num = 0;
+    is_mapped = mapped.open(filename) && !mapped.isGzipped();
+    if (is_mapped) {
+        map_pos = map_released = mapped.data();
+        return;
+    }
+    mapped.close();
+    gz_in = new igzstream;
+    // set the failbit and badbit
+    gz_in->exceptions(ios::failbit | ios::badbit);
+    gz_in->open(filename);
+    // remove the failbit
+    gz_in->exceptions(ios::badbit);
+}
+
+void StreamedColumns::closeInput() {
+    if (gz_in) {
+        gz_in->clear();
+        gz_in->close();
+        delete gz_in;
+        gz_in = NULL;
+    }
+}
+
+bool StreamedColumns::nextLine(const char *&begin, const char *&end) {
+    if (is_mapped) {
+        const char *file_end = mapped.data() + mapped.size();
+        if (map_pos >= file_end) {
+            return false;
+        }
+        begin = end = map_pos;
+        // a line ends with \n, \r or \r\n, like in safeGetline
+        while (end < file_end && *end != '\n' && *end != '\r') {
+            end++;
+        }
+        map_pos = end;
+        if (map_pos < file_end && *map_pos++ == '\r' && map_pos < file_end && *map_pos == '\n') {
+            map_pos++;
+        }
+        // the lines read so far are only needed again when the columns are extracted
+        if ((size_t)(map_pos - map_released) >= SEQ_BUFFER_SIZE) {
+            map_released = mapped.release(map_released, map_pos);
+        }
+    } else {
+        if (gz_in->eof()) {
+            return false;
+        }
+        safeGetline(*gz_in, line);
+        begin = line.data();
+        end = begin + line.length();
+    }
+    line_num++;
+    return true;
+}
+
+bool StreamedColumns::addSequenceLine(int seq, const char *begin, const char *end) {
+    const char *first = NULL, *last = NULL;
+    size_t len = 0;
+    bool exclam_found = false;
+    // same characters as processSeq
+    for (const char *pos = begin; pos != end; pos++) {
+        unsigned char ch = *pos;
+        if (ch <= ' ') {
+            continue;
+        }
+        if (isalnum(ch) || ch == '-' || ch == '?'|| ch == '.' || ch == '*' || ch == '~') {
+            ch = toupper(ch);
+        } else if (ch == '!') {
+            if (!exclam_found) {
+                exclam_found = true;
+                cout << "Warning: Line " + convertIntToString(line_num) + ": '!' was found in the alignment, which will be interpreted as a gap" << endl;
+            }
+        } else if (ch == '(' || ch == '{') {
+            // bracketed characters are collapsed into one unknown character
+            return false;
+        } else {
+            throw "Line " + convertIntToString(line_num) + ": Unrecognized character "  + (char)ch;
+        }
+        char_count[ch]++;
+        if (!first) {
+            first = pos;
+        }
+        last = pos;
+        len++;
+    }
+    if (!len) {
+        return true;
+    }
+    seq_length[seq] += len;
+    if (!is_mapped) {
+        first = storeCharacters(first, last + 1, len);
+        last = first + len - 1;
+    }
+    vector<Segment> &seq_segments = segments[seq];
+    if (!seq_segments.empty()) {
+        // extend the last segment if only white spaces lie in between
+        const char *gap = seq_segments.back().end;
+        while (is_mapped && gap < first && (unsigned char)*gap <= ' ') {
+            gap++;
+        }
+        if (gap == first) {
+            seq_segments.back().end = last + 1;
+            return true;
+        }
+    }
+    Segment segment;
+    segment.begin = first;
+    segment.end   = last + 1;
+    seq_segments.push_back(segment);
+    return true;
+}
+
+const char *StreamedColumns::storeCharacters(const char *begin, const char *end, size_t len) {
+    if (buffers.empty() || buffer_used + len > buffer_capacity) {
+        buffer_capacity = max(SEQ_BUFFER_SIZE, len);
+        buffers.push_back(new char[buffer_capacity]);
+        buffer_used = 0;
+    }
+    char *start = buffers.back() + buffer_used;
+    char *out = start;
+    for (const char *pos = begin; pos != end; pos++) {
+        if ((unsigned char)*pos > ' ') {
+            *out++ = *pos;
+        }
+    }
+    buffer_used += len;
+    return start;
+}
+
+bool StreamedColumns::readFasta(const char *filename) {
+    openInput(filename);
+    const char *begin, *end;
+    {
+        progress_display progress(is_mapped ? mapped.size() : gz_in->getCompressedLength(),
+                                  "Reading fasta file", "", "");
+        while (nextLine(begin, end)) {
+            if (begin == end) {
+                continue;
+            }
+            if (*begin == '>') { // next sequence
+                seq_names.push_back(string(begin + 1, end));
+                trimString(seq_names.back());
+                seq_length.push_back(0);
+                segments.push_back(vector<Segment>());
+                continue;
+            }
+            // read sequence contents
+            if (seq_names.empty()) {
+                throw "First line must begin with '>' to define sequence name";
+            }
+            if (!addSequenceLine(seq_names.size() - 1, begin, end)) {
+                closeInput();
+                return false;
+            }
+            if (is_mapped) {
+                progress = (double)(map_pos - mapped.data());
+            } else {
+                progress = (double)gz_in->getCompressedPosition();
+            }
+        }
+    }
+    closeInput();
+    nseq  = seq_names.size();
+    nsite = nseq ? seq_length[0] : 0;
+    checkSequenceLengths();
+    initCursors();
+    return true;
+}
+
+bool StreamedColumns::readPhylip(const char *filename) {
+    ostringstream err_str;
+    openInput(filename);
+    const char *begin, *end;
+    int seq_id = 0;
+    while (nextLine(begin, end)) {
+        if (begin == end) {
+            continue;
+        }
+        if (nseq == 0) { // read number of sequences and sites
+            istringstream line_in(string(begin, end));
+            if (!(line_in >> nseq >> nsite))
+                throw "Invalid PHYLIP format. First line must contain number of sequences and sites";
+            if (nseq < 3)
+                throw "There must be at least 3 sequences";
+            if (nsite < 1)
+                throw "No alignment columns";
+            seq_names.resize(nseq, "");
+            seq_length.resize(nseq, 0);
+            segments.resize(nseq);
+            continue;
+        }
+        // read sequence contents
+        if (seq_names[seq_id] == "") { // cut out the sequence name
+            const char *pos = begin;
+            while (pos != end && *pos != ' ' && *pos != '\t') {
+                pos++;
+            }
+            if (pos == end) {
+                pos = begin + min((ptrdiff_t)10, end - begin); //  assume standard phylip
+            }
+            seq_names[seq_id] = string(begin, pos);
+            begin = pos;
+        }
+        size_t old_len = seq_length[seq_id];
+        if (!addSequenceLine(seq_id, begin, end)) {
+            closeInput();
+            return false;
+        }
+        if (seq_length[seq_id] != seq_length[0]) {
+            err_str << "Line " << line_num << ": Sequence " << seq_names[seq_id] << " has wrong sequence length " << seq_length[seq_id] << endl;
+            throw err_str.str();
+        }
+        if (seq_length[seq_id] > old_len) {
+            seq_id++;
+        }
+        if (seq_id == nseq) {
+            seq_id = 0;
+        }
+    }
+    closeInput();
+    checkSequenceLengths();
+    initCursors();
+    return true;
+}
+
+void StreamedColumns::checkSequenceLengths() {
+    ostringstream err_str;
+    for (int seq = 0; seq < nseq; seq++) {
+        if (seq_length[seq] != (size_t)nsite) {
+            err_str << "Sequence " << seq_names[seq] << " contains ";
+            if (seq_length[seq] < (size_t)nsite)
+                err_str << "not enough";
+            else
+                err_str << "too many";
+            err_str << " characters (" << seq_length[seq] << ")\n";
+        }
+    }
+    if (err_str.str() != "") {
+        throw err_str.str();
+    }
+}
+
+void StreamedColumns::initCursors() {
+    cursor_segment.assign(nseq, 0);
+    cursor.resize(nseq);
+    released.resize(nseq);
+    for (int seq = 0; seq < nseq; seq++) {
+        cursor[seq] = released[seq] = segments[seq].empty() ? NULL : segments[seq][0].begin;
+    }
+}
+
+void StreamedColumns::countCharacters(vector<size_t> &char_count) {
+    char_count = this->char_count;
+}
+
+void StreamedColumns::loadColumns(int start, int count) {
+    resizeBlock(start, count);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static, COLUMN_SEQ_CHUNK)
+#endif
+    for (int seq = 0; seq < nseq; seq++) {
+        vector<Segment> &seq_segments = segments[seq];
+        size_t segment = cursor_segment[seq];
+        const char *pos = cursor[seq];
+        char *out = &block[seq];
+        for (int i = 0; i < count; pos++) {
+            if (pos == seq_segments[segment].end) {
+                if (is_mapped) {
+                    mapped.release(released[seq], pos);
+                }
+                segment++;
+                pos = released[seq] = seq_segments[segment].begin;
+            }
+            unsigned char ch = *pos;
+            if (ch <= ' ') {
+                continue;
+            }
+            out[(size_t)i * nseq] = toupper(ch);
+            i++;
+        }
+        cursor_segment[seq] = segment;
+        cursor[seq] = pos;
+        if (is_mapped) {
+            released[seq] = mapped.release(released[seq], pos);
+        }
+    }
+}
@@ -0,0 +1,194 @@
+//
+//  alignmentcolumns.h
+//  alignment
+//
+//  Column-by-column access to the characters of the input sequences,
+//  used by Alignment::buildPattern to build site patterns block by block.
+//
+
+#ifndef ALIGNMENTCOLUMNS_H
+#define ALIGNMENTCOLUMNS_H
+
+#include "utils/tools.h"
+#include "utils/mappedfile.h"
+#include "utils/gzstream.h"
+
+/**
+    Columns of an alignment, made available one block of sites at a time.
+    Characters of a block are stored column-major, so that a site of all
+    sequences is contiguous.
+*/
+class AlignmentColumns {
+public:
+    AlignmentColumns();
+    virtual ~AlignmentColumns() {}
+
+    /**
+        load a block of sites, invalidating the previous block
+        @param start first site of the block
+        @param count number of sites in the block
+    */
+    virtual void loadColumns(int start, int count) = 0;
+
+    /**
+        @param site a site of the last loaded block
+        @return characters of all sequences at the site
+    */
+    const char *getColumn(int site) const {
+        return &block[(size_t)(site - block_start) * nseq];
+    }
+
+    /** @return number of sequences */
+    int getNSeq() const { return nseq; }
+
+    /** @return number of sites */
+    int getNSite() const { return nsite; }
+
+    /**
+        count how many times every character occurs, for detecting the sequence type
+        @param[out] char_count number of occurrences, indexed by (unsigned char)
+    */
+    virtual void countCharacters(vector<size_t> &char_count) = 0;
+
+protected:
+    /** allocate the block for count sites and remember its first site */
+    void resizeBlock(int start, int count);
+
+    int nseq;
+    int nsite;
+
+    /** first site of the loaded block */
+    int block_start;
+
+    /** characters of the loaded block, column-major */
+    vector<char> block;
+};
+
+/**
+    Columns of sequences that are already in memory
+*/
+class StrVectorColumns : public AlignmentColumns {
+public:
+    /**
+        @param sequences sequences of equal length, must outlive this object
+    */
+    StrVectorColumns(StrVector &sequences);
+
+    virtual void loadColumns(int start, int count);
+
+    virtual void countCharacters(vector<size_t> &char_count);
+
+private:
+    StrVector &sequences;
+};
+
+/**
+    Columns of a FASTA or PHYLIP file read without copying its sequences.
+    Uncompressed files are memory-mapped and only the position of every sequence
+    is recorded; gzipped files are inflated line by line into a compact buffer.
+    Columns are then extracted block by block, several sequences per thread, and
+    the pages of a mapped file that have been read completely are released.
+*/
+class StreamedColumns : public AlignmentColumns {
+public:
+    StreamedColumns();
+    virtual ~StreamedColumns();
+
+    /**
+        read a FASTA file
+        @param filename file name
+        @return false if the file has content this reader does not handle,
+            e.g. bracketed ambiguity codes; the caller should read it the classical way
+        @throw const char* or string on a format error, like Alignment::doReadFasta
+    */
+    bool readFasta(const char *filename);
+
+    /**
+        read an interleaved PHYLIP file
+        @param filename file name
+        @return false if the file has content this reader does not handle
+        @throw const char* or string on a format error, like Alignment::doReadPhylip
+    */
+    bool readPhylip(const char *filename);
+
+    /** @return sequence names as they appear in the file */
+    StrVector &getSeqNames() { return seq_names; }
+
+    virtual void loadColumns(int start, int count);
+
+    virtual void countCharacters(vector<size_t> &char_count);
+
+private:
+    /** contiguous range of characters of a sequence, possibly including white spaces */
+    struct Segment {
+        const char *begin;
+        const char *end;
+    };
+
+    /**
+        get the next line of the input
+        @param[out] begin first character of the line
+        @param[out] end one past the last character, without the line break
+        @return false at the end of the input
+    */
+    bool nextLine(const char *&begin, const char *&end);
+
+    /** open the input file, mapping it if it is not compressed */
+    void openInput(const char *filename);
+
+    /** close the input file; a mapped file stays mapped until the columns are extracted */
+    void closeInput();
+
+    /**
+        check and count the characters of a line and add them to a sequence
+        @return false if the line has characters this reader does not handle
+    */
+    bool addSequenceLine(int seq, const char *begin, const char *end);
+
+    /** copy characters of a line into the own buffer, for unmapped input */
+    const char *storeCharacters(const char *begin, const char *end, size_t len);
+
+    /** throw the errors of sequences whose length differs from the first one */
+    void checkSequenceLengths();
+
+    /** set the cursors to the beginning of the sequences */
+    void initCursors();
+
+    StrVector seq_names;
+
+    /** number of non-space characters of every sequence */
+    vector<size_t> seq_length;
+
+    /** ranges of characters of every sequence, in order */
+    vector<vector<Segment> > segments;
+
+    /** segment and position in it of the next character of every sequence */
+    vector<size_t> cursor_segment;
+    vector<const char*> cursor;
+
+    /** start of the part of the current segment of every sequence not yet released */
+    vector<const char*> released;
+
+    /** occurrences of every character */
+    vector<size_t> char_count;
+
+    /** the mapped input file, or nothing if the input is compressed */
+    MappedFile mapped;
+    bool is_mapped;
+    const char *map_pos;
+
+    /** end of the part of the mapped file released while reading it */
+    const char *map_released;
+
+    /** compressed input and its current line */
+    igzstream *gz_in;
+    string line;
+    int line_num;
+
+    /** buffers holding the characters of unmapped input */
+    vector<char*> buffers;
+    size_t buffer_used;
+    size_t buffer_capacity;
+};
+
+#endif
@@ -12,7 +12,7 @@ public:
     /**
     chunks of sequence
     */
-   vector<vector<short int>> sequence_chunks;
+   vector<SimStateVector> sequence_chunks;
    
    /**
        number of children which have completed simulating the sequence (for AliSim)
@@ -3,6 +3,7 @@
 #define LIBIQTREE2_FUNCTIONS_H
 
 #include <string>
+#include <vector>
 #include <functional>
 
 // Returns the version of the library
@@ -17,12 +18,37 @@ std::string generate_random_tree(
 // Calculates the RF distance between two trees
 int calculate_RF_distance(const std::string& tree1, const std::string& tree2);
 
-// Performs phylogenetic analysis
+// Calculates the RF distances between every tree of trees1 and every tree of
+// trees2, or between all pairs of trees1 if trees2 is empty. Each tree is parsed
+// and converted into splits once; pairs are compared in parallel.
+// Returns a row-major matrix of trees1.size() rows.
+std::vector<double> calculate_RF_distances(
+    const std::vector<std::string>& trees1,
+    const std::vector<std::string>& trees2 = {});
+
+// Performs phylogenetic analysis of an alignment given as a string in any
+// format iqtree2 reads, and returns the maximum-likelihood tree in Newick format.
+// Each call uses its own parameters, random stream and scratch directory, so
+// analyses may run concurrently on different threads (one thread each).
+// Errors are thrown as exceptions, except those raised inside an OpenMP parallel
+// region of the analysis: an exception cannot leave such a region, so these
+// still terminate the process even though each analysis uses one thread.
+// Side effects on the process:
+// - alignment, partition and initial_tree are written to a fresh directory under
+//   $TMPDIR (/tmp by default) and parsed from there by the file readers of iqtree2,
+//   so the input is held twice and pays a round trip through the disk; the
+//   directory is removed when the call returns
+// - the first call with a log_callback replaces the stream buffer of std::cout
+//   for the whole process and never restores it. Output of threads running an
+//   analysis with a callback goes to the callback, all other output is passed on
+//   unbuffered to the previous buffer; code that swaps std::cout's buffer later
+//   bypasses the callbacks.
 std::string phylogenic_analysis(
     const std::string& alignment, 
     const std::string& partition = "", 
     const std::string& model = "", 
     const std::string& initial_tree = "",
-    std::function<void(const std::string)> log_callback = nullptr);
+    std::function<void(const std::string)> log_callback = nullptr,
+    int rand_seed = 0);
 
 #endif // LIBIQTREE2_FUNCTIONS_H
@@ -1,8 +1,83 @@
 #include "libiqtree2_functions.h"
 #include <pybind11/pybind11.h>
+#include <sstream>
+#include <stdexcept>
+#include <climits>
+
+#include "utils/tools.h"
+#include "tree/mtreeset.h"
+
+// makes outError() throw for the duration of one call instead of exiting the process
+class ThrowOnErrorScope {
+public:
+    ThrowOnErrorScope() { setThrowOnError(true); }
+    ~ThrowOnErrorScope() { setThrowOnError(false); }
+};
+
+// parses all Newick strings of trees exactly once into a tree set with
+// taxon IDs assigned consistently by taxon name, one tree per string
+static void readTreeSet(const std::vector<std::string>& trees, MTreeSet& treeset) {
+    std::stringstream in;
+    for (auto& tree : trees) {
+        in << tree << std::endl;
+    }
+    bool is_rooted = false;
+    try {
+        treeset.readTrees(in, is_rooted, 0, INT_MAX);
+    } catch (std::ios::failure&) {
+        outError(ERR_READ_INPUT);
+    } catch (const char* str) {
+        outError(str);
+    } catch (std::string& str) {
+        outError(str);
+    }
+    // the strings are parsed as one stream, so an empty string or a string
+    // with several trees would shift every later tree to a wrong index
+    if (treeset.empty() || treeset.size() != trees.size()) {
+        throw std::invalid_argument("every tree string must contain exactly one tree");
+    }
+    treeset.checkConsistency();
+    if (!treeset.equal_taxon_set) {
+        throw std::invalid_argument("trees must have the same taxon set");
+    }
+}
+
+// Calculates the RF distances between two lists of trees
+std::vector<double> calculate_RF_distances(
+    const std::vector<std::string>& trees1,
+    const std::vector<std::string>& trees2) {
+    if (trees1.empty()) {
+        throw std::invalid_argument("trees1 must contain at least one tree");
+    }
+    ThrowOnErrorScope throw_on_error;
+
+    MTreeSet treeset1;
+    readTreeSet(trees1, treeset1);
+
+    if (trees2.empty()) {
+        size_t ntrees = treeset1.size();
+        std::vector<double> rfdist(ntrees * ntrees, 0.0);
+        treeset1.computeRFDist(rfdist.data(), RF_ALL_PAIR);
+        return rfdist;
+    }
+
+    MTreeSet treeset2;
+    readTreeSet(trees2, treeset2);
+    // IDs follow the sorted taxon names, so both sets agree if their names do
+    std::vector<std::string> taxname1, taxname2;
+    treeset1.front()->getTaxaName(taxname1);
+    treeset2.front()->getTaxaName(taxname2);
+    if (taxname1 != taxname2) {
+        throw std::invalid_argument("trees must have the same taxon set");
+    }
+
+    std::vector<double> rfdist(treeset1.size() * treeset2.size(), 0.0);
+    treeset1.computeRFDist(rfdist.data(), &treeset2, false);
+    return rfdist;
+}
 
 // Calculates the RF distance between two trees
 int calculate_RF_distance(const std::string& tree1, const std::string& tree2) {
-    // Placeholder implementation
-    return 0; // Example RF distance
+    std::vector<double> rfdist = calculate_RF_distances({tree1}, {tree2});
+    return (int)rfdist[0];
 }
@@ -1,63 +1,258 @@
 #include "libiqtree2_functions.h"
 #include <pybind11/pybind11.h>
-#include <functional> 
+#include <functional>
 #include <sstream>
+#include <fstream>
 #include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <string>
 
+#include "utils/tools.h"
+#include "utils/checkpoint.h"
+#include "tree/iqtree.h"
+#include "main/phyloanalysis.h"
+#include "vectorclass/instrset.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
-// callback stream buffer to redirect std::cout to a passed in callback function
-class CallbackStreambuf : public std::streambuf {
+#if defined WIN32 || defined _WIN32 || defined __WIN32__ || defined WIN64
+#include <direct.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+// log callback of the analysis running on the calling thread, if any
+static thread_local const std::function<void(const std::string)> *thread_log_callback = nullptr;
+
+// stream buffer installed once on std::cout; output written by a thread that runs
+// an analysis with a log callback goes to that callback, everything else is passed
+// on to the original buffer. The buffer is unbuffered, so no state is shared
+// between threads and concurrent analyses never swap std::cout's buffer.
+class ThreadLogStreambuf : public std::streambuf {
 public:
-    CallbackStreambuf(std::function<void(const std::string&)> callback)
-        : callback_(callback) {}
+    ThreadLogStreambuf(std::streambuf* original)
+        : original_(original) {}
 
 protected:
     virtual std::streamsize xsputn(const char* s, std::streamsize n) {
-        if (callback_) { // Check if the callback is not null
+        if (thread_log_callback) {
             std::string str(s, n);
             pybind11::gil_scoped_acquire acquire; // Acquire the Python Global Interpreter Lock (GIL)
-            callback_(str);
+            (*thread_log_callback)(str);
+            return n;
         }
-        return n;
+        return original_->sputn(s, n);
     }
 
     virtual int overflow(int c) {
-        if (callback_) { // Check if the callback is not null
+        if (c == traits_type::eof()) {
+            return traits_type::not_eof(c);
+        }
+        if (thread_log_callback) {
             char ch = c;
             pybind11::gil_scoped_acquire acquire; // Acquire the GIL
-            callback_(std::string(&ch, 1));
+            (*thread_log_callback)(std::string(&ch, 1));
+            return c;
+        }
+        return original_->sputc(c);
+    }
+
+    virtual int sync() {
+        if (thread_log_callback) {
+            return 0;
         }
-        return c;
+        return original_->pubsync();
     }
 
 private:
-    std::function<void(const std::string&)> callback_;
+    std::streambuf* original_;
+};
+
+static void installThreadLogStreambuf() {
+    static std::once_flag installed;
+    std::call_once(installed, []() {
+        // never deleted: std::cout may be used until the process exits
+        std::cout.rdbuf(new ThreadLogStreambuf(std::cout.rdbuf()));
+    });
+}
+
+// creates a fresh scratch directory for the input and output files of one analysis;
+// the alignment readers (including the NEXUS parser) only read from files
+static std::string makeScratchDir() {
+#if defined WIN32 || defined _WIN32 || defined __WIN32__ || defined WIN64
+    const char* tmp = getenv("TEMP");
+    std::string templ = std::string(tmp ? tmp : ".") + "\\libiqtree2_XXXXXX";
+    std::vector<char> path(templ.begin(), templ.end());
+    path.push_back(0);
+    if (_mktemp_s(path.data(), path.size()) != 0 || _mkdir(path.data()) != 0) {
+        throw std::runtime_error("Cannot create scratch directory " + templ);
+    }
+    return std::string(path.data()) + "\\";
+#else
+    const char* tmp = getenv("TMPDIR");
+    std::string templ = std::string(tmp ? tmp : "/tmp") + "/libiqtree2_XXXXXX";
+    std::vector<char> path(templ.begin(), templ.end());
+    path.push_back(0);
+    if (mkdtemp(path.data()) == nullptr) {
+        throw std::runtime_error("Cannot create scratch directory " + templ);
+    }
+    return std::string(path.data()) + "/";
+#endif
+}
+
+static void removeScratchDir(const std::string& dir) {
+    StrVector filenames;
+    getFilesInDir(dir.c_str(), filenames);
+    for (auto& filename : filenames) {
+        std::remove((dir + filename).c_str());
+    }
+#if defined WIN32 || defined _WIN32 || defined __WIN32__ || defined WIN64
+    _rmdir(dir.c_str());
+#else
+    rmdir(dir.c_str());
+#endif
+}
+
+static std::string writeScratchFile(const std::string& dir, const std::string& name, const std::string& content) {
+    std::string filename = dir + name;
+    std::ofstream out(filename.c_str());
+    out << content;
+    out.close();
+    if (!out) {
+        throw std::runtime_error("Cannot write " + filename);
+    }
+    return filename;
+}
+
+// everything bound to the calling thread for the duration of one analysis,
+// released in reverse order even if the analysis throws
+class AnalysisScope {
+public:
+    AnalysisScope(const std::function<void(const std::string)>& log_callback)
+        : params(Params::newInstance()), checkpoint(new Checkpoint) {
+        scratch_dir = makeScratchDir();
+        Params::setThreadInstance(params);
+        setThrowOnError(true);
+        if (log_callback) {
+            installThreadLogStreambuf();
+            thread_log_callback = &log_callback;
+        }
+    }
+
+    ~AnalysisScope() {
+        thread_log_callback = nullptr;
+        setThrowOnError(false);
+        if (randstream) {
+            finish_random();
+            randstream = nullptr;
+        }
+        Params::setThreadInstance(nullptr);
+        delete checkpoint;
+        delete params;
+        removeScratchDir(scratch_dir);
+    }
+
+    Params* params;
+    Checkpoint* checkpoint;
+    std::string scratch_dir;
+};
+
+// tree and alignment built by one analysis, deleted even if the analysis throws
+class AnalysisResult {
+public:
+    AnalysisResult() : tree(nullptr), aln(nullptr) {}
+
+    ~AnalysisResult() {
+        // alignment can be changed during the analysis, delete tree->aln instead
+        if (tree && tree->aln) {
+            aln = tree->aln;
+        }
+        delete tree;
+        delete aln;
+    }
+
+    IQTree* tree;
+    Alignment* aln;
 };
 
 std::string phylogenic_analysis(
-    const std::string& alignment, 
-    const std::string& partition, 
-    const std::string& model, 
+    const std::string& alignment,
+    const std::string& partition,
+    const std::string& model,
     const std::string& initial_tree,
-    std::function<void(const std::string)> log_callback) {
+    std::function<void(const std::string)> log_callback,
+    int rand_seed) {
 
-    // Redirect std::cout to the callback function only if it's not null
-    CallbackStreambuf* callback_buf = nullptr;
-    std::streambuf* old_cout_buf = nullptr;
-    if (log_callback) {
-        callback_buf = new CallbackStreambuf(log_callback);
-        old_cout_buf = std::cout.rdbuf(callback_buf);
+    if (alignment.empty()) {
+        throw std::invalid_argument("alignment must not be empty");
     }
 
-    // ... perform analysis writing out log messages to std::cout ...
-    std::cout << "sample log message\n";
+    AnalysisScope scope(log_callback);
+    Params& params = *scope.params;
 
-    // Restore the original std::cout buffer
-    if (log_callback) {
-        std::cout.rdbuf(old_cout_buf);
-        delete callback_buf;
+    // build the command line the iqtree2 binary would be given; the strings
+    // must outlive the analysis because parseArg keeps pointers into them
+    std::vector<std::string> args = {"iqtree2", "-redo", "-nt", "1"};
+    args.push_back("-s");
+    args.push_back(writeScratchFile(scope.scratch_dir, "alignment", alignment));
+    if (!partition.empty()) {
+        args.push_back("-p");
+        args.push_back(writeScratchFile(scope.scratch_dir, "partition.nex", partition));
     }
+    if (!model.empty()) {
+        args.push_back("-m");
+        args.push_back(model);
+    }
+    if (!initial_tree.empty()) {
+        args.push_back("-t");
+        args.push_back(writeScratchFile(scope.scratch_dir, "initial.treefile", initial_tree));
+    }
+    if (rand_seed != 0) {
+        args.push_back("-seed");
+        args.push_back(convertIntToString(rand_seed));
+    }
+    args.push_back("-pre");
+    args.push_back(scope.scratch_dir + "iqtree");
+
+    std::vector<char*> argv;
+    for (auto& arg : args) {
+        argv.push_back(&arg[0]);
+    }
+    argv.push_back(nullptr);
+    parseArg((int)args.size(), argv.data(), params);
+
+    // same kernel and thread setup as main(), but local to this thread
+    int instruction_set = instrset_detect();
+#if defined(BINARY32) || defined(__NOAVX__)
+    instruction_set = min(instruction_set, (int)LK_SSE42);
+#endif
+    if (instruction_set < LK_SSE2) {
+        outError("Your CPU does not support SSE2!");
+    }
+    if (instruction_set >= LK_AVX && hasFMA3() && instruction_set < LK_AVX_FMA) {
+        instruction_set = LK_AVX_FMA;
+    }
+    params.SSE = min(params.SSE, (LikelihoodKernel)instruction_set);
+#ifdef _OPENMP
+    // concurrency comes from running several analyses, one per calling thread
+    omp_set_num_threads(1);
+    params.num_threads = 1;
+#endif
+    init_random(params.ran_seed);
+
+    scope.checkpoint->setFileName((std::string)params.out_prefix + ".ckp.gz");
+
+    AnalysisResult analysis;
+    runPhyloAnalysis(params, scope.checkpoint, analysis.tree, analysis.aln);
 
-    return "Analysis results";
-}
\ No newline at end of file
+    std::ostringstream result;
+    analysis.tree->printResultTree(result);
+    return result.str();
+}
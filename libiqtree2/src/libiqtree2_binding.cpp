@@ -1,5 +1,7 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/functional.h>
+#include <pybind11/numpy.h>
+#include <pybind11/stl.h>
 #include "libiqtree2_functions.h"
 
 namespace py = pybind11;
@@ -17,13 +19,36 @@ PYBIND11_MODULE(libiqtree2, m) {
           py::arg("tree1"), py::arg("tree2"), 
           "Calculates the Robinson-Foulds distance between two trees");
 
+    m.def("calculate_RF_distances",
+          [](const std::vector<std::string>& trees1, const std::vector<std::string>& trees2) {
+              std::vector<double>* rfdist;
+              {
+                  py::gil_scoped_release release;
+                  rfdist = new std::vector<double>(calculate_RF_distances(trees1, trees2));
+              }
+              // the array takes ownership of the buffer, no copy is made
+              py::capsule owner(rfdist, [](void* p) { delete reinterpret_cast<std::vector<double>*>(p); });
+              size_t rows = trees1.size();
+              size_t cols = trees2.empty() ? trees1.size() : trees2.size();
+              return py::array_t<double>({rows, cols}, {cols * sizeof(double), sizeof(double)},
+                                         rfdist->data(), owner);
+          },
+          py::arg("trees1"),
+          py::arg("trees2") = std::vector<std::string>(),
+          "Calculates the Robinson-Foulds distances between two lists of trees, "
+          "or between all pairs of trees1 if trees2 is empty");
+
     m.def("phylogenic_analysis", &phylogenic_analysis, 
           py::arg("alignment"), 
           py::arg("partition") = "", 
           py::arg("model") = "", 
           py::arg("initial_tree") = "",
           py::arg("log_callback") = nullptr, 
-          "Performs phylogenic analysis");
+          py::arg("rand_seed") = 0,
+          py::call_guard<py::gil_scoped_release>(),
+          "Performs phylogenic analysis. The inputs are written to a temporary directory "
+          "and parsed from disk; the first call with a log_callback replaces the buffer "
+          "of std::cout for the whole process");
 
     m.def("version", &version, "Returns the version of the IQTree2");
 
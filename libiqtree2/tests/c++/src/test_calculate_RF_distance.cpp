@@ -12,3 +12,40 @@ TEST_CASE("calculate_RF_distance returns expected distance", "[calculate_RF_dist
     std::string tree2 = "(B,A);";
     REQUIRE(calculate_RF_distance(tree1, tree2) == 0); // Assuming 0 is the expected distance for identical/similar trees
 }
+
+TEST_CASE("calculate_RF_distance counts differing splits", "[calculate_RF_distance]") {
+    std::string tree1 = "((A,B),(C,D),E);";
+    std::string tree2 = "((A,C),(B,D),E);";
+    REQUIRE(calculate_RF_distance(tree1, tree1) == 0);
+    REQUIRE(calculate_RF_distance(tree1, tree2) == 4);
+}
+
+TEST_CASE("calculate_RF_distances returns all pairs of one list", "[calculate_RF_distances]") {
+    std::vector<std::string> trees = {"((A,B),(C,D),E);", "((A,C),(B,D),E);", "((B,A),(D,C),E);"};
+    auto rfdist = calculate_RF_distances(trees);
+    REQUIRE(rfdist == std::vector<double>({0, 4, 0,
+                                           4, 0, 4,
+                                           0, 4, 0}));
+}
+
+TEST_CASE("calculate_RF_distances returns distances between two lists", "[calculate_RF_distances]") {
+    std::vector<std::string> trees1 = {"((A,B),(C,D),E);", "((A,C),(B,D),E);"};
+    std::vector<std::string> trees2 = {"((A,C),(B,D),E);", "((A,B),(C,D),E);", "((A,E),(C,D),B);"};
+    auto rfdist = calculate_RF_distances(trees1, trees2);
+    REQUIRE(rfdist == std::vector<double>({4, 0, 2,
+                                           0, 4, 4}));
+}
+
+TEST_CASE("calculate_RF_distances throws for different taxon sets", "[calculate_RF_distances]") {
+    std::vector<std::string> trees1 = {"((A,B),(C,D),E);"};
+    std::vector<std::string> trees2 = {"((A,B),(C,D),F);"};
+    REQUIRE_THROWS_AS(calculate_RF_distances(trees1, trees2), std::invalid_argument);
+}
+
+TEST_CASE("calculate_RF_distances throws unless every string holds one tree", "[calculate_RF_distances]") {
+    std::vector<std::string> empty_tree = {"((A,B),(C,D),E);", ""};
+    std::vector<std::string> two_trees = {"((A,B),(C,D),E); ((A,C),(B,D),E);"};
+    REQUIRE_THROWS_AS(calculate_RF_distances(empty_tree), std::invalid_argument);
+    REQUIRE_THROWS_AS(calculate_RF_distances(two_trees), std::invalid_argument);
+    REQUIRE_THROWS_AS(calculate_RF_distances({"((A,B),(C,D),E);"}, two_trees), std::invalid_argument);
+}
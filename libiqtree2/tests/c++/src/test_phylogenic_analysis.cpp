@@ -6,11 +6,42 @@
     #include <catch2/catch_all.hpp>
 #endif
 #include "libiqtree2_functions.h"
+#include <stdexcept>
+#include <thread>
 
-TEST_CASE("phylogenic_analysis returns expected result", "[phylogenic_analysis]") {
-    std::string alignment = "example_alignment";
-    std::string partition = "example_partition";
-    std::string model = "example_model";
-    std::string initial_tree = "example_tree";
-    REQUIRE(phylogenic_analysis(alignment, partition, model, initial_tree) == "Analysis results");
+static const std::string example_alignment =
+    "5 40\n"
+    "A  ACGTACGTACGTACGTACGTACGTACGTACGTACGTACGT\n"
+    "B  ACGTACGTACGTACGTACCTACGTACGTACGAACGTACGT\n"
+    "C  ACGTTCGTACGAACGTACCTACGTACGTACGAACGTACCT\n"
+    "D  ACGTTCGTACGAACGTACCTAGGTACGTTCGAACGTACCT\n"
+    "E  TCGTTCGTACGAACGAACCTAGGTACGTTCGAACGTTCCT\n";
+
+TEST_CASE("phylogenic_analysis returns a tree with all taxa", "[phylogenic_analysis]") {
+    std::string result = phylogenic_analysis(example_alignment, "", "JC", "", nullptr, 1);
+    REQUIRE(result.find(';') != std::string::npos);
+    for (std::string taxon : {"A", "B", "C", "D", "E"}) {
+        REQUIRE(result.find(taxon) != std::string::npos);
+    }
+}
+
+TEST_CASE("phylogenic_analysis returns same result for same seed", "[phylogenic_analysis]") {
+    auto result1 = phylogenic_analysis(example_alignment, "", "JC", "", nullptr, 42);
+    auto result2 = phylogenic_analysis(example_alignment, "", "JC", "", nullptr, 42);
+    REQUIRE(result1 == result2);
+}
+
+TEST_CASE("phylogenic_analysis runs concurrently on several threads", "[phylogenic_analysis]") {
+    auto expected = phylogenic_analysis(example_alignment, "", "JC", "", nullptr, 42);
+    std::string result1, result2;
+    std::thread thread1([&]() { result1 = phylogenic_analysis(example_alignment, "", "JC", "", nullptr, 42); });
+    std::thread thread2([&]() { result2 = phylogenic_analysis(example_alignment, "", "JC", "", nullptr, 42); });
+    thread1.join();
+    thread2.join();
+    REQUIRE(result1 == expected);
+    REQUIRE(result2 == expected);
+}
+
+TEST_CASE("phylogenic_analysis throws on an invalid alignment", "[phylogenic_analysis]") {
+    REQUIRE_THROWS_AS(phylogenic_analysis("example_alignment"), std::runtime_error);
 }
@@ -2,8 +2,22 @@ import sys
 import os
 sys.path.insert(0, os.path.abspath(os.path.join(os.path.dirname(__file__), '..', '..','libs')))
 import libiqtree2 as iqtree  # Adjust the import according to your actual module name
+import numpy as np
 
 def test_calculate_RF_distance():
     tree1 = "(A,B);"
     tree2 = "(B,A);"
     assert iqtree.calculate_RF_distance(tree1, tree2) == 0  # Assuming 0 is the expected distance
+
+def test_calculate_RF_distances_all_pairs():
+    trees = ["((A,B),(C,D),E);", "((A,C),(B,D),E);", "((B,A),(D,C),E);"]
+    rfdist = iqtree.calculate_RF_distances(trees)
+    assert rfdist.shape == (3, 3)
+    np.testing.assert_array_equal(rfdist, [[0, 4, 0], [4, 0, 4], [0, 4, 0]])
+
+def test_calculate_RF_distances_two_lists():
+    trees1 = ["((A,B),(C,D),E);", "((A,C),(B,D),E);"]
+    trees2 = ["((A,C),(B,D),E);", "((A,B),(C,D),E);", "((A,E),(C,D),B);"]
+    rfdist = iqtree.calculate_RF_distances(trees1, trees2)
+    assert rfdist.shape == (2, 3)
+    np.testing.assert_array_equal(rfdist, [[4, 0, 2], [0, 4, 4]])
@@ -3,18 +3,35 @@ import os
 sys.path.insert(0, os.path.abspath(os.path.join(os.path.dirname(__file__), '..', '..','libs')))
 
 import libiqtree2 as iqtree  # Adjust the import according to your actual module name
+import pytest
+from concurrent.futures import ThreadPoolExecutor
 from unittest.mock import Mock
 
-def test_phylogenic_analysis():
-    alignment = "example_alignment"
-    partition = "example_partition"
-    model = "example_model"
-    initial_tree = "example_tree"
+example_alignment = (
+    "5 40\n"
+    "A  ACGTACGTACGTACGTACGTACGTACGTACGTACGTACGT\n"
+    "B  ACGTACGTACGTACGTACCTACGTACGTACGAACGTACGT\n"
+    "C  ACGTTCGTACGAACGTACCTACGTACGTACGAACGTACCT\n"
+    "D  ACGTTCGTACGAACGTACCTAGGTACGTTCGAACGTACCT\n"
+    "E  TCGTTCGTACGAACGAACCTAGGTACGTTCGAACGTTCCT\n"
+)
 
+def test_phylogenic_analysis():
     # create a mock object for the log callback
     mock_log_callback = Mock()
 
-    assert iqtree.phylogenic_analysis(alignment, partition, model, initial_tree,log_callback=mock_log_callback) == "Analysis results"
+    result = iqtree.phylogenic_analysis(example_alignment, model="JC", log_callback=mock_log_callback, rand_seed=1)
+    assert result.strip().endswith(";")
+    for taxon in "ABCDE":
+        assert taxon in result
     mock_log_callback.assert_called()
-    mock_log_callback.assert_any_call("sample log message\n")
-    mock_log_callback.call_count == 1
\ No newline at end of file
+
+def test_phylogenic_analysis_runs_concurrently():
+    expected = iqtree.phylogenic_analysis(example_alignment, model="JC", rand_seed=42)
+    with ThreadPoolExecutor(max_workers=4) as pool:
+        results = list(pool.map(lambda _: iqtree.phylogenic_analysis(example_alignment, model="JC", rand_seed=42), range(4)))
+    assert results == [expected] * 4
+
+def test_phylogenic_analysis_raises_on_invalid_alignment():
+    with pytest.raises(RuntimeError):
+        iqtree.phylogenic_analysis("example_alignment")
@@ -12,6 +12,14 @@ void runAliSim(Params &params, Checkpoint *checkpoint)
     MPIHelper::getInstance().barrier();
     auto start = getRealTime();
     
+    // only convert a packed binary alignment into FASTA format if the user wants to do so
+    if (params.alisim_binary_to_fasta.length() > 0)
+    {
+        if (MPIHelper::getInstance().isMaster())
+            convertBinaryAlignmentToFasta(params.alisim_binary_to_fasta, params.alisim_output_filename);
+        return;
+    }
+    
     // Init variables
     IQTree *tree;
     Alignment *aln;
@@ -459,6 +467,9 @@ void executeSimulation(Params& params, IQTree *&tree)
     AliSimulator *alisimulator;
     if (tree && params.alisim_inference_mode)
         alisimulator = new AliSimulator(&params, tree);
+    // the simulators of all threads must draw the same random numbers if simulating alignments in parallel
+    else if (params.alisim_parallel_datasets && params.num_threads != 1 && params.alisim_dataset_num > 1)
+        alisimulator = createAliSimulatorFromSetupSeed(&params);
     else
         alisimulator = new AliSimulator(&params);
     
@@ -529,7 +540,7 @@ void showParameters(Params &params, bool is_partition_model)
 /**
 *  retrieve the ancestral sequence for the root node from an input file
 */
-void retrieveAncestralSequenceFromInputFile(AliSimulator *super_alisimulator, vector<short int> &sequence)
+void retrieveAncestralSequenceFromInputFile(AliSimulator *super_alisimulator, SimStateVector &sequence)
 {
     // get variables
     char *aln_filepath = super_alisimulator->params->alisim_ancestral_sequence_aln_filepath;
@@ -714,7 +725,7 @@ void addMutations2Tree(const std::vector<std::pair<std::string, std::string>>& n
 void generateMultipleAlignmentsFromSingleTree(AliSimulator *super_alisimulator, map<string,string> input_msa)
 {
     // Load ancestral sequence from the input file if user has specified it
-    vector<short int> ancestral_sequence;
+    SimStateVector ancestral_sequence;
     if (super_alisimulator->params->alisim_ancestral_sequence_name.length() > 0)
         retrieveAncestralSequenceFromInputFile(super_alisimulator, ancestral_sequence);
     
@@ -733,6 +744,38 @@ void generateMultipleAlignmentsFromSingleTree(AliSimulator *super_alisimulator,
     if (super_alisimulator->params->num_threads != 1 && super_alisimulator->params->alisim_insertion_ratio + super_alisimulator->params->alisim_deletion_ratio > 0)
         outError("OpenMP has not yet been supported in simulations with Indels. Please use a single thread for this simulation.");
     
+    // packed binary alignments are written one file per alignment
+    if (super_alisimulator->params->aln_output_format == IN_ALIBIN)
+    {
+        if (super_alisimulator->params->alisim_insertion_ratio + super_alisimulator->params->alisim_deletion_ratio > 0)
+        {
+            outWarning("Binary output is not supported in simulations with Indels. AliSim will output alignments in PHYLIP format.");
+            Params::getInstance().aln_output_format = IN_PHYLIP;
+            super_alisimulator->params->aln_output_format = IN_PHYLIP;
+        }
+        else
+        {
+            if (super_alisimulator->params->do_compression)
+            {
+                outWarning("Compression is not supported with binary output. AliSim will output uncompressed binary alignments.");
+                Params::getInstance().do_compression = false;
+                super_alisimulator->params->do_compression = false;
+            }
+            if (super_alisimulator->params->alisim_single_output)
+            {
+                outWarning("Ignore --single-output option since it is not supported with binary output. Alignments will be outputted in separated files.");
+                Params::getInstance().alisim_single_output = false;
+                super_alisimulator->params->alisim_single_output = false;
+            }
+            if (super_alisimulator->params->alisim_write_internal_sequences)
+            {
+                outWarning("Could not write out the internal sequences with binary output. Only sequences at tips will be written to the output file.");
+                Params::getInstance().alisim_write_internal_sequences = false;
+                super_alisimulator->params->alisim_write_internal_sequences = false;
+            }
+        }
+    }
+    
     // do not support compression when outputting multiple data sets into a same file
     if (Params::getInstance().do_compression && (Params::getInstance().alisim_single_output || Params::getInstance().keep_seq_order))
     {
@@ -837,8 +880,64 @@ void generateMultipleAlignmentsFromSingleTree(AliSimulator *super_alisimulator,
         Params::getInstance().aln_output_format = IN_PHYLIP;
     }
     
+    // when simulating many small alignments with a single thread, write (and compress) each alignment in a writer thread while simulating the next one
+    // only used if alignments are written right after being simulated and are not read again (Maple conversion, deleting outputs)
+    AliSimOutputWriter *output_writer = NULL;
+    int num_output_seqs = super_alisimulator->params->alisim_write_internal_sequences ? super_alisimulator->tree->nodeNum : super_alisimulator->tree->leafNum;
+    uint64_t aln_size = ((uint64_t) num_output_seqs) * (super_alisimulator->expected_num_sites * super_alisimulator->num_sites_per_state + super_alisimulator->max_length_taxa_name + 2);
+    bool pipelined_output = super_alisimulator->params->alisim_dataset_num > 1
+        && aln_size <= MAX_PIPELINED_ALN_SIZE
+        && actual_output_format != IN_MAPLE && actual_output_format != IN_ALIBIN && !super_alisimulator->params->delete_output
+        && !super_alisimulator->tree->isSuperTree()
+        && super_alisimulator->tree->getModelFactory() && super_alisimulator->tree->getModelFactory()->getASC() == ASC_NONE
+        && super_alisimulator->params->alisim_insertion_ratio + super_alisimulator->params->alisim_deletion_ratio == 0;
+    
+    // simulate several alignments at once (one alignment per thread) instead of splitting each alignment among the threads
+    bool parallel_datasets = false;
+    if (super_alisimulator->params->alisim_parallel_datasets && super_alisimulator->params->num_threads != 1)
+    {
+        parallel_datasets = pipelined_output && !super_alisimulator->params->alisim_inference_mode && !super_alisimulator->params->include_pre_mutations;
+        if (!parallel_datasets)
+            outWarning("Ignore --parallel-datasets option since it is only supported when simulating multiple alignments (each smaller than " + convertIntToString(MAX_PIPELINED_ALN_SIZE / (1024 * 1024)) + " MB) without an input alignment, Partitions, +ASC models, Indels, predefined mutations, binary or Maple output. Each alignment will be simulated with " + convertIntToString(super_alisimulator->params->num_threads) + " threads.");
+    }
+    
+    // write all alignments into a single archive file with an index
+    string archive_filepath = "";
+    if (super_alisimulator->params->alisim_archive)
+    {
+        if (pipelined_output && (super_alisimulator->params->num_threads == 1 || parallel_datasets) && MPIHelper::getInstance().getNumProcesses() == 1)
+        {
+            archive_filepath = getOutputNameWithExt(super_alisimulator->params->aln_output_format, super_alisimulator->params->alisim_output_filename);
+            if (super_alisimulator->params->alisim_single_output)
+            {
+                outWarning("Ignore --single-output option since all alignments are written into the archive " + archive_filepath);
+                super_alisimulator->params->alisim_single_output = false;
+            }
+        }
+        else
+            outWarning("Ignore --aln-archive option since it is only supported when simulating multiple alignments (each smaller than " + convertIntToString(MAX_PIPELINED_ALN_SIZE / (1024 * 1024)) + " MB) with a single thread or --parallel-datasets, without MPI, Partitions, +ASC models, Indels, binary or Maple output. Alignments will be outputted in separated files.");
+    }
+    
+    if (pipelined_output && (super_alisimulator->params->num_threads == 1 || parallel_datasets))
+    {
+        output_writer = new AliSimOutputWriter(super_alisimulator->params->do_compression, archive_filepath);
+        super_alisimulator->output_writer = output_writer;
+    }
+    
+    // share transition matrices across branches, threads, and alignments of the same tree
+    TransMatrixCache *trans_matrix_cache = NULL;
+    if (!super_alisimulator->tree->isSuperTree())
+    {
+        trans_matrix_cache = new TransMatrixCache(super_alisimulator->max_num_states);
+        super_alisimulator->trans_matrix_cache = trans_matrix_cache;
+    }
+    
+    // simulate alignments in parallel, each thread with its own simulator
+    if (parallel_datasets)
+        generateAlignmentsInParallel(super_alisimulator, ancestral_sequence, input_msa);
+    
     // iteratively generate multiple datasets for each tree
-    for (int i = 0; i < super_alisimulator->params->alisim_dataset_num; i++)
+    for (int i = 0; i < super_alisimulator->params->alisim_dataset_num && !parallel_datasets; i++)
     {
         // parallelize over MPI ranks statically
         int proc_ID = MPIHelper::getInstance().getProcessID();
@@ -855,6 +954,9 @@ void generateMultipleAlignmentsFromSingleTree(AliSimulator *super_alisimulator,
         // record the alignment_id to generate different random seed when simulating different alignment
         super_alisimulator->params->alignment_id = i;
         
+        // whether packed binary sequences are written while simulating them
+        bool stream_binary_output = false;
+        
         // output the simulated aln at the current execution localtion
         string output_filepath = super_alisimulator->params->alisim_output_filename;
         
@@ -918,7 +1020,7 @@ void generateMultipleAlignmentsFromSingleTree(AliSimulator *super_alisimulator,
                 extractSiteID(current_tree->aln, info_spec, site_ids, false, total_expected_num_states);
 
                 // extract the ancestral sequence for the current partition from the full ancestral_sequence
-                vector<short int> ancestral_sequence_current_tree;
+                SimStateVector ancestral_sequence_current_tree;
                 if (ancestral_sequence.size() > 0)
                 {
                     ASSERT(site_ids.size() == expected_num_states_current_tree);
@@ -954,8 +1056,12 @@ void generateMultipleAlignmentsFromSingleTree(AliSimulator *super_alisimulator,
                 aln_names.push_back(output_filepath);
             }
             
+            // packed binary sequences could be written while simulating them (but not with FunDi)
+            stream_binary_output = super_alisimulator->params->aln_output_format == IN_ALIBIN && super_alisimulator->params->alisim_fundi_taxon_set.size() == 0;
+            
             // check whether we could write the output to file immediately after simulating it
-            if (super_alisimulator->tree->getModelFactory() && super_alisimulator->tree->getModelFactory()->getASC() == ASC_NONE && super_alisimulator->params->alisim_insertion_ratio + super_alisimulator->params->alisim_deletion_ratio == 0)
+            if (super_alisimulator->tree->getModelFactory() && super_alisimulator->tree->getModelFactory()->getASC() == ASC_NONE && super_alisimulator->params->alisim_insertion_ratio + super_alisimulator->params->alisim_deletion_ratio == 0
+                && (super_alisimulator->params->aln_output_format != IN_ALIBIN || stream_binary_output))
                 generatePartitionAlignmentFromSingleSimulator(super_alisimulator, ancestral_sequence, input_msa, site_locked_vec, output_filepath, open_mode);
             // otherwise, writing output to file after completing the simulation
             else
@@ -965,7 +1071,8 @@ void generateMultipleAlignmentsFromSingleTree(AliSimulator *super_alisimulator,
         // merge & write alignments to files if they have not yet been written
         if ((super_alisimulator->tree->getModelFactory() && super_alisimulator->tree->getModelFactory()->getASC() != ASC_NONE)
             || super_alisimulator->tree->isSuperTree()
-            || super_alisimulator->params->alisim_insertion_ratio + super_alisimulator->params->alisim_deletion_ratio > 0)
+            || super_alisimulator->params->alisim_insertion_ratio + super_alisimulator->params->alisim_deletion_ratio > 0
+            || (super_alisimulator->params->aln_output_format == IN_ALIBIN && !stream_binary_output))
             mergeAndWriteSequencesToFiles(output_filepath, super_alisimulator, seqtypes, aln_names, open_mode);
         
         // only report model params when simulating the first MSA
@@ -1026,6 +1133,26 @@ void generateMultipleAlignmentsFromSingleTree(AliSimulator *super_alisimulator,
         }
     }
     
+    // wait for the writer thread to write all remaining alignments, then report write errors (if any)
+    if (output_writer)
+    {
+        super_alisimulator->output_writer = NULL;
+        std::unique_ptr<AliSimOutputWriter> writer(output_writer);
+        writer->close();
+        
+        if (archive_filepath.length())
+            cout << "All alignments have been exported to " << archive_filepath << " (offset and size of each alignment listed in " << archive_filepath << ".idx)" << endl;
+    }
+    
+    // report the usage of the transition matrix cache
+    if (trans_matrix_cache)
+    {
+        if (verbose_mode >= VB_MED)
+            cout << "Transition matrix cache: " << trans_matrix_cache->num_hits << " hits, " << trans_matrix_cache->num_misses << " misses" << endl;
+        delete trans_matrix_cache;
+        super_alisimulator->trans_matrix_cache = NULL;
+    }
+    
     // output full tree (with internal node names) if outputting internal sequences
     if (super_alisimulator->params->alisim_write_internal_sequences)
         outputTreeWithInternalNames(super_alisimulator);
@@ -1035,6 +1162,140 @@ void generateMultipleAlignmentsFromSingleTree(AliSimulator *super_alisimulator,
         delete site_locked_vec;
 }
 
+AliSimulator* createAliSimulatorFromSetupSeed(Params *params)
+{
+    // use a dedicated random stream, which is not used to simulate any alignment
+    int *saved_randstream = randstream;
+    init_random(params->ran_seed + MPIHelper::getInstance().getProcessID() * 1000 + params->alisim_dataset_num);
+    
+    AliSimulator *alisimulator = new AliSimulator(params);
+    
+    // restore randstream
+    finish_random();
+    randstream = saved_randstream;
+    
+    return alisimulator;
+}
+
+/**
+*  silence cout while in scope, its state is restored even if an exception is thrown
+*/
+class SilentCout {
+public:
+    SilentCout() : saved_state(cout.rdstate()) { cout.setstate(ios::failbit); }
+    ~SilentCout() { cout.clear(saved_state); }
+private:
+    ios::iostate saved_state;
+};
+
+void generateAlignmentsInParallel(AliSimulator *super_alisimulator, SimStateVector &ancestral_sequence, map<string,string> &input_msa)
+{
+    Params *params = super_alisimulator->params;
+    int proc_ID = MPIHelper::getInstance().getProcessID();
+    int nprocs  = MPIHelper::getInstance().getNumProcesses();
+    // alignments of this MPI process: proc_ID, proc_ID + nprocs, ...
+    int num_alignments = (params->alisim_dataset_num - proc_ID + nprocs - 1) / nprocs;
+    int num_threads = min(params->num_threads, num_alignments);
+    
+    // create the simulators one by one as they read the input files, each with its own Params (returned by Params::getInstance() in its thread) and its own cache of transition matrices
+    Params *saved_params = Params::hasThreadInstance() ? &Params::getInstance() : NULL;
+    vector<AliSimulator*> alisimulators(num_threads);
+    {
+        // warnings were already shown when creating super_alisimulator
+        SilentCout silent_cout;
+        for (int thread_id = 0; thread_id < num_threads; thread_id++)
+        {
+            Params *thread_params = new Params(*params);
+            thread_params->num_threads = 1;
+            Params::setThreadInstance(thread_params);
+            alisimulators[thread_id] = createAliSimulatorFromSetupSeed(thread_params);
+            alisimulators[thread_id]->output_writer = super_alisimulator->output_writer;
+            alisimulators[thread_id]->trans_matrix_cache = new TransMatrixCache(alisimulators[thread_id]->max_num_states);
+        }
+    }
+    Params::setThreadInstance(saved_params);
+    
+    #ifdef _OPENMP
+    #pragma omp parallel num_threads(num_threads)
+    #endif
+    {
+        int thread_id = 0;
+        #ifdef _OPENMP
+        thread_id = omp_get_thread_num();
+        #endif
+        AliSimulator *alisimulator = alisimulators[thread_id];
+        Params *thread_saved_params = Params::hasThreadInstance() ? &Params::getInstance() : NULL;
+        Params::setThreadInstance(alisimulator->params);
+        
+        // keep the output of the current alignment until the previous alignments have been passed to the writer
+        vector<AliSimOutputWriter::OutputJob> outputs;
+        alisimulator->deferred_outputs = &outputs;
+        
+        #ifdef _OPENMP
+        #pragma omp for schedule(dynamic) ordered
+        #endif
+        for (int k = 0; k < num_alignments; k++)
+        {
+            int i = k * nprocs + proc_ID;
+            alisimulator->params->alignment_id = i;
+            
+            // random numbers drawn outside the simulation of sequence chunks (e.g., the root sequence, random state frequencies) only depend on the alignment id
+            int *saved_randstream = randstream;
+            init_random(params->ran_seed + proc_ID * 1000 + params->alisim_dataset_num + 1 + i);
+            
+            string output_filepath = params->alisim_output_filename;
+            if (!params->alisim_single_output)
+                output_filepath = output_filepath + "_" + convertIntToString(i + 1);
+            std::ios_base::openmode open_mode = std::ios_base::out;
+            if (i > 0 && params->alisim_single_output)
+                open_mode = std::ios_base::in|std::ios_base::out|std::ios_base::ate;
+            
+            SimStateVector alignment_ancestral_sequence = ancestral_sequence;
+            generatePartitionAlignmentFromSingleSimulator(alisimulator, alignment_ancestral_sequence, input_msa, NULL, output_filepath, open_mode);
+            
+            // restore randstream
+            finish_random();
+            randstream = saved_randstream;
+            
+            #ifdef _OPENMP
+            #pragma omp ordered
+            #endif
+            {
+                // only report model params when simulating the first MSA
+                if (i == 0)
+                {
+                    reportSubstitutionProcess(cout, *(alisimulator->params), *(alisimulator->tree));
+                    if (alisimulator->tree->aln->seq_type == SEQ_CODON)
+                        alisimulator->tree->getModel()->writeInfo(cout);
+                }
+                
+                for (AliSimOutputWriter::OutputJob &job : outputs)
+                    alisimulator->output_writer->submit(job.output_filepath, job.open_mode, job.content);
+                outputs.clear();
+            }
+        }
+        
+        alisimulator->deferred_outputs = NULL;
+        Params::setThreadInstance(thread_saved_params);
+    }
+    
+    // delete the simulators, adding the usage of their caches to that of super_alisimulator
+    for (AliSimulator *alisimulator : alisimulators)
+    {
+        if (super_alisimulator->trans_matrix_cache)
+        {
+            super_alisimulator->trans_matrix_cache->num_hits += alisimulator->trans_matrix_cache->num_hits;
+            super_alisimulator->trans_matrix_cache->num_misses += alisimulator->trans_matrix_cache->num_misses;
+        }
+        delete alisimulator->trans_matrix_cache;
+        Params *thread_params = alisimulator->params;
+        if (alisimulator->tree) delete alisimulator->tree;
+        if (alisimulator->first_insertion) delete alisimulator->first_insertion;
+        delete alisimulator;
+        delete thread_params;
+    }
+}
+
 /**
     copy sequences of leaves from a partition tree to super_tree
 */
@@ -1073,7 +1334,7 @@ void copySequencesToSuperTree(IntVector &site_ids, int expected_num_states_super
 /**
 *  generate a partition alignment from a single simulator
 */
-void generatePartitionAlignmentFromSingleSimulator(AliSimulator *&alisimulator, vector<short int> &ancestral_sequence, map<string,string> input_msa, std::vector<bool>* const site_locked_vec, string output_filepath, std::ios_base::openmode open_mode)
+void generatePartitionAlignmentFromSingleSimulator(AliSimulator *&alisimulator, SimStateVector &ancestral_sequence, map<string,string> input_msa, std::vector<bool>* const site_locked_vec, string output_filepath, std::ios_base::openmode open_mode)
 {
     // show an error if continuous gamma is used in inference mode.
     if (alisimulator->params->alisim_inference_mode && alisimulator->tree->getModelFactory() && alisimulator->tree->getModelFactory()->is_continuous_gamma)
@@ -1144,6 +1405,13 @@ void generatePartitionAlignmentFromSingleSimulator(AliSimulator *&alisimulator,
 */
 void writeSequencesToFile(string file_path, Alignment *aln, int sequence_length, int num_leaves, AliSimulator *alisimulator, std::ios_base::openmode open_mode)
 {
+    // write a packed binary alignment
+    if (alisimulator->params->aln_output_format == IN_ALIBIN)
+    {
+        writeSequencesToBinaryFile(file_path, aln, sequence_length, alisimulator);
+        return;
+    }
+    
     try {
             // init output_stream for Indels to output aln without gaps
             ostream *out_indels = NULL;
@@ -1246,6 +1514,180 @@ void writeSequencesToFile(string file_path, Alignment *aln, int sequence_length,
         }
 }
 
+/**
+*  read an unsigned integer in little-endian byte order
+*/
+static uint64_t readLittleEndian(istream &in, int num_bytes)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < num_bytes; i++)
+        value |= ((uint64_t) (unsigned char) in.get()) << (8 * i);
+    return value;
+}
+
+/**
+*  write all sequences of a tree to a packed binary alignment (-af bin)
+*/
+void writeSequencesToBinaryFile(string file_path, Alignment *aln, int sequence_length, AliSimulator *alisimulator)
+{
+    file_path = getOutputNameWithExt(IN_ALIBIN, file_path);
+    int num_sites_per_state = aln->seq_type == SEQ_CODON ? 3 : 1;
+    int num_states = aln->num_states;
+    
+    // collect the output sequences in the same order as text outputs
+    vector<Node*> nodes;
+    AliSimBinaryWriter::collectOutputNodes(nodes, alisimulator->tree->root, alisimulator->tree->root);
+    int num_seqs = nodes.size();
+    
+    // only reserve a code for gaps if any sequence contains a gap (e.g., missing taxa in partitions)
+    bool has_gaps = false;
+    #ifdef _OPENMP
+    #pragma omp parallel for reduction(||:has_gaps) schedule(static)
+    #endif
+    for (int i = 0; i < num_seqs; i++)
+    {
+        vector<SimStateVector> &sequence_chunks = nodes[i]->sequence->sequence_chunks;
+        if (sequence_chunks.empty() || sequence_chunks[0].size() < sequence_length)
+        {
+            has_gaps = true;
+            continue;
+        }
+        for (int j = 0; j < sequence_length && !has_gaps; j++)
+            if (sequence_chunks[0][j] < 0 || sequence_chunks[0][j] >= num_states)
+                has_gaps = true;
+    }
+    
+    vector<string> seq_names(num_seqs);
+    for (int i = 0; i < num_seqs; i++)
+    {
+        seq_names[i] = nodes[i]->name;
+        // write node's id if node's name is empty
+        if (seq_names[i].length() == 0)
+            seq_names[i] = convertIntToString(nodes[i]->id);
+    }
+    
+    // initialize state_mapping (mapping from state to characters)
+    vector<string> state_mapping;
+    AliSimulator::initializeStateMapping(num_sites_per_state, aln, state_mapping);
+    
+    // write the header, the alphabet, and the sequence names
+    AliSimBinaryWriter binary_writer(file_path, aln, state_mapping, seq_names, sequence_length, has_gaps);
+    
+    // pack and write sequences in parallel, each at its precomputed offset
+    bool write_failed = false;
+    #ifdef _OPENMP
+    #pragma omp parallel
+    #endif
+    {
+        ofstream out(file_path.c_str(), ios::in | ios::out | ios::binary);
+        string packed_seq;
+        #ifdef _OPENMP
+        #pragma omp for schedule(static)
+        #endif
+        for (int i = 0; i < num_seqs; i++)
+        {
+            vector<SimStateVector> &sequence_chunks = nodes[i]->sequence->sequence_chunks;
+            SimStateVector no_states;
+            binary_writer.packStates(sequence_chunks.empty() ? no_states : sequence_chunks[0], sequence_length, packed_seq);
+            out.seekp(binary_writer.getPosition(i, 0));
+            out.write(packed_seq.data(), packed_seq.size());
+        }
+        out.close();
+        if (out.fail())
+        {
+            #ifdef _OPENMP
+            #pragma omp critical
+            #endif
+            write_failed = true;
+        }
+    }
+    if (write_failed)
+        outError(ERR_WRITE_OUTPUT, file_path);
+    
+    // show the output file name
+    if (!(MPIHelper::getInstance().getNumProcesses() > 1 && alisimulator->params->alisim_dataset_num > 1))
+        cout << "An alignment has just been exported to " << file_path << endl;
+}
+
+/**
+*  convert a packed binary alignment into FASTA format
+*/
+void convertBinaryAlignmentToFasta(string bin_filepath, string output_filepath)
+{
+    output_filepath = getOutputNameWithExt(IN_FASTA, output_filepath);
+    ifstream in;
+    ofstream out;
+    try {
+        in.exceptions(ios::failbit | ios::badbit);
+        in.open(bin_filepath.c_str(), ios::in | ios::binary);
+    
+        // read the header
+        char magic[8];
+        in.read(magic, 8);
+        if (memcmp(magic, ALIBIN_MAGIC, 8) != 0)
+            outError(bin_filepath + " is not a binary alignment outputted by AliSim (-af bin)");
+        readLittleEndian(in, 4); // seq_type
+        int num_sites_per_state = readLittleEndian(in, 4);
+        int num_codes = readLittleEndian(in, 4);
+        int bits_per_state = readLittleEndian(in, 4);
+        int num_seqs = readLittleEndian(in, 4);
+        readLittleEndian(in, 4); // reserved
+        uint64_t sequence_length = readLittleEndian(in, 8);
+        uint64_t bytes_per_seq = readLittleEndian(in, 8);
+        uint64_t data_offset = readLittleEndian(in, 8);
+        if (bits_per_state < 1 || bits_per_state > 8 || num_codes > (1 << bits_per_state)
+            || (num_sites_per_state != 1 && num_sites_per_state != 3)
+            || bytes_per_seq != (sequence_length * bits_per_state + 7) / 8)
+            outError(bin_filepath + " has an invalid header");
+    
+        // read the alphabet and the sequence names
+        vector<string> code_strs(num_codes, string(num_sites_per_state, '-'));
+        for (int code = 0; code < num_codes; code++)
+            in.read(&code_strs[code][0], num_sites_per_state);
+        vector<string> seq_names(num_seqs);
+        for (int i = 0; i < num_seqs; i++)
+        {
+            seq_names[i].resize(readLittleEndian(in, 4));
+            in.read(&seq_names[i][0], seq_names[i].length());
+        }
+    
+        // unpack and write sequences one by one
+        out.exceptions(ios::failbit | ios::badbit);
+        out.open(output_filepath.c_str());
+        in.seekg(data_offset);
+        vector<unsigned char> packed_seq(bytes_per_seq);
+        string output(sequence_length * num_sites_per_state, '-');
+        unsigned int mask = (1 << bits_per_state) - 1;
+        for (int i = 0; i < num_seqs; i++)
+        {
+            in.read((char*) packed_seq.data(), bytes_per_seq);
+            uint64_t bit_pos = 0;
+            for (uint64_t j = 0; j < sequence_length; j++, bit_pos += bits_per_state)
+            {
+                int shift = bit_pos & 7;
+                uint64_t byte_index = bit_pos >> 3;
+                unsigned int code = packed_seq[byte_index] >> shift;
+                if (shift + bits_per_state > 8)
+                    code |= packed_seq[byte_index + 1] << (8 - shift);
+                code &= mask;
+                if (code >= num_codes)
+                    outError(bin_filepath + " contains an invalid state");
+                for (int k = 0; k < num_sites_per_state; k++)
+                    output[j * num_sites_per_state + k] = code_strs[code][k];
+            }
+            out << ">" << seq_names[i] << "\n" << output << "\n";
+        }
+        out.close();
+        in.close();
+    } catch (ios::failure) {
+        if (out.is_open())
+            outError(ERR_WRITE_OUTPUT, output_filepath);
+        outError(ERR_READ_INPUT, bin_filepath);
+    }
+    
+    cout << "The binary alignment has been converted into FASTA format: " << output_filepath << endl;
+}
+
 /**
 *  merge and write all sequences to output files
 */
@@ -1493,9 +1935,10 @@ map<string,string> loadInputMSA(AliSimulator *alisimulator)
     if (alisimulator->params->alisim_inference_mode &&
         ((alisimulator->tree->getModelFactory() && alisimulator->tree->getModelFactory()->getASC() != ASC_NONE)
         || alisimulator->tree->isSuperTree()
-        || alisimulator->params->alisim_insertion_ratio + alisimulator->params->alisim_deletion_ratio > 0))
+        || alisimulator->params->alisim_insertion_ratio + alisimulator->params->alisim_deletion_ratio > 0
+        || alisimulator->params->aln_output_format == IN_ALIBIN))
     {
-        outWarning("AliSim will not copy gaps from the input alignment into the output alignments in simulations with Indels/Partitions/+ASC models.");
+        outWarning("AliSim will not copy gaps from the input alignment into the output alignments in simulations with Indels/Partitions/+ASC models or binary output.");
         return input_msa;
     }
     
@@ -1645,11 +2088,14 @@ void writeSeqsFromTmpDataAndGenomeTreesIndels(AliSimulator* alisimulator, int se
         int seq_length_ori = convert_int(line.substr(index_of_first_at + 1, index_of_second_at - index_of_first_at - 1).c_str());
         
         // extract original sequences
-        vector<short int> seq_ori(seq_length_ori, 0);
+        SimStateVector seq_ori(seq_length_ori, 0);
         string internal_states = line.substr(index_of_second_at + 1, line.length() - index_of_second_at - 1);
         istringstream seq_in(internal_states);
-        for (int i = 0; i < seq_length_ori; i++)
-            seq_in >> seq_ori[i];
+        for (int i = 0, state; i < seq_length_ori; i++)
+        {
+            seq_in >> state;
+            seq_ori[i] = state;
+        }
         
         // initialize the output sequence with all gaps (to handle the cases with missing taxa in partitions)
         string pre_output = AliSimulator::exportPreOutputString(node, output_format, max_length_taxa_name);
@@ -19,6 +19,9 @@
 #include <string.h>
 #include "phyloanalysis.h"
 
+// max size (in bytes) of an alignment to be written by a writer thread while simulating the next alignment
+#define MAX_PIPELINED_ALN_SIZE (64 * 1024 * 1024)
+
 /**
 *  execute Alignment Simulator (AliSim)
 */
@@ -62,7 +65,7 @@ void showParameters(Params &params, bool is_partition_model);
 /**
 *  retrieve the ancestral sequence for the root node from an input file
 */
-void retrieveAncestralSequenceFromInputFile(AliSimulator *super_alisimulator, vector<short int> &sequence);
+void retrieveAncestralSequenceFromInputFile(AliSimulator *super_alisimulator, SimStateVector &sequence);
 
 /**
 *  get a vector of site statuses denote whether a site is locked (by predefined mutations) or not
@@ -74,10 +77,22 @@ void getLockedSites(Node* const node, Node* const dad, std::vector<bool>* const
 */
 void generateMultipleAlignmentsFromSingleTree(AliSimulator *super_alisimulator, map<string,string> input_msa);
 
+/**
+*  create an AliSimulator from the input tree and model, drawing its random numbers (e.g., random branch lengths, model parameters) from a stream seeded by the user seed,
+*  so that identical simulators could be created again for the threads simulating alignments in parallel
+*/
+AliSimulator* createAliSimulatorFromSetupSeed(Params *params);
+
+/**
+*  generate mutiple alignments at once, each thread simulates one alignment at a time with its own simulator.
+*  The random numbers of an alignment only depend on its id, thus the alignments do not depend on the number of threads
+*/
+void generateAlignmentsInParallel(AliSimulator *super_alisimulator, SimStateVector &ancestral_sequence, map<string,string> &input_msa);
+
 /**
 *  generate a partition alignment from a single simulator
 */
-void generatePartitionAlignmentFromSingleSimulator(AliSimulator *&alisimulator, vector<short int> &ancestral_sequence, map<string,string> input_msa, std::vector<bool>* const site_locked_vec, string output_filepath = "", std::ios_base::openmode open_mode = std::ios_base::out);
+void generatePartitionAlignmentFromSingleSimulator(AliSimulator *&alisimulator, SimStateVector &ancestral_sequence, map<string,string> input_msa, std::vector<bool>* const site_locked_vec, string output_filepath = "", std::ios_base::openmode open_mode = std::ios_base::out);
 
 /**
 *  compute the total sequence length of all partitions
@@ -94,6 +109,16 @@ void copySequencesToSuperTree(IntVector &site_ids, int expected_num_states_super
 */
 void writeSequencesToFile(string file_path, Alignment *aln, int sequence_length, int num_leaves, AliSimulator *alisimulator);
 
+/**
+*  write all sequences of a tree to a packed binary alignment (-af bin)
+*/
+void writeSequencesToBinaryFile(string file_path, Alignment *aln, int sequence_length, AliSimulator *alisimulator);
+
+/**
+*  convert a packed binary alignment into FASTA format
+*/
+void convertBinaryAlignmentToFasta(string bin_filepath, string output_filepath);
+
 /**
 *  write a sequence of a node to an output file
 */
@@ -45,6 +45,7 @@
 #include "pda/splitgraph.h"
 #include "pda/circularnetwork.h"
 #include "tree/mtreeset.h"
+#include "tree/splitarena.h"
 #include "tree/mexttree.h"
 #include "ncl/ncl.h"
 #include "nclextra/msetsblock.h"
@@ -1240,22 +1241,55 @@ void calcDistribution(Params &params) {
     }
 }
 
-void printRFDist(string filename, double *rfdist, int n, int m, int rf_dist_mode, bool print_msg = true) {
+/**
+    print the header of a Robinson-Foulds distance file
+*/
+void printRFDistHeader(ostream &out, string filename, int n, int rf_dist_mode) {
+    if (Params::getInstance().output_format == FORMAT_CSV) {
+        out << "# Robinson-Foulds distances" << endl
+        << "# This file can be read in MS Excel or in R with command:" << endl
+        << "#    dat=read.csv('" <<  filename << "',comment.char='#')" << endl
+        << "# Columns are comma-separated with following meanings:" << endl
+        << "#    ID1:     Tree 1 ID" << endl
+        << "#    ID2:     Tree 2 ID" << endl
+        << "#    Dist:    Robinson-Foulds distance" << endl
+        << "ID1,ID2,Dist" << endl;
+    } else if (rf_dist_mode == RF_ADJACENT_PAIR || Params::getInstance().rf_same_pair) {
+        out << "XXX        ";
+        out << 1 << " " << n << endl;
+    }
+}
+
+/**
+    print rows row_start..row_end-1 of a full Robinson-Foulds distance matrix
+    @param rfdist the rows to print, (row_end-row_start) x m
+*/
+void printRFDistRows(ostream &out, double *rfdist, int row_start, int row_end, int m) {
     int i, j;
+    if (Params::getInstance().output_format == FORMAT_CSV) {
+        for (i = row_start; i < row_end; i++)  {
+            for (j = 0; j < m; j++)
+                out << i+1 << ',' << j+1 << ',' << rfdist[(size_t)(i-row_start)*m+j] << endl;
+        }
+    } else {
+        for (i = row_start; i < row_end; i++)  {
+            out << "Tree" << i << "      ";
+            for (j = 0; j < m; j++)
+                out << " " << rfdist[(size_t)(i-row_start)*m+j];
+            out << endl;
+        }
+    }
+}
+
+void printRFDist(string filename, double *rfdist, int n, int m, int rf_dist_mode, bool print_msg = true) {
+    int i;
 
     try {
         ofstream out;
         out.exceptions(ios::failbit | ios::badbit);
         out.open(filename);
+        printRFDistHeader(out, filename, n, rf_dist_mode);
         if (Params::getInstance().output_format == FORMAT_CSV) {
-            out << "# Robinson-Foulds distances" << endl
-            << "# This file can be read in MS Excel or in R with command:" << endl
-            << "#    dat=read.csv('" <<  filename << "',comment.char='#')" << endl
-            << "# Columns are comma-separated with following meanings:" << endl
-            << "#    ID1:     Tree 1 ID" << endl
-            << "#    ID2:     Tree 2 ID" << endl
-            << "#    Dist:    Robinson-Foulds distance" << endl
-            << "ID1,ID2,Dist" << endl;
             if (rf_dist_mode == RF_ADJACENT_PAIR) {
                 for (i = 0; i < n; i++)
                     out << i+1 << ',' << i+2 << ',' << rfdist[i] << endl;
@@ -1263,26 +1297,16 @@ void printRFDist(string filename, double *rfdist, int n, int m, int rf_dist_mode
                 for (i = 0; i < n; i++)
                     out << i+1 << ',' << i+1 << ',' << rfdist[i] << endl;
             } else {
-                for (i = 0; i < n; i++)  {
-                    for (j = 0; j < m; j++)
-                        out << i+1 << ',' << j+1 << ',' << rfdist[i*m+j] << endl;
-                }
+                printRFDistRows(out, rfdist, 0, n, m);
             }
         } else if (rf_dist_mode == RF_ADJACENT_PAIR || Params::getInstance().rf_same_pair) {
-            out << "XXX        ";
-            out << 1 << " " << n << endl;
             for (i = 0; i < n; i++)
                 out << " " << rfdist[i];
             out << endl;
         } else {
             // all pairs
             out << n << " " << m << endl;
-            for (i = 0; i < n; i++)  {
-                out << "Tree" << i << "      ";
-                for (j = 0; j < m; j++)
-                    out << " " << rfdist[i*m+j];
-                out << endl;
-            }
+            printRFDistRows(out, rfdist, 0, n, m);
         }
         out.close();
         if (print_msg)
@@ -1292,6 +1316,52 @@ void printRFDist(string filename, double *rfdist, int n, int m, int rf_dist_mode
     }
 }
 
+/** maximal number of Robinson-Foulds distances kept in memory by computeRFDistBlocks */
+const size_t RF_MAX_BLOCK_SIZE = 1 << 25;
+
+/**
+    compute the Robinson-Foulds distances between all pairs of trees, or between two
+    tree sets, with the bit-packed SplitArena and print the matrix to filename
+    block of rows by block of rows, so that the whole matrix is never in memory
+    @param treeset2 second tree set, NULL for all pairs of trees
+*/
+void computeRFDistBlocks(Params &params, MTreeSet &trees, MTreeSet *treeset2, string filename) {
+    cout << "Computing Robinson-Foulds distance..." << endl;
+    double start_time = getRealTime();
+    SplitArena arena(trees, treeset2 ? -1000 : params.split_weight_threshold);
+    SplitArena *arena2 = &arena;
+    if (treeset2)
+        arena2 = new SplitArena(*treeset2, -1000, trees.front());
+    bool normalize = treeset2 && params.normalize_tree_dist;
+    int n = arena.getNTrees(), m = arena2->getNTrees();
+    int block_rows = max((size_t)1, min((size_t)n, RF_MAX_BLOCK_SIZE / m));
+    double *rfdist = new double[(size_t)block_rows * m];
+
+    try {
+        ofstream out;
+        out.exceptions(ios::failbit | ios::badbit);
+        out.open(filename);
+        printRFDistHeader(out, filename, n, params.rf_dist_mode);
+        if (params.output_format != FORMAT_CSV)
+            out << n << " " << m << endl;
+        for (int row = 0; row < n; row += block_rows) {
+            int row_end = min(row + block_rows, n);
+            arena.computeRFDistBlock(row, row_end, *arena2, rfdist, normalize);
+            printRFDistRows(out, rfdist, row, row_end, m);
+        }
+        out.close();
+        cout << "Robinson-Foulds distances printed to " << filename << endl;
+    } catch (ios::failure) {
+        outError(ERR_WRITE_OUTPUT, filename);
+    }
+    if (verbose_mode >= VB_MED)
+        cout << "RF computation took " << getRealTime() - start_time << " seconds" << endl;
+
+    delete [] rfdist;
+    if (arena2 != &arena)
+        delete arena2;
+}
+
 void computeRFDistExtended(const char *trees1, const char *trees2, const char *filename) {
     cout << "Reading input trees 1 file " << trees1 << endl;
     int ntrees = 0, ntrees2 = 0;
@@ -1403,6 +1473,19 @@ void computeRFDist(Params &params) {
     }
 
     MTreeSet trees(params.user_file, params.is_rooted, params.tree_burnin, params.tree_max_count);
+
+    // the full matrix without detailed split output is computed block-wise
+    if (params.rf_dist_mode == RF_ALL_PAIR && trees.size() >= 2) {
+        computeRFDistBlocks(params, trees, NULL, filename);
+        return;
+    }
+    if (params.rf_dist_mode == RF_TWO_TREE_SETS && verbose_mode < VB_MED) {
+        MTreeSet treeset2(params.second_tree, params.is_rooted, params.tree_burnin, params.tree_max_count);
+        cout << "Computing Robinson-Foulds distances between two sets of trees" << endl;
+        computeRFDistBlocks(params, trees, &treeset2, filename);
+        return;
+    }
+
     int n = trees.size(), m = trees.size();
     double *rfdist;
     double *incomp_splits = NULL;
@@ -1714,11 +1797,11 @@ outstreambuf* outstreambuf::close() {
 }
 
 int outstreambuf::overflow( int c) { // used for output buffer only
-    if ((verbose_mode >= VB_MIN && MPIHelper::getInstance().isMaster()) || verbose_mode >= VB_MED)
+    if ((verbose_mode >= VB_MIN && MPIHelper::getInstance().isOutputProcess()) || verbose_mode >= VB_MED)
         if (cout_buf->sputc(c) == EOF) return EOF;
     if (Params::getInstance().suppress_output_flags & OUT_LOG)
         return c;
-    if (!MPIHelper::getInstance().isMaster())
+    if (!MPIHelper::getInstance().isOutputProcess())
         return c;
     if (fout_buf->sputc(c) == EOF) return EOF;
     return c;
@@ -1727,9 +1810,9 @@ int outstreambuf::overflow( int c) { // used for output buffer only
 
 
 int outstreambuf::sync() { // used for output buffer only
-    if ((verbose_mode >= VB_MIN && MPIHelper::getInstance().isMaster()) || verbose_mode >= VB_MED)
+    if ((verbose_mode >= VB_MIN && MPIHelper::getInstance().isOutputProcess()) || verbose_mode >= VB_MED)
         cout_buf->pubsync();
-    if ((Params::getInstance().suppress_output_flags & OUT_LOG) || !MPIHelper::getInstance().isMaster())
+    if ((Params::getInstance().suppress_output_flags & OUT_LOG) || !MPIHelper::getInstance().isOutputProcess())
         return 0;        
     return fout_buf->pubsync();
 }
@@ -2295,6 +2378,8 @@ int main(int argc, char *argv[]) {
     }
 
     MPIHelper::getInstance().syncRandomSeed();
+    if (Params::getInstance().mpi_patterns)
+        MPIHelper::getInstance().initPatternParallel();
     
     signal(SIGABRT, &funcAbort);
     signal(SIGFPE, &funcAbort);
@@ -2429,7 +2514,10 @@ int main(int argc, char *argv[]) {
 #endif
 
 #ifdef _IQTREE_MPI
-    cout << endl << "MPI:     " << MPIHelper::getInstance().getNumProcesses() << " processes";
+    if (MPIHelper::getInstance().isPatternParallel())
+        cout << endl << "MPI:     " << MPIHelper::getInstance().getNumPatternProcesses() << " processes sharing site patterns";
+    else
+        cout << endl << "MPI:     " << MPIHelper::getInstance().getNumProcesses() << " processes";
 #endif
     
     int num_procs = countPhysicalCPUCores();
@@ -878,7 +878,7 @@ void reportCredits(ofstream &out) {
 /***********************************************************
  * CREATE REPORT FILE
  ***********************************************************/
-extern StringIntMap pllTreeCounter;
+extern thread_local StringIntMap pllTreeCounter;
 
 void exhaustiveSearchGAMMAInvar(Params &params, IQTree &iqtree);
 
@@ -913,6 +913,10 @@ void printOutfilesInfo(Params &params, IQTree &tree) {
         cout << "  BIONJ tree:                    " << params.out_prefix << ".bionj"
                 << endl;
     }
+    if (!params.user_file && params.start_tree == STT_PLACEMENT) {
+        cout << "  Placement start tree:          " << params.out_prefix << ".placetree"
+                << endl;
+    }
     if (!params.dist_file) {
         //cout << "  Juke-Cantor distances:    " << params.out_prefix << ".jcdist" << endl;
         if (params.compute_ml_dist)
@@ -1929,6 +1933,26 @@ void printAnalysisInfo(int model_df, IQTree& iqtree, Params& params) {
     cout << endl;
 }
 
+/**
+    @return true if the distance matrix is only needed for the start tree, so that
+        it can be kept as a single precision lower triangle (--dist-float) instead of
+        the dense dist_matrix and var_matrix
+ */
+bool isLowerTriangleDistUsable(Params &params) {
+    if (!params.dist_float || params.dist_file) {
+        return false;
+    }
+    // least squares, IQP quartets, stable clade collapsing and WH test read dist_matrix
+    bool usable = !params.leastSquareBranch && !params.leastSquareNNI
+        && (!(params.iqp || !params.snni) || params.iqp_assess_quartet != IQP_DISTANCE)
+        && params.aLRT_threshold > 100 && params.model_name != "WHTEST";
+    if (!usable) {
+        outWarning("--dist-float is ignored as the full distance matrix is needed later");
+        params.dist_float = false;
+    }
+    return usable;
+}
+
 void computeMLDist ( Params& params, IQTree& iqtree
                    , double begin_wallclock_time, double begin_cpu_time) {
     double longest_dist;
@@ -1936,29 +1960,37 @@ void computeMLDist ( Params& params, IQTree& iqtree
     double *ml_dist = nullptr;
     double *ml_var  = nullptr;
     iqtree.decideDistanceFilePath(params);
-    longest_dist = iqtree.computeDist(params, iqtree.aln, ml_dist, ml_var);
+    bool lower_triangle = isLowerTriangleDistUsable(params);
+    if (lower_triangle) {
+        longest_dist = iqtree.computeDistLowerTriangle(params, iqtree.aln);
+    } else {
+        longest_dist = iqtree.computeDist(params, iqtree.aln, ml_dist, ml_var);
+    }
     cout << "Computing ML distances took "
         << (getRealTime() - begin_wallclock_time) << " sec (of wall-clock time) "
         << (getCPUTime() - begin_cpu_time) << " sec (of CPU time)" << endl;
-    size_t n = iqtree.aln->getNSeq();
-    size_t nSquared = n*n;
-    if ( iqtree.dist_matrix == nullptr ) {
-        iqtree.dist_matrix = ml_dist;
-        ml_dist = nullptr;
-    } else {
-        memmove(iqtree.dist_matrix, ml_dist,
-                sizeof(double) * nSquared);
-        delete[] ml_dist;
-    }
-    if ( iqtree.var_matrix == nullptr ) {
-        iqtree.var_matrix = ml_var;
-        ml_var = nullptr;
-    } else {
-        memmove(iqtree.var_matrix, ml_var,
-                sizeof(double) * nSquared);
-        delete[] ml_var;
+    if (!lower_triangle) {
+        size_t n = iqtree.aln->getNSeq();
+        size_t nSquared = n*n;
+        if ( iqtree.dist_matrix == nullptr ) {
+            iqtree.dist_matrix = ml_dist;
+            ml_dist = nullptr;
+        } else {
+            memmove(iqtree.dist_matrix, ml_dist,
+                    sizeof(double) * nSquared);
+            delete[] ml_dist;
+        }
+        if ( iqtree.var_matrix == nullptr ) {
+            iqtree.var_matrix = ml_var;
+            ml_var = nullptr;
+        } else {
+            memmove(iqtree.var_matrix, ml_var,
+                    sizeof(double) * nSquared);
+            delete[] ml_var;
+        }
     }
-    if (!params.dist_file)
+    // with --dist-float the distance file is written only if asked for
+    if (!params.dist_file && (!lower_triangle || params.write_dist_file))
     {
         iqtree.printDistanceFile();
     }
@@ -1983,7 +2015,11 @@ void computeInitialDist(Params &params, IQTree &iqtree) {
     }
 
     if (params.compute_jc_dist || params.compute_obs_dist || params.partition_file) {
-        longest_dist = iqtree.computeDist(params, iqtree.aln, iqtree.dist_matrix, iqtree.var_matrix);
+        if (isLowerTriangleDistUsable(params)) {
+            longest_dist = iqtree.computeDistLowerTriangle(params, iqtree.aln);
+        } else {
+            longest_dist = iqtree.computeDist(params, iqtree.aln, iqtree.dist_matrix, iqtree.var_matrix);
+        }
         //if (!params.suppress_zero_distance_warnings) {
         //  checkZeroDist(iqtree.aln, iqtree.dist_matrix);
         //}
@@ -2610,7 +2646,10 @@ void runTreeReconstruction(Params &params, IQTree* &iqtree) {
 
         uint64_t mem_required = iqtree->getMemoryRequired();
 
-        if (mem_required >= total_mem*0.95 && !iqtree->isSuperTree()) {
+        if (params.lh_scratch_dir) {
+            // partial likelihoods are paged in and out of the scratch file instead of the RAM
+            cout << "NOTE: Partial likelihood vectors are kept in a scratch file in " << params.lh_scratch_dir << endl;
+        } else if (mem_required >= total_mem*0.95 && !iqtree->isSuperTree()) {
             // switch to memory saving mode
             if (params.lh_mem_save != LM_MEM_SAVE) {
                 params.max_mem_size = (total_mem*0.95)/mem_required;
@@ -2626,7 +2665,7 @@ void runTreeReconstruction(Params &params, IQTree* &iqtree) {
                 mem_required = iqtree->getMemoryRequired();
             }
         }
-        if (mem_required >= total_mem) {
+        if (mem_required >= total_mem && !params.lh_scratch_dir) {
             cerr << "ERROR: Your RAM is below minimum requirement of " << (mem_required / 1073741824.0) << " GB RAM" << endl;
             outError("Memory saving mode cannot work, switch to another computer!!!");
         }
@@ -2734,6 +2773,10 @@ void runTreeReconstruction(Params &params, IQTree* &iqtree) {
         if ((params.user_file || params.start_tree == STT_RANDOM_TREE) && params.snni && !params.iqp) {
             params.compute_ml_dist = false;
         }
+        if (params.start_tree == STT_PLACEMENT && !params.iqp) {
+            // the point of -t PLACE is to never build the full distance matrix
+            params.compute_ml_dist = false;
+        }
         if (params.constraint_tree_file) {
             params.compute_ml_dist = false;
         }
@@ -2791,7 +2834,8 @@ void runTreeReconstruction(Params &params, IQTree* &iqtree) {
                 iqtree->candidateTrees.update(initTree, iqtree->getCurScore());
             }
         }
-        if (!wasMLDistanceWrittenToFile && !params.dist_file) {
+        if (!wasMLDistanceWrittenToFile && !params.dist_file &&
+            (!iqtree->dist_lower || params.write_dist_file)) {
             double write_begin_time = getRealTime();
             iqtree->printDistanceFile();
             if (verbose_mode >= VB_MED) {
@@ -2979,10 +3023,11 @@ void runTreeReconstruction(Params &params, IQTree* &iqtree) {
         iqtree->writeUFBootTrees(params);
 
     if (iqtree->rooted && params.gbo_replicates && params.online_bootstrap) {
+        iqtree->flushRellBatch();
         cout << "Computing rootstrap supports..." << endl;
         string saved = iqtree->getTreeString();
         MTreeSet trees;
-        trees.init(iqtree->boot_trees, iqtree->rooted);
+        iqtree->getBootTreeSet(trees);
         iqtree->computeRootstrap(trees, true);
         iqtree->readTreeString(saved);
     }
@@ -3765,7 +3810,7 @@ void computeSiteFrequencyModel(Params &params, Alignment *alignment) {
     uint64_t mem_size = tree->getMemoryRequired();
     uint64_t total_mem = getMemorySize();
     cout << "NOTE: " << (mem_size / 1024) / 1024 << " MB RAM is required!" << endl;
-    if (mem_size >= total_mem) {
+    if (mem_size >= total_mem && !params.lh_scratch_dir) {
         outError("Memory required exceeds your computer RAM size!");
     }
 #ifdef BINARY32
@@ -4150,6 +4195,19 @@ void runPhyloAnalysis(Params &params, Checkpoint *checkpoint, IQTree *&tree, Ali
 
     /*************** initialize tree ********************/
     bool isTreeMix = isTreeMixture(params);
+
+    if (params.float_lh && (alignment->isSuperAlignment() || isTreeMix)) {
+        outWarning("--float-lh is not supported for partition and tree-mixture models, using double precision");
+        params.float_lh = false;
+    }
+#ifdef __AVX512KNL
+    if (params.float_lh && params.SSE < LK_AVX512) {
+#else
+    if (params.float_lh) {
+#endif
+        outWarning("--float-lh needs the AVX-512 likelihood kernel, using double precision");
+        params.float_lh = false;
+    }
     
     if (isTreeMix) {
         cout << "Tree-mixture model" << endl;
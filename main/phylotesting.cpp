@@ -871,7 +871,7 @@ void runModelFinder(Params &params, IQTree &iqtree, ModelCheckpoint &model_info)
     
     uint64_t mem_size = iqtree.getMemoryRequiredThreaded(max_cats);
     cout << "NOTE: ModelFinder requires " << (mem_size / 1024) / 1024 << " MB RAM!" << endl;
-    if (mem_size >= getMemorySize()) {
+    if (mem_size >= getMemorySize() && !params.lh_scratch_dir) {
         outError("Memory required exceeds your computer RAM size!");
     }
 #ifdef BINARY32
@@ -2053,11 +2053,13 @@ void testPartitionModel(Params &params, PhyloSuperTree* in_tree, ModelCheckpoint
     }
     bool test_merge = (params.partition_merge != MERGE_NONE) && params.partition_type != TOPO_UNLINKED && (in_tree->size() > 1);
     
+    ThreadSettings thread_settings;
 #ifdef _OPENMP
     parallel_over_partitions = !params.model_test_and_tree && (in_tree->size() >= num_threads);
 #pragma omp parallel for private(i) schedule(dynamic) reduction(+: lhsum, dfsum) if(parallel_over_partitions)
 #endif
 	for (int j = 0; j < in_tree->size(); j++) {
+        thread_settings.apply();
         i = partitionID[j].first;
         PhyloTree *this_tree = in_tree->at(i);
 		// scan through models for this partition, assuming the information occurs consecutively
@@ -2192,10 +2194,12 @@ void testPartitionModel(Params &params, PhyloSuperTree* in_tree, ModelCheckpoint
         size_t num_pairs = closest_pairs.size();
         size_t compute_pairs = 0;
 
+        ThreadSettings thread_settings;
 #ifdef _OPENMP
 #pragma omp parallel for private(i) schedule(dynamic) if(!params.model_test_and_tree)
 #endif
         for (size_t pair = 0; pair < num_pairs; pair++) {
+            thread_settings.apply();
             // information of current partitions pair
             ModelPair cur_pair;
             cur_pair.part1 = closest_pairs[pair].first;
@@ -2400,11 +2404,13 @@ void testPartitionModel(Params &params, PhyloSuperTree* in_tree, ModelCheckpoint
         cout << "No. Model        Score       Charset" << endl;
         int partition_id = 0;
 
+        ThreadSettings thread_settings;
     #ifdef _OPENMP
         parallel_over_partitions = !params.model_test_and_tree && (in_tree->size() >= num_threads);
         #pragma omp parallel for private(i) schedule(dynamic) reduction(+: lhsum, dfsum) if(parallel_over_partitions)
     #endif
         for (int j = 0; j < in_tree->size(); j++) {
+            thread_settings.apply();
             i = partitionID[j].first;
             PhyloTree *this_tree = in_tree->at(i);
             // scan through models for this partition, assuming the information occurs consecutively
@@ -2959,10 +2965,12 @@ CandidateModel CandidateModelSet::evaluateAll(Params &params, PhyloTree* in_tree
     }
 
     int64_t num_models = size();
+    ThreadSettings thread_settings;
 #ifdef _OPENMP
 #pragma omp parallel num_threads(num_threads)
 #endif
     {
+    thread_settings.apply();
     int64_t model;
     do {
         model = getNextModel();
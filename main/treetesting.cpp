@@ -16,6 +16,7 @@
 #include "tree/phylotree.h"
 #include "tree/phylosupertree.h"
 #include "tree/iqtreemix.h"
+#include "tree/splitarena.h"
 #include "gsl/mygsl.h"
 #include "utils/timeutil.h"
 
@@ -783,42 +784,255 @@ int mlecoef(double *cnts, double *rr, double bb, int kk,
 /* END CODE WAS TAKEN FROM CONSEL PROGRAM */
 
 /**
- @param tree_lhs RELL score matrix of size #trees x #replicates
+    smoothed count of the values <= t in a histogram, the counterpart of cntdist3 for the streaming AU test:
+    values are spread uniformly within each bin, the values below (above) the bins uniformly between min_val and lo
+    (lo+nbins*width and max_val)
+    @param hist nbins+2 counts: values below lo, the nbins bins of size width, values above lo+nbins*width
+    @param min_val, max_val the smallest and the largest value
+    @param total total number of values
  */
-void performAUTest(Params &params, PhyloTree *tree, double *pattern_lhs, vector<TreeInfo> &info) {
-    
-    if (params.topotest_replicates < 10000)
-        outWarning("Too few replicates for AU test. At least -zb 10000 for reliable results!");
-    
-    /* STEP 1: specify scale factors */
-    size_t nscales = 10;
-    double r[] = {0.5, 0.6, 0.7, 0.8, 0.9, 1.0, 1.1, 1.2, 1.3, 1.4};
-    double rr[] = {sqrt(0.5), sqrt(0.6), sqrt(0.7), sqrt(0.8), sqrt(0.9), 1.0,
-        sqrt(1.1), sqrt(1.2), sqrt(1.3), sqrt(1.4)};
-    double rr_inv[] = {sqrt(1/0.5), sqrt(1/0.6), sqrt(1/0.7), sqrt(1/0.8), sqrt(1/0.9), 1.0,
-        sqrt(1/1.1), sqrt(1/1.2), sqrt(1/1.3), sqrt(1/1.4)};
-    
-    /* STEP 2: compute bootstrap proportion */
-    size_t ntrees = info.size();
+double cnthist(unsigned int *hist, int nbins, double lo, double width, double min_val, double max_val, double total, double t)
+{
+    double hi = lo + width * nbins;
+    if (t < lo) {
+        if (t < min_val)
+            return 0.0;
+        return hist[0] * (t - min_val) / (lo - min_val);
+    }
+    if (t >= hi) {
+        if (t >= max_val)
+            return total;
+        return total - hist[nbins+1] * (max_val - t) / (max_val - hi);
+    }
+    double pos = (t - lo) / width;
+    int bin = min((int)pos, nbins - 1);
+    double p = hist[0];
+    for (int i = 1; i <= bin; i++)
+        p += hist[i];
+    p += hist[bin+1] * (pos - bin);
+    return p;
+}
+
+/**
+    @return the value t with cnthist(t) = p, the counterpart of picking vec[p] from a sorted vector
+ */
+double quantilehist(unsigned int *hist, int nbins, double lo, double width, double min_val, double max_val, double p)
+{
+    if (p <= hist[0] && hist[0] > 0)
+        return min_val + (lo - min_val) * p / hist[0];
+    double cnt = hist[0];
+    for (int i = 0; i < nbins; i++) {
+        if (cnt + hist[i+1] >= p && hist[i+1] > 0)
+            return lo + width * (i + (p - cnt) / hist[i+1]);
+        cnt += hist[i+1];
+    }
+    double hi = lo + width * nbins;
+    if (hist[nbins+1] > 0)
+        return hi + (max_val - hi) * min(1.0, (p - cnt) / hist[nbins+1]);
+    return hi;
+}
+
+/** @return the histogram bin of a value at position pos in bin widths from the lower bound */
+inline int histbin(double pos, int nbins)
+{
+    if (pos < 0.0)
+        return 0;
+    if (pos >= nbins)
+        return nbins + 1;
+    return (int)pos + 1;
+}
+
+/**
+    compute the AU test statistics of a block of multiscale bootstrap replicates
+    @param first, last the replicates of the block
+    @param scale scale factor
+    @param first_is_orig true if replicate 0 is the original alignment
+    @param boot_sample buffer of maxnptn ints
+    @param boot_block buffer of (last-first) x maxnptn doubles
+    @param[out] stats (last-first) x ntrees statistics: difference to the best tree,
+        or second best minus best for the best tree
+ */
+void computeAUBlockStats(PhyloTree *tree, double *pattern_lhs, size_t ntrees, size_t first, size_t last,
+                         double scale, bool first_is_orig, int *rstream, int *boot_sample,
+                         double *boot_block, double *stats)
+{
+    size_t nptn = tree->getAlnNPattern();
+    size_t maxnptn = get_safe_upper_limit(nptn);
+    size_t nblock = last - first;
+    string str = "SCALE=" + convertDoubleToString(scale);
+    for (size_t b = 0; b < nblock; b++) {
+        if (first_is_orig && first + b == 0)
+            tree->aln->getPatternFreq(boot_sample);
+        else
+            tree->aln->createBootstrapAlignment(boot_sample, str.c_str(), rstream);
+        double *boot_sample_dbl = boot_block + b*maxnptn;
+        for (size_t ptn = 0; ptn < maxnptn; ptn++)
+            boot_sample_dbl[ptn] = boot_sample[ptn];
+    }
+    // blocked product of the tree pattern log-likelihoods with the replicates:
+    // a pattern block of the replicates stays in cache for all trees
+    const size_t PTN_BLOCK = 1024;
+    memset(stats, 0, sizeof(double)*nblock*ntrees);
+    for (size_t ptn = 0; ptn < maxnptn; ptn += PTN_BLOCK) {
+        size_t len = min(PTN_BLOCK, maxnptn - ptn);
+        for (size_t tid = 0; tid < ntrees; tid++) {
+            double *pattern_lh = pattern_lhs + tid*maxnptn + ptn;
+            for (size_t b = 0; b < nblock; b++) {
+                double *boot_sample_dbl = boot_block + b*maxnptn + ptn;
+                if (Params::getInstance().SSE == LK_386) {
+                    double tree_lh = 0.0;
+                    for (size_t i = 0; i < len; i++)
+                        tree_lh += pattern_lh[i] * boot_sample_dbl[i];
+                    stats[b*ntrees + tid] += tree_lh;
+                } else {
+                    stats[b*ntrees + tid] += tree->dotProductDoubleCall(pattern_lh, boot_sample_dbl, len);
+                }
+            }
+        }
+    }
+    for (size_t b = 0; b < nblock; b++) {
+        double *tree_lh = stats + b*ntrees;
+        double max_lh = -DBL_MAX, second_max_lh = -DBL_MAX;
+        size_t max_tid = 0;
+        for (size_t tid = 0; tid < ntrees; tid++) {
+            // rescale lh
+            tree_lh[tid] /= scale;
+            if (tree_lh[tid] > max_lh) {
+                second_max_lh = max_lh;
+                max_lh = tree_lh[tid];
+                max_tid = tid;
+            } else if (tree_lh[tid] > second_max_lh)
+                second_max_lh = tree_lh[tid];
+        }
+        for (size_t tid = 0; tid < ntrees; tid++)
+            if (tid != max_tid)
+                tree_lh[tid] = max_lh - tree_lh[tid];
+            else
+                tree_lh[tid] = second_max_lh - max_lh;
+    }
+}
+
+/**
+    streaming version of STEP 2 of the AU test (--au-bins): the replicates are generated and evaluated
+    in blocks by all threads, and only a histogram of the statistics per tree and scale is kept.
+    The histogram range is taken from the first replicates of each scale.
+    @param[out] hist ntrees x nscales x (nbins+2) counts
+    @param[out] hist_lo, hist_width ntrees x nscales lower bounds and bin widths
+    @param[out] hist_min, hist_max ntrees x nscales smallest and largest statistics, for the counts outside the bins
+ */
+void computeAUHistograms(Params &params, PhyloTree *tree, double *pattern_lhs, size_t ntrees,
+                         size_t nscales, double *r, int nbins, unsigned int *hist,
+                         double *hist_lo, double *hist_width, double *hist_min, double *hist_max)
+{
+    size_t nboot = params.topotest_replicates;
+    size_t maxnptn = get_safe_upper_limit(tree->getAlnNPattern());
+    const size_t BOOT_BLOCK = 8;
+    size_t npilot = min(nboot, (size_t)1000);
+    size_t hist_size = nbins + 2;
+    double *pilot_stats = new double[npilot*ntrees];
+    memset(hist, 0, sizeof(unsigned int)*ntrees*nscales*hist_size);
+
+#ifdef _OPENMP
+#pragma omp parallel
+    {
+    int *rstream;
+    init_random(params.ran_seed + omp_get_thread_num(), false, &rstream);
+#else
+    int *rstream = randstream;
+#endif
+    int *boot_sample = aligned_alloc<int>(maxnptn);
+    memset(boot_sample, 0, maxnptn*sizeof(int));
+    double *boot_block = aligned_alloc<double>(BOOT_BLOCK*maxnptn);
+    double *stats = new double[BOOT_BLOCK*ntrees];
+
+    for (size_t k = 0; k < nscales; k++) {
+        bool first_is_orig = (r[k] == 1.0);
+        // the first replicates fix the histogram range
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+        for (size_t first = 0; first < npilot; first += BOOT_BLOCK) {
+            size_t last = min(first + BOOT_BLOCK, npilot);
+            computeAUBlockStats(tree, pattern_lhs, ntrees, first, last, r[k], first_is_orig,
+                                rstream, boot_sample, boot_block, pilot_stats + first*ntrees);
+        }
+#ifdef _OPENMP
+#pragma omp single
+#endif
+        {
+        for (size_t tid = 0; tid < ntrees; tid++) {
+            size_t row = tid*nscales + k;
+            // the range always contains 0, where the AU test evaluates the bootstrap probabilities
+            double min_stat = 0.0, max_stat = 0.0;
+            for (size_t boot = 0; boot < npilot; boot++) {
+                min_stat = min(min_stat, pilot_stats[boot*ntrees + tid]);
+                max_stat = max(max_stat, pilot_stats[boot*ntrees + tid]);
+            }
+            // leave a margin for the replicates outside the range of the first ones
+            double span = (max_stat > min_stat) ? max_stat - min_stat : 1.0;
+            hist_lo[row] = min_stat - 0.5*span;
+            hist_width[row] = 2.0*span / nbins;
+            hist_min[row] = min_stat;
+            hist_max[row] = max_stat;
+            for (size_t boot = 0; boot < npilot; boot++) {
+                double pos = (pilot_stats[boot*ntrees + tid] - hist_lo[row]) / hist_width[row];
+                hist[row*hist_size + histbin(pos, nbins)]++;
+            }
+        }
+        }
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+        for (size_t first = npilot; first < nboot; first += BOOT_BLOCK) {
+            size_t last = min(first + BOOT_BLOCK, nboot);
+            computeAUBlockStats(tree, pattern_lhs, ntrees, first, last, r[k], first_is_orig,
+                                rstream, boot_sample, boot_block, stats);
+            for (size_t b = 0; b < last - first; b++)
+                for (size_t tid = 0; tid < ntrees; tid++) {
+                    size_t row = tid*nscales + k;
+                    double pos = (stats[b*ntrees + tid] - hist_lo[row]) / hist_width[row];
+                    int bin = histbin(pos, nbins);
+                    unsigned int &cnt = hist[row*hist_size + bin];
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
+                    cnt++;
+                    // the few values outside the bins extend the range of the statistics
+                    if (bin == 0 || bin == nbins + 1) {
+#ifdef _OPENMP
+#pragma omp critical(au_hist_range)
+#endif
+                        {
+                        hist_min[row] = min(hist_min[row], stats[b*ntrees + tid]);
+                        hist_max[row] = max(hist_max[row], stats[b*ntrees + tid]);
+                        }
+                    }
+                }
+        }
+    }
+
+    delete [] stats;
+    aligned_free(boot_block);
+    aligned_free(boot_sample);
+#ifdef _OPENMP
+    finish_random(rstream);
+    }
+#endif
+    delete [] pilot_stats;
+}
+
+/**
+    STEP 2 of the AU test: generate the multiscale bootstrap replicates and keep the statistics of all of them
+    @param[out] treelhs ntrees x nscales x nboot statistics, sorted for each tree and scale
+ */
+void computeAUTreeLhs(Params &params, PhyloTree *tree, double *pattern_lhs, size_t ntrees,
+                      size_t nscales, double *r, double *treelhs)
+{
     size_t nboot = params.topotest_replicates;
-    //    double nboot_inv = 1.0 / nboot;
-    
     size_t nptn = tree->getAlnNPattern();
     size_t maxnptn = get_safe_upper_limit(nptn);
-    
-    //    double *bp = new double[ntrees*nscales];
-    //    memset(bp, 0, sizeof(double)*ntrees*nscales);
-    
-    double *treelhs;
-    cout << (ntrees*nscales*nboot*sizeof(double) >> 20) << " MB required for AU test" << endl;
-    treelhs = new double[ntrees*nscales*nboot];
-    if (!treelhs)
-        outError("Not enough memory to perform AU test!");
-    
     size_t k, tid, ptn;
     
-    double start_time = getRealTime();
-    
     cout << "Generating " << nscales << " x " << nboot << " multiscale bootstrap replicates... ";
     
 #ifdef _OPENMP
@@ -897,6 +1111,62 @@ void performAUTest(Params &params, PhyloTree *tree, double *pattern_lhs, vector<
     finish_random(rstream);
     }
 #endif
+}
+
+/**
+ @param tree_lhs RELL score matrix of size #trees x #replicates
+ */
+void performAUTest(Params &params, PhyloTree *tree, double *pattern_lhs, vector<TreeInfo> &info) {
+    
+    if (params.topotest_replicates < 10000)
+        outWarning("Too few replicates for AU test. At least -zb 10000 for reliable results!");
+    
+    /* STEP 1: specify scale factors */
+    size_t nscales = 10;
+    double r[] = {0.5, 0.6, 0.7, 0.8, 0.9, 1.0, 1.1, 1.2, 1.3, 1.4};
+    double rr[] = {sqrt(0.5), sqrt(0.6), sqrt(0.7), sqrt(0.8), sqrt(0.9), 1.0,
+        sqrt(1.1), sqrt(1.2), sqrt(1.3), sqrt(1.4)};
+    double rr_inv[] = {sqrt(1/0.5), sqrt(1/0.6), sqrt(1/0.7), sqrt(1/0.8), sqrt(1/0.9), 1.0,
+        sqrt(1/1.1), sqrt(1/1.2), sqrt(1/1.3), sqrt(1/1.4)};
+    
+    /* STEP 2: compute bootstrap proportion */
+    size_t ntrees = info.size();
+    size_t nboot = params.topotest_replicates;
+    //    double nboot_inv = 1.0 / nboot;
+    
+    size_t nptn = tree->getAlnNPattern();
+    size_t maxnptn = get_safe_upper_limit(nptn);
+    
+    //    double *bp = new double[ntrees*nscales];
+    //    memset(bp, 0, sizeof(double)*ntrees*nscales);
+    
+    double *treelhs = NULL;
+    int nbins = params.au_bins;
+    unsigned int *hist = NULL;
+    double *hist_lo = NULL, *hist_width = NULL, *hist_min = NULL, *hist_max = NULL;
+    if (nbins > 0) {
+        cout << ((ntrees*nscales*(nbins+2)*sizeof(unsigned int)) >> 20) << " MB required for AU test histograms" << endl;
+        hist = new unsigned int[ntrees*nscales*(nbins+2)];
+        hist_lo = new double[ntrees*nscales];
+        hist_width = new double[ntrees*nscales];
+        hist_min = new double[ntrees*nscales];
+        hist_max = new double[ntrees*nscales];
+    } else {
+        cout << (ntrees*nscales*nboot*sizeof(double) >> 20) << " MB required for AU test" << endl;
+        treelhs = new double[ntrees*nscales*nboot];
+        if (!treelhs)
+            outError("Not enough memory to perform AU test!");
+    }
+    
+    size_t k, tid, ptn;
+    
+    double start_time = getRealTime();
+    
+    if (nbins > 0) {
+        cout << "Streaming " << nscales << " x " << nboot << " multiscale bootstrap replicates into " << nbins << " bins... ";
+        computeAUHistograms(params, tree, pattern_lhs, ntrees, nscales, r, nbins, hist, hist_lo, hist_width, hist_min, hist_max);
+    } else
+        computeAUTreeLhs(params, tree, pattern_lhs, ntrees, nscales, r, treelhs);
     
     //    if (verbose_mode >= VB_MED) {
     //        cout << "scale";
@@ -921,8 +1191,15 @@ void performAUTest(Params &params, PhyloTree *tree, double *pattern_lhs, vector<
     double *this_bp = new double[nscales];
     cout << "TreeID\tAU\tRSS\td\tc" << endl;
     for (tid = 0; tid < ntrees; tid++) {
-        double *this_stat = treelhs + tid*nscales*nboot;
-        double xn = this_stat[(nscales/2)*nboot + nboot/2], x;
+        double *this_stat = NULL;
+        double xn, x;
+        if (nbins > 0) {
+            size_t row = tid*nscales + nscales/2;
+            xn = quantilehist(hist + row*(nbins+2), nbins, hist_lo[row], hist_width[row], hist_min[row], hist_max[row], nboot/2 + 0.5);
+        } else {
+            this_stat = treelhs + tid*nscales*nboot;
+            xn = this_stat[(nscales/2)*nboot + nboot/2];
+        }
         double c, d; // c, d in original paper
         int idf0 = -2;
         double z = 0.0, z0 = 0.0, thp = 0.0, th = 0.0, ze = 0.0, ze0 = 0.0;
@@ -936,7 +1213,11 @@ void performAUTest(Params &params, PhyloTree *tree, double *pattern_lhs, vector<
             x = xn;
             int num_k = 0;
             for (k = 0; k < nscales; k++) {
-                this_bp[k] = cntdist3(this_stat + k*nboot, nboot, x) / nboot;
+                if (nbins > 0) {
+                    size_t row = tid*nscales + k;
+                    this_bp[k] = cnthist(hist + row*(nbins+2), nbins, hist_lo[row], hist_width[row], hist_min[row], hist_max[row], nboot, x) / nboot;
+                } else
+                    this_bp[k] = cntdist3(this_stat + k*nboot, nboot, x) / nboot;
                 if (this_bp[k] <= 0 || this_bp[k] >= 1) {
                     cc[k] = w[k] = 0.0;
                 } else {
@@ -1048,12 +1329,87 @@ void performAUTest(Params &params, PhyloTree *tree, double *pattern_lhs, vector<
     delete [] this_bp;
     delete [] w;
     delete [] cc;
+    if (hist) {
+        delete [] hist_max;
+        delete [] hist_min;
+        delete [] hist_width;
+        delete [] hist_lo;
+        delete [] hist;
+    }
+    if (treelhs)
+        delete [] treelhs;
     
     cout << "Time for AU test: " << getRealTime() - start_time << " seconds" << endl;
     //    delete [] bp;
 }
 
 
+/**
+    order the trees for --tree-reuse so that consecutive trees share many subtrees:
+    starting from the first tree, the next tree is the one with the smallest
+    Robinson-Foulds distance to the last ordered tree among the first window trees
+    not yet ordered
+    @param tree_strs NEWICK strings, empty for trees not to evaluate
+    @param aln alignment, gives the taxon IDs by name
+    @param is_rooted true if the trees are rooted
+    @param window number of candidate trees
+    @param[out] order indices of the non-empty tree strings in evaluation order
+    @return false if the trees do not all have the same taxa, order is then not changed
+ */
+bool orderSimilarTrees(StrVector &tree_strs, Alignment *aln, bool is_rooted, int window, IntVector &order) {
+    MTreeSet trees;
+    IntVector ids;
+    for (int i = 0; i < tree_strs.size(); i++)
+        if (!tree_strs[i].empty()) {
+            bool rooted = is_rooted;
+            trees.addTree(tree_strs[i], rooted);
+            ids.push_back(i);
+        }
+    // addTree() takes the taxon IDs from numeric taxon names, use the alignment IDs instead
+    for (MTreeSet::iterator it = trees.begin(); it != trees.end(); it++) {
+        int nleaf = (*it)->leafNum;
+        if (nleaf != trees.front()->leafNum)
+            return false;
+        NodeVector taxa;
+        (*it)->getTaxa(taxa);
+        vector<bool> has_id(nleaf, false);
+        for (NodeVector::iterator taxit = taxa.begin(); taxit != taxa.end(); taxit++) {
+            int id = ((*taxit)->name == ROOT_NAME) ? nleaf - 1 : aln->getSeqID((*taxit)->name);
+            if (id < 0 || id >= nleaf || has_id[id])
+                return false;
+            has_id[id] = true;
+            (*taxit)->id = id;
+        }
+    }
+    SplitArena arena(trees);
+    int ntrees = ids.size();
+    vector<bool> ordered(ntrees, false);
+    int last = 0, first = 1;
+    order.clear();
+    order.push_back(ids[0]);
+    ordered[0] = true;
+    for (int k = 1; k < ntrees; k++) {
+        while (ordered[first])
+            first++;
+        int best = -1;
+        double best_dist = 0.0;
+        for (int i = first, cnt = 0; i < ntrees && cnt < window; i++) {
+            if (ordered[i])
+                continue;
+            cnt++;
+            double dist = arena.computeRFDist(last, arena, i);
+            if (best < 0 || dist < best_dist) {
+                best = i;
+                best_dist = dist;
+            }
+        }
+        order.push_back(ids[best]);
+        ordered[best] = true;
+        last = best;
+    }
+    return true;
+}
+
 void evaluateTrees(istream &in, Params &params, IQTree *tree, vector<TreeInfo> &info, IntVector &distinct_ids)
 {
     cout << endl;
@@ -1167,12 +1523,57 @@ void evaluateTrees(istream &in, Params &params, IQTree *tree, vector<TreeInfo> &
     info.resize(ntrees);
     string saved_tree;
     saved_tree = tree->getTreeString();
-    //for (MTreeSet::iterator it = trees.begin(); it != trees.end(); it++, tree_index++) {
+
+    // evaluation order and index among the distinct trees of every tree
+    IntVector eval_order, tree_tids;
     for (tree_index = 0, tid = 0; tree_index < distinct_ids.size(); tree_index++) {
+        eval_order.push_back(tree_index);
+        tree_tids.push_back((distinct_ids[tree_index] >= 0) ? -1 : tid++);
+    }
+
+    // --tree-reuse: read all trees first to evaluate similar trees one after another
+    int reuse_window = params.tree_reuse;
+    if (reuse_window && (tree->isSuperTree() || tree->getMixlen() > 1 ||
+        params.lh_mem_save == LM_MEM_SAVE || params.topotest_optimize_model)) {
+        outWarning("--tree-reuse does not work with partition models, mixture branch lengths, -mem or --estimate-model");
+        reuse_window = 0;
+    }
+    StrVector tree_strs, tree_lines;
+    bool reordered = false;
+    if (reuse_window) {
+        tree_strs.resize(distinct_ids.size());
+        for (tree_index = 0; tree_index < distinct_ids.size(); tree_index++) {
+            string tree_str;
+            char ch;
+            while (in.get(ch) && ch != ';')
+                tree_str += ch;
+            if (distinct_ids[tree_index] < 0)
+                tree_strs[tree_index] = tree_str + ';';
+        }
+        IntVector order;
+        if (reuse_window > 1 && ntrees > 2 && !params.print_site_lh && !params.print_partition_lh &&
+            orderSimilarTrees(tree_strs, tree->aln, tree->rooted, reuse_window, order)) {
+            // identical trees are reported first
+            eval_order.clear();
+            for (tree_index = 0; tree_index < distinct_ids.size(); tree_index++)
+                if (distinct_ids[tree_index] >= 0)
+                    eval_order.push_back(tree_index);
+            eval_order.insert(eval_order.end(), order.begin(), order.end());
+            tree_lines.resize(distinct_ids.size());
+            reordered = true;
+        }
+    }
+
+    //for (MTreeSet::iterator it = trees.begin(); it != trees.end(); it++, tree_index++) {
+    for (int k = 0; k < eval_order.size(); k++) {
+        tree_index = eval_order[k];
+        tid = tree_tids[tree_index];
         
         cout << "Tree " << tree_index + 1;
         if (distinct_ids[tree_index] >= 0) {
             cout << " / identical to tree " << distinct_ids[tree_index]+1 << endl;
+            if (!tree_strs.empty())
+                continue;
             // ignore tree
             char ch;
             do {
@@ -1181,7 +1582,12 @@ void evaluateTrees(istream &in, Params &params, IQTree *tree, vector<TreeInfo> &
             continue;
         }
         tree->freeNode();
-        tree->readTree(in, tree->rooted);
+        if (tree_strs.empty()) {
+            tree->readTree(in, tree->rooted);
+        } else {
+            stringstream tree_in(tree_strs[tree_index]);
+            tree->readTree(tree_in, tree->rooted);
+        }
         if (!tree->findNodeName(tree->aln->getSeqName(0))) {
             outError("Taxon " + tree->aln->getSeqName(0) + " not found in tree");
         }
@@ -1204,6 +1610,12 @@ void evaluateTrees(istream &in, Params &params, IQTree *tree, vector<TreeInfo> &
         
         tree->initializeAllPartialLh();
         tree->fixNegativeBranch(false);
+        if (reuse_window) {
+            // lengths of shared splits and partial likelihoods of identical subtrees of the previous tree
+            int reused = tree->restoreSubtreePartialLh(!params.fixed_branch_length);
+            if (verbose_mode >= VB_MED)
+                cout << " / " << reused << " partial likelihoods reused";
+        }
         if (params.fixed_branch_length) {
             tree->setCurScore(tree->computeLikelihood());
         } else if (params.topotest_optimize_model) {
@@ -1212,11 +1624,17 @@ void evaluateTrees(istream &in, Params &params, IQTree *tree, vector<TreeInfo> &
         } else {
             tree->setCurScore(tree->optimizeAllBranches(100, 0.001));
         }
-        treeout << "[ tree " << tree_index+1 << " lh=" << tree->getCurScore() << " ]";
-        tree->printTree(treeout);
-        treeout << endl;
-        if (params.print_tree_lh)
-            scoreout << tree->getCurScore() << endl;
+        ostringstream tree_line;
+        tree_line << "[ tree " << tree_index+1 << " lh=" << tree->getCurScore() << " ]";
+        tree->printTree(tree_line);
+        if (reordered) {
+            // written in the input order after all trees are evaluated
+            tree_lines[tree_index] = tree_line.str();
+        } else {
+            treeout << tree_line.str() << endl;
+            if (params.print_tree_lh)
+                scoreout << tree->getCurScore() << endl;
+        }
         
         cout << " / LogL: " << tree->getCurScore() << endl;
         
@@ -1236,11 +1654,11 @@ void evaluateTrees(istream &in, Params &params, IQTree *tree, vector<TreeInfo> &
             printPartitionLh(part_lh_file.c_str(), tree, pattern_lh, true, tree_name.c_str());
         }
         info[tid].logl = tree->getCurScore();
+        if (reuse_window)
+            tree->saveSubtreePartialLh();
         
-        if (!params.topotest_replicates || ntrees <= 1) {
-            tid++;
+        if (!params.topotest_replicates || ntrees <= 1)
             continue;
-        }
         // now compute RELL scores
         orig_tree_lh[tid] = tree->getCurScore();
         double *tree_lhs_offset = tree_lhs + (tid*params.topotest_replicates);
@@ -1251,10 +1669,19 @@ void evaluateTrees(istream &in, Params &params, IQTree *tree, vector<TreeInfo> &
                 lh += pattern_lh[ptn] * this_boot_sample[ptn];
             tree_lhs_offset[boot] = lh;
         }
-        tid++;
     }
     
-    ASSERT(tid == ntrees);
+    if (reuse_window)
+        tree->clearSubtreePartialLh();
+    if (reordered) {
+        for (tree_index = 0; tree_index < distinct_ids.size(); tree_index++) {
+            if (tree_tids[tree_index] < 0)
+                continue;
+            treeout << tree_lines[tree_index] << endl;
+            if (params.print_tree_lh)
+                scoreout << info[tree_tids[tree_index]].logl << endl;
+        }
+    }
     
     if (params.topotest_replicates && ntrees > 1) {
         double *tree_probs = new double[ntrees];
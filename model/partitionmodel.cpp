@@ -21,6 +21,7 @@
 #include "alignment/superalignment.h"
 #include "model/rategamma.h"
 #include "model/modelmarkov.h"
+#include "utils/timeutil.h"
 
 PartitionModel::PartitionModel()
         : ModelFactory()
@@ -251,14 +252,19 @@ double PartitionModel::computeFunction(double shape) {
     int ntrees = tree->size();
     linked_alpha = shape;
     if (tree->part_order.empty()) tree->computePartitionOrder();
+    int loop_threads = tree->beginPartitionLoop();
+    ThreadSettings thread_settings;
 #ifdef _OPENMP
-#pragma omp parallel for reduction(+: res) schedule(dynamic) if(tree->num_threads > 1)
+#pragma omp parallel for reduction(+: res) schedule(dynamic) num_threads(loop_threads) if(tree->num_threads > 1)
 #endif
     for (int j = 0; j < ntrees; j++) {
+        thread_settings.apply();
         int i = tree->part_order[j];
+        tree->beginPartitionTask(i);
         if (tree->at(i)->getRate()->isGammaRate())
             res += tree->at(i)->getRate()->computeFunction(shape);
     }
+    tree->endPartitionLoop();
     if (res == 0.0) {
         outError("No partition has Gamma rate heterogeneity!");
     }
@@ -292,18 +298,23 @@ double PartitionModel::targetFunk(double x[]) {
     double res = 0;
     int ntrees = tree->size();
     if (tree->part_order.empty()) tree->computePartitionOrder();
+    int loop_threads = tree->beginPartitionLoop();
+    ThreadSettings thread_settings;
 #ifdef _OPENMP
-#pragma omp parallel for reduction(+: res) schedule(dynamic) if(tree->num_threads > 1)
+#pragma omp parallel for reduction(+: res) schedule(dynamic) num_threads(loop_threads) if(tree->num_threads > 1)
 #endif
     for (int j = 0; j < ntrees; j++) {
+        thread_settings.apply();
         int i = tree->part_order[j];
         ModelSubst *part_model = tree->at(i)->getModel();
         if (part_model->getName() != model->getName())
             continue;
+        tree->beginPartitionTask(i);
         bool fixed = part_model->fixParameters(false);
         res += part_model->targetFunk(x);
         part_model->fixParameters(fixed);
     }
+    tree->endPartitionLoop();
     if (res == 0.0)
         outError("No partition has model ", model->getName());
     return res;
@@ -457,6 +468,24 @@ bool PartitionModel::isLinkedModel() {
     return Params::getInstance().link_alpha || (linked_models.size()>0);
 }
 
+void PartitionModel::reportPartitionTime(DoubleVector &part_time, double wall_time, bool print_partitions) {
+    PhyloSuperTree *tree = (PhyloSuperTree*)site_rate->getTree();
+    double max_part_time = 0.0, sum_part_time = 0.0;
+    for (int i = 0; i < part_time.size(); i++) {
+        if (print_partitions) {
+            cout << "Partition " << tree->at(i)->aln->name << " / Time: " << part_time[i] << " sec";
+            if (!tree->part_threads.empty())
+                cout << " / Threads: " << tree->part_threads[i];
+            cout << endl;
+        }
+        max_part_time = max(max_part_time, part_time[i]);
+        sum_part_time += part_time[i];
+    }
+    // wall time close to the longest partition means that no thread was left waiting for it
+    cout << "Partition wall time: " << wall_time << " sec / Longest partition: " << max_part_time
+         << " sec / Sum over partitions: " << sum_part_time << " sec" << endl;
+}
+
 double PartitionModel::optimizeParameters(int fixed_len, bool write_info, double logl_epsilon, double gradient_epsilon) {
     PhyloSuperTree *tree = (PhyloSuperTree*)site_rate->getTree();
     double prev_tree_lh = -DBL_MAX, tree_lh = 0.0;
@@ -465,11 +494,18 @@ double PartitionModel::optimizeParameters(int fixed_len, bool write_info, double
     for (int step = 0; step < Params::getInstance().model_opt_steps; step++) {
         tree_lh = 0.0;
         if (tree->part_order.empty()) tree->computePartitionOrder();
+        double loop_start_time = getRealTime();
+        DoubleVector part_time(ntrees, 0.0);
+        int loop_threads = tree->beginPartitionLoop();
+        ThreadSettings thread_settings;
         #ifdef _OPENMP
-        #pragma omp parallel for reduction(+: tree_lh) schedule(dynamic) if(tree->num_threads > 1)
+        #pragma omp parallel for reduction(+: tree_lh) schedule(dynamic) num_threads(loop_threads) if(tree->num_threads > 1)
         #endif
         for (int i = 0; i < ntrees; i++) {
+            thread_settings.apply();
             int part = tree->part_order[i];
+            double start_time = getRealTime();
+            tree->beginPartitionTask(part);
             double score;
             if (opt_gamma_invar)
                 score = tree->at(part)->getModelFactory()->optimizeParametersGammaInvar(fixed_len,
@@ -480,6 +516,7 @@ double PartitionModel::optimizeParameters(int fixed_len, bool write_info, double
                     write_info && verbose_mode >= VB_MED,
                     logl_epsilon/min(ntrees,10), gradient_epsilon/min(ntrees,10));
             tree_lh += score;
+            part_time[part] = getRealTime() - start_time;
             if (write_info)
 #ifdef _OPENMP
 #pragma omp critical
@@ -488,9 +525,15 @@ double PartitionModel::optimizeParameters(int fixed_len, bool write_info, double
                 cout << "Partition " << tree->at(part)->aln->name
                      << " / Model: " << tree->at(part)->getModelName()
                      << " / df: " << tree->at(part)->getModelFactory()->getNParameters(fixed_len)
-                << " / LogL: " << score << endl;
+                << " / LogL: " << score << " / Time: " << part_time[part] << " sec";
+                if (!tree->part_threads.empty())
+                    cout << " / Threads: " << tree->part_threads[part];
+                cout << endl;
             }
         }
+        tree->endPartitionLoop();
+        if (write_info && tree->num_threads > 1)
+            reportPartitionTime(part_time, getRealTime() - loop_start_time, false);
         //return ModelFactory::optimizeParameters(fixed_len, write_info);
 
         if (!isLinkedModel())
@@ -150,6 +150,14 @@ public:
      */
     bool isLinkedModel();
 
+    /**
+        print how the time of the parallel partition loops was spread over the partitions
+        @param part_time wall-clock time (in seconds) spent on each partition
+        @param wall_time elapsed wall-clock time of the partition loops
+        @param print_partitions TRUE to also print one line per partition
+     */
+    void reportPartitionTime(DoubleVector &part_time, double wall_time, bool print_partitions);
+
 //protected:
 
 	/** linked Gamma shape alpha between partitions */
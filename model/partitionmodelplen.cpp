@@ -96,15 +96,23 @@ double PartitionModelPlen::optimizeParameters(int fixed_len, bool write_info, do
     
     cout<<"Initial log-likelihood: "<<tree_lh<<endl;
     double begin_time = getRealTime();
+    DoubleVector part_time(ntrees, 0.0);
+    double loop_time = 0.0;
     int i;
     for(i = 1; i < tree->params->num_param_iterations; i++){
         cur_lh = 0.0;
         if (tree->part_order.empty()) tree->computePartitionOrder();
+        double loop_start_time = getRealTime();
+        int loop_threads = tree->beginPartitionLoop();
+        ThreadSettings thread_settings;
 #ifdef _OPENMP
-#pragma omp parallel for reduction(+: cur_lh) schedule(dynamic) if(tree->num_threads > 1)
+#pragma omp parallel for reduction(+: cur_lh) schedule(dynamic) num_threads(loop_threads) if(tree->num_threads > 1)
 #endif
         for (int partid = 0; partid < ntrees; partid++) {
+            thread_settings.apply();
             int part = tree->part_order[partid];
+            double start_time = getRealTime();
+            tree->beginPartitionTask(part);
             // Subtree model parameters optimization
             tree->part_info[part].cur_score = tree->at(part)->getModelFactory()->
                 optimizeParametersOnly(i+1, gradient_epsilon/min(min(i,ntrees),10),
@@ -123,8 +131,10 @@ double PartitionModelPlen::optimizeParameters(int fixed_len, bool write_info, do
                 tree->at(part)->scaleLength(mean_rate);
                 tree->part_info[part].part_rate *= mean_rate;
             }
-            
+            part_time[part] += getRealTime() - start_time;
         }
+        tree->endPartitionLoop();
+        loop_time += getRealTime() - loop_start_time;
         if (tree->params->link_alpha) {
             cur_lh = optimizeLinkedAlpha(write_info, gradient_epsilon);
         }
@@ -182,6 +192,9 @@ double PartitionModelPlen::optimizeParameters(int fixed_len, bool write_info, do
     if (write_info)
         writeInfo(cout);
 
+    if (write_info && tree->num_threads > 1)
+        reportPartitionTime(part_time, loop_time, true);
+
     // write linked_models
     if (verbose_mode <= VB_MIN && write_info) {
         for (auto it = linked_models.begin(); it != linked_models.end(); it++)
@@ -229,12 +242,16 @@ double PartitionModelPlen::optimizeGeneRate(double gradient_epsilon)
         }
     }
     if (tree->part_order.empty()) tree->computePartitionOrder();
+    int loop_threads = tree->beginPartitionLoop();
     
+    ThreadSettings thread_settings;
 #ifdef _OPENMP
-#pragma omp parallel for reduction(+: score) schedule(dynamic) if(tree->num_threads > 1)
+#pragma omp parallel for reduction(+: score) schedule(dynamic) num_threads(loop_threads) if(tree->num_threads > 1)
 #endif
     for (int j = 0; j < tree->size(); j++) {
+        thread_settings.apply();
         int i = tree->part_order[j];
+        tree->beginPartitionTask(i);
         double min_scaling = 1.0/tree->at(i)->getAlnNSite();
         double max_scaling = nsites / tree->at(i)->getAlnNSite();
         if (max_scaling < tree->part_info[i].part_rate)
@@ -244,6 +261,7 @@ double PartitionModelPlen::optimizeGeneRate(double gradient_epsilon)
         tree->part_info[i].cur_score = tree->at(i)->optimizeTreeLengthScaling(min_scaling, tree->part_info[i].part_rate, max_scaling, gradient_epsilon);
         score += tree->part_info[i].cur_score;
     }
+    tree->endPartitionLoop();
     // now normalize the rates
     double sum = 0.0;
     size_t nsite = 0;
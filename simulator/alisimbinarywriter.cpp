@@ -0,0 +1,181 @@
+//
+//  alisimbinarywriter.cpp
+//  iqtree
+//
+//  Packed binary alignment output of AliSim (-af bin)
+//
+
+#include "alisimbinarywriter.h"
+
+/**
+*  write an unsigned integer in little-endian byte order
+*/
+static void writeLittleEndian(ostream &out, uint64_t value, int num_bytes)
+{
+    for (int i = 0; i < num_bytes; i++, value >>= 8)
+        out.put((char) (value & 0xFF));
+}
+
+AliSimBinaryWriter::AliSimBinaryWriter(string file_path, Alignment *aln, vector<string> &state_mapping, vector<string> &seq_names, int sequence_length, bool has_gaps)
+{
+    this->file_path = file_path;
+    int num_sites_per_state = aln->seq_type == SEQ_CODON ? 3 : 1;
+    num_seqs = seq_names.size();
+
+    // compute the layout of the output file
+    num_states = aln->num_states;
+    num_codes = num_states + (has_gaps ? 1 : 0);
+    bits_per_state = 1;
+    while ((1 << bits_per_state) < num_codes)
+        bits_per_state++;
+    ASSERT(bits_per_state <= 8);
+    bytes_per_seq = ((uint64_t) sequence_length * bits_per_state + 7) / 8;
+    data_offset = ALIBIN_HEADER_SIZE + num_codes * num_sites_per_state;
+    for (int i = 0; i < num_seqs; i++)
+        data_offset += 4 + seq_names[i].length();
+    data_offset = (data_offset + 7) / 8 * 8;
+
+    // write the header, the alphabet, and the sequence names
+    try {
+        ofstream out(file_path.c_str(), ios::out | ios::binary);
+        out.exceptions(ios::failbit | ios::badbit);
+        out.write(ALIBIN_MAGIC, 8);
+        writeLittleEndian(out, aln->seq_type, 4);
+        writeLittleEndian(out, num_sites_per_state, 4);
+        writeLittleEndian(out, num_codes, 4);
+        writeLittleEndian(out, bits_per_state, 4);
+        writeLittleEndian(out, num_seqs, 4);
+        writeLittleEndian(out, 0, 4);
+        writeLittleEndian(out, sequence_length, 8);
+        writeLittleEndian(out, bytes_per_seq, 8);
+        writeLittleEndian(out, data_offset, 8);
+
+        for (int code = 0; code < num_codes; code++)
+        {
+            string code_str = code < num_states ? state_mapping[code] : state_mapping[aln->STATE_UNKNOWN];
+            code_str.resize(num_sites_per_state, '-');
+            out.write(code_str.c_str(), num_sites_per_state);
+        }
+
+        for (int i = 0; i < num_seqs; i++)
+        {
+            writeLittleEndian(out, seq_names[i].length(), 4);
+            out.write(seq_names[i].c_str(), seq_names[i].length());
+        }
+
+        // pad to data_offset, then extend the file to its full size so that sequences could be written in any order
+        while ((uint64_t) out.tellp() < data_offset)
+            out.put(0);
+        if (num_seqs > 0 && bytes_per_seq > 0)
+        {
+            out.seekp(data_offset + num_seqs * bytes_per_seq - 1);
+            out.put(0);
+        }
+        out.close();
+    } catch (ios::failure) {
+        outError(ERR_WRITE_OUTPUT, file_path);
+    }
+}
+
+void AliSimBinaryWriter::packStates(SimStateVector &states, int num_packed_states, string &packed, int first_bit)
+{
+    packed.assign((first_bit + (uint64_t) num_packed_states * bits_per_state + 7) / 8, 0);
+    int num_simulated_states = min((int) states.size(), num_packed_states);
+    uint64_t bit_pos = first_bit;
+    for (int j = 0; j < num_packed_states; j++, bit_pos += bits_per_state)
+    {
+        int code = num_states;
+        if (j < num_simulated_states && states[j] < num_states)
+            code = states[j];
+        else
+            ASSERT(num_codes > num_states && "gaps in a binary alignment without a gap code");
+        int shift = bit_pos & 7;
+        uint64_t byte_index = bit_pos >> 3;
+        packed[byte_index] |= (char) (code << shift);
+        if (shift + bits_per_state > 8)
+            packed[byte_index + 1] |= (char) (code >> (8 - shift));
+    }
+}
+
+uint64_t AliSimBinaryWriter::getPosition(int seq_index, int segment_start)
+{
+    ASSERT(segment_start % 8 == 0);
+    return data_offset + seq_index * bytes_per_seq + (uint64_t) segment_start / 8 * bits_per_state;
+}
+
+void AliSimBinaryWriter::initSegments(int default_segment_length, int num_segments)
+{
+    // a byte is shared if a segment starts inside it
+    shared_bytes.clear();
+    for (int i = 1; i < num_segments; i++)
+    {
+        uint64_t start_bit = (uint64_t) i * default_segment_length * bits_per_state;
+        if ((start_bit & 7) && (shared_bytes.empty() || shared_bytes.back() != start_bit >> 3))
+            shared_bytes.push_back(start_bit >> 3);
+    }
+    shared_byte_values.assign(shared_bytes.size() * num_seqs, 0);
+}
+
+uint64_t AliSimBinaryWriter::packSegment(int seq_index, SimStateVector &states, int segment_start, int segment_length, string &packed)
+{
+    uint64_t start_bit = (uint64_t) segment_start * bits_per_state;
+    uint64_t first_byte = start_bit >> 3;
+    packStates(states, segment_length, packed, start_bit & 7);
+    
+    // merge the first and the last bytes if they are shared with the neighbouring segments
+    if (!packed.empty() && mergeSharedByte(seq_index, first_byte + packed.size() - 1, packed.back()))
+        packed.pop_back();
+    if (!packed.empty() && mergeSharedByte(seq_index, first_byte, packed[0]))
+    {
+        packed.erase(0, 1);
+        first_byte++;
+    }
+    
+    return data_offset + seq_index * bytes_per_seq + first_byte;
+}
+
+bool AliSimBinaryWriter::mergeSharedByte(int seq_index, uint64_t byte_offset, unsigned char value)
+{
+    vector<uint64_t>::iterator it = lower_bound(shared_bytes.begin(), shared_bytes.end(), byte_offset);
+    if (it == shared_bytes.end() || *it != byte_offset)
+        return false;
+    
+    // segments set disjoint bits of a shared byte
+    unsigned char &shared_value = shared_byte_values[seq_index * shared_bytes.size() + (it - shared_bytes.begin())];
+    #ifdef _OPENMP
+    #pragma omp atomic
+    #endif
+    shared_value |= value;
+    return true;
+}
+
+void AliSimBinaryWriter::writeSharedBytes()
+{
+    if (shared_bytes.empty())
+        return;
+    
+    try {
+        fstream out(file_path.c_str(), ios::in | ios::out | ios::binary);
+        out.exceptions(ios::failbit | ios::badbit);
+        for (int i = 0; i < num_seqs; i++)
+            for (int j = 0; j < shared_bytes.size(); j++)
+            {
+                out.seekp(data_offset + i * bytes_per_seq + shared_bytes[j]);
+                out.put((char) shared_byte_values[i * shared_bytes.size() + j]);
+            }
+        out.close();
+    } catch (ios::failure) {
+        outError(ERR_WRITE_OUTPUT, file_path);
+    }
+}
+
+void AliSimBinaryWriter::collectOutputNodes(vector<Node*> &nodes, Node *node, Node *dad)
+{
+    if (node->isLeaf() && node->name != ROOT_NAME)
+        nodes.push_back(node);
+
+    NeighborVec::iterator it;
+    FOR_NEIGHBOR(node, dad, it) {
+        collectOutputNodes(nodes, (*it)->node, node);
+    }
+}
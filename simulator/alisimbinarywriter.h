@@ -0,0 +1,141 @@
+//
+//  alisimbinarywriter.h
+//  iqtree
+//
+//  Packed binary alignment output of AliSim (-af bin)
+//
+
+#ifndef alisimbinarywriter_h
+#define alisimbinarywriter_h
+
+#include "alignment/alignment.h"
+#include "tree/mtree.h"
+
+/**
+*  packed binary alignment (-af bin), all integers in little-endian byte order:
+*  - header: ALIBIN_MAGIC, uint32 seq_type, num_sites_per_state, num_codes, bits_per_state, num_seqs, (reserved),
+*    uint64 sequence_length (in states), bytes_per_seq, data_offset
+*  - alphabet: num_sites_per_state characters for each code; states are coded 0..num_states-1, gaps as num_states
+*  - names: uint32 length + characters of each sequence name
+*  - data (at data_offset): sequence i is packed in bytes_per_seq bytes at data_offset + i * bytes_per_seq,
+*    state j at bits [j * bits_per_state, (j + 1) * bits_per_state) counted from the lowest bit of the first byte
+*/
+#define ALIBIN_MAGIC "ALIBIN01"
+#define ALIBIN_HEADER_SIZE 56
+
+/**
+ *  Layout of a packed binary alignment. The constructor writes everything but the sequences and extends the file to its full size,
+ *  then each sequence (or a segment of it) is packed and written at its own position, in any order and by any thread.
+ */
+class AliSimBinaryWriter {
+public:
+    /**
+        constructor, write the header, the alphabet and the sequence names
+        @param file_path the output file (with extension)
+        @param aln the alignment, for the sequence type and the number of states
+        @param state_mapping the characters of each state, see AliSimulator::initializeStateMapping()
+        @param seq_names names of the output sequences, in the order of their records
+        @param sequence_length number of states of each sequence
+        @param has_gaps TRUE to reserve a code for gaps
+     */
+    AliSimBinaryWriter(string file_path, Alignment *aln, vector<string> &state_mapping, vector<string> &seq_names, int sequence_length, bool has_gaps);
+
+    /**
+        pack states into bytes, states outside [0, num_states) and states beyond the end of the vector are written as gaps
+        @param states the states
+        @param num_packed_states number of states to pack
+        @param packed (OUT) (first_bit + num_packed_states * bits_per_state + 7) / 8 bytes
+        @param first_bit bit of the first byte where the first state starts (0-7)
+     */
+    void packStates(SimStateVector &states, int num_packed_states, string &packed, int first_bit = 0);
+
+    /**
+        @return the position of a segment of a sequence in the file
+        @param seq_index index of the sequence record
+        @param segment_start first state of the segment, a multiple of 8 so that the segment starts at a byte boundary
+     */
+    uint64_t getPosition(int seq_index, int segment_start);
+
+    /**
+        set the segments of the sequences simulated by the threads, segment i starts at state i * default_segment_length.
+        A segment needs not start at a byte boundary: the bytes shared by two segments are merged in memory and written by writeSharedBytes().
+        @param default_segment_length number of states of each segment but the last one
+        @param num_segments number of segments
+     */
+    void initSegments(int default_segment_length, int num_segments);
+
+    /**
+        pack a segment of a sequence; its bytes shared with other segments are merged in memory (thread-safe)
+        @param seq_index index of the sequence record
+        @param states the states of the segment
+        @param segment_start first state of the segment
+        @param segment_length number of states of the segment
+        @param packed (OUT) the bytes written only by this segment
+        @return the position of packed in the file
+     */
+    uint64_t packSegment(int seq_index, SimStateVector &states, int segment_start, int segment_length, string &packed);
+
+    /**
+        write the bytes shared by two segments, once all segments were packed
+     */
+    void writeSharedBytes();
+
+    /**
+        collect the nodes whose sequences are written, in the order of their records
+     */
+    static void collectOutputNodes(vector<Node*> &nodes, Node *node, Node *dad);
+
+    /**
+        the output file
+     */
+    string file_path;
+
+    /**
+        number of states (without gaps)
+     */
+    int num_states;
+
+    /**
+        number of codes (states, and gaps if any)
+     */
+    int num_codes;
+
+    /**
+        number of bits of each code
+     */
+    int bits_per_state;
+
+    /**
+        number of bytes of each sequence record
+     */
+    uint64_t bytes_per_seq;
+
+    /**
+        position of the first sequence record
+     */
+    uint64_t data_offset;
+
+    /**
+        number of sequence records
+     */
+    int num_seqs;
+
+    /**
+        offsets (in a record) of the bytes shared by two segments, in increasing order
+     */
+    vector<uint64_t> shared_bytes;
+
+    /**
+        merged values of the shared bytes, shared_bytes.size() for each record
+     */
+    vector<unsigned char> shared_byte_values;
+
+protected:
+    /**
+        merge a byte into the shared bytes of a record
+        @return FALSE if the byte is not shared (and not merged)
+     */
+    bool mergeSharedByte(int seq_index, uint64_t byte_offset, unsigned char value);
+};
+
+#endif /* alisimbinarywriter_h */
@@ -0,0 +1,209 @@
+//
+//  alisimoutputwriter.cpp
+//  iqtree
+//
+//  Background writer for AliSim output files when simulating many alignments
+//
+
+#include "alisimoutputwriter.h"
+#include "utils/gzstream.h"
+#include <zlib.h>
+
+AliSimOutputWriter::AliSimOutputWriter(bool compression, string archive_filepath, int max_pending_jobs)
+{
+    do_compression = compression;
+    this->archive_filepath = archive_filepath;
+    archive_size = 0;
+    this->max_pending_jobs = max(max_pending_jobs, 1);
+#ifdef _OPENMP
+    busy = false;
+    stop = false;
+    writer = std::thread(&AliSimOutputWriter::run, this);
+#endif
+}
+
+AliSimOutputWriter::~AliSimOutputWriter()
+{
+    stopWriter();
+}
+
+void AliSimOutputWriter::close()
+{
+    stopWriter();
+    checkWriteError();
+}
+
+void AliSimOutputWriter::stopWriter()
+{
+#ifdef _OPENMP
+    if (!writer.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(jobs_mutex);
+        stop = true;
+    }
+    job_submitted.notify_one();
+    writer.join();
+#endif
+    // the last alignments may still be buffered in the archive
+    if (archive.is_open())
+    {
+        try {
+            archive.close();
+            archive_index.close();
+        } catch (ios::failure) {
+            if (failed_filepath.empty())
+                failed_filepath = archive_filepath;
+        }
+    }
+}
+
+void AliSimOutputWriter::submit(string output_filepath, std::ios_base::openmode open_mode, string &content)
+{
+    OutputJob job;
+    job.output_filepath = output_filepath;
+    job.open_mode = open_mode;
+    job.content.swap(content);
+#ifdef _OPENMP
+    {
+        // limit the memory held by alignments waiting to be written
+        std::unique_lock<std::mutex> lock(jobs_mutex);
+        job_written.wait(lock, [this] { return (int) jobs.size() < max_pending_jobs; });
+        jobs.push_back(std::move(job));
+    }
+    job_submitted.notify_one();
+#else
+    if (!writeJob(job) && failed_filepath.empty())
+        failed_filepath = archive_filepath.empty() ? job.output_filepath : archive_filepath;
+#endif
+    checkWriteError();
+}
+
+void AliSimOutputWriter::flush()
+{
+#ifdef _OPENMP
+    std::unique_lock<std::mutex> lock(jobs_mutex);
+    job_written.wait(lock, [this] { return jobs.empty() && !busy; });
+    lock.unlock();
+#endif
+    checkWriteError();
+}
+
+bool AliSimOutputWriter::writeJob(OutputJob &job)
+{
+    // the streams are closed (and freed) when leaving the scope, also if writing fails
+    try {
+        if (!archive_filepath.empty())
+            writeArchiveMember(job);
+        else if (do_compression)
+        {
+            ogzstream out(job.output_filepath.c_str(), job.open_mode);
+            writeContent(out, job.content);
+            out.close();
+        }
+        else
+        {
+            ofstream out(job.output_filepath.c_str(), job.open_mode);
+            writeContent(out, job.content);
+            out.close();
+        }
+    } catch (ios::failure) {
+        return false;
+    }
+    return true;
+}
+
+void AliSimOutputWriter::writeArchiveMember(OutputJob &job)
+{
+    if (!archive.is_open())
+    {
+        archive.exceptions(ios::failbit | ios::badbit);
+        archive_index.exceptions(ios::failbit | ios::badbit);
+        archive.open(archive_filepath.c_str(), std::ios_base::out | std::ios_base::binary);
+        archive_index.open((archive_filepath + ".idx").c_str());
+    }
+    
+    // each gzip member could be decompressed alone, while the whole archive is still a valid gzip file
+    if (do_compression)
+    {
+        string compressed_content;
+        if (!compressContent(job.content, compressed_content))
+            throw ios::failure("could not compress " + job.output_filepath);
+        job.content.swap(compressed_content);
+    }
+    archive.write(job.content.data(), job.content.size());
+    
+    string file_name = job.output_filepath.substr(job.output_filepath.find_last_of("/\\") + 1);
+    archive_index << file_name << "\t" << archive_size << "\t" << job.content.size() << "\n";
+    archive_size += job.content.size();
+}
+
+bool AliSimOutputWriter::compressContent(const string &content, string &compressed_content)
+{
+    z_stream zs;
+    zs.zalloc = Z_NULL;
+    zs.zfree = Z_NULL;
+    zs.opaque = Z_NULL;
+    // 15 + 16: the largest window with a gzip header and trailer, as written by ogzstream
+    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        return false;
+    
+    compressed_content.resize(deflateBound(&zs, content.size()));
+    zs.next_in = (Bytef*) content.data();
+    zs.avail_in = content.size();
+    zs.next_out = (Bytef*) &compressed_content[0];
+    zs.avail_out = compressed_content.size();
+    int status = deflate(&zs, Z_FINISH);
+    compressed_content.resize(zs.total_out);
+    deflateEnd(&zs);
+    return status == Z_STREAM_END;
+}
+
+void AliSimOutputWriter::writeContent(ostream &out, const string &content)
+{
+    out.exceptions(ios::failbit | ios::badbit);
+    out.write(content.data(), content.size());
+}
+
+void AliSimOutputWriter::checkWriteError()
+{
+#ifdef _OPENMP
+    std::string filepath;
+    {
+        std::lock_guard<std::mutex> lock(jobs_mutex);
+        filepath = failed_filepath;
+    }
+#else
+    std::string filepath = failed_filepath;
+#endif
+    if (!filepath.empty())
+        outError(ERR_WRITE_OUTPUT, filepath);
+}
+
+#ifdef _OPENMP
+void AliSimOutputWriter::run()
+{
+    std::unique_lock<std::mutex> lock(jobs_mutex);
+    while (true)
+    {
+        job_submitted.wait(lock, [this] { return stop || !jobs.empty(); });
+        if (jobs.empty())
+            break;
+
+        // write the job without holding the lock so that the next alignment can be submitted meanwhile
+        OutputJob job = std::move(jobs.front());
+        jobs.pop_front();
+        busy = true;
+        lock.unlock();
+        job_written.notify_all();
+
+        bool written = writeJob(job);
+
+        lock.lock();
+        if (!written && failed_filepath.empty())
+            failed_filepath = archive_filepath.empty() ? job.output_filepath : archive_filepath;
+        busy = false;
+        job_written.notify_all();
+    }
+}
+#endif
@@ -0,0 +1,162 @@
+//
+//  alisimoutputwriter.h
+//  iqtree
+//
+//  Background writer for AliSim output files when simulating many alignments
+//
+
+#ifndef alisimoutputwriter_h
+#define alisimoutputwriter_h
+
+#include "utils/tools.h"
+#include <deque>
+#ifdef _OPENMP
+    #include <thread>
+    #include <mutex>
+    #include <condition_variable>
+#endif
+
+/**
+ *  Writes (and compresses) simulated alignments in a dedicated thread so that the next alignment can be simulated meanwhile.
+ *  Alignments are written in the order they were submitted, thus appending several alignments into a single output file works as before.
+ *  Alternatively, all alignments are written into one archive file: each alignment is a separate gzip member if compressed,
+ *  and a line <file name> <offset> <size> (in bytes, tab-separated) is added to <archive>.idx so that it could be extracted alone.
+ *  Without OpenMP (no pthread support), alignments are written immediately by the calling thread.
+ */
+class AliSimOutputWriter {
+public:
+    /**
+        constructor
+        @param compression TRUE to write gzip-compressed files
+        @param archive_filepath the archive file to write all alignments into, empty to write each alignment into its own output file
+        @param max_pending_jobs max number of alignments kept in memory before submit() waits for the writer
+     */
+    AliSimOutputWriter(bool compression, string archive_filepath = "", int max_pending_jobs = 8);
+
+    /**
+        deconstructor, write all pending alignments then stop the writer thread if close() was not called.
+        Write errors are not reported here (an error thrown by outError() must not leave a destructor), call close() for that
+     */
+    ~AliSimOutputWriter();
+
+    /**
+        submit the content of an output file to be written
+        @param output_filepath the output file, only its file name is recorded in the index if writing an archive
+        @param open_mode create a new file or append to an existing file (ignored if writing an archive)
+        @param content (IN) the content, (OUT) empty as it is moved to the writer
+     */
+    void submit(string output_filepath, std::ios_base::openmode open_mode, string &content);
+
+    /**
+        wait until all submitted alignments have been written
+     */
+    void flush();
+
+    /**
+        write all pending alignments, stop the writer thread, then show an error if an output file could not be written.
+        No alignment could be submitted afterwards
+     */
+    void close();
+
+    /**
+        an output file waiting to be written
+     */
+    struct OutputJob {
+        string output_filepath;
+        std::ios_base::openmode open_mode;
+        string content;
+    };
+
+protected:
+
+    /**
+        TRUE to write gzip-compressed files
+     */
+    bool do_compression;
+
+    /**
+        max number of alignments waiting to be written
+     */
+    int max_pending_jobs;
+
+    /**
+        alignments waiting to be written
+     */
+    deque<OutputJob> jobs;
+
+    /**
+        the archive file, empty if each alignment is written into its own output file
+     */
+    string archive_filepath;
+
+    /**
+        the archive and its index, opened when writing the first alignment
+     */
+    ofstream archive, archive_index;
+
+    /**
+        the size of the archive written so far
+     */
+    uint64_t archive_size;
+
+    /**
+        the first output file that could not be written
+     */
+    string failed_filepath;
+
+    /**
+        write an output file
+        @return FALSE if the file could not be written
+     */
+    bool writeJob(OutputJob &job);
+
+    /**
+        append an alignment to the archive then add it to the index, throw ios::failure if it fails
+     */
+    void writeArchiveMember(OutputJob &job);
+
+    /**
+        compress an alignment into a gzip member
+        @return FALSE if zlib failed
+     */
+    static bool compressContent(const string &content, string &compressed_content);
+
+    /**
+        write the content of an output file into an opened stream, throw ios::failure if it fails
+     */
+    static void writeContent(ostream &out, const string &content);
+
+    /**
+        show an error if an output file could not be written
+     */
+    void checkWriteError();
+
+    /**
+        write all pending alignments then stop the writer thread, do nothing if it was already stopped
+     */
+    void stopWriter();
+
+#ifdef _OPENMP
+    /**
+        TRUE if the writer thread is writing a job
+     */
+    bool busy;
+
+    /**
+        TRUE to stop the writer thread once all jobs have been written
+     */
+    bool stop;
+
+    std::thread writer;
+    std::mutex jobs_mutex;
+    std::condition_variable job_submitted;
+    std::condition_variable job_written;
+
+    /**
+        main loop of the writer thread
+     */
+    void run();
+#endif
+};
+
+#endif /* alisimoutputwriter_h */
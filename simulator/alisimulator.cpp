@@ -17,6 +17,8 @@ AliSimulator::AliSimulator(Params *input_params, int expected_number_sites, doub
     tree->initSequences();
     num_sites_per_state = tree->aln->seq_type == SEQ_CODON?3:1;
     STATE_UNKNOWN = tree->aln->STATE_UNKNOWN;
+    // node sequences store one state per byte (SimStateVector)
+    ASSERT(STATE_UNKNOWN <= UINT8_MAX);
     max_num_states = tree->aln->getMaxNumStates();
     latest_insertion = NULL;
     first_insertion = NULL;
@@ -51,6 +53,8 @@ AliSimulator::AliSimulator(Params *input_params, IQTree *iq_tree, int expected_n
     tree->initSequences();
     num_sites_per_state = tree->aln->seq_type == SEQ_CODON?3:1;
     STATE_UNKNOWN = tree->aln->STATE_UNKNOWN;
+    // node sequences store one state per byte (SimStateVector)
+    ASSERT(STATE_UNKNOWN <= UINT8_MAX);
     max_num_states = tree->aln->getMaxNumStates();
     latest_insertion = NULL;
     first_insertion = NULL;
@@ -486,7 +490,7 @@ void AliSimulator::removeConstantSites(){
 void AliSimulator::getOnlyVariantSites(vector<short int> &variant_state_mask, Node *node, Node *dad){
     if (node->isLeaf() && node->name!=ROOT_NAME) {
         // dummy sequence
-        vector<short int> variant_sites(variant_state_mask.size(),0);
+        SimStateVector variant_sites(variant_state_mask.size(),0);
         
         // initialize the number of variant sites
         int num_variant_states = 0;
@@ -524,7 +528,7 @@ void AliSimulator::getOnlyVariantSites(vector<short int> &variant_state_mask, No
 /**
 *  generate the current partition of an alignment from a tree (model, alignment instances are supplied via the IQTree instance)
 */
-void AliSimulator::generatePartitionAlignment(vector<short int> &ancestral_sequence, map<string,string> input_msa, std::vector<bool>* const site_locked_vec, string output_filepath, std::ios_base::openmode open_mode)
+void AliSimulator::generatePartitionAlignment(SimStateVector &ancestral_sequence, map<string,string> input_msa, std::vector<bool>* const site_locked_vec, string output_filepath, std::ios_base::openmode open_mode)
 {
     // reset number of chunks of the root sequence to 1
     tree->MTree::root->sequence->sequence_chunks.resize(1);
@@ -553,7 +557,7 @@ void AliSimulator::generatePartitionAlignment(vector<short int> &ancestral_seque
         int num_abundant_sites = expected_num_sites - ancestral_sequence.size();
         if (num_abundant_sites > 0)
         {
-            vector<short int> abundant_sites;
+            SimStateVector abundant_sites;
             generateRandomSequence(num_abundant_sites, abundant_sites);
             for (int site:abundant_sites)
                 tree->MTree::root->sequence->sequence_chunks[0].push_back(site);
@@ -590,7 +594,7 @@ void AliSimulator::createVariantStateMask(vector<short int> &variant_state_mask,
         if (num_variant_states == -1)
         {
             num_variant_states = 0;
-            variant_state_mask = node->sequence->sequence_chunks[0];
+            variant_state_mask.assign(node->sequence->sequence_chunks[0].begin(), node->sequence->sequence_chunks[0].end());
         }
         // otherwise, check state by state to update the mask
         else
@@ -631,7 +635,7 @@ void AliSimulator::createVariantStateMask(vector<short int> &variant_state_mask,
 *  randomly generate the ancestral sequence for the root node
 *  by default (initial_freqs = true) freqs could be randomly generated if they are not specified
 */
-void AliSimulator::generateRandomSequence(int sequence_length, vector<short int> &sequence, bool initial_freqs)
+void AliSimulator::generateRandomSequence(int sequence_length, SimStateVector &sequence, bool initial_freqs)
 {
     // if the Frequency Type is FREQ_EQUAL -> randomly generate each site in the sequence follows the normal distribution
     if (tree->getModel()->getFreqType() == FREQ_EQUAL)
@@ -778,12 +782,28 @@ void AliSimulator::simulateSeqsForTree(map<string,string> input_msa, std::vector
     // init variables
     initVariables(sequence_length, output_filepath, state_mapping, model, default_segment_length, max_depth, write_sequences_to_tmp_data, store_seq_at_cache, site_locked_vec, generator);
     
+    // drop cached transition matrices if the model has changed since the previous alignment
+    if (trans_matrix_cache)
+        trans_matrix_cache->validate(model);
+    
+    // write packed binary sequences into their own records while simulating them
+    if (output_filepath.length() > 0 && params->aln_output_format == IN_ALIBIN && store_seq_at_cache && state_mapping.size() > 0)
+        initBinaryOutput(output_filepath, state_mapping, default_segment_length);
+    
     // execute one of the AliSim-OpenMP algorithms to simulate sequences
     if (params->alisim_openmp_alg == IM)
         executeIM(thread_id, sequence_length, default_segment_length, model, input_msa, site_locked_vec, output_filepath, open_mode, write_sequences_to_tmp_data, store_seq_at_cache, max_depth, state_mapping);
     else
         executeEM(thread_id, sequence_length, default_segment_length, model, input_msa, site_locked_vec, output_filepath, open_mode, write_sequences_to_tmp_data, store_seq_at_cache, max_depth, state_mapping);
     
+    // write the bytes shared by the segments of two threads, then delete the binary writer
+    if (binary_writer)
+    {
+        binary_writer->writeSharedBytes();
+        delete binary_writer;
+        binary_writer = NULL;
+    }
+    
     // process after simulating sequences
     postSimulateSeqs(sequence_length, output_filepath, write_sequences_to_tmp_data);
 }
@@ -793,7 +813,7 @@ void AliSimulator::executeEM(int thread_id, int &sequence_length, int default_se
     ostream *single_output = NULL;
     ostream *out = NULL;
     int *rstream = NULL;
-    vector<vector<short int>> sequence_cache;
+    vector<SimStateVector> sequence_cache;
     int actual_segment_length = sequence_length;
     
     // default_random_engine for generating a random number from a discrete distribution
@@ -835,11 +855,11 @@ void AliSimulator::executeEM(int thread_id, int &sequence_length, int default_se
         
         // close the output stream
         if (output_filepath.length() > 0 || write_sequences_to_tmp_data)
-            closeOutputStream(out, num_threads != 1);
+            closeOutputStream(out, num_threads != 1 || binary_writer);
         
         // release sequence cache
         if (store_seq_at_cache)
-            vector<vector<short int>>().swap(sequence_cache);
+            vector<SimStateVector>().swap(sequence_cache);
         
         // release mem for rstream
         finish_random(rstream);
@@ -865,8 +885,8 @@ void AliSimulator::mergeOutputFiles(ostream *&single_output, int thread_id, stri
     
     if (output_filepath.length() > 0 && !write_sequences_to_tmp_data)
     {
-        // merge output files into a single file
-        if (num_threads != 1)
+        // merge output files into a single file (all threads write into the same binary output)
+        if (num_threads != 1 && !binary_writer)
         {
             // open single_output stream
             #ifdef _OPENMP
@@ -1025,7 +1045,7 @@ void AliSimulator::executeIM(int thread_id, int &sequence_length, int default_se
     int actual_segment_length = sequence_length;
     ostream *out = NULL;
     int *rstream = NULL;
-    vector<vector<short int>> sequence_cache;
+    vector<SimStateVector> sequence_cache;
     // default_random_engine for generating a random number from a discrete distribution
     default_random_engine generator;
     generator.seed(params->ran_seed + MPIHelper::getInstance().getProcessID() * 1000 + params->alignment_id);
@@ -1112,7 +1132,7 @@ void AliSimulator::executeIM(int thread_id, int &sequence_length, int default_se
         
         // release sequence cache
         if (store_seq_at_cache)
-            vector<vector<short int>>().swap(sequence_cache);
+            vector<SimStateVector>().swap(sequence_cache);
         
         // release mem for rstream
         finish_random(rstream);
@@ -1123,7 +1143,7 @@ void AliSimulator::executeIM(int thread_id, int &sequence_length, int default_se
     
     // close the output stream
     if (output_filepath.length() > 0 || write_sequences_to_tmp_data)
-        closeOutputStream(out);
+        closeOutputStream(out, binary_writer);
 }
 
 void AliSimulator::writeSeqChunkFromCache(ostream *&out)
@@ -1342,6 +1362,13 @@ void AliSimulator::initVariables(int sequence_length, string output_filepath, ve
 */
 void AliSimulator::initOutputFile(ostream *&out, int thread_id, int actual_segment_length, string output_filepath, std::ios_base::openmode open_mode, bool write_sequences_to_tmp_data)
 {
+    // all threads update the binary output, which was already created with its full size
+    if (binary_writer)
+    {
+        openOutputStream(out, binary_writer->file_path, std::ios_base::in | std::ios_base::out | std::ios_base::binary, true);
+        return;
+    }
+    
     if (output_filepath.length() > 0 || write_sequences_to_tmp_data)
     {
         // init an output_filepath to temporarily output the sequences (when simulating Indels)
@@ -1410,11 +1437,48 @@ void AliSimulator::initOutputFile(ostream *&out, int thread_id, int actual_segme
     }
 }
 
+/**
+    init the packed binary output (-af bin)
+*/
+void AliSimulator::initBinaryOutput(string output_filepath, vector<string> &state_mapping, int default_segment_length)
+{
+    // collect the output sequences in the same order as text outputs
+    vector<Node*> nodes;
+    AliSimBinaryWriter::collectOutputNodes(nodes, tree->root, tree->root);
+    
+    // map node's id to the index of its record
+    vector<string> seq_names(nodes.size());
+    binary_record_index.clear();
+    for (int i = 0; i < nodes.size(); i++)
+    {
+        seq_names[i] = nodes[i]->name;
+        // write node's id if node's name is empty
+        if (seq_names[i].length() == 0)
+            seq_names[i] = convertIntToString(nodes[i]->id);
+        if (nodes[i]->id >= binary_record_index.size())
+            binary_record_index.resize(nodes[i]->id + 1, -1);
+        binary_record_index[nodes[i]->id] = i;
+    }
+    
+    // sequences are simulated without gaps
+    binary_writer = new AliSimBinaryWriter(getOutputNameWithExt(IN_ALIBIN, output_filepath), tree->aln, state_mapping, seq_names, round(expected_num_sites * inverse_length_ratio), false);
+    binary_writer->initSegments(default_segment_length, num_simulating_threads);
+}
+
 /**
     open an output stream
 */
 void AliSimulator::openOutputStream(ostream *&out, string output_filepath, std::ios_base::openmode open_mode, bool force_uncompression)
 {
+    // buffer the output in memory, output_writer will write (and compress) it to file
+    if (output_writer && !force_uncompression)
+    {
+        out = new ostringstream();
+        buffered_output_filepath = output_filepath;
+        buffered_open_mode = open_mode;
+        return;
+    }
+    
     try {
         if (params->do_compression && !force_uncompression)
             out = new ogzstream(output_filepath.c_str(), open_mode);
@@ -1431,6 +1495,23 @@ void AliSimulator::openOutputStream(ostream *&out, string output_filepath, std::
 */
 void AliSimulator::closeOutputStream(ostream *&out, bool force_uncompression)
 {
+    if (output_writer && !force_uncompression)
+    {
+        string content = ((ostringstream*)out)->str();
+        delete out;
+        if (deferred_outputs)
+        {
+            AliSimOutputWriter::OutputJob job;
+            job.output_filepath = buffered_output_filepath;
+            job.open_mode = buffered_open_mode;
+            job.content.swap(content);
+            deferred_outputs->push_back(std::move(job));
+        }
+        else
+            output_writer->submit(buffered_output_filepath, buffered_open_mode, content);
+        return;
+    }
+    
     if (params->do_compression && !force_uncompression)
         ((ogzstream*)out)->close();
     else
@@ -1442,7 +1523,7 @@ void AliSimulator::closeOutputStream(ostream *&out, bool force_uncompression)
 *  simulate sequences for all nodes in the tree by DFS
 *
 */
-void AliSimulator::simulateSeqs(int thread_id, int segment_start, int &segment_length, int &sequence_length, ModelSubst *model, double *trans_matrix, vector<vector<short int>> &sequence_cache, bool store_seq_at_cache, Node *node, Node *dad, ostream &out, vector<string> &state_mapping, map<string,string> input_msa, std::vector<bool>* const site_locked_vec, int* rstream, default_random_engine& generator)
+void AliSimulator::simulateSeqs(int thread_id, int segment_start, int &segment_length, int &sequence_length, ModelSubst *model, double *trans_matrix, vector<SimStateVector> &sequence_cache, bool store_seq_at_cache, Node *node, Node *dad, ostream &out, vector<string> &state_mapping, map<string,string> input_msa, std::vector<bool>* const site_locked_vec, int* rstream, default_random_engine& generator)
 {
     // process its neighbors/children
     NeighborVec::iterator it;
@@ -1452,7 +1533,7 @@ void AliSimulator::simulateSeqs(int thread_id, int segment_start, int &segment_l
             (*it)->node->sequence->num_gaps = node->sequence->num_gaps;
         
         // get dad_seq_chunk and node_seq_chunk
-        vector<short int> *dad_seq_chunk, *node_seq_chunk;
+        SimStateVector *dad_seq_chunk, *node_seq_chunk;
         if (store_seq_at_cache)
         {
             int dad_depth = node->sequence->depth;
@@ -1572,7 +1653,7 @@ void AliSimulator::simulateSeqs(int thread_id, int segment_start, int &segment_l
     }
 }
 
-void AliSimulator::handlePreMutations(const NeighborVec::iterator& it, int& predefined_mutation_count, const int& segment_start, const int& segment_length, const int& seq_length, vector<short int>* const node_seq_chunk)
+void AliSimulator::handlePreMutations(const NeighborVec::iterator& it, int& predefined_mutation_count, const int& segment_start, const int& segment_length, const int& seq_length, SimStateVector* const node_seq_chunk)
 {
     // parse the list of predefined mutations (if any)
     auto atb_it = (*it)->attributes.find(MTree::ANTT_MUT);
@@ -1618,7 +1699,7 @@ void AliSimulator::handlePreMutations(const NeighborVec::iterator& it, int& pred
 /**
     branch-specific evolution by multi threads
 */
-void AliSimulator::branchSpecificEvolution(int thread_id, int sequence_length, vector<short int> &dad_seq_chunk, vector<short int> &node_seq_chunk, bool store_seq_at_cache, double *trans_matrix, Node *node, NeighborVec::iterator it, int* rstream, default_random_engine& generator)
+void AliSimulator::branchSpecificEvolution(int thread_id, int sequence_length, SimStateVector &dad_seq_chunk, SimStateVector &node_seq_chunk, bool store_seq_at_cache, double *trans_matrix, Node *node, NeighborVec::iterator it, int* rstream, default_random_engine& generator)
 {
     unsigned short int num_threads_reach_barrier = 0;
     
@@ -1664,8 +1745,8 @@ void AliSimulator::branchSpecificEvolution(int thread_id, int sequence_length, v
         node_seq_chunk = (*it)->node->sequence->sequence_chunks[thread_id];
         
         // release memory allocated to node and dad node
-        vector<short int>().swap((*it)->node->sequence->sequence_chunks[thread_id]);
-        vector<short int>().swap(node->sequence->sequence_chunks[thread_id]);
+        SimStateVector().swap((*it)->node->sequence->sequence_chunks[thread_id]);
+        SimStateVector().swap(node->sequence->sequence_chunks[thread_id]);
         
         // manual implementation of barrier
         waitAtBarrier(4, (*it)->node);
@@ -1676,8 +1757,8 @@ void AliSimulator::branchSpecificEvolution(int thread_id, int sequence_length, v
         #endif
         {
             // release memory allocated to the node
-            vector<vector<short int>>().swap((*it)->node->sequence->sequence_chunks);
-            vector<vector<short int>>().swap(node->sequence->sequence_chunks);
+            vector<SimStateVector>().swap((*it)->node->sequence->sequence_chunks);
+            vector<SimStateVector>().swap(node->sequence->sequence_chunks);
         }
     }
 }
@@ -1707,11 +1788,11 @@ void AliSimulator::writeInternalStatesIndels(Node* node, ostream &out)
 {
     out << node->name<<"@"<<node->sequence->sequence_chunks[0].size()<<"@";
     for (int i = 0; i < node->sequence->sequence_chunks[0].size(); i++)
-        out << node->sequence->sequence_chunks[0][i]<<" ";
+        out << (int) node->sequence->sequence_chunks[0][i]<<" ";
     out<<endl;
     
     // release the memory
-    vector<short int>().swap(node->sequence->sequence_chunks[0]);
+    SimStateVector().swap(node->sequence->sequence_chunks[0]);
     
     map_seqname_node[node->name] = node;
 }
@@ -1773,7 +1854,7 @@ void AliSimulator::mergeAndWriteSeqIndelFunDi(int thread_id, ostream &out, int s
                             convertNumericalStatesIntoReadableCharacters((*it)->node->sequence->sequence_chunks[0], output, sequence_length, num_sites_per_state, state_mapping);
                         
                         // release memory allocated to the sequence chunk
-                        vector<short int>().swap((*it)->node->sequence->sequence_chunks[0]);
+                        SimStateVector().swap((*it)->node->sequence->sequence_chunks[0]);
                         
                         // write output to file
                         #ifdef _OPENMP
@@ -1805,7 +1886,7 @@ void AliSimulator::mergeAndWriteSeqIndelFunDi(int thread_id, ostream &out, int s
                             convertNumericalStatesIntoReadableCharacters(node->sequence->sequence_chunks[0], output, sequence_length, num_sites_per_state, state_mapping);
                         
                         // release memory allocated to the sequence chunk
-                        vector<short int>().swap(node->sequence->sequence_chunks[0]);
+                        SimStateVector().swap(node->sequence->sequence_chunks[0]);
                         
                         // write output to file
                         #ifdef _OPENMP
@@ -1822,10 +1903,20 @@ void AliSimulator::mergeAndWriteSeqIndelFunDi(int thread_id, ostream &out, int s
 /**
     write and delete the current chunk of sequence if possible
 */
-void AliSimulator::writeAndDeleteSequenceChunkIfPossible(int thread_id, int segment_start, int segment_length, vector<short int> &dad_seq_chunk, vector<short int> &node_seq_chunk, bool store_seq_at_cache, ostream &out, vector<string> &state_mapping, map<string,string> input_msa, NeighborVec::iterator it, Node* node)
+void AliSimulator::writeAndDeleteSequenceChunkIfPossible(int thread_id, int segment_start, int segment_length, SimStateVector &dad_seq_chunk, SimStateVector &node_seq_chunk, bool store_seq_at_cache, ostream &out, vector<string> &state_mapping, map<string,string> input_msa, NeighborVec::iterator it, Node* node)
 {
+    // write packed sequences at tips into their records of the binary output
+    if (binary_writer)
+    {
+        if ((*it)->node->isLeaf())
+            outputOneBinarySequence((*it)->node, node_seq_chunk, thread_id, segment_start, segment_length, out);
+        
+        // avoid writing sequence of __root__
+        if (node->isLeaf() && node->name!=ROOT_NAME)
+            outputOneBinarySequence(node, dad_seq_chunk, thread_id, segment_start, segment_length, out);
+    }
     // we can only write and delete sequence chunk in normal simulations: without Indels, FunDi, ASC, etc
-    if (params->alisim_insertion_ratio + params->alisim_deletion_ratio == 0 && state_mapping.size() > 0)
+    else if (params->alisim_insertion_ratio + params->alisim_deletion_ratio == 0 && state_mapping.size() > 0)
     {
         if (params->alisim_fundi_taxon_set.size() == 0)
         {
@@ -1894,7 +1985,7 @@ void AliSimulator::writeAndDeleteSequenceChunkIfPossible(int thread_id, int segm
         
         // delete sequence at internal node if all sequences of its children are simulated
         if (!node->isLeaf() && node->sequence->nums_children_done_simulation[thread_id] >= (node->neighbors.size() - 1) && !(params->alisim_insertion_ratio + params->alisim_deletion_ratio > 0 && params->alisim_write_internal_sequences))
-            vector<short int>().swap(dad_seq_chunk);
+            SimStateVector().swap(dad_seq_chunk);
     }
 }
 
@@ -1947,6 +2038,24 @@ void AliSimulator::outputOneSequence(Node* node, string &output, int thread_id,
     }
 }
 
+void AliSimulator::outputOneBinarySequence(Node* node, SimStateVector &sequence_chunk, int thread_id, int segment_start, int segment_length, ostream &out)
+{
+    string packed;
+    int64_t pos = binary_writer->packSegment(binary_record_index[node->id], sequence_chunk, segment_start, segment_length, packed);
+    if (packed.empty())
+        return;
+    
+    //  cache output into the writing queue (AliSim-OpenMP-IM)
+    if (params->alisim_openmp_alg == IM && num_threads != 1)
+        cacheSeqChunkStr(pos, packed, thread_id);
+    // write output to file
+    else
+    {
+        out.seekp(pos);
+        out.write(packed.data(), packed.size());
+    }
+}
+
 void AliSimulator::cacheSeqChunkStr(int64_t pos, string seq_chunk_str, int thread_id)
 {
     // seek an empty slot in the cache
@@ -2027,6 +2136,21 @@ int AliSimulator::getRandomItemWithProbabilityMatrix(double *probability_maxtrix
 }
 
 
+/**
+*  compute the accumulated transition probability matrix, or copy it from trans_matrix_cache if cached
+*/
+void AliSimulator::computeAccumulatedTransMatrix(ModelSubst *model, double time, double *trans_matrix, int mixture)
+{
+    if (trans_matrix_cache && trans_matrix_cache->getMatrix(model, mixture, time, trans_matrix))
+        return;
+    
+    model->computeTransMatrix(time, trans_matrix, mixture);
+    convertProMatrixIntoAccumulatedProMatrix(trans_matrix, max_num_states, max_num_states);
+    
+    if (trans_matrix_cache)
+        trans_matrix_cache->addMatrix(model, mixture, time, trans_matrix);
+}
+
 /**
 *  convert an probability matrix into an accumulated probability matrix
 */
@@ -2258,7 +2382,7 @@ void AliSimulator::initializeStateMapping(int num_sites_per_state, Alignment *al
 *  convert numerical states into readable characters
 *
 */
-void AliSimulator::convertNumericalStatesIntoReadableCharacters(vector<short int> &sequence_chunk, string &output, int sequence_length, int num_sites_per_state, vector<string> &state_mapping, int segment_length)
+void AliSimulator::convertNumericalStatesIntoReadableCharacters(SimStateVector &sequence_chunk, string &output, int sequence_length, int num_sites_per_state, vector<string> &state_mapping, int segment_length)
 {
     segment_length = segment_length == -1 ? sequence_length : segment_length;
     ASSERT(segment_length <= sequence_chunk.size());
@@ -2582,13 +2706,10 @@ void AliSimulator::simulateASequenceFromBranch(ModelSubst *model, int sequence_l
 /**
     simulate a sequence for a node from a specific branch after all variables has been initializing
 */
-void AliSimulator::simulateASequenceFromBranchAfterInitVariables(int segment_start, ModelSubst *model, double *trans_matrix, vector<short int> &dad_seq_chunk, vector<short int> &node_seq_chunk, Node *node, NeighborVec::iterator it, int* rstream, string lengths)
+void AliSimulator::simulateASequenceFromBranchAfterInitVariables(int segment_start, ModelSubst *model, double *trans_matrix, SimStateVector &dad_seq_chunk, SimStateVector &node_seq_chunk, Node *node, NeighborVec::iterator it, int* rstream, string lengths)
 {
-    // compute the transition probability matrix
-    model->computeTransMatrix(partition_rate * params->alisim_branch_scale * (*it)->length, trans_matrix);
-    
-    // convert the probability matrix into an accumulated probability matrix
-    convertProMatrixIntoAccumulatedProMatrix(trans_matrix, max_num_states, max_num_states);
+    // compute the accumulated transition probability matrix
+    computeAccumulatedTransMatrix(model, partition_rate * params->alisim_branch_scale * (*it)->length, trans_matrix);
     
     // estimate the sequence for the current neighbor
     for (int i = 0; i < node_seq_chunk.size(); i++)
@@ -2616,7 +2737,7 @@ void AliSimulator::initVariablesRateHeterogeneity(int sequence_length, default_r
 /**
     regenerate the root sequence if the user has specified specific state frequencies in branch-specific model
 */
-void AliSimulator::regenerateRootSequenceBranchSpecificModel(string freqs, int sequence_length, vector<short int> &sequence){
+void AliSimulator::regenerateRootSequenceBranchSpecificModel(string freqs, int sequence_length, SimStateVector &sequence){
     std::cout << "Regenerate the root sequence according to user-defined state frequencies." << std::endl;
     
     // initizlize state_freqs
@@ -2668,7 +2789,7 @@ void AliSimulator::regenerateRootSequenceBranchSpecificModel(string freqs, int s
 /**
     generate a random sequence by state frequencies
 */
-void AliSimulator::generateRandomSequenceFromStateFreqs(int sequence_length, vector<short int> &sequence, double* state_freqs, int max_prob_pos)
+void AliSimulator::generateRandomSequenceFromStateFreqs(int sequence_length, SimStateVector &sequence, double* state_freqs, int max_prob_pos)
 {
     sequence.resize(sequence_length);
     
@@ -2683,7 +2804,7 @@ void AliSimulator::generateRandomSequenceFromStateFreqs(int sequence_length, vec
 /**
 *  export a sequence with gaps copied from the input sequence
 */
-void AliSimulator::exportSequenceWithGaps(vector<short int> &sequence_chunk, string &output, int sequence_length, int num_sites_per_state, string input_sequence, vector<string> &state_mapping, int segment_start, int segment_length)
+void AliSimulator::exportSequenceWithGaps(SimStateVector &sequence_chunk, string &output, int sequence_length, int num_sites_per_state, string input_sequence, vector<string> &state_mapping, int segment_start, int segment_length)
 {
     segment_length = segment_length == -1 ? sequence_length : segment_length;
     
@@ -2784,7 +2905,7 @@ void AliSimulator::extractRatesJMatrix(ModelSubst *model)
 /**
     initialize variables for Rate_matrix approach: total_sub_rate, accumulated_rates, num_gaps
 */
-void AliSimulator::initVariables4RateMatrix(int segment_start, double &total_sub_rate, int &num_gaps, vector<double> &sub_rate_by_site, vector<short int> &sequence)
+void AliSimulator::initVariables4RateMatrix(int segment_start, double &total_sub_rate, int &num_gaps, vector<double> &sub_rate_by_site, SimStateVector &sequence)
 {
     // initialize variables
     total_sub_rate = 0;
@@ -2819,16 +2940,18 @@ void AliSimulator::initVariables4RateMatrix(int segment_start, double &total_sub
 /**
     handle indels
 */
-void AliSimulator::simulateSeqByGillespie(int segment_start, int &segment_length, ModelSubst *model, vector<short int> &node_seq_chunk, int &sequence_length, NeighborVec::iterator it, SIMULATION_METHOD simulation_method, std::vector<bool>* const site_locked_vec, const int& total_predefined_mutation_count, int *rstream, default_random_engine& generator)
+void AliSimulator::simulateSeqByGillespie(int segment_start, int &segment_length, ModelSubst *model, SimStateVector &node_seq_chunk, int &sequence_length, NeighborVec::iterator it, SIMULATION_METHOD simulation_method, std::vector<bool>* const site_locked_vec, const int& total_predefined_mutation_count, int *rstream, default_random_engine& generator)
 {
     int predefined_mutation_count = total_predefined_mutation_count;
     int num_gaps = 0;
     double total_sub_rate = 0;
-    vector<double> sub_rate_by_site;
+    SiteRateSampler sub_rate_by_site;
     // If AliSim is using RATE_MATRIX approach -> initialize variables for Rate_matrix approach: total_sub_rate, accumulated_rates, num_gaps
     if (simulation_method == RATE_MATRIX || params->indel_rate_variation)
     {
-        initVariables4RateMatrix(segment_start, total_sub_rate, num_gaps, sub_rate_by_site, node_seq_chunk);
+        vector<double> sub_rates_of_sites;
+        initVariables4RateMatrix(segment_start, total_sub_rate, num_gaps, sub_rates_of_sites, node_seq_chunk);
+        sub_rate_by_site.init(sub_rates_of_sites);
         
         // handle cases when total_sub_rate == NaN due to extreme freqs
         if (total_sub_rate != total_sub_rate)
@@ -2867,6 +2990,13 @@ void AliSimulator::simulateSeqByGillespie(int segment_start, int &segment_length
     int ori_seq_length = node_seq_chunk.size();
     Insertion* insertion_before_simulation = latest_insertion;
     
+    // work on a chunked copy of the sequence so that insertions do not shift the whole tail of the sequence
+    ChunkedSequence indel_sequence;
+    indel_sequence.assign(node_seq_chunk.begin(), node_seq_chunk.end());
+    // insertions also grow the per-site vectors (indels are simulated with a single thread, segment_start is 0)
+    if (params->alisim_insertion_ratio > 0)
+        chunkSiteVectors();
+    
     double branch_length = (*it)->length * params->alisim_branch_scale;
     while (branch_length > 0)
     {
@@ -2897,13 +3027,13 @@ void AliSimulator::simulateSeqByGillespie(int segment_start, int &segment_length
             {
                 case INSERTION:
                 {
-                    length_change = handleInsertion(sequence_length, node_seq_chunk, total_sub_rate, sub_rate_by_site, simulation_method, generator);
+                    length_change = handleInsertion(sequence_length, indel_sequence, total_sub_rate, sub_rate_by_site, simulation_method, generator);
                     segment_length = sequence_length;
                     break;
                 }
                 case DELETION:
                 {
-                    int deletion_length = handleDeletion(sequence_length, node_seq_chunk, total_sub_rate, sub_rate_by_site, simulation_method, generator);
+                    int deletion_length = handleDeletion(sequence_length, indel_sequence, total_sub_rate, sub_rate_by_site, simulation_method, generator);
                     length_change = -deletion_length;
                     (*it)->node->sequence->num_gaps += deletion_length;
                     break;
@@ -2917,7 +3047,7 @@ void AliSimulator::simulateSeqByGillespie(int segment_start, int &segment_length
                             --predefined_mutation_count;
                         // otherwise, no predefined mutations or all of them were paid, handle a new substitution
                         else
-                            handleSubs(segment_start, total_sub_rate, sub_rate_by_site, node_seq_chunk, model->getNMixtures(), site_locked_vec, rstream, generator);
+                            handleSubs(segment_start, total_sub_rate, sub_rate_by_site, indel_sequence, model->getNMixtures(), site_locked_vec, rstream, generator);
                     }
                     break;
                 }
@@ -2951,6 +3081,11 @@ void AliSimulator::simulateSeqByGillespie(int segment_start, int &segment_length
 
     }
     
+    // copy the simulated sequence back
+    indel_sequence.exportTo(node_seq_chunk);
+    if (site_vectors_chunked)
+        unchunkSiteVectors();
+    
     // if insertion events occur -> insert gaps to other nodes
     if (insertion_before_simulation && insertion_before_simulation->next)
     {
@@ -2969,13 +3104,37 @@ void AliSimulator::simulateSeqByGillespie(int segment_start, int &segment_length
     }
 }
 
+/**
+    copy the per-site vectors into their chunked copies, so that insertions do not shift their whole tail
+*/
+void AliSimulator::chunkSiteVectors()
+{
+    chunked_site_specific_model_index.assign(site_specific_model_index.begin(), site_specific_model_index.end());
+    chunked_site_specific_rate_index.assign(site_specific_rate_index.begin(), site_specific_rate_index.end());
+    chunked_site_specific_rates.assign(site_specific_rates.begin(), site_specific_rates.end());
+    chunked_site_to_patternID.assign(site_to_patternID.begin(), site_to_patternID.end());
+    site_vectors_chunked = true;
+}
+
+/**
+    copy the chunked per-site vectors back
+*/
+void AliSimulator::unchunkSiteVectors()
+{
+    chunked_site_specific_model_index.exportTo(site_specific_model_index);
+    chunked_site_specific_rate_index.exportTo(site_specific_rate_index);
+    chunked_site_specific_rates.exportTo(site_specific_rates);
+    chunked_site_to_patternID.exportTo(site_to_patternID);
+    site_vectors_chunked = false;
+}
+
 /**
 *  insert a new sequence into the current sequence
 *
 */
-void AliSimulator::insertNewSequenceForInsertionEvent(vector<short int> &indel_sequence, int position, vector<short int> &new_sequence, default_random_engine& generator)
+void AliSimulator::insertNewSequenceForInsertionEvent(ChunkedSequence &indel_sequence, int position, SimStateVector &new_sequence, default_random_engine& generator)
 {
-    indel_sequence.insert(indel_sequence.begin()+position, new_sequence.begin(), new_sequence.end());
+    indel_sequence.insert(position, new_sequence.begin(), new_sequence.end());
 }
 
 /**
@@ -3053,7 +3212,7 @@ void AliSimulator::updateInternalSeqsFromNodeToRoot(GenomeTree* genome_tree, int
 /**
     handle insertion events
 */
-int AliSimulator::handleInsertion(int &sequence_length, vector<short int> &indel_sequence, double &total_sub_rate, vector<double> &sub_rate_by_site, SIMULATION_METHOD simulation_method, default_random_engine& generator)
+int AliSimulator::handleInsertion(int &sequence_length, ChunkedSequence &indel_sequence, double &total_sub_rate, SiteRateSampler &sub_rate_by_site, SIMULATION_METHOD simulation_method, default_random_engine& generator)
 {
     // Randomly select the position/site (from the set of all sites) where the insertion event occurs
     int position;
@@ -3063,8 +3222,8 @@ int AliSimulator::handleInsertion(int &sequence_length, vector<short int> &indel
     // with indel-rate variation -> based on the sub_rate_by_site
     else
     {
-        discrete_distribution<> random_discrete_dis(sub_rate_by_site.begin(), sub_rate_by_site.end());
-        position = random_discrete_dis(generator);
+        uniform_real_distribution<double> random_uniform_dis(0.0, 1.0);
+        position = sub_rate_by_site.sample(random_uniform_dis(generator));
     }
     
     // Randomly generate the length (length_I) of inserted sites from the indel-length distribution (​​geometric distribution (by default) or user-defined distributions).
@@ -3082,7 +3241,7 @@ int AliSimulator::handleInsertion(int &sequence_length, vector<short int> &indel
         outError("Sorry! Could not generate a positive length (for insertion events) based on the insertion-distribution within 1000 attempts.");
     
     // insert new_sequence into the current sequence
-    vector<short int> new_sequence;
+    SimStateVector new_sequence;
     generateRandomSequence(length, new_sequence, false);
     insertNewSequenceForInsertionEvent(indel_sequence, position, new_sequence, generator);
     
@@ -3091,15 +3250,16 @@ int AliSimulator::handleInsertion(int &sequence_length, vector<short int> &indel
     {
         // update sub_rate_by_site of the inserted sites
         double sub_rate_change = 0;
-        sub_rate_by_site.insert(sub_rate_by_site.begin()+position, length, 0);
+        vector<double> inserted_sub_rates(length);
         for (int i = position; i < position + length; i++)
         {
             // NHANLT: potential improvement
             // cache site_specific_model_index[i] * max_num_states
-            double sub_rate_from_model = site_specific_model_index.size() == 0 ? sub_rates[indel_sequence[i]] : sub_rates[site_specific_model_index[i] * max_num_states + indel_sequence[i]];
-            sub_rate_by_site[i] = site_specific_rates.size() > 0 ? (site_specific_rates[i] * sub_rate_from_model) : sub_rate_from_model;
-            sub_rate_change += sub_rate_by_site[i];
+            double sub_rate_from_model = getNumSiteSpecificModelIndexes() == 0 ? sub_rates[new_sequence[i - position]] : sub_rates[getSiteSpecificModelIndex(i) * max_num_states + new_sequence[i - position]];
+            inserted_sub_rates[i - position] = getNumSiteSpecificRates() > 0 ? (getSiteSpecificRate(i) * sub_rate_from_model) : sub_rate_from_model;
+            sub_rate_change += inserted_sub_rates[i - position];
         }
+        sub_rate_by_site.insertSites(position, inserted_sub_rates);
         
         // update total_sub_rate
         total_sub_rate += sub_rate_change;
@@ -3120,7 +3280,7 @@ int AliSimulator::handleInsertion(int &sequence_length, vector<short int> &indel
 /**
     handle deletion events
 */
-int AliSimulator::handleDeletion(int sequence_length, vector<short int> &indel_sequence, double &total_sub_rate, vector<double> &sub_rate_by_site, SIMULATION_METHOD simulation_method, default_random_engine& generator)
+int AliSimulator::handleDeletion(int sequence_length, ChunkedSequence &indel_sequence, double &total_sub_rate, SiteRateSampler &sub_rate_by_site, SIMULATION_METHOD simulation_method, default_random_engine& generator)
 {
     // Randomly generate the length (length_D) of sites (which will be deleted) from the indel-length distribution.
     int length = -1;
@@ -3148,8 +3308,8 @@ int AliSimulator::handleDeletion(int sequence_length, vector<short int> &indel_s
     // with indel-rate variation -> based on the sub_rate_by_site
     else
     {
-        discrete_distribution<> random_discrete_dis(sub_rate_by_site.begin(), sub_rate_by_site.end());
-        position = random_discrete_dis(generator);
+        uniform_real_distribution<double> random_uniform_dis(0.0, 1.0);
+        position = sub_rate_by_site.sample(random_uniform_dis(generator));
     }
     
     // Replace up to length_D sites by gaps from the sequence starting at the selected location
@@ -3158,9 +3318,9 @@ int AliSimulator::handleDeletion(int sequence_length, vector<short int> &indel_s
     for (int i = 0; i < length && (position + i) < indel_sequence.size(); i++)
     {
         // if the current site is not a gap (has not been deleted) -> replacing it by a gap
-        if (indel_sequence[position + i ] != STATE_UNKNOWN)
+        if (indel_sequence.get(position + i) != STATE_UNKNOWN)
         {
-            indel_sequence[position + i ] = STATE_UNKNOWN;
+            indel_sequence.set(position + i, STATE_UNKNOWN);
             real_deleted_length++;
         }
         // otherwise, ignore the current site, moving forward to find a valid site (not a gap)
@@ -3173,8 +3333,8 @@ int AliSimulator::handleDeletion(int sequence_length, vector<short int> &indel_s
         // if RATE_MATRIX approach is used -> update sub_rate_by_site
         if (simulation_method == RATE_MATRIX || params->indel_rate_variation)
         {
-            sub_rate_change -= sub_rate_by_site[position + i];
-            sub_rate_by_site[position + i] = 0;
+            sub_rate_change -= sub_rate_by_site.getRate(position + i);
+            sub_rate_by_site.setRate(position + i, 0);
         }
     }
     
@@ -3189,15 +3349,15 @@ int AliSimulator::handleDeletion(int sequence_length, vector<short int> &indel_s
 /**
     handle substitution events
 */
-void AliSimulator::handleSubs(int segment_start, double &total_sub_rate, vector<double> &sub_rate_by_site, vector<short int> &indel_sequence, int num_mixture_models, std::vector<bool>* const site_locked_vec, int* rstream, default_random_engine& generator)
+void AliSimulator::handleSubs(int segment_start, double &total_sub_rate, SiteRateSampler &sub_rate_by_site, ChunkedSequence &indel_sequence, int num_mixture_models, std::vector<bool>* const site_locked_vec, int* rstream, default_random_engine& generator)
 {
     // select a position where the substitution event occurs
-    discrete_distribution<> random_discrete_dis(sub_rate_by_site.begin(), sub_rate_by_site.end());
+    uniform_real_distribution<double> random_uniform_dis(0.0, 1.0);
     int pos;
     // make up to indel_sequence.size() attempts to select an unlocked site
     for (int i = 0; i < indel_sequence.size(); i++)
     {
-        pos = random_discrete_dis(generator);
+        pos = sub_rate_by_site.sample(random_uniform_dis(generator));
         
         // a valid site must NOT be locked
         if (!site_locked_vec || !site_locked_vec->at(segment_start + pos))
@@ -3208,37 +3368,38 @@ void AliSimulator::handleSubs(int segment_start, double &total_sub_rate, vector<
         outError("Failed to select a site for a substitution to occur. It may be because almost all sites are locked by prededfined mutaions!");
     
     // extract the current state
-    short int current_state = indel_sequence[pos];
+    short int current_state = indel_sequence.get(pos);
     
     // estimate the new state
     int mixture_index = 0;
     // randomly select a model component if mixture model at substitution level is used
-    if (site_specific_model_index.size() > segment_start + pos)
+    if (getNumSiteSpecificModelIndexes() > segment_start + pos)
     {
         if (params->alisim_mixture_at_sub_level)
             mixture_index = getRandomItemWithAccumulatedProbMatrixMaxProbFirst(mixture_accumulated_weight, 0, num_mixture_models, mixture_max_weight_pos, rstream);
         else
-            mixture_index = site_specific_model_index[segment_start + pos];
+            mixture_index = getSiteSpecificModelIndex(segment_start + pos);
     }
     
     int mixture_index_times_num_states = (mixture_index == 0 ? 0 : (mixture_index * max_num_states));
     int starting_index = (mixture_index_times_num_states + current_state) * max_num_states;
-    indel_sequence[pos] = getRandomItemWithAccumulatedProbMatrixMaxProbFirst(Jmatrix, starting_index, max_num_states, max_num_states * 0.5, rstream);
+    short int new_state = getRandomItemWithAccumulatedProbMatrixMaxProbFirst(Jmatrix, starting_index, max_num_states, max_num_states * 0.5, rstream);
+    indel_sequence.set(pos, new_state);
     
     // update total_sub_rate
-    double sub_rate_change = sub_rates[mixture_index_times_num_states + indel_sequence[pos]] - sub_rates[mixture_index_times_num_states + current_state];
-    sub_rate_change = (site_specific_rates.size() == 0 ? sub_rate_change : (sub_rate_change * site_specific_rates[segment_start + pos]));
+    double sub_rate_change = sub_rates[mixture_index_times_num_states + new_state] - sub_rates[mixture_index_times_num_states + current_state];
+    sub_rate_change = (getNumSiteSpecificRates() == 0 ? sub_rate_change : (sub_rate_change * getSiteSpecificRate(segment_start + pos)));
     total_sub_rate += sub_rate_change;
     
     // update sub_rate_by_site
-    sub_rate_by_site[pos] += sub_rate_change;
+    sub_rate_by_site.addRate(pos, sub_rate_change);
 }
 
 /**
 *  randomly select a valid position (not a deleted-site) for insertion/deletion event
 *
 */
-int AliSimulator::selectValidPositionForIndels(int upper_bound, vector<short int> &sequence)
+int AliSimulator::selectValidPositionForIndels(int upper_bound, ChunkedSequence &sequence)
 {
     int position = -1;
     for (int i = 0; i < upper_bound; i++)
@@ -3246,17 +3407,17 @@ int AliSimulator::selectValidPositionForIndels(int upper_bound, vector<short int
         position = random_int(upper_bound);
         
         // try to move to the following site if the selected site is a gap
-        if (position < sequence.size() && sequence[position] == STATE_UNKNOWN)
+        if (position < sequence.size() && sequence.get(position) == STATE_UNKNOWN)
             for (; position < upper_bound; position++)
-                if (position == sequence.size() || sequence[position] != STATE_UNKNOWN)
+                if (position == sequence.size() || sequence.get(position) != STATE_UNKNOWN)
                     break;
         
         // a valid position must not be a deleted site
-        if (position == sequence.size() || sequence[position] != STATE_UNKNOWN)
+        if (position == sequence.size() || sequence.get(position) != STATE_UNKNOWN)
             break;
     }
     // validate the position
-    if (position < sequence.size() && sequence[position] == STATE_UNKNOWN)
+    if (position < sequence.size() && sequence.get(position) == STATE_UNKNOWN)
         outError("Sorry! Could not select a valid position (not a deleted-site) for insertion/deletion events. You may specify a too high deletion rate, thus almost all sites were deleted. Please try again a a smaller deletion ratio!");
     return position;
 }
@@ -3400,7 +3561,7 @@ void AliSimulator::computeSwitchingParam(int seq_length)
 /**
     change state of sites due to Error model
 */
-void AliSimulator::changeSitesErrorModel(vector<int> sites, vector<short int> &sequence_chunk, double error_prop, int* rstream)
+void AliSimulator::changeSitesErrorModel(vector<int> sites, SimStateVector &sequence_chunk, double error_prop, int* rstream)
 {
     // estimate the total of sites need to change
     int num_changes = round(error_prop*sites.size());
@@ -3441,7 +3602,7 @@ void AliSimulator::changeSitesErrorModel(vector<int> sites, vector<short int> &s
 /**
     handle DNA error
 */
-void AliSimulator::handleDNAerr(int segment_start, double error_prop, vector<short int> &sequence_chunk, int* rstream, int model_index)
+void AliSimulator::handleDNAerr(int segment_start, double error_prop, SimStateVector &sequence_chunk, int* rstream, int model_index)
 {
     // dummy variables
     vector<int> sites;
@@ -3680,7 +3841,7 @@ void AliSimulator::separateSeqIntoChunks(Node* node)
 {
     if (node->sequence->sequence_chunks.size() != num_simulating_threads)
     {
-        vector<short int> root_seq = node->sequence->sequence_chunks[0];
+        SimStateVector root_seq = node->sequence->sequence_chunks[0];
         assert(root_seq.size() == expected_num_sites);
         node->sequence->sequence_chunks.resize(num_simulating_threads);
         int default_segment_length = expected_num_sites / num_simulating_threads;
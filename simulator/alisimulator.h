@@ -30,6 +30,11 @@
 #endif
 #include "utils/MPIHelper.h"
 #include "alignment/sequencechunkstr.h"
+#include "chunkedvector.h"
+#include "siteratesampler.h"
+#include "alisimoutputwriter.h"
+#include "alisimbinarywriter.h"
+#include "transmatrixcache.h"
 
 struct FunDi_Item {
   int selected_site;
@@ -77,7 +82,7 @@ protected:
     *  randomly generate the ancestral sequence for the root node
     *  by default (initial_freqs = true) freqs could be randomly generated if they are not specified
     */
-    void generateRandomSequence(int sequence_length, vector<short int> &sequence, bool initial_freqs = true);
+    void generateRandomSequence(int sequence_length, SimStateVector &sequence, bool initial_freqs = true);
     
     /**
     *  randomly generate the base frequencies
@@ -98,6 +103,11 @@ protected:
     *  convert an probability matrix into an accumulated probability matrix
     */
     void convertProMatrixIntoAccumulatedProMatrix(double *probability_maxtrix, int num_rows, int num_columns, bool force_round_1 = true);
+    
+    /**
+    *  compute the accumulated transition probability matrix, or copy it from trans_matrix_cache if cached
+    */
+    void computeAccumulatedTransMatrix(ModelSubst *model, double time, double *trans_matrix, int mixture = 0);
 
     /**
     *  binary search an item from a set with accumulated probability array
@@ -112,13 +122,13 @@ protected:
     /**
     *  handle predefined mutations at a branch
     */
-    void handlePreMutations(const NeighborVec::iterator& it, int& predefined_mutation_count, const int& segment_start, const int& segment_length, const int& seq_length, vector<short int>* const node_seq_chunk);
+    void handlePreMutations(const NeighborVec::iterator& it, int& predefined_mutation_count, const int& segment_start, const int& segment_length, const int& seq_length, SimStateVector* const node_seq_chunk);
     
     /**
     *  simulate sequences for all nodes in the tree by DFS
     *
     */
-    void simulateSeqs(int thread_id, int segment_start, int &segment_length, int &sequence_length, ModelSubst *model, double *trans_matrix, vector<vector<short int>> &sequence_cache, bool store_seq_at_cache, Node *node, Node *dad, ostream &out, vector<string> &state_mapping, map<string, string> input_msa, std::vector<bool>* const site_locked_vec, int* rstream, default_random_engine& generator);
+    void simulateSeqs(int thread_id, int segment_start, int &segment_length, int &sequence_length, ModelSubst *model, double *trans_matrix, vector<SimStateVector> &sequence_cache, bool store_seq_at_cache, Node *node, Node *dad, ostream &out, vector<string> &state_mapping, map<string, string> input_msa, std::vector<bool>* const site_locked_vec, int* rstream, default_random_engine& generator);
     
     /**
     *  reset tree (by reset some variables of nodes)
@@ -190,12 +200,12 @@ protected:
     /**
         write and delete the current chunk of sequence if possible
     */
-    void writeAndDeleteSequenceChunkIfPossible(int thread_id, int segment_start, int segment_length, vector<short int> &dad_seq_chunk, vector<short int> &node_seq_chunk, bool store_seq_at_cache, ostream &out, vector<string> &state_mapping, map<string, string> input_msa, NeighborVec::iterator it, Node* node);
+    void writeAndDeleteSequenceChunkIfPossible(int thread_id, int segment_start, int segment_length, SimStateVector &dad_seq_chunk, SimStateVector &node_seq_chunk, bool store_seq_at_cache, ostream &out, vector<string> &state_mapping, map<string, string> input_msa, NeighborVec::iterator it, Node* node);
     
     /**
         branch-specific evolution by multi threads
     */
-    void branchSpecificEvolution(int thread_id, int sequence_length, vector<short int> &dad_seq_chunk, vector<short int> &node_seq_chunk, bool store_seq_at_cache, double *trans_matrix, Node *node, NeighborVec::iterator it, int* rstream, default_random_engine& generator);
+    void branchSpecificEvolution(int thread_id, int sequence_length, SimStateVector &dad_seq_chunk, SimStateVector &node_seq_chunk, bool store_seq_at_cache, double *trans_matrix, Node *node, NeighborVec::iterator it, int* rstream, default_random_engine& generator);
     
     
     /**
@@ -211,7 +221,7 @@ protected:
     /**
         simulate a sequence for a node from a specific branch after all variables has been initializing
     */
-    virtual void simulateASequenceFromBranchAfterInitVariables(int segment_start, ModelSubst *model, double *trans_matrix, vector<short int> &dad_seq_chunk, vector<short int> &node_seq_chunk, Node *node, NeighborVec::iterator it, int* rstream, string lengths = "");
+    virtual void simulateASequenceFromBranchAfterInitVariables(int segment_start, ModelSubst *model, double *trans_matrix, SimStateVector &dad_seq_chunk, SimStateVector &node_seq_chunk, Node *node, NeighborVec::iterator it, int* rstream, string lengths = "");
     
     /**
         initialize variables
@@ -231,37 +241,67 @@ protected:
     /**
         regenerate the root sequence if the user has specified specific state frequencies in branch-specific model
     */
-    void regenerateRootSequenceBranchSpecificModel(string freqs, int sequence_length, vector<short int> &sequence);
+    void regenerateRootSequenceBranchSpecificModel(string freqs, int sequence_length, SimStateVector &sequence);
     
     /**
         generate a random sequence by state frequencies
     */
-    void generateRandomSequenceFromStateFreqs(int sequence_length, vector<short int> &sequence, double* state_freqs, int max_prob_pos);
+    void generateRandomSequenceFromStateFreqs(int sequence_length, SimStateVector &sequence, double* state_freqs, int max_prob_pos);
     
     /**
     *  export a sequence with gaps copied from the input sequence
     */
-    void exportSequenceWithGaps(vector<short int> &sequence_chunk, string &output, int sequence_length, int num_sites_per_state, string input_sequence, vector<string> &state_mapping, int segment_start = 0, int segment_length = -1);
+    void exportSequenceWithGaps(SimStateVector &sequence_chunk, string &output, int sequence_length, int num_sites_per_state, string input_sequence, vector<string> &state_mapping, int segment_start = 0, int segment_length = -1);
     
     /**
         handle indels
     */
-    void simulateSeqByGillespie(int segment_start, int &segment_length, ModelSubst *model, vector<short int> &node_seq_chunk, int &sequence_length, NeighborVec::iterator it, SIMULATION_METHOD simulation_method, std::vector<bool>* const site_locked_vec, const int& total_predefined_mutation_count, int *rstream, default_random_engine& generator);
+    void simulateSeqByGillespie(int segment_start, int &segment_length, ModelSubst *model, SimStateVector &node_seq_chunk, int &sequence_length, NeighborVec::iterator it, SIMULATION_METHOD simulation_method, std::vector<bool>* const site_locked_vec, const int& total_predefined_mutation_count, int *rstream, default_random_engine& generator);
     
     /**
         handle substitution events
     */
-    void handleSubs(int segment_start, double &total_sub_rate, vector<double> &sub_rate_by_site, vector<short int> &indel_sequence, int num_mixture_models, std::vector<bool>* const site_locked_vec, int* rstream, default_random_engine& generator);
+    void handleSubs(int segment_start, double &total_sub_rate, SiteRateSampler &sub_rate_by_site, ChunkedSequence &indel_sequence, int num_mixture_models, std::vector<bool>* const site_locked_vec, int* rstream, default_random_engine& generator);
+    
+    /**
+        copy the per-site vectors into their chunked copies, so that insertions do not shift their whole tail
+    */
+    void chunkSiteVectors();
+    
+    /**
+        copy the chunked per-site vectors back
+    */
+    void unchunkSiteVectors();
+    
+    /**
+        @return number of site-specific model indexes (of the chunked copy while simulating indels on a branch)
+    */
+    int getNumSiteSpecificModelIndexes() { return site_vectors_chunked ? chunked_site_specific_model_index.size() : site_specific_model_index.size(); }
+    
+    /**
+        @return the model index of a site (from the chunked copy while simulating indels on a branch)
+    */
+    short int getSiteSpecificModelIndex(int site) { return site_vectors_chunked ? chunked_site_specific_model_index.get(site) : site_specific_model_index[site]; }
+    
+    /**
+        @return number of site-specific rates (of the chunked copy while simulating indels on a branch)
+    */
+    int getNumSiteSpecificRates() { return site_vectors_chunked ? chunked_site_specific_rates.size() : site_specific_rates.size(); }
+    
+    /**
+        @return the rate of a site (from the chunked copy while simulating indels on a branch)
+    */
+    double getSiteSpecificRate(int site) { return site_vectors_chunked ? chunked_site_specific_rates.get(site) : site_specific_rates[site]; }
     
     /**
         handle insertion events, return the insertion-size
     */
-    int handleInsertion(int &sequence_length, vector<short int> &indel_sequence, double &total_sub_rate, vector<double> &sub_rate_by_site, SIMULATION_METHOD simulation_method, default_random_engine& generator);
+    int handleInsertion(int &sequence_length, ChunkedSequence &indel_sequence, double &total_sub_rate, SiteRateSampler &sub_rate_by_site, SIMULATION_METHOD simulation_method, default_random_engine& generator);
     
     /**
         handle deletion events, return the deletion-size
     */
-    int handleDeletion(int sequence_length, vector<short int> &indel_sequence, double &total_sub_rate, vector<double> &sub_rate_by_site, SIMULATION_METHOD simulation_method, default_random_engine& generator);
+    int handleDeletion(int sequence_length, ChunkedSequence &indel_sequence, double &total_sub_rate, SiteRateSampler &sub_rate_by_site, SIMULATION_METHOD simulation_method, default_random_engine& generator);
     
     /**
         extract array of substitution rates and Jmatrix
@@ -271,13 +311,13 @@ protected:
     /**
         initialize variables for Rate_matrix approach: total_sub_rate, accumulated_rates, num_gaps
     */
-    virtual void initVariables4RateMatrix(int segment_start, double &total_sub_rate, int &num_gaps, vector<double> &sub_rate_by_site, vector<short int> &sequence);
+    virtual void initVariables4RateMatrix(int segment_start, double &total_sub_rate, int &num_gaps, vector<double> &sub_rate_by_site, SimStateVector &sequence);
     
     /**
     *  insert a new sequence into the current sequence
     *
     */
-    virtual void insertNewSequenceForInsertionEvent(vector<short int> &indel_sequence, int position, vector<short int> &new_sequence, default_random_engine& generator);
+    virtual void insertNewSequenceForInsertionEvent(ChunkedSequence &indel_sequence, int position, SimStateVector &new_sequence, default_random_engine& generator);
     
     /**
     *  update internal sequences due to Indels
@@ -301,7 +341,7 @@ protected:
     *  randomly select a valid position (not a deleted-site) for insertion/deletion event
     *
     */
-    int selectValidPositionForIndels(int upper_bound, vector<short int> &sequence);
+    int selectValidPositionForIndels(int upper_bound, ChunkedSequence &sequence);
     
     /**
         generate indel-size from its distribution
@@ -326,12 +366,12 @@ protected:
     /**
         change state of sites due to Error model
     */
-    void changeSitesErrorModel(vector<int> sites, vector<short int> &sequence, double error_prop, int* rstream);
+    void changeSitesErrorModel(vector<int> sites, SimStateVector &sequence, double error_prop, int* rstream);
     
     /**
         handle DNA error
     */
-    void handleDNAerr(int segment_start, double error_prop, vector<short int> &sequence, int* rstream, int model_index = -1);
+    void handleDNAerr(int segment_start, double error_prop, SimStateVector &sequence, int* rstream, int model_index = -1);
     
     /**
         TRUE if posterior mean rate can be used
@@ -369,12 +409,17 @@ protected:
     void initOutputFile(ostream *&out, int thread_id, int actual_segment_length, string output_filepath, std::ios_base::openmode open_mode, bool write_sequences_to_tmp_data);
     
     /**
-        open an output stream
+        init the packed binary output (-af bin): write everything but the sequences, which are written at their own positions when simulated
+    */
+    void initBinaryOutput(string output_filepath, vector<string> &state_mapping, int default_segment_length);
+    
+    /**
+        open an output stream, or an in-memory buffer if the output is written by output_writer
     */
     void openOutputStream(ostream *&out, string output_filepath, std::ios_base::openmode open_mode, bool force_uncompression = false);
     
     /**
-        close an output stream
+        close an output stream, passing the buffered output to output_writer if used
     */
     void closeOutputStream(ostream *&out, bool force_uncompression = false);
     
@@ -418,6 +463,11 @@ protected:
     */
     void outputOneSequence(Node* node, string &output, int thread_id, int segment_start, ostream &out);
     
+    /**
+        pack a sequence (chunk) and write it into its record of the packed binary output (if using AliSim-OpenMP-EM) or store it to common cache (if using AliSim-OpenMP-IM)
+    */
+    void outputOneBinarySequence(Node* node, SimStateVector &sequence_chunk, int thread_id, int segment_start, int segment_length, ostream &out);
+    
     /**
         Traverse the tree from root to update the ancestral (root) sequence according to the predefined mutations
     */
@@ -439,6 +489,13 @@ public:
     vector<short int> site_specific_model_index;
     vector<short int> site_specific_rate_index;
     vector<double> site_specific_rates;
+    
+    // chunked copies of the per-site vectors above (and site_to_patternID), used instead of them while simulating indels on a branch
+    bool site_vectors_chunked = false;
+    ChunkedVector<short int, 1024> chunked_site_specific_model_index;
+    ChunkedVector<short int, 1024> chunked_site_specific_rate_index;
+    ChunkedVector<double, 1024> chunked_site_specific_rates;
+    ChunkedVector<int, 1024> chunked_site_to_patternID;
     const int RATE_ZERO_INDEX = -1;
     const int RATE_ONE_INDEX = 0;
     double* sub_rates;
@@ -462,6 +519,20 @@ public:
     int cache_size_per_thread;
     bool force_output_PHYLIP = false;
     
+    // writer thread for the output alignments (NULL: write output files directly)
+    AliSimOutputWriter* output_writer = NULL;
+    // output files kept here instead of being passed to output_writer, to be submitted later in the order of the alignments (NULL: submit them right away)
+    vector<AliSimOutputWriter::OutputJob>* deferred_outputs = NULL;
+    string buffered_output_filepath;
+    std::ios_base::openmode buffered_open_mode = std::ios_base::out;
+    
+    // packed binary output written while simulating (NULL: text output, or binary output written after the simulation)
+    AliSimBinaryWriter* binary_writer = NULL;
+    IntVector binary_record_index;
+    
+    // cache of accumulated transition matrices shared by all threads and alignments (NULL: no caching)
+    TransMatrixCache* trans_matrix_cache = NULL;
+    
     // variables using for posterior mean rates/state frequencies
     bool applyPosRateHeterogeneity = false;
     double* ptn_state_freq = NULL;
@@ -494,7 +565,7 @@ public:
     /**
     *  generate the current partition of an alignment from a tree (model, alignment instances are supplied via the IQTree instance)
     */
-    void generatePartitionAlignment(vector<short int> &ancestral_sequence, map<string,string> input_msa, std::vector<bool>* const site_locked_vec, string output_filepath = "", std::ios_base::openmode open_mode = std::ios_base::out);
+    void generatePartitionAlignment(SimStateVector &ancestral_sequence, map<string,string> input_msa, std::vector<bool>* const site_locked_vec, string output_filepath = "", std::ios_base::openmode open_mode = std::ios_base::out);
     
     /**
     *  update the expected_num_sites due to the change of the sequence_length
@@ -511,7 +582,7 @@ public:
     *  convert numerical states into readable characters
     *
     */
-    static void convertNumericalStatesIntoReadableCharacters(vector<short int> &sequence_chunk, string &output, int sequence_length, int num_sites_per_state, vector<string> &state_mapping, int segment_length = -1);
+    static void convertNumericalStatesIntoReadableCharacters(SimStateVector &sequence_chunk, string &output, int sequence_length, int num_sites_per_state, vector<string> &state_mapping, int segment_length = -1);
     
     /**
     *  export pre_output string (containing taxon name and ">" or "space" based on the output format)
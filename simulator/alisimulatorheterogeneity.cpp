@@ -33,6 +33,9 @@ AliSimulatorHeterogeneity::AliSimulatorHeterogeneity(AliSimulator *alisimulator)
     output_line_length = alisimulator->output_line_length;
     num_threads = alisimulator->num_threads;
     force_output_PHYLIP = alisimulator->force_output_PHYLIP;
+    output_writer = alisimulator->output_writer;
+    deferred_outputs = alisimulator->deferred_outputs;
+    trans_matrix_cache = alisimulator->trans_matrix_cache;
 }
 
 /**
@@ -147,7 +150,7 @@ void AliSimulatorHeterogeneity::intSiteSpecificModelIndexPosteriorProb(int seque
 /**
     regenerate ancestral sequence based on mixture model component base fequencies
 */
-vector<short int> AliSimulatorHeterogeneity::regenerateSequenceMixtureModel(int length, vector<short int> &new_site_specific_model_index){
+SimStateVector AliSimulatorHeterogeneity::regenerateSequenceMixtureModel(int length, vector<short int> &new_site_specific_model_index){
     // dummy variables
     ModelSubst* model = tree->getModel();
     int num_models = model->getNMixtures();
@@ -175,7 +178,7 @@ vector<short int> AliSimulatorHeterogeneity::regenerateSequenceMixtureModel(int
     convertProMatrixIntoAccumulatedProMatrix(base_freqs_all_components, num_models, num_states);
     
     // re-generate the sequence
-    vector <short int> new_sequence(length, num_states);
+    SimStateVector new_sequence(length, num_states);
     int num_states_minus_one = num_states - 1;
     for (int i = 0; i < length; i++)
     {
@@ -221,7 +224,7 @@ void AliSimulatorHeterogeneity::extractPatternPosteriorFreqsAndModelProb()
 /**
     regenerate sequence based on posterior mean state frequencies (for mixture models)
 */
-vector<short int> AliSimulatorHeterogeneity::regenerateSequenceMixtureModelPosteriorMean(int length, IntVector &site_to_patternID)
+SimStateVector AliSimulatorHeterogeneity::regenerateSequenceMixtureModelPosteriorMean(int length, IntVector &site_to_patternID)
 {
     ASSERT(tree->params->alisim_stationarity_heterogeneity == POSTERIOR_MEAN);
     
@@ -241,7 +244,7 @@ vector<short int> AliSimulatorHeterogeneity::regenerateSequenceMixtureModelPoste
     }
     
     // re-generate the sequence
-    vector <short int> new_sequence(length, max_num_states);
+    SimStateVector new_sequence(length, max_num_states);
     int max_num_states_minus_one = max_num_states - 1;
     for (int i = 0; i < length; i++)
     {
@@ -296,17 +299,14 @@ void AliSimulatorHeterogeneity::intializeCachingAccumulatedTransMatrices(double
             double rate = rate_heterogeneity->getNRate() == 1?1:rate_heterogeneity->getRate(category_index);
             double branch_length_by_category = rate_heterogeneity->isHeterotachy()?branch_lengths[category_index]:branch_lengths[0];
             
-            // compute the transition matrix
-            model->computeTransMatrix(combine_rate * branch_length_by_category * rate, trans_matrix, model_index);
+            // compute the accumulated transition matrix
+            computeAccumulatedTransMatrix(model, combine_rate * branch_length_by_category * rate, trans_matrix, model_index);
             
-            // copy the transition matrix to the cache_trans_matrix
+            // copy the accumulated transition matrix to the cache_trans_matrix
             for (int trans_index = 0; trans_index < num_state_square; trans_index++)
                 cache_trans_matrix_pointer[trans_index] = trans_matrix[trans_index];
         }
     }
-    
-    // convert cache_trans_matrix into an accumulated cache_trans_matrix
-    convertProMatrixIntoAccumulatedProMatrix(cache_trans_matrix, num_models * num_rate_categories * max_num_states, max_num_states);
 }
 
 /**
@@ -601,7 +601,7 @@ void AliSimulatorHeterogeneity::getSiteSpecificRates(vector<short int> &new_site
 /**
     simulate a sequence for a node from a specific branch after all variables has been initializing
 */
-void AliSimulatorHeterogeneity::simulateASequenceFromBranchAfterInitVariables(int segment_start, ModelSubst *model, double *trans_matrix, vector<short int> &dad_seq_chunk, vector<short int> &node_seq_chunk, Node *node, NeighborVec::iterator it, int* rstream, string lengths){
+void AliSimulatorHeterogeneity::simulateASequenceFromBranchAfterInitVariables(int segment_start, ModelSubst *model, double *trans_matrix, SimStateVector &dad_seq_chunk, SimStateVector &node_seq_chunk, Node *node, NeighborVec::iterator it, int* rstream, string lengths){
     
     // estimate the sequence for the current neighbor
     // check if trans_matrix could be caching (without rate_heterogeneity or the num of rate_categories is lowr than the threshold (5)) or not
@@ -698,7 +698,7 @@ void AliSimulatorHeterogeneity::initVariablesRateHeterogeneity(int sequence_leng
 *  insert a new sequence into the current sequence
 *
 */
-void AliSimulatorHeterogeneity::insertNewSequenceForInsertionEvent(vector<short int> &indel_sequence, int position, vector<short int> &new_sequence, default_random_engine& generator)
+void AliSimulatorHeterogeneity::insertNewSequenceForInsertionEvent(ChunkedSequence &indel_sequence, int position, SimStateVector &new_sequence, default_random_engine& generator)
 {
     // init new_site_to_patternID
     IntVector new_site_to_patternID;
@@ -710,12 +710,12 @@ void AliSimulatorHeterogeneity::insertNewSequenceForInsertionEvent(vector<short
         int site_id;
         for (int i = 0; i < new_sequence.size(); i++)
         {
-            site_id = random_int(site_to_patternID.size());
-            new_site_to_patternID[i] = site_to_patternID[site_id];
+            site_id = random_int(chunked_site_to_patternID.size());
+            new_site_to_patternID[i] = chunked_site_to_patternID.get(site_id);
         }
         
         // insert new_site_to_patternID into site_to_patternID
-        site_to_patternID.insert(site_to_patternID.begin()+position, new_site_to_patternID.begin(), new_site_to_patternID.end());
+        chunked_site_to_patternID.insert(position, new_site_to_patternID.begin(), new_site_to_patternID.end());
     }
     
     // initialize new_site_specific_model_index
@@ -723,7 +723,7 @@ void AliSimulatorHeterogeneity::insertNewSequenceForInsertionEvent(vector<short
     intializeSiteSpecificModelIndex(new_sequence.size(), new_site_specific_model_index, new_site_to_patternID);
     
     // insert new_site_specific_model_index into site_specific_model_index
-    site_specific_model_index.insert(site_specific_model_index.begin()+position, new_site_specific_model_index.begin(), new_site_specific_model_index.end());
+    chunked_site_specific_model_index.insert(position, new_site_specific_model_index.begin(), new_site_specific_model_index.end());
     
     // initialize new_site_specific_rates, and new_site_specific_rate_index for new sequence
     vector<double> new_site_specific_rates;
@@ -731,10 +731,10 @@ void AliSimulatorHeterogeneity::insertNewSequenceForInsertionEvent(vector<short
     getSiteSpecificRates(new_site_specific_rate_index, new_site_specific_rates, new_site_specific_model_index, new_sequence.size(), new_site_to_patternID, generator);
     
     // insert new_site_specific_rates into site_specific_rates
-    site_specific_rates.insert(site_specific_rates.begin()+position, new_site_specific_rates.begin(), new_site_specific_rates.end());
+    chunked_site_specific_rates.insert(position, new_site_specific_rates.begin(), new_site_specific_rates.end());
     
     // insert new_site_specific_rate_index into site_specific_rate_index
-    site_specific_rate_index.insert(site_specific_rate_index.begin()+position, new_site_specific_rate_index.begin(), new_site_specific_rate_index.end());
+    chunked_site_specific_rate_index.insert(position, new_site_specific_rate_index.begin(), new_site_specific_rate_index.end());
     
     // regenerate new_sequence if mixture model is used
     if (tree->getModel()->isMixture())
@@ -754,7 +754,7 @@ void AliSimulatorHeterogeneity::insertNewSequenceForInsertionEvent(vector<short
 /**
     initialize variables for Rate_matrix approach: total_sub_rate, accumulated_rates, num_gaps
 */
-void AliSimulatorHeterogeneity::initVariables4RateMatrix(int segment_start, double &total_sub_rate, int &num_gaps, vector<double> &sub_rate_by_site, vector<short int> &sequence)
+void AliSimulatorHeterogeneity::initVariables4RateMatrix(int segment_start, double &total_sub_rate, int &num_gaps, vector<double> &sub_rate_by_site, SimStateVector &sequence)
 {
     // initialize variables
     total_sub_rate = 0;
@@ -56,17 +56,17 @@ protected:
     /**
         regenerate sequence based on mixture model component base fequencies
     */
-    vector<short int> regenerateSequenceMixtureModel(int length, vector<short int> &new_site_specific_model_index);
+    SimStateVector regenerateSequenceMixtureModel(int length, vector<short int> &new_site_specific_model_index);
     
     /**
         regenerate sequence based on posterior mean state frequencies (for mixture models)
     */
-    vector<short int> regenerateSequenceMixtureModelPosteriorMean(int length, IntVector &site_to_patternID);
+    SimStateVector regenerateSequenceMixtureModelPosteriorMean(int length, IntVector &site_to_patternID);
     
     /**
         simulate a sequence for a node from a specific branch after all variables has been initializing
     */
-    virtual void simulateASequenceFromBranchAfterInitVariables(int segment_start, ModelSubst *model, double *trans_matrix, vector<short int> &dad_seq_chunk, vector<short int> &node_seq_chunk, Node *node, NeighborVec::iterator it, int* rstream, string lengths = "");
+    virtual void simulateASequenceFromBranchAfterInitVariables(int segment_start, ModelSubst *model, double *trans_matrix, SimStateVector &dad_seq_chunk, SimStateVector &node_seq_chunk, Node *node, NeighborVec::iterator it, int* rstream, string lengths = "");
     
     /**
         initialize variables (e.g., site-specific rate)
@@ -77,12 +77,12 @@ protected:
     *  insert a new sequence into the current sequence
     *
     */
-    virtual void insertNewSequenceForInsertionEvent(vector<short int> &indel_sequence, int position, vector<short int> &new_sequence, default_random_engine& generator);
+    virtual void insertNewSequenceForInsertionEvent(ChunkedSequence &indel_sequence, int position, SimStateVector &new_sequence, default_random_engine& generator);
     
     /**
         initialize variables for Rate_matrix approach: total_sub_rate, accumulated_rates, num_gaps
     */
-    virtual void initVariables4RateMatrix(int segment_start, double &total_sub_rate, int &num_gaps, vector<double> &sub_rate_by_site, vector<short int> &sequence);
+    virtual void initVariables4RateMatrix(int segment_start, double &total_sub_rate, int &num_gaps, vector<double> &sub_rate_by_site, SimStateVector &sequence);
     
     /**
         extract pattern- posterior mean state frequencies and posterior model probability
@@ -33,21 +33,21 @@ AliSimulatorInvar::AliSimulatorInvar(AliSimulator *alisimulator, double invar_pr
     output_line_length = alisimulator->output_line_length;
     num_threads = alisimulator->num_threads;
     force_output_PHYLIP = alisimulator->force_output_PHYLIP;
+    output_writer = alisimulator->output_writer;
+    deferred_outputs = alisimulator->deferred_outputs;
+    trans_matrix_cache = alisimulator->trans_matrix_cache;
 }
 
 /**
     simulate a sequence for a node from a specific branch after all variables has been initializing
 */
-void AliSimulatorInvar::simulateASequenceFromBranchAfterInitVariables(int segment_start, ModelSubst *model, double *trans_matrix, vector<short int> &dad_seq_chunk, vector<short int> &node_seq_chunk, Node *node, NeighborVec::iterator it, int* rstream, string lengths)
+void AliSimulatorInvar::simulateASequenceFromBranchAfterInitVariables(int segment_start, ModelSubst *model, double *trans_matrix, SimStateVector &dad_seq_chunk, SimStateVector &node_seq_chunk, Node *node, NeighborVec::iterator it, int* rstream, string lengths)
 {
     // rescale ratio due to invariant sites
     double scale = 1.0 / (1 - invariant_proportion);
     
-    // compute the transition probability matrix
-    model->computeTransMatrix(partition_rate * params->alisim_branch_scale * (*it)->length * scale, trans_matrix);
-    
-    // convert the probability matrix into an accumulated probability matrix
-    convertProMatrixIntoAccumulatedProMatrix(trans_matrix, max_num_states, max_num_states);
+    // compute the accumulated transition probability matrix
+    computeAccumulatedTransMatrix(model, partition_rate * params->alisim_branch_scale * (*it)->length * scale, trans_matrix);
     
     // estimate the sequence for the current neighbor
     for (int i = 0; i < node_seq_chunk.size(); i++)
@@ -94,14 +94,14 @@ void AliSimulatorInvar::initSiteSpecificRates(vector<double> &site_specific_rate
 *  insert a new sequence into the current sequence
 *
 */
-void AliSimulatorInvar::insertNewSequenceForInsertionEvent(vector<short int> &indel_sequence, int position, vector<short int> &new_sequence, default_random_engine& generator)
+void AliSimulatorInvar::insertNewSequenceForInsertionEvent(ChunkedSequence &indel_sequence, int position, SimStateVector &new_sequence, default_random_engine& generator)
 {
     // initialize new_site_specific_rates for new sequence
     vector<double> new_site_specific_rates;
     initSiteSpecificRates(new_site_specific_rates, new_sequence.size());
     
     // insert new_site_specific_rates into site_specific_rates
-    site_specific_rates.insert(site_specific_rates.begin()+position, new_site_specific_rates.begin(), new_site_specific_rates.end());
+    chunked_site_specific_rates.insert(position, new_site_specific_rates.begin(), new_site_specific_rates.end());
     
     // insert new_sequence into the current sequence
     AliSimulator::insertNewSequenceForInsertionEvent(indel_sequence, position, new_sequence, generator);
@@ -0,0 +1,212 @@
+//
+//  chunkedvector.h
+//  iqtree
+//
+//  Chunked vector (a simple rope) for sequences that grow by insertions in the middle
+//
+
+#ifndef chunkedvector_h
+#define chunkedvector_h
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+using namespace std;
+
+/**
+ *  A vector stored in blocks of BLOCK_SIZE to 2*BLOCK_SIZE items, with a Fenwick tree over the number of items per block.
+ *  Accessing an item and inserting items in the middle take O(log L + BLOCK_SIZE) instead of shifting the whole tail;
+ *  splitting a too large block rebuilds the Fenwick tree in O(L/BLOCK_SIZE).
+ */
+template <class T, int BLOCK_SIZE = 256>
+class ChunkedVector {
+public:
+    /**
+        constructor
+     */
+    ChunkedVector()
+    {
+        num_items = 0;
+    }
+
+    /**
+        deconstructor
+     */
+    virtual ~ChunkedVector() {}
+
+    /**
+        replace the content by the items in [first, last) in O(L)
+     */
+    template <class InputIt>
+    void assign(InputIt first, InputIt last)
+    {
+        blocks.clear();
+        num_items = 0;
+        while (first != last)
+        {
+            blocks.push_back(vector<T>());
+            blocks.back().reserve(BLOCK_SIZE);
+            for (int i = 0; i < BLOCK_SIZE && first != last; i++, first++)
+                blocks.back().push_back(*first);
+            num_items += blocks.back().size();
+        }
+        rebuildIndex();
+    }
+
+    /**
+        copy all items into a vector in O(L)
+     */
+    template <class U>
+    void exportTo(vector<U> &items)
+    {
+        items.resize(num_items);
+        typename vector<U>::iterator out = items.begin();
+        for (const vector<T> &block : blocks)
+            out = copy(block.begin(), block.end(), out);
+    }
+
+    /**
+        @return number of items
+     */
+    int size() { return num_items; }
+
+    /**
+        @return the item at a position
+     */
+    T get(int pos)
+    {
+        int block = findBlock(pos);
+        return blocks[block][pos];
+    }
+
+    /**
+        set the item at a position
+     */
+    void set(int pos, T value)
+    {
+        int block = findBlock(pos);
+        blocks[block][pos] = value;
+    }
+
+    /**
+        insert the items in [first, last) before a position (pos = size() appends them)
+     */
+    template <class InputIt>
+    void insert(int pos, InputIt first, InputIt last)
+    {
+        insertItems(pos, first, last);
+    }
+
+protected:
+    /**
+        items of each block
+     */
+    vector<vector<T> > blocks;
+
+    /**
+        Fenwick tree (1-based) of the number of items of each block
+     */
+    vector<int> fenwick_size;
+
+    /**
+        total number of items
+     */
+    int num_items;
+
+    /**
+        rebuild the Fenwick tree from the blocks in O(number of blocks)
+     */
+    virtual void rebuildIndex()
+    {
+        int num_blocks = blocks.size();
+        fenwick_size.assign(num_blocks + 1, 0);
+        for (int i = 1; i <= num_blocks; i++)
+        {
+            // all entries below i were already added to fenwick_size[i]
+            fenwick_size[i] += blocks[i - 1].size();
+            int parent = i + (i & -i);
+            if (parent <= num_blocks)
+                fenwick_size[parent] += fenwick_size[i];
+        }
+    }
+
+    /**
+        find the block containing a position
+        @param pos (IN) the position, (OUT) the position inside the block
+        @return block index
+     */
+    int findBlock(int &pos)
+    {
+        int num_blocks = blocks.size();
+        int step = 1;
+        while (step * 2 <= num_blocks)
+            step *= 2;
+
+        // descend the Fenwick tree to the first block whose cumulative size exceeds pos
+        int block = 0;
+        for (; step > 0; step >>= 1)
+            if (block + step <= num_blocks && fenwick_size[block + step] <= pos)
+            {
+                block += step;
+                pos -= fenwick_size[block];
+            }
+        return block;
+    }
+
+    /**
+        insert the items in [first, last) before a position
+        @return the block receiving the items, or -1 if blocks were split and rebuildIndex() was called
+     */
+    template <class InputIt>
+    int insertItems(int pos, InputIt first, InputIt last)
+    {
+        if (first == last)
+            return -1;
+        if (blocks.empty())
+        {
+            assign(first, last);
+            return -1;
+        }
+
+        // find the block to insert into, appending to the last block if pos is at the end
+        int block;
+        if (pos >= num_items)
+        {
+            block = blocks.size() - 1;
+            pos = blocks[block].size();
+        }
+        else
+            block = findBlock(pos);
+
+        int old_block_size = blocks[block].size();
+        blocks[block].insert(blocks[block].begin() + pos, first, last);
+        int num_inserted = blocks[block].size() - old_block_size;
+        num_items += num_inserted;
+
+        // split a too large block, then rebuild the index
+        if (blocks[block].size() > 2 * BLOCK_SIZE)
+        {
+            vector<T> large_block;
+            large_block.swap(blocks[block]);
+            vector<vector<T> > new_blocks;
+            for (size_t i = 0; i < large_block.size(); i += BLOCK_SIZE)
+                new_blocks.push_back(vector<T>(large_block.begin() + i, large_block.begin() + min(i + BLOCK_SIZE, large_block.size())));
+            blocks.erase(blocks.begin() + block);
+            blocks.insert(blocks.begin() + block, new_blocks.begin(), new_blocks.end());
+            rebuildIndex();
+            return -1;
+        }
+
+        // otherwise, only update the Fenwick tree
+        for (int i = block + 1; i < fenwick_size.size(); i += (i & -i))
+            fenwick_size[i] += num_inserted;
+        return block;
+    }
+};
+
+/**
+ *  working copy of a sequence while simulating indels on a branch, stored in one byte per state like node sequences (SimStateVector)
+ */
+typedef ChunkedVector<uint8_t, 1024> ChunkedSequence;
+
+#endif /* chunkedvector_h */
@@ -0,0 +1,128 @@
+//
+//  siteratesampler.cpp
+//  iqtree
+//
+//  Weighted site sampler for the Gillespie (Rate matrix) simulation with indels
+//
+
+#include "siteratesampler.h"
+
+void SiteRateSampler::init(const vector<double> &rates)
+{
+    assign(rates.begin(), rates.end());
+}
+
+void SiteRateSampler::rebuildIndex()
+{
+    ChunkedVector<double>::rebuildIndex();
+    int num_blocks = blocks.size();
+    fenwick_rate.assign(num_blocks + 1, 0);
+    for (int i = 1; i <= num_blocks; i++)
+    {
+        // all entries below i were already added to fenwick_rate[i]
+        for (double rate : blocks[i - 1])
+            fenwick_rate[i] += rate;
+        int parent = i + (i & -i);
+        if (parent <= num_blocks)
+            fenwick_rate[parent] += fenwick_rate[i];
+    }
+}
+
+void SiteRateSampler::updateBlockRate(int block, double rate_change)
+{
+    for (int i = block + 1; i < fenwick_rate.size(); i += (i & -i))
+        fenwick_rate[i] += rate_change;
+}
+
+double SiteRateSampler::getRate(int pos)
+{
+    int block = findBlock(pos);
+    return blocks[block][pos];
+}
+
+void SiteRateSampler::setRate(int pos, double rate)
+{
+    int block = findBlock(pos);
+    double rate_change = rate - blocks[block][pos];
+    blocks[block][pos] = rate;
+    updateBlockRate(block, rate_change);
+}
+
+void SiteRateSampler::addRate(int pos, double rate_change)
+{
+    int block = findBlock(pos);
+    blocks[block][pos] += rate_change;
+    updateBlockRate(block, rate_change);
+}
+
+void SiteRateSampler::insertSites(int pos, const vector<double> &rates)
+{
+    // the Fenwick tree of rates was rebuilt if insertItems() split the block
+    int block = insertItems(pos, rates.begin(), rates.end());
+    if (block < 0)
+        return;
+    double rate_change = 0;
+    for (double rate : rates)
+        rate_change += rate;
+    updateBlockRate(block, rate_change);
+}
+
+int SiteRateSampler::sample(double random_num)
+{
+    int num_blocks = blocks.size();
+    if (num_blocks == 0)
+        return 0;
+
+    // total rate = prefix sum over all blocks
+    double total_rate = 0;
+    for (int i = num_blocks; i > 0; i -= (i & -i))
+        total_rate += fenwick_rate[i];
+    double remaining = random_num * total_rate;
+
+    // descend the Fenwick tree to the first block whose cumulative rate exceeds remaining
+    int step = 1;
+    while (step * 2 <= num_blocks)
+        step *= 2;
+    int block = 0;
+    int num_prev_sites = 0;
+    for (; step > 0; step >>= 1)
+        if (block + step <= num_blocks && fenwick_rate[block + step] <= remaining)
+        {
+            block += step;
+            remaining -= fenwick_rate[block];
+            num_prev_sites += fenwick_size[block];
+        }
+
+    // rounding errors may move past the last block
+    if (block == num_blocks)
+    {
+        block--;
+        num_prev_sites = num_items - blocks[block].size();
+    }
+
+    // select the site inside the block, never a site with a zero rate
+    vector<double> &rates = blocks[block];
+    int last_valid = -1;
+    for (int i = 0; i < rates.size(); i++)
+        if (rates[i] > 0)
+        {
+            last_valid = i;
+            if (remaining < rates[i])
+                return num_prev_sites + i;
+            remaining -= rates[i];
+        }
+    if (last_valid >= 0)
+        return num_prev_sites + last_valid;
+
+    // the block has no positive rate due to rounding errors -> take the last site with a positive rate
+    for (block = num_blocks - 1, num_prev_sites = num_items; block >= 0; block--)
+    {
+        num_prev_sites -= blocks[block].size();
+        for (int i = blocks[block].size() - 1; i >= 0; i--)
+            if (blocks[block][i] > 0)
+                return num_prev_sites + i;
+    }
+
+    // all rates are zero
+    return 0;
+}
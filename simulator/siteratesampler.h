@@ -0,0 +1,72 @@
+//
+//  siteratesampler.h
+//  iqtree
+//
+//  Weighted site sampler for the Gillespie (Rate matrix) simulation with indels
+//
+
+#ifndef siteratesampler_h
+#define siteratesampler_h
+
+#include "chunkedvector.h"
+
+/**
+ *  Substitution rates of all sites of a sequence, supporting
+ *  - sampling a site proportional to its rate in O(log L)
+ *  - updating the rate of a site in O(log L)
+ *  - inserting new sites anywhere in the sequence
+ *  On top of the blocks of ChunkedVector, a second Fenwick tree holds the total rate of each block.
+ */
+class SiteRateSampler : public ChunkedVector<double> {
+public:
+    /**
+        initialize from the rates of all sites in O(L)
+     */
+    void init(const vector<double> &rates);
+
+    /**
+        @return rate of a site
+     */
+    double getRate(int pos);
+
+    /**
+        set the rate of a site
+     */
+    void setRate(int pos, double rate);
+
+    /**
+        add a value to the rate of a site
+     */
+    void addRate(int pos, double rate_change);
+
+    /**
+        insert new sites before a position (pos = size() appends them)
+        @param rates rates of the new sites
+     */
+    void insertSites(int pos, const vector<double> &rates);
+
+    /**
+        select a site with probability proportional to its rate
+        @param random_num a random number in [0, 1)
+        @return position of the selected site
+     */
+    int sample(double random_num);
+
+protected:
+    /**
+        Fenwick tree (1-based) of the total rate of each block
+     */
+    vector<double> fenwick_rate;
+
+    /**
+        rebuild both Fenwick trees from the blocks in O(number of blocks)
+     */
+    virtual void rebuildIndex();
+
+    /**
+        add a rate change to a block
+     */
+    void updateBlockRate(int block, double rate_change);
+};
+
+#endif /* siteratesampler_h */
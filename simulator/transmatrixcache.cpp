@@ -0,0 +1,71 @@
+//
+//  transmatrixcache.cpp
+//  iqtree
+//
+//  Cache of accumulated transition probability matrices for AliSim
+//
+
+#include "transmatrixcache.h"
+
+TransMatrixCache::TransMatrixCache(int num_states)
+{
+    matrix_size = num_states * num_states;
+    max_num_matrices = max((size_t) 1, (size_t) TRANS_MATRIX_CACHE_SIZE / (matrix_size * sizeof(double)));
+    cached_model = NULL;
+    num_hits = 0;
+    num_misses = 0;
+}
+
+void TransMatrixCache::validate(ModelSubst *model)
+{
+    // get the Q matrices of all mixture components
+    int num_mixtures = model->getNMixtures();
+    int q_size = model->num_states * model->num_states;
+    vector<double> q_matrices(num_mixtures * q_size);
+    for (int i = 0; i < num_mixtures; i++)
+        model->getQMatrix(&q_matrices[i * q_size], i);
+
+    if (model != cached_model || q_matrices != cached_q_matrices)
+    {
+        matrices.clear();
+        cached_model = model;
+        cached_q_matrices.swap(q_matrices);
+    }
+}
+
+bool TransMatrixCache::getMatrix(ModelSubst *model, int mixture, double time, double *trans_matrix)
+{
+    if (model != cached_model)
+        return false;
+    bool found = false;
+    #ifdef _OPENMP
+    #pragma omp critical(trans_matrix_cache)
+    #endif
+    {
+        map<pair<int, double>, vector<double> >::iterator it = matrices.find(make_pair(mixture, time));
+        if (it != matrices.end())
+        {
+            copy(it->second.begin(), it->second.end(), trans_matrix);
+            found = true;
+            num_hits++;
+        }
+        else
+            num_misses++;
+    }
+    return found;
+}
+
+void TransMatrixCache::addMatrix(ModelSubst *model, int mixture, double time, double *trans_matrix)
+{
+    if (model != cached_model)
+        return;
+    #ifdef _OPENMP
+    #pragma omp critical(trans_matrix_cache)
+    #endif
+    {
+        // start over if the cache is full, e.g. many random branch lengths
+        if (matrices.size() >= max_num_matrices)
+            matrices.clear();
+        matrices[make_pair(mixture, time)].assign(trans_matrix, trans_matrix + matrix_size);
+    }
+}
@@ -0,0 +1,80 @@
+//
+//  transmatrixcache.h
+//  iqtree
+//
+//  Cache of accumulated transition probability matrices for AliSim
+//
+
+#ifndef transmatrixcache_h
+#define transmatrixcache_h
+
+#include "model/modelsubst.h"
+#include <map>
+
+// max memory (in bytes) of the accumulated transition matrices kept in a TransMatrixCache
+#define TRANS_MATRIX_CACHE_SIZE (64 * 1024 * 1024)
+
+/**
+ *  Accumulated transition probability matrices of a model, keyed by (mixture component, time),
+ *  shared by all simulating threads and kept across alignments simulated from the same tree.
+ *  Times are compared exactly, thus using the cache does not change the simulated alignments.
+ *  The cache is cleared if the Q matrices of the model change (e.g. randomly generated state frequencies for a new alignment)
+ *  or if it exceeds TRANS_MATRIX_CACHE_SIZE.
+ */
+class TransMatrixCache {
+public:
+    /**
+        constructor
+        @param num_states number of states, each matrix has num_states * num_states entries
+     */
+    TransMatrixCache(int num_states);
+
+    /**
+        clear the cache if the model or its Q matrices differ from the cached ones
+     */
+    void validate(ModelSubst *model);
+
+    /**
+        copy a cached matrix
+        @param model the model computing the matrix, only the validated model is cached
+        @param mixture mixture component
+        @param time branch length times rates
+        @param trans_matrix (OUT) the accumulated transition matrix if cached
+        @return TRUE if the matrix was cached
+     */
+    bool getMatrix(ModelSubst *model, int mixture, double time, double *trans_matrix);
+
+    /**
+        add a matrix to the cache
+     */
+    void addMatrix(ModelSubst *model, int mixture, double time, double *trans_matrix);
+
+    /**
+        number of cache hits and misses
+     */
+    int64_t num_hits, num_misses;
+
+protected:
+    /**
+        number of entries of a matrix
+     */
+    int matrix_size;
+
+    /**
+        max number of cached matrices
+     */
+    size_t max_num_matrices;
+
+    /**
+        the validated model and its Q matrices of all mixture components
+     */
+    ModelSubst *cached_model;
+    vector<double> cached_q_matrices;
+
+    /**
+        accumulated transition matrices, keyed by (mixture component, time)
+     */
+    map<pair<int, double>, vector<double> > matrices;
+};
+
+#endif /* transmatrixcache_h */
@@ -0,0 +1,52 @@
+#!/bin/bash -
+#===============================================================================
+#
+#          FILE: bench_alisim_binary.sh
+#
+#         USAGE: ./bench_alisim_binary.sh <iqtree_binary> [<num_taxa> [<length> [<threads>]]]
+#
+#   DESCRIPTION: Time AliSim with FASTA and packed binary output (-af bin), then
+#                convert the binary alignment back (--bin-to-fasta) and check
+#                that both outputs contain the same sequences
+#
+#       OPTIONS: num_taxa: number of taxa of the random tree (default: 100000)
+#                length: sequence length (default: 1001)
+#                threads: -T (default: 4); the default length does not split into
+#                         whole bytes per thread, so the threads share the bytes at
+#                         the boundaries of their segments
+#===============================================================================
+
+set -o nounset                              # Treat unset variables as an error
+
+if [ $# -lt 1 ]; then
+    echo "USAGE: $0 <iqtree_binary> [<num_taxa> [<length> [<threads>]]]"
+    exit 1
+fi
+
+binary=$1
+ntaxa=${2:-100000}
+len=${3:-1001}
+threads=${4:-4}
+outdir=$(mktemp -d bench_alisim_binary.XXXXXX)
+
+echo -e "output\ttime (s)\tfile size (bytes)"
+for format in fasta bin; do
+    prefix=$outdir/$format
+    start=$(date +%s.%N)
+    $binary --alisim $prefix -t "RANDOM{yh,$ntaxa}" -m GTR+G4 --length $len \
+        -af $format -T $threads -seed 1 -pre $prefix > $prefix.out 2>&1
+    end=$(date +%s.%N)
+    file=$(ls $prefix.fa $prefix.alibin 2> /dev/null | head -n 1)
+    awk -v f=$format -v s=$start -v e=$end -v b=$(wc -c < $file) 'BEGIN {printf "%s\t%.2f\t%d\n", f, e - s, b}'
+done
+
+# convert the binary alignment into FASTA and compare the sequences (in any order),
+# ignoring the spaces that AliSim pads sequence names with
+$binary --alisim $outdir/converted --bin-to-fasta $outdir/bin.alibin > $outdir/converted.out 2>&1
+if diff <(sed 's/ *$//' $outdir/fasta.fa | paste - - | sort) \
+        <(sed 's/ *$//' $outdir/converted.fa | paste - - | sort) > /dev/null; then
+    echo "Converted binary alignment is identical to the FASTA output"
+else
+    echo "ERROR: converted binary alignment differs from the FASTA output"
+fi
+echo "Output files in $outdir"
@@ -0,0 +1,45 @@
+#!/bin/bash -
+#===============================================================================
+#
+#          FILE: bench_alisim_datasets.sh
+#
+#         USAGE: ./bench_alisim_datasets.sh <iqtree_binary> [<num_alignments> [<length> [<num_threads>]]]
+#
+#   DESCRIPTION: Time AliSim when simulating many small alignments from a single
+#                tree with a single thread, with and without compressed output,
+#                into a compressed archive, and with one alignment per thread
+#
+#       OPTIONS: num_alignments: --num-alignments (default: 10000)
+#                length: sequence length of each alignment (default: 300)
+#                num_threads: -T with --parallel-datasets (default: 4)
+#===============================================================================
+
+set -o nounset                              # Treat unset variables as an error
+
+if [ $# -lt 1 ]; then
+    echo "USAGE: $0 <iqtree_binary> [<num_alignments> [<length> [<num_threads>]]]"
+    exit 1
+fi
+
+binary=$1
+num_alns=${2:-10000}
+len=${3:-300}
+threads=${4:-4}
+outdir=$(mktemp -d bench_alisim_datasets.XXXXXX)
+
+echo -e "output\ttime (s)\ttime per alignment (ms)"
+for output in plain gz archive parallel; do
+    prefix=$outdir/$output
+    opts="-T 1"
+    case $output in
+        gz) opts="-gz -T 1" ;;
+        archive) opts="-gz --aln-archive -T 1" ;;
+        parallel) opts="-gz --aln-archive -T $threads --parallel-datasets" ;;
+    esac
+    start=$(date +%s.%N)
+    $binary --alisim $prefix -t "RANDOM{yh,20}" -m GTR+G4 --length $len \
+        --num-alignments $num_alns $opts -seed 1 -pre $prefix > $prefix.out 2>&1
+    end=$(date +%s.%N)
+    awk -v o=$output -v n=$num_alns -v s=$start -v e=$end 'BEGIN {t = e - s; printf "%s\t%.2f\t%.3f\n", o, t, t / n * 1000}'
+done
+echo "Output files in $outdir"
@@ -0,0 +1,39 @@
+#!/bin/bash -
+#===============================================================================
+#
+#          FILE: bench_alisim_indels.sh
+#
+#         USAGE: ./bench_alisim_indels.sh <iqtree_binary> [<num_taxa> [<lengths>]]
+#
+#   DESCRIPTION: Time AliSim with indels and the Rate matrix (Gillespie) approach
+#                for increasing sequence lengths, to check that the run time grows
+#                about linearly with the length
+#
+#       OPTIONS: num_taxa: number of taxa of the random tree (default: 20)
+#                lengths: sequence lengths to simulate (default: "10000 100000 1000000")
+#===============================================================================
+
+set -o nounset                              # Treat unset variables as an error
+
+if [ $# -lt 1 ]; then
+    echo "USAGE: $0 <iqtree_binary> [<num_taxa> [<lengths>]]"
+    exit 1
+fi
+
+binary=$1
+ntaxa=${2:-20}
+lengths=${3:-"10000 100000 1000000"}
+outdir=$(mktemp -d bench_alisim_indels.XXXXXX)
+
+echo -e "length\ttime (s)\ttime per site (us)"
+for len in $lengths; do
+    prefix=$outdir/len$len
+    # --simulation-thresh 1: every branch shorter than 1 is simulated event by event
+    start=$(date +%s.%N)
+    $binary --alisim $prefix -t "RANDOM{yh,$ntaxa}" -m GTR+G4 --length $len \
+        --indel 0.1,0.05 --indel-rate-variation --simulation-thresh 1 -seed 1 \
+        -pre $prefix > $prefix.out 2>&1
+    end=$(date +%s.%N)
+    awk -v l=$len -v s=$start -v e=$end 'BEGIN {t = e - s; printf "%d\t%.2f\t%.3f\n", l, t, t / l * 1000000}'
+done
+echo "Output files in $outdir"
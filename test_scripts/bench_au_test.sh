@@ -0,0 +1,57 @@
+#!/bin/bash -
+#===============================================================================
+#
+#          FILE: bench_au_test.sh
+#
+#         USAGE: ./bench_au_test.sh <iqtree_binary> <alignment> <tree_set> [<replicates> [<bins> [<threads>]]]
+#
+#   DESCRIPTION: Compare the streaming AU test (--au-bins) with the default AU test
+#                that keeps all replicates: AU p-values, run time and peak memory
+#
+#       OPTIONS: replicates: -zb replicates (default: 10000)
+#                bins: histogram bins for --au-bins (default: 10000)
+#                threads: -T (default: 1)
+#  REQUIREMENTS: GNU time for the peak memory (/usr/bin/time)
+#===============================================================================
+
+set -o nounset                              # Treat unset variables as an error
+
+if [ $# -lt 3 ]; then
+    echo "USAGE: $0 <iqtree_binary> <alignment> <tree_set> [<replicates> [<bins> [<threads>]]]"
+    exit 1
+fi
+
+binary=$1
+aln=$2
+trees=$3
+reps=${4:-10000}
+bins=${5:-10000}
+threads=${6:-1}
+outdir=$(mktemp -d bench_au.XXXXXX)
+
+run_au () {
+    prefix=$outdir/$1
+    shift
+    if [ -x /usr/bin/time ]; then
+        /usr/bin/time -f "%M" -o $prefix.mem $binary -s $aln -z $trees -zb $reps -au -n 0 -T $threads \
+            -seed 1 -pre $prefix "$@" > /dev/null 2>&1
+    else
+        $binary -s $aln -z $trees -zb $reps -au -n 0 -T $threads -seed 1 -pre $prefix "$@" > /dev/null 2>&1
+        echo "NA" > $prefix.mem
+    fi
+    # AU p-values printed after the "TreeID AU RSS d c" header
+    awk '/^TreeID\tAU/ {found=1; next} found && /^[0-9]+\t/ {print $2} found && !/^[0-9]+\t/ {found=0}' \
+        $prefix.log > $prefix.au
+    grep "Time for AU test" $prefix.log | awk '{print $(NF-1)}' > $prefix.time
+}
+
+run_au exact
+run_au stream --au-bins $bins
+
+echo "Replicates: $reps   bins: $bins   threads: $threads"
+echo -e "\texact\tstreaming"
+echo -e "time (s)\t$(cat $outdir/exact.time)\t$(cat $outdir/stream.time)"
+echo -e "peak KB\t$(cat $outdir/exact.mem)\t$(cat $outdir/stream.mem)"
+echo -e "TreeID\tp-AU exact\tp-AU streaming\tdifference"
+paste $outdir/exact.au $outdir/stream.au | awk '{d = $1 - $2; if (d < 0) d = -d; printf "%d\t%s\t%s\t%.4f\n", NR, $1, $2, d}'
+echo "Output files in $outdir"
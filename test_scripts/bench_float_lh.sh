@@ -0,0 +1,63 @@
+#!/bin/bash -
+#===============================================================================
+#
+#          FILE: bench_float_lh.sh
+#
+#         USAGE: ./bench_float_lh.sh <iqtree_binary> <alignment> <tree> [<model> [<threads> [<kernel>]]]
+#
+#   DESCRIPTION: Compare single precision partial likelihoods (--float-lh) with the
+#                default double precision: log-likelihood of the given tree after
+#                optimizing branch lengths and model parameters, run time and peak memory
+#
+#       OPTIONS: model: -m (default: GTR+G4)
+#                threads: -T (default: 1)
+#                kernel: -lk SSE, AVX, FMA or AVX512 (default: best for this CPU);
+#                        --float-lh only takes effect with AVX512
+#  REQUIREMENTS: an AVX-512 build of iqtree2 (IQTREE_FLAGS=KNL),
+#                GNU time for the peak memory (/usr/bin/time)
+#===============================================================================
+
+set -o nounset                              # Treat unset variables as an error
+
+if [ $# -lt 3 ]; then
+    echo "USAGE: $0 <iqtree_binary> <alignment> <tree> [<model> [<threads> [<kernel>]]]"
+    exit 1
+fi
+
+binary=$1
+aln=$2
+tree=$3
+model=${4:-GTR+G4}
+threads=${5:-1}
+kernel=${6:-}
+outdir=$(mktemp -d bench_float_lh.XXXXXX)
+
+run_lh () {
+    prefix=$outdir/$1
+    shift
+    opts="-s $aln -te $tree -m $model -T $threads -seed 1 -pre $prefix"
+    if [ -n "$kernel" ]; then
+        opts="$opts -lk $kernel"
+    fi
+    if [ -x /usr/bin/time ]; then
+        /usr/bin/time -f "%M" -o $prefix.mem $binary $opts "$@" > /dev/null 2>&1
+    else
+        $binary $opts "$@" > /dev/null 2>&1
+        echo "NA" > $prefix.mem
+    fi
+    grep "Log-likelihood of the tree" $prefix.iqtree | awk '{print $5}' > $prefix.lh
+    grep "Total wall-clock time used" $prefix.log | awk '{print $5}' > $prefix.time
+    grep -c "switching to double precision" $prefix.log > $prefix.fallback
+}
+
+run_lh double
+run_lh float --float-lh
+
+echo "Model: $model   threads: $threads   $(grep '^Kernel:' $outdir/double.log)"
+echo -e "\tdouble\tfloat"
+echo -e "time (s)\t$(cat $outdir/double.time)\t$(cat $outdir/float.time)"
+echo -e "peak KB\t$(cat $outdir/double.mem)\t$(cat $outdir/float.mem)"
+echo -e "logL\t$(cat $outdir/double.lh)\t$(cat $outdir/float.lh)"
+paste $outdir/double.lh $outdir/float.lh | awk '{d = $1 - $2; if (d < 0) d = -d; printf "logL difference\t%.6f\n", d}'
+echo -e "fallback to double\t$(cat $outdir/float.fallback)"
+echo "Output files in $outdir"
@@ -0,0 +1,52 @@
+#!/bin/bash -
+#===============================================================================
+#
+#          FILE: bench_sankoff.sh
+#
+#         USAGE: ./bench_sankoff.sh <iqtree_binary> [<cost_file> [<threads>]]
+#
+#   DESCRIPTION: Time the Sankoff parsimony tree (--mpcost) with the SSE, AVX and
+#                AVX512 kernels (-lk) on 20-state (protein) and 61-state (codon) data
+#                and check that all kernels give the same parsimony score
+#
+#       OPTIONS: cost_file: --mpcost file, must match the number of states
+#                           (default: fitch, i.e. uniform costs)
+#                threads: -T (default: 1)
+#  REQUIREMENTS: the AVX512 kernel needs a binary built with AVX-512 support
+#===============================================================================
+
+set -o nounset                              # Treat unset variables as an error
+
+if [ $# -lt 1 ]; then
+    echo "USAGE: $0 <iqtree_binary> [<cost_file> [<threads>]]"
+    exit 1
+fi
+
+binary=$1
+cost=${2:-fitch}
+threads=${3:-1}
+data=$(dirname $0)/test_data
+outdir=$(mktemp -d bench_sankoff.XXXXXX)
+
+# name, alignment, extra options
+datasets=(
+    "protein20 $data/prot_M126_27_269.phy -st AA -m LG"
+    "codon61 $data/d59_8.phy -st CODON -m GY"
+)
+
+echo -e "data\tkernel\ttime (s)\tparsimony score"
+for dataset in "${datasets[@]}"; do
+    set -- $dataset
+    name=$1
+    aln=$2
+    shift 2
+    for kernel in SSE AVX AVX512; do
+        prefix=$outdir/$name.$kernel
+        $binary -s $aln "$@" -t PARS --mpcost $cost -lk $kernel -n 0 -T $threads -seed 1 \
+            -pre $prefix > /dev/null 2>&1
+        # "<time> seconds, parsimony score: <score> ..." printed after the tree is built
+        grep "seconds, parsimony score:" $prefix.log | head -n 1 | \
+            awk -v d=$name -v k=$kernel '{printf "%s\t%s\t%s\t%s\n", d, k, $1, $5}'
+    done
+done
+echo "Output files in $outdir"
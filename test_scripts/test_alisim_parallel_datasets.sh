@@ -0,0 +1,80 @@
+#!/bin/bash -
+#===============================================================================
+#
+#          FILE: test_alisim_parallel_datasets.sh
+#
+#         USAGE: ./test_alisim_parallel_datasets.sh <iqtree_binary>
+#
+#   DESCRIPTION: Check that AliSim with --parallel-datasets outputs the same
+#                alignments whatever the number of threads, and that every
+#                alignment of an --aln-archive (compressed or not) could be
+#                extracted from the offset and size listed in the index
+#
+#       OPTIONS: none
+#  REQUIREMENTS: none
+#===============================================================================
+
+set -o nounset                              # Treat unset variables as an error
+
+if [ $# -lt 1 ]; then
+    echo "USAGE: $0 <iqtree_binary>"
+    exit 1
+fi
+
+binary=$1
+num_alns=20
+outdir=$(mktemp -d test_alisim_parallel_datasets.XXXXXX)
+
+$binary --alisim $outdir/random -t "RANDOM{yh/12}" --length 10 -seed 1 > /dev/null 2>&1
+tree=$outdir/random.treefile
+if [ ! -f $tree ]; then
+    echo "FAILED: could not generate a random tree"
+    exit 1
+fi
+
+# random state frequencies (GTR) and root sequences are drawn per alignment
+for threads in 2 3; do
+    mkdir $outdir/T$threads
+    $binary --alisim $outdir/T$threads/aln -t $tree -m GTR+G4 --length 200 \
+        --num-alignments $num_alns --parallel-datasets -T $threads -seed 1 > $outdir/T$threads.out 2>&1
+    if [ $? -ne 0 ] || [ $(ls $outdir/T$threads/aln_*.phy 2> /dev/null | wc -l) -ne $num_alns ]; then
+        echo "FAILED: not all alignments were simulated with -T $threads, see $outdir"
+        exit 1
+    fi
+done
+for i in $(seq 1 $num_alns); do
+    if ! cmp -s $outdir/T2/aln_$i.phy $outdir/T3/aln_$i.phy; then
+        echo "FAILED: alignment $i differs between -T 2 and -T 3, see $outdir"
+        exit 1
+    fi
+done
+
+for output in plain gz; do
+    opts=""
+    cat=cat
+    if [ $output == "gz" ]; then
+        opts="-gz"
+        cat="gzip -dc"
+    fi
+    $binary --alisim $outdir/$output -t $tree -m GTR+G4 --length 200 \
+        --num-alignments $num_alns --parallel-datasets --aln-archive $opts -T 2 -seed 1 > $outdir/$output.out 2>&1
+    if [ $? -ne 0 ] || [ $(wc -l < $outdir/$output.phy.idx) -ne $num_alns ]; then
+        echo "FAILED: the index of the $output archive does not list $num_alns alignments, see $outdir"
+        exit 1
+    fi
+    # the alignments were simulated from the same tree and seed as those in T2
+    while read name offset size; do
+        if ! tail -c +$((offset + 1)) $outdir/$output.phy | head -c $size | $cat | cmp -s - $outdir/T2/${name/#$output/aln}; then
+            echo "FAILED: $name extracted from the $output archive differs from $outdir/T2/${name/#$output/aln}"
+            exit 1
+        fi
+    done < $outdir/$output.phy.idx
+done
+# the members of the compressed archive also form a single gzip file
+if [ "$(gzip -dc $outdir/gz.phy | md5sum)" != "$(cat $outdir/plain.phy | md5sum)" ]; then
+    echo "FAILED: the compressed archive could not be decompressed as a whole, see $outdir"
+    exit 1
+fi
+
+echo "PASSED"
+rm -rf $outdir
@@ -0,0 +1,74 @@
+#!/bin/bash -
+#===============================================================================
+#
+#          FILE: test_mpi_patterns.sh
+#
+#         USAGE: ./test_mpi_patterns.sh <iqtree_mpi_binary> [<mpirun>]
+#
+#   DESCRIPTION: Check that --mpi-patterns gives the same log-likelihoods as a
+#                single-process run: the trees of a fixed tree set are evaluated
+#                with 2 MPI processes sharing the site patterns, and with one
+#                process. Run for the normal and the safe likelihood kernel,
+#                which keep scaling numbers per pattern and per category.
+#
+#       OPTIONS: none
+#  REQUIREMENTS: an MPI build of iqtree2 (IQTREE_FLAGS=mpi) and mpirun
+#===============================================================================
+
+set -o nounset                              # Treat unset variables as an error
+
+if [ $# -lt 1 ]; then
+    echo "USAGE: $0 <iqtree_mpi_binary> [<mpirun>]"
+    exit 1
+fi
+
+binary=$1
+mpirun=${2:-mpirun}
+outdir=$(mktemp -d test_mpi_patterns.XXXXXX)
+
+cat > $outdir/trees.nwk <<EOF
+(((A:0.1,B:0.1):0.1,(C:0.1,D:0.1):0.1):0.1,((E:0.1,F:0.1):0.1,(G:0.1,H:0.1):0.1):0.1);
+(((A:0.1,E:0.1):0.1,(B:0.1,F:0.1):0.1):0.1,((C:0.1,G:0.1):0.1,(D:0.1,H:0.1):0.1):0.1);
+(((A:0.1,C:0.1):0.1,(B:0.1,D:0.1):0.1):0.1,((E:0.1,G:0.1):0.1,(F:0.1,H:0.1):0.1):0.1);
+EOF
+head -n 1 $outdir/trees.nwk > $outdir/true.nwk
+
+# an odd number of patterns, so that the last slice is not full
+$binary --alisim $outdir/aln -t $outdir/true.nwk -m GTR+G4 --length 1999 -seed 1 > /dev/null 2>&1
+if [ ! -f $outdir/aln.phy ]; then
+    echo "FAILED: could not simulate the alignment"
+    exit 1
+fi
+
+for kernel in normal safe; do
+    kernel_opt=""
+    if [ $kernel == safe ]; then
+        kernel_opt="-safe"
+    fi
+    $binary -s $outdir/aln.phy -z $outdir/trees.nwk -n 0 -m GTR+G4 -T 1 -seed 1 $kernel_opt \
+        -pre $outdir/single_$kernel > $outdir/single_$kernel.out 2>&1
+    $mpirun -np 2 $binary -s $outdir/aln.phy -z $outdir/trees.nwk -n 0 -m GTR+G4 -T 1 -seed 1 $kernel_opt \
+        --mpi-patterns -pre $outdir/mpi_$kernel > $outdir/mpi_$kernel.out 2>&1
+    if ! grep -q "2 processes sharing site patterns" $outdir/mpi_$kernel.out; then
+        echo "FAILED: --mpi-patterns did not run with 2 processes, see $outdir"
+        exit 1
+    fi
+    # "Tree <id> / LogL: <logl>"
+    for run in single mpi; do
+        grep '^Tree [0-9]* / LogL' $outdir/${run}_$kernel.out | awk '{print $2, $5}' > $outdir/${run}_$kernel.logl
+        if [ $(wc -l < $outdir/${run}_$kernel.logl) -ne 3 ]; then
+            echo "FAILED: not all trees were evaluated by the $run run ($kernel kernel), see $outdir"
+            exit 1
+        fi
+    done
+    # the sums over patterns are taken in a different order, so the last printed decimal may change
+    if ! join $outdir/single_$kernel.logl $outdir/mpi_$kernel.logl \
+        | awk '{d = $2 - $3; if (d < 0) d = -d; if (d > 0.0015) bad = 1} END {exit bad}'; then
+        echo "FAILED: log-likelihoods with --mpi-patterns ($kernel kernel) differ from a single process, see $outdir"
+        exit 1
+    fi
+    echo "$kernel kernel: $(cut -d ' ' -f 2 $outdir/mpi_$kernel.logl | tr '\n' ' ')"
+done
+
+echo "PASSED"
+rm -rf $outdir
@@ -0,0 +1,78 @@
+#!/bin/bash -
+#===============================================================================
+#
+#          FILE: test_tree_reuse.sh
+#
+#         USAGE: ./test_tree_reuse.sh <iqtree_binary>
+#
+#   DESCRIPTION: Check that --tree-reuse evaluates similar trees one after another:
+#                the tree set alternates two distant topologies, so with a window
+#                of 5 the evaluation order must differ from the input order, while
+#                the log-likelihood of every tree stays the same as without --tree-reuse
+#
+#       OPTIONS: none
+#  REQUIREMENTS: none
+#===============================================================================
+
+set -o nounset                              # Treat unset variables as an error
+
+if [ $# -lt 1 ]; then
+    echo "USAGE: $0 <iqtree_binary>"
+    exit 1
+fi
+
+binary=$1
+outdir=$(mktemp -d test_tree_reuse.XXXXXX)
+
+# trees 1, 3, 5 group (A,B,C,D) and trees 2, 4, 6 group (A,E,B,F)
+cat > $outdir/trees.nwk <<EOF
+(((A:0.1,B:0.1):0.1,(C:0.1,D:0.1):0.1):0.1,((E:0.1,F:0.1):0.1,(G:0.1,H:0.1):0.1):0.1);
+(((A:0.1,E:0.1):0.1,(B:0.1,F:0.1):0.1):0.1,((C:0.1,G:0.1):0.1,(D:0.1,H:0.1):0.1):0.1);
+(((A:0.1,B:0.1):0.1,(C:0.1,D:0.1):0.1):0.1,((E:0.1,G:0.1):0.1,(F:0.1,H:0.1):0.1):0.1);
+(((A:0.1,E:0.1):0.1,(B:0.1,F:0.1):0.1):0.1,((C:0.1,H:0.1):0.1,(D:0.1,G:0.1):0.1):0.1);
+(((A:0.1,B:0.1):0.1,(C:0.1,D:0.1):0.1):0.1,((E:0.1,H:0.1):0.1,(F:0.1,G:0.1):0.1):0.1);
+(((A:0.1,E:0.1):0.1,(B:0.1,F:0.1):0.1):0.1,((C:0.1,G:0.1):0.1,(D:0.1,H:0.1):0.1):0.1);
+EOF
+head -n 1 $outdir/trees.nwk > $outdir/true.nwk
+
+$binary --alisim $outdir/aln -t $outdir/true.nwk -m JC --length 500 -seed 1 > /dev/null 2>&1
+if [ ! -f $outdir/aln.phy ]; then
+    echo "FAILED: could not simulate the alignment"
+    exit 1
+fi
+
+# the run without --tree-reuse is the reference
+for window in 0 1 5; do
+    reuse_opt=""
+    if [ $window -gt 0 ]; then
+        reuse_opt="--tree-reuse $window"
+    fi
+    $binary -s $outdir/aln.phy -z $outdir/trees.nwk -n 0 -m GTR+G4 -T 1 -seed 1 $reuse_opt \
+        -pre $outdir/reuse$window > $outdir/reuse$window.out 2>&1
+    # "Tree <id> / LogL: <logl>" in evaluation order
+    grep '^Tree [0-9]* / LogL' $outdir/reuse$window.out | awk '{print $2, $5}' > $outdir/reuse$window.order
+done
+
+for window in 0 1 5; do
+    if [ $(wc -l < $outdir/reuse$window.order) -ne 6 ]; then
+        echo "FAILED: not all trees were evaluated, see $outdir"
+        exit 1
+    fi
+done
+if [ "$(cut -d ' ' -f 1 $outdir/reuse0.order)" == "$(cut -d ' ' -f 1 $outdir/reuse5.order)" ]; then
+    echo "FAILED: --tree-reuse 5 did not change the evaluation order, see $outdir"
+    exit 1
+fi
+# log-likelihoods are printed with 3 decimals, partial likelihoods and branch lengths
+# taken from the previous tree may change the last one
+for window in 1 5; do
+    if ! join <(sort $outdir/reuse0.order) <(sort $outdir/reuse$window.order) \
+        | awk '{d = $2 - $3; if (d < 0) d = -d; if (d > 0.0015) bad = 1} END {exit bad}'; then
+        echo "FAILED: log-likelihoods with --tree-reuse $window differ from those without it, see $outdir"
+        exit 1
+    fi
+done
+
+echo "Evaluation order with --tree-reuse 5: $(cut -d ' ' -f 1 $outdir/reuse5.order | tr '\n' ' ')"
+echo "PASSED"
+rm -rf $outdir
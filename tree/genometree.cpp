@@ -230,10 +230,10 @@ void GenomeTree::convertGapsIntoNormal(GenomeNode *node)
 /**
     export new genome from original genome and genome tree
  */
-vector<short int> GenomeTree::exportNewGenome(vector<short int> &ori_seq, int seq_length, int UNKOWN_STATE)
+SimStateVector GenomeTree::exportNewGenome(SimStateVector &ori_seq, int seq_length, int UNKOWN_STATE)
 {
     // init new genome
-    vector<short int> new_seq(seq_length, UNKOWN_STATE);
+    SimStateVector new_seq(seq_length, UNKOWN_STATE);
     
     // traverse the genome tree to export new genome
     queue<GenomeNode*> genome_nodes;
@@ -278,7 +278,7 @@ vector<short int> GenomeTree::exportNewGenome(vector<short int> &ori_seq, int se
 /**
  export readable characters (for writing to file) from original genome and genome tree
  */
-void GenomeTree::exportReadableCharacters(vector<short int> &ori_seq, int num_sites_per_state, vector<string> &state_mapping, string &output)
+void GenomeTree::exportReadableCharacters(SimStateVector &ori_seq, int num_sites_per_state, vector<string> &state_mapping, string &output)
 {
     queue<GenomeNode*> genome_nodes;
     root->cumulative_gaps_from_parent = 0;
@@ -36,9 +36,12 @@
 #include "utils/MPIHelper.h"
 #include "utils/pllnni.h"
 
-Params *globalParams;
-Alignment *globalAlignment;
-extern StringIntMap pllTreeCounter;
+thread_local Params *globalParams;
+thread_local Alignment *globalAlignment;
+extern thread_local StringIntMap pllTreeCounter;
+
+/** fraction of the RAM that the buffer of --rell-batch may take */
+const double RELL_BATCH_MEM_FRACTION = 0.1;
 
 IQTree::IQTree() : PhyloTree() {
     IQTree::init();
@@ -50,6 +53,7 @@ void IQTree::init() {
     k_delete = k_delete_min = k_delete_max = k_delete_stay = 0;
     dist_matrix = NULL;
     var_matrix = NULL;
+    dist_lower = NULL;
 //    curScore = 0.0; // Current score of the tree
     cur_pars_score = -1;
 //    enable_parsimony = false;
@@ -84,6 +88,13 @@ void IQTree::init() {
     on_refine_btree = false;
     contree_rfdist = -1;
     boot_consense_logl = 0.0;
+    rell_batch_lh = NULL;
+    rell_batch_ptnlh = NULL;
+    rell_batch_size = 0;
+    subtree_lh_cache = NULL;
+    subtree_scale_cache = NULL;
+    subtree_lh_slots = 0;
+    subtree_lh_float = false;
 
 }
 
@@ -100,17 +111,18 @@ void IQTree::setCheckpoint(Checkpoint *checkpoint) {
 }
 
 void IQTree::saveUFBoot(Checkpoint *checkpoint) {
+    flushRellBatch();
     checkpoint->startStruct("UFBoot");
     if (MPIHelper::getInstance().isWorker()) {
         CKP_SAVE(sample_start);
         CKP_SAVE(sample_end);
-        checkpoint->startList(boot_samples.size());
+        checkpoint->startList(boot_tree_ids.size());
         checkpoint->setListElement(sample_start-1);
         for (int id = sample_start; id != sample_end; id++) {
             checkpoint->addListElement();
             stringstream ss;
             ss.precision(10);
-            ss << boot_counts[id] << " " << boot_logl[id] << " " << boot_orig_logl[id] << " " << boot_trees[id];
+            ss << boot_counts[id] << " " << boot_logl[id] << " " << boot_orig_logl[id] << " " << getBootTree(id);
             checkpoint->put("", ss.str());
         }
         checkpoint->endList();
@@ -118,12 +130,12 @@ void IQTree::saveUFBoot(Checkpoint *checkpoint) {
         CKP_SAVE(logl_cutoff);
         int boot_splits_size = boot_splits.size();
         CKP_SAVE(boot_splits_size);
-        checkpoint->startList(boot_samples.size());
-        for (int id = 0; id != boot_samples.size(); id++) {
+        checkpoint->startList(boot_tree_ids.size());
+        for (int id = 0; id != boot_tree_ids.size(); id++) {
             checkpoint->addListElement();
             stringstream ss;
             ss.precision(10);
-            ss << boot_counts[id] << " " << boot_logl[id] << " " << boot_orig_logl[id] << " " << boot_trees[id];
+            ss << boot_counts[id] << " " << boot_logl[id] << " " << boot_orig_logl[id] << " " << getBootTree(id);
             checkpoint->put("", ss.str());
         }
         checkpoint->endList();
@@ -135,7 +147,7 @@ void IQTree::saveCheckpoint() {
     stop_rule.saveCheckpoint();
     candidateTrees.saveCheckpoint();
     
-    if (boot_samples.size() > 0 && !boot_trees.front().empty()) {
+    if (hasBootSamples() && !getBootTree(0).empty()) {
         saveUFBoot(checkpoint);
         // boot_splits
         int id = 0;
@@ -166,7 +178,9 @@ void IQTree::restoreUFBoot(Checkpoint *checkpoint) {
         checkpoint->getString("", str);
         ASSERT(!str.empty());
         stringstream ss(str);
-        ss >> boot_counts[id] >> boot_logl[id] >> boot_orig_logl[id] >> boot_trees[id];
+        string tree_str;
+        ss >> boot_counts[id] >> boot_logl[id] >> boot_orig_logl[id] >> tree_str;
+        setBootTree(id, tree_str);
     }
     checkpoint->endList();
     checkpoint->endStruct();
@@ -184,7 +198,7 @@ void IQTree::restoreCheckpoint() {
         // save boot_samples and boot_trees
         int id = 0;
         checkpoint->startList(params->gbo_replicates);
-        boot_trees.resize(params->gbo_replicates);
+        boot_tree_ids.resize(params->gbo_replicates, -1);
         boot_logl.resize(params->gbo_replicates);
         boot_orig_logl.resize(params->gbo_replicates);
         boot_counts.resize(params->gbo_replicates);
@@ -193,7 +207,9 @@ void IQTree::restoreCheckpoint() {
             string str;
             checkpoint->getString("", str);
             stringstream ss(str);
-            ss >> boot_counts[id] >> boot_logl[id] >> boot_orig_logl[id] >> boot_trees[id];
+            string tree_str;
+            ss >> boot_counts[id] >> boot_logl[id] >> boot_orig_logl[id] >> tree_str;
+            setBootTree(id, tree_str);
         }
         checkpoint->endList();
         int boot_splits_size = 0;
@@ -344,20 +360,18 @@ void IQTree::initSettings(Params &params) {
         
 //        cout << "Generating " << params.gbo_replicates << " samples for ultrafast "
 //             << RESAMPLE_NAME << " (seed: " << params.ran_seed << ")..." << endl;
-        // allocate memory for boot_samples
-        boot_samples.resize(params.gbo_replicates);
         sample_start = 0;
-        sample_end = boot_samples.size();
+        sample_end = params.gbo_replicates;
 
         // compute the sample_start and sample_end
         if (MPIHelper::getInstance().getNumProcesses() > 1) {
-            int num_samples = boot_samples.size() / MPIHelper::getInstance().getNumProcesses();
-            if (boot_samples.size() % MPIHelper::getInstance().getNumProcesses() != 0)
+            int num_samples = params.gbo_replicates / MPIHelper::getInstance().getNumProcesses();
+            if (params.gbo_replicates % MPIHelper::getInstance().getNumProcesses() != 0)
                 num_samples++;
             sample_start = MPIHelper::getInstance().getProcessID() * num_samples;
             sample_end = sample_start + num_samples;
-            if (sample_end > boot_samples.size())
-                sample_end = boot_samples.size();
+            if (sample_end > params.gbo_replicates)
+                sample_end = params.gbo_replicates;
         }
 
         size_t orig_nptn = getAlnNPattern();
@@ -366,18 +380,29 @@ void IQTree::initSettings(Params &params) {
 #else
         size_t nptn = get_safe_upper_limit(orig_nptn);
 #endif
-        BootValType *mem = aligned_alloc<BootValType>(nptn * (size_t)(params.gbo_replicates));
-        memset(mem, 0, nptn * (size_t)(params.gbo_replicates) * sizeof(BootValType));
-        for (i = 0; i < params.gbo_replicates; i++)
-            boot_samples[i] = mem + i*nptn;
+        // allocate memory for boot_samples, or boot_weights with 1 instead of sizeof(BootValType) bytes per pattern
+        if (params.ufboot_compact) {
+            boot_weights.resize(params.gbo_replicates);
+            boot_weight_overflow.resize(params.gbo_replicates);
+            uint8_t *mem = aligned_alloc<uint8_t>(nptn * (size_t)(params.gbo_replicates));
+            memset(mem, 0, nptn * (size_t)(params.gbo_replicates));
+            for (i = 0; i < params.gbo_replicates; i++)
+                boot_weights[i] = mem + i*nptn;
+        } else {
+            boot_samples.resize(params.gbo_replicates);
+            BootValType *mem = aligned_alloc<BootValType>(nptn * (size_t)(params.gbo_replicates));
+            memset(mem, 0, nptn * (size_t)(params.gbo_replicates) * sizeof(BootValType));
+            for (i = 0; i < params.gbo_replicates; i++)
+                boot_samples[i] = mem + i*nptn;
+        }
 
-        if (boot_trees.empty()) {
+        if (boot_tree_ids.empty()) {
             boot_logl.resize(params.gbo_replicates, -DBL_MAX);
             boot_orig_logl.resize(params.gbo_replicates, -DBL_MAX);
-            boot_trees.resize(params.gbo_replicates, "");
+            boot_tree_ids.resize(params.gbo_replicates, -1);
             boot_counts.resize(params.gbo_replicates, 0);
         } else {
-            cout << "CHECKPOINT: " << boot_trees.size() << " UFBoot trees and " << boot_splits.size() << " UFBootSplits restored" << endl;
+            cout << "CHECKPOINT: " << boot_tree_ids.size() << " UFBoot trees and " << boot_splits.size() << " UFBootSplits restored" << endl;
         }
         VerboseMode saved_mode = verbose_mode;
         verbose_mode = VB_QUIET;
@@ -390,15 +415,13 @@ void IQTree::initSettings(Params &params) {
                     bootstrap_alignment = new Alignment;
                 IntVector this_sample;
                 bootstrap_alignment->createBootstrapAlignment(aln, &this_sample, params.bootstrap_spec);
-                for (size_t j = 0; j < orig_nptn; j++)
-                    boot_samples[i][j] = this_sample[j];
+                setBootSampleWeights(i, this_sample);
                 bootstrap_alignment->printAlignment(params.aln_output_format, bootaln_name.c_str(), true);
                 delete bootstrap_alignment;
             } else {
                 IntVector this_sample;
                 aln->createBootstrapAlignment(this_sample, params.bootstrap_spec);
-                for (size_t j = 0; j < orig_nptn; j++)
-                    boot_samples[i][j] = this_sample[j];
+                setBootSampleWeights(i, this_sample);
             }
         }
         verbose_mode = saved_mode;
@@ -420,7 +443,7 @@ void IQTree::initSettings(Params &params) {
             for (size_t i = 0; i < params.gbo_replicates; i++) {
                 boot_samples_int[i].resize(nptn, 0);
                 for (size_t j = 0; j < orig_nptn; j++)
-                    boot_samples_int[i][j] = boot_samples[i][j];
+                    boot_samples_int[i][j] = getBootSampleWeight(i, j);
                }
         }
 
@@ -449,6 +472,15 @@ IQTree::~IQTree() {
         aligned_free(boot_samples[0]); // free memory
         boot_samples.clear();
     }
+    if (!boot_weights.empty()) {
+        aligned_free(boot_weights[0]);
+        boot_weights.clear();
+    }
+    if (rell_batch_ptnlh)
+        aligned_free(rell_batch_ptnlh);
+    if (rell_batch_lh)
+        aligned_free(rell_batch_lh);
+    clearSubtreePartialLh();
 }
 
 extern const char *aa_model_names_rax[];
@@ -640,6 +672,17 @@ void IQTree::computeInitialTree(LikelihoodKernel kernel, istream* in) {
             else
                 fixed_number = wrapperFixNegativeBranch(false);
             break;
+        case STT_PLACEMENT:
+            // no full distance matrix: groups around sampled representatives
+            cout << "Creating initial tree by placing sequences around representatives..." << endl;
+            computePlacementTree(*params);
+            cout << getRealTime() - start << " seconds" << endl;
+            params->numInitTrees = 1;
+            if (isSuperTree())
+                wrapperFixNegativeBranch(true);
+            else
+                fixed_number = wrapperFixNegativeBranch(false);
+            break;
         case STT_USER_TREE:
             ASSERT(0 && "User tree should be handled already");
             break;
@@ -713,8 +756,11 @@ void IQTree::initCandidateTreeSet(int nParTrees, int nNNITrees) {
     StrVector pars_trees;
     if (params->start_tree == STT_PARSIMONY && nParTrees >= 1) {
         pars_trees.resize(nParTrees);
+        UINT *tip_pars = NULL;
+        ThreadSettings thread_settings;
         #pragma omp parallel
         {
+            thread_settings.apply();
             int *rstream;
             int ran_seed = params->ran_seed + processID * 1000 + omp_get_thread_num();
             init_random(ran_seed, false, &rstream);
@@ -725,13 +771,20 @@ void IQTree::initCandidateTreeSet(int nParTrees, int nNNITrees) {
             tree.setParams(params);
             tree.setParsimonyKernel(params->SSE);
             tree.rooted = rooted;
+            tree.aln = aln;
+            // the leaf bit vectors are the same for all trees: build them once and share them
+            #pragma omp single
+            tip_pars = tree.newTipParsimony();
+            tree.shared_tip_pars = tip_pars;
             #pragma omp for schedule(dynamic)
             for (int i = 0; i < nParTrees; i++) {
                 tree.computeParsimonyTree(NULL, aln, rstream);
                 pars_trees[i] = tree.getTreeString();
             }
+            tree.shared_tip_pars = NULL;
             finish_random(rstream);
         }
+        aligned_free(tip_pars);
     }
 #endif
 
@@ -2060,7 +2113,7 @@ double IQTree::perturb(int times) {
 }
 
 //extern "C" pllUFBootData * pllUFBootDataPtr;
-extern pllUFBootData * pllUFBootDataPtr;
+extern thread_local pllUFBootData * pllUFBootDataPtr;
 
 string IQTree::optimizeModelParameters(bool printInfo, double logl_epsilon) {
     prepareToComputeDistances();
@@ -2290,6 +2343,9 @@ double IQTree::doTreeSearch() {
     while (!stop_rule.meetStopCondition(stop_rule.getCurIt(), cur_correlation)) {
 
         searchinfo.curIter = stop_rule.getCurIt();
+        flushRellBatch();
+        if (boot_tree_strs.size() > boot_tree_ids.size())
+            compactBootTrees();
         // estimate logl_cutoff for bootstrap
         if (!boot_orig_logl.empty())
             logl_cutoff = *min_element(boot_orig_logl.begin(), boot_orig_logl.end());
@@ -2403,6 +2459,7 @@ double IQTree::doTreeSearch() {
         //     ((PhyloSuperTreePlen*)this)->printNNIcasesNUM();
 
     }
+    flushRellBatch();
 
     // 2019-06-03: check convergence here to avoid effect of refineBootTrees
     if (boot_splits.size() >= 2 && MPIHelper::getInstance().isMaster()) {
@@ -2440,6 +2497,9 @@ double IQTree::doTreeSearch() {
     MPIHelper::getInstance().resetNumbers();
 #endif
 
+    if (params->lh_mem_save == LM_MEM_SAVE && verbose_mode >= VB_MED && !isSuperTree())
+        mem_slots.report(cout);
+
     cout << "TREE SEARCH COMPLETED AFTER " << stop_rule.getCurIt() << " ITERATIONS"
     << " / Time: " << convert_time(getRealTime() - params->start_real_time) << endl << endl;
 
@@ -2649,6 +2709,7 @@ void IQTree::refineBootTrees(){
  ***********************************************************/
 void IQTree::refineBootTrees() {
 
+    flushRellBatch();
     int *saved_randstream = randstream;
     init_random(params->ran_seed);
 
@@ -2686,7 +2747,7 @@ void IQTree::refineBootTrees() {
     ModelsBlock *models_block = readModelsDefinition(*params);
     
 	// do bootstrap analysis
-	for (int sample = refined_samples; sample < boot_trees.size(); sample++) {
+	for (int sample = refined_samples; sample < boot_tree_ids.size(); sample++) {
         // create bootstrap alignment
         Alignment* bootstrap_alignment;
         if (aln->isSuperAlignment())
@@ -2746,9 +2807,9 @@ void IQTree::refineBootTrees() {
         // load the current ufboot tree
         // 2019-02-06: fix crash with -sp and -bnni
         if (isSuperTree())
-            boot_tree->PhyloTree::readTreeString(boot_trees[sample]);
+            boot_tree->PhyloTree::readTreeString(getBootTree(sample));
         else
-            boot_tree->readTreeString(boot_trees[sample]);
+            boot_tree->readTreeString(getBootTree(sample));
         
         if (boot_tree->isSuperTree() && params->partition_type == BRLEN_OPTIMIZE) {
             if (((PhyloSuperTree*)boot_tree)->size() > 1) {
@@ -2783,7 +2844,7 @@ void IQTree::refineBootTrees() {
             boot_tree->printTree(ostr, WT_TAXON_ID | WT_SORT_TAXA | WT_BR_LEN | WT_BR_LEN_SHORT);
         else
             boot_tree->printTree(ostr, WT_TAXON_ID | WT_SORT_TAXA);
-        boot_trees[sample] = ostr.str();
+        setBootTree(sample, ostr.str());
         boot_logl[sample] = boot_tree->curScore;
 
 
@@ -2828,7 +2889,7 @@ void IQTree::refineBootTrees() {
     checkpoint->dump();
     
     // restore
-    params->gbo_replicates = boot_trees.size();
+    params->gbo_replicates = boot_tree_ids.size();
     params->nni_type = saved_nni_type;
     if(params->nni_type == NNI5) {
         params->nni5 = true;
@@ -3273,7 +3334,7 @@ void IQTree::pllInitUFBootData(){
                 if(!pllUFBootDataPtr->boot_samples[i]) outError("Not enough dynamic memory!");
                 for(int j = 0; j < pllAlignment->sequenceLength; j++){
                     pllUFBootDataPtr->boot_samples[i][j] =
-                        boot_samples[i][pll2iqtree_pattern_index[j]];
+                        getBootSampleWeight(i, pll2iqtree_pattern_index[j]);
                 }
             }
 
@@ -3561,24 +3622,43 @@ void IQTree::saveCurrentTree(double cur_logl) {
         printTree(out_treels, WT_NEWLINE | WT_BR_LEN);
 
     int nptn = getAlnNPattern();
+    // buffer the pattern log-likelihoods for flushRellBatch() instead of evaluating them now
+    bool batch = params->rell_batch > 1 && hasBootSamples();
 
 #ifdef BOOT_VAL_FLOAT
     int maxnptn = get_safe_upper_limit_float(nptn);
-    BootValType *pattern_lh = aligned_alloc<BootValType>(maxnptn);
-    memset(pattern_lh, 0, maxnptn*sizeof(BootValType));
-    double *pattern_lh_orig = aligned_alloc<double>(nptn);
+#else
+    int maxnptn = get_safe_upper_limit(nptn);
+#endif
+    BootValType *pattern_lh;
+    if (batch) {
+        if (!rell_batch_lh) {
+            // cap the batch so that its buffer takes at most RELL_BATCH_MEM_FRACTION of the RAM
+            uint64_t max_batch_size = (uint64_t)(getMemorySize() * RELL_BATCH_MEM_FRACTION) / (maxnptn * sizeof(BootValType));
+            rell_batch_size = (size_t)min((uint64_t)params->rell_batch, max(max_batch_size, (uint64_t)1));
+            if (rell_batch_size < (size_t)params->rell_batch)
+                outWarning("--rell-batch " + convertIntToString(params->rell_batch) + " needs too much memory, evaluating RELL for " +
+                    convertInt64ToString(rell_batch_size) + " trees at once");
+            rell_batch_lh = aligned_alloc<BootValType>(maxnptn * rell_batch_size);
+            memset(rell_batch_lh, 0, maxnptn * rell_batch_size * sizeof(BootValType));
+            rell_batch_ptnlh = aligned_alloc<double>(maxnptn);
+        }
+        pattern_lh = rell_batch_lh + maxnptn * rell_batch_trees.size();
+    } else {
+        pattern_lh = aligned_alloc<BootValType>(maxnptn);
+        memset(pattern_lh, 0, maxnptn*sizeof(BootValType));
+    }
+#ifdef BOOT_VAL_FLOAT
+    double *pattern_lh_orig = batch ? rell_batch_ptnlh : aligned_alloc<double>(nptn);
     computePatternLikelihood(pattern_lh_orig, &cur_logl);
     for (int i = 0; i < nptn; i++)
         pattern_lh[i] = (float)pattern_lh_orig[i];
 #else
-    int maxnptn = get_safe_upper_limit(nptn);
-    BootValType *pattern_lh = aligned_alloc<BootValType>(maxnptn);
-    memset(pattern_lh, 0, maxnptn*sizeof(BootValType));
     computePatternLikelihood(pattern_lh, &cur_logl);
 #endif
 
 
-    if (boot_samples.empty()) {
+    if (!hasBootSamples()) {
         // for runGuidedBootstrap
     } else {
         // online bootstrap
@@ -3594,10 +3674,20 @@ void IQTree::saveCurrentTree(double cur_logl) {
             printTree(ostr, WT_TAXON_ID + WT_SORT_TAXA);
         tree_str = ostr.str();
 
+        if (batch) {
+            rell_batch_trees.push_back(tree_str);
+            rell_batch_logl.push_back(cur_logl);
+            if (rell_batch_trees.size() == rell_batch_size)
+                flushRellBatch();
+        } else {
+        // the tree is added to boot_tree_index only if it becomes the best tree of a replicate
+        IntVector adopted(sample_end - sample_start, 0);
     #ifdef _OPENMP
         int rand_seed = random_int(1000);
+        ThreadSettings thread_settings;
         #pragma omp parallel
         {
+        thread_settings.apply();
         int *rstream;
         init_random(rand_seed + omp_get_thread_num(), false, &rstream);
         #pragma omp for
@@ -3609,11 +3699,7 @@ void IQTree::saveCurrentTree(double cur_logl) {
 
             {
                 // SSE optimized version of the above loop
-                BootValType *boot_sample = boot_samples[sample];
-
-                BootValType res = (this->*dotProduct)(pattern_lh, boot_sample, nptn);
-
-                rell = res;
+                rell = computeBootRell(pattern_lh, sample, 0, nptn);
             }
 
             bool better = rell > boot_logl[sample] + params->ufboot_epsilon;
@@ -3628,13 +3714,23 @@ void IQTree::saveCurrentTree(double cur_logl) {
                 }
                 boot_logl[sample] = max(boot_logl[sample], rell);
                 boot_orig_logl[sample] = cur_logl;
-                boot_trees[sample] = tree_str;
+                adopted[sample - sample_start] = 1;
             }
         }
     #ifdef _OPENMP
         finish_random(rstream);
         }
     #endif
+        int tree_id = -1;
+        for (int sample = sample_start; sample < sample_end; sample++)
+            if (adopted[sample - sample_start]) {
+                if (tree_id < 0)
+                    tree_id = addBootTree(tree_str);
+                boot_tree_ids[sample] = tree_id;
+            }
+        if (boot_tree_strs.size() > 2 * boot_tree_ids.size())
+            compactBootTrees();
+        }
     }
     if (Params::getInstance().print_tree_lh) {
         out_treelh << cur_logl;
@@ -3654,7 +3750,9 @@ void IQTree::saveCurrentTree(double cur_logl) {
         out_sitelh << endl;
     }
 
-    if (!boot_samples.empty()) {
+    if (batch) {
+        // rows of rell_batch_lh are kept until the next flushRellBatch()
+    } else if (hasBootSamples()) {
 #ifdef BOOT_VAL_FLOAT
         aligned_free(pattern_lh_orig);
 #endif
@@ -3667,6 +3765,198 @@ void IQTree::saveCurrentTree(double cur_logl) {
 
 }
 
+void IQTree::flushRellBatch() {
+    int ntrees = rell_batch_trees.size();
+    if (ntrees == 0)
+        return;
+    size_t nptn = getAlnNPattern();
+#ifdef BOOT_VAL_FLOAT
+    size_t maxnptn = get_safe_upper_limit_float(nptn);
+#else
+    size_t maxnptn = get_safe_upper_limit(nptn);
+#endif
+    // blocked product of the buffered trees with the replicates: a pattern block of all trees
+    // stays in cache for SAMPLE_BLOCK replicates, and a block of one replicate for all trees
+    const size_t PTN_BLOCK = 1024;
+    const int SAMPLE_BLOCK = 8;
+    int nblocks = (sample_end - sample_start + SAMPLE_BLOCK - 1) / SAMPLE_BLOCK;
+    // index in the batch of the new best tree of each replicate, -1 if unchanged
+    IntVector best_ids(sample_end - sample_start, -1);
+
+#ifdef _OPENMP
+    int rand_seed = random_int(1000);
+    ThreadSettings thread_settings;
+    #pragma omp parallel
+    {
+    thread_settings.apply();
+    int *rstream;
+    init_random(rand_seed + omp_get_thread_num(), false, &rstream);
+#else
+    int *rstream = randstream;
+#endif
+    double *rell = new double[SAMPLE_BLOCK*ntrees];
+#ifdef _OPENMP
+    // static schedule: each thread's random stream always serves the same blocks,
+    // so ties are broken reproducibly for a fixed -seed and number of threads
+    #pragma omp for schedule(static)
+#endif
+    for (int block = 0; block < nblocks; block++) {
+        int first = sample_start + block*SAMPLE_BLOCK;
+        int last = min(first + SAMPLE_BLOCK, sample_end);
+        memset(rell, 0, sizeof(double)*SAMPLE_BLOCK*ntrees);
+        for (size_t ptn = 0; ptn < maxnptn; ptn += PTN_BLOCK) {
+            int len = min(PTN_BLOCK, maxnptn - ptn);
+            for (int sample = first; sample < last; sample++) {
+                double *sample_rell = rell + (sample-first)*ntrees;
+                for (int id = 0; id < ntrees; id++)
+                    sample_rell[id] += computeBootRell(rell_batch_lh + id*maxnptn + ptn, sample, ptn, len);
+            }
+        }
+        // update the best trees in the order the trees were visited, as saveCurrentTree() would
+        for (int sample = first; sample < last; sample++) {
+            double *sample_rell = rell + (sample-first)*ntrees;
+            int best_id = -1;
+            for (int id = 0; id < ntrees; id++) {
+                double cur_rell = sample_rell[id];
+                bool better = cur_rell > boot_logl[sample] + params->ufboot_epsilon;
+                if (!better && cur_rell > boot_logl[sample] - params->ufboot_epsilon) {
+                    better = (random_double(rstream) <= 1.0 / (boot_counts[sample] + 1));
+                }
+                if (better) {
+                    if (cur_rell <= boot_logl[sample] + params->ufboot_epsilon) {
+                        boot_counts[sample]++;
+                    } else {
+                        boot_counts[sample] = 1;
+                    }
+                    boot_logl[sample] = max(boot_logl[sample], cur_rell);
+                    boot_orig_logl[sample] = rell_batch_logl[id];
+                    best_id = id;
+                }
+            }
+            best_ids[sample - sample_start] = best_id;
+        }
+    }
+    delete [] rell;
+#ifdef _OPENMP
+    finish_random(rstream);
+    }
+#endif
+    // add only the trees that became the best tree of a replicate to boot_tree_index
+    IntVector tree_ids(ntrees, -1);
+    for (int sample = sample_start; sample < sample_end; sample++) {
+        int best_id = best_ids[sample - sample_start];
+        if (best_id < 0)
+            continue;
+        if (tree_ids[best_id] < 0)
+            tree_ids[best_id] = addBootTree(rell_batch_trees[best_id]);
+        boot_tree_ids[sample] = tree_ids[best_id];
+    }
+    if (boot_tree_strs.size() > 2 * boot_tree_ids.size())
+        compactBootTrees();
+    rell_batch_trees.clear();
+    rell_batch_logl.clear();
+}
+
+void IQTree::setBootSampleWeights(int sample, IntVector &freqs) {
+    size_t nptn = getAlnNPattern();
+    if (boot_weights.empty()) {
+        for (size_t ptn = 0; ptn < nptn; ptn++)
+            boot_samples[sample][ptn] = freqs[ptn];
+        return;
+    }
+    boot_weight_overflow[sample].clear();
+    for (size_t ptn = 0; ptn < nptn; ptn++) {
+        if (freqs[ptn] > UINT8_MAX) {
+            boot_weights[sample][ptn] = UINT8_MAX;
+            boot_weight_overflow[sample].push_back(make_pair((int)ptn, freqs[ptn] - UINT8_MAX));
+        } else {
+            boot_weights[sample][ptn] = freqs[ptn];
+        }
+    }
+}
+
+int IQTree::getBootSampleWeight(int sample, size_t ptn) {
+    if (boot_weights.empty())
+        return boot_samples[sample][ptn];
+    int weight = boot_weights[sample][ptn];
+    if (weight == UINT8_MAX)
+        for (auto it = boot_weight_overflow[sample].begin(); it != boot_weight_overflow[sample].end(); it++)
+            if ((size_t)it->first == ptn)
+                return weight + it->second;
+    return weight;
+}
+
+double IQTree::computeBootRell(BootValType *pattern_lh, int sample, size_t ptn, int len) {
+    if (boot_weights.empty())
+        return (this->*dotProduct)(pattern_lh, boot_samples[sample] + ptn, len);
+    double rell = (this->*dotProductCount)(pattern_lh, boot_weights[sample] + ptn, len);
+    // add the part of the frequencies that did not fit into 8 bits
+    for (auto it = boot_weight_overflow[sample].begin(); it != boot_weight_overflow[sample].end(); it++)
+        if ((size_t)it->first >= ptn && (size_t)it->first < ptn + len)
+            rell += pattern_lh[it->first - ptn] * it->second;
+    return rell;
+}
+
+int IQTree::addBootTree(const string &tree_str) {
+    if (tree_str.empty())
+        return -1;
+    auto it = boot_tree_index.find(tree_str);
+    if (it != boot_tree_index.end())
+        return it->second;
+    int id = boot_tree_strs.size();
+    it = boot_tree_index.insert(make_pair(tree_str, id)).first;
+    boot_tree_strs.push_back(&it->first);
+    return id;
+}
+
+const string &IQTree::getBootTree(int sample) {
+    static const string empty_tree;
+    if (boot_tree_ids[sample] < 0)
+        return empty_tree;
+    return *boot_tree_strs[boot_tree_ids[sample]];
+}
+
+void IQTree::getBootTreeWeights(IntVector &weights) {
+    weights.clear();
+    weights.resize(boot_tree_strs.size(), 0);
+    for (auto it = boot_tree_ids.begin(); it != boot_tree_ids.end(); it++)
+        if (*it >= 0)
+            weights[*it]++;
+}
+
+void IQTree::getBootTreeSet(MTreeSet &trees) {
+    IntVector weights;
+    getBootTreeWeights(weights);
+    int count = 0;
+    for (int id = 0; id < weights.size(); id++)
+        if (weights[id] > 0) {
+            trees.addTree(*boot_tree_strs[id], rooted, weights[id]);
+            count++;
+        }
+    if (verbose_mode >= VB_MED)
+        cout << count << " distinct tree(s) for " << boot_tree_ids.size() << " replicates converted" << endl;
+}
+
+void IQTree::compactBootTrees() {
+    IntVector weights;
+    getBootTreeWeights(weights);
+    IntVector new_ids(weights.size(), -1);
+    vector<const string*> new_strs;
+    for (int id = 0; id < weights.size(); id++) {
+        if (weights[id] == 0) {
+            boot_tree_index.erase(*boot_tree_strs[id]);
+            continue;
+        }
+        new_ids[id] = new_strs.size();
+        new_strs.push_back(boot_tree_strs[id]);
+        boot_tree_index[*boot_tree_strs[id]] = new_ids[id];
+    }
+    boot_tree_strs = new_strs;
+    for (auto it = boot_tree_ids.begin(); it != boot_tree_ids.end(); it++)
+        if (*it >= 0)
+            *it = new_ids[*it];
+}
+
 void IQTree::saveNNITrees(PhyloNode *node, PhyloNode *dad) {
     if (!node) {
         node = (PhyloNode*) root;
@@ -3784,6 +4074,7 @@ void IQTree::summarizeBootstrap(Params &params, MTreeSet &trees) {
 }
 
 void IQTree::writeUFBootTrees(Params &params) {
+    flushRellBatch();
     MTreeSet trees;
 //    IntVector tree_weights;
     int i, j;
@@ -3791,8 +4082,16 @@ void IQTree::writeUFBootTrees(Params &params) {
     filename += ".ufboot";
     ofstream out(filename.c_str());
 
-    trees.init(boot_trees, rooted);
-    for (i = 0; i < trees.size(); i++) {
+    IntVector weights;
+    getBootTreeWeights(weights);
+    getBootTreeSet(trees);
+    // newick string to print for each tree ID
+    StrVector tree_strs(weights.size());
+    int id = 0;
+    for (i = 0; i < trees.size(); i++, id++) {
+        // trees holds the IDs with at least one replicate, in increasing order
+        while (weights[id] == 0)
+            id++;
         NodeVector taxa;
         // change the taxa name from ID to real name
         trees[i]->getOrderedTaxa(taxa);
@@ -3802,28 +4101,34 @@ void IQTree::writeUFBootTrees(Params &params) {
             // reinsert removed seqs into each tree
             trees[i]->insertTaxa(removed_seqs, twin_seqs);
         }
-        // now print to file
-        for (j = 0; j < trees.tree_weights[i]; j++)
-            if (params.print_ufboot_trees == 1)
-                trees[i]->printTree(out, WT_NEWLINE);
-            else
-                trees[i]->printTree(out, WT_NEWLINE + WT_BR_LEN);
+        stringstream ss;
+        if (params.print_ufboot_trees == 1)
+            trees[i]->printTree(ss, WT_NEWLINE);
+        else
+            trees[i]->printTree(ss, WT_NEWLINE + WT_BR_LEN);
+        tree_strs[id] = ss.str();
     }
+    // now print to file, one line per replicate in replicate order
+    for (i = 0; i < boot_tree_ids.size(); i++)
+        if (boot_tree_ids[i] >= 0)
+            out << tree_strs[boot_tree_ids[i]];
     cout << "UFBoot trees printed to " << filename << endl;
     out.close();
 }
 
 void IQTree::summarizeBootstrap(Params &params) {
+    flushRellBatch();
     setRootNode(params.root);
     MTreeSet trees;
-    trees.init(boot_trees, rooted);
+    getBootTreeSet(trees);
     summarizeBootstrap(params, trees);
 }
 
 void IQTree::summarizeBootstrap(SplitGraph &sg) {
+    flushRellBatch();
     MTreeSet trees;
     //SplitGraph sg;
-    trees.init(boot_trees, rooted);
+    getBootTreeSet(trees);
     SplitIntMap hash_ss;
     // make the taxa name
     vector<string> taxname;
@@ -3903,9 +4208,9 @@ void IQTree::computeRootstrap(MTreeSet &trees, bool use_taxid) {
             if (other.shouldInvert())
                 other.invert();
             // count how often both splits occur in the tree set
-            for (auto splits : ssvec) {
-                if (splits.findSplit(sg[i]) && splits.findSplit(&other)) {
-                    rootstrap++;
+            for (int t = 0; t < ssvec.size(); t++) {
+                if (ssvec[t].findSplit(sg[i]) && ssvec[t].findSplit(&other)) {
+                    rootstrap += trees.tree_weights[t];
                 }
             }
 
@@ -3931,16 +4236,16 @@ void IQTree::computeRootstrap(MTreeSet &trees, bool use_taxid) {
             }
             
             // count how often both splits occur in the tree set
-            for (auto splits : ssvec) {
-                if (splits.findSplit(left) && splits.findSplit(right)) {
-                    rootstrap++;
+            for (int t = 0; t < ssvec.size(); t++) {
+                if (ssvec[t].findSplit(left) && ssvec[t].findSplit(right)) {
+                    rootstrap += trees.tree_weights[t];
                 }
             }
             delete right;
             delete left;
         }
         
-        double rootstrap_dbl = (double)rootstrap*100.0 / trees.size();
+        double rootstrap_dbl = (double)rootstrap*100.0 / trees.sumTreeWeights();
         //branch.first->findNeighbor(branch.second)->putAttr("rootstrap", rootstrap_dbl);
         Neighbor *nei = branch.second->findNeighbor(branch.first);
         nei->putAttr("rootstrap", rootstrap_dbl);
@@ -4123,6 +4428,168 @@ void IQTree::computeRootstrapUnrooted(MTreeSet &trees, const char* outgroup, boo
     cout << "Annotated tree (best viewed in FigTree) written to " << filename << endl;
 }
 
+/****************************************************************************
+ Reuse of likelihoods between the trees of a tree set (--tree-reuse)
+ ****************************************************************************/
+
+/** finalizer of splitmix64, spreads the bits of a taxon or subtree hash */
+static inline uint64_t mixSubtreeHash(uint64_t h) {
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+void IQTree::computeSubtreeHash(PhyloNeighbor *dad_branch, PhyloNode *dad,
+    unordered_map<PhyloNeighbor*, pair<uint64_t, uint64_t> > &hashes)
+{
+    if (hashes.find(dad_branch) != hashes.end())
+        return;
+    PhyloNode *node = (PhyloNode*)dad_branch->node;
+    if (node->isLeaf()) {
+        hashes[dad_branch] = make_pair(mixSubtreeHash(2*(uint64_t)node->id+1), mixSubtreeHash(2*(uint64_t)node->id+2));
+        return;
+    }
+    uint64_t split_hash = 0, subtree_hash = 0;
+    FOR_NEIGHBOR_IT(node, dad, it) {
+        PhyloNeighbor *child = (PhyloNeighbor*)(*it);
+        computeSubtreeHash(child, node, hashes);
+        pair<uint64_t, uint64_t> child_hash = hashes[child];
+        uint64_t length_bits;
+        memcpy(&length_bits, &child->length, sizeof(length_bits));
+        split_hash ^= child_hash.first;
+        // a sum does not depend on the order of the children
+        subtree_hash += mixSubtreeHash(child_hash.second ^ mixSubtreeHash(length_bits));
+    }
+    hashes[dad_branch] = make_pair(split_hash, mixSubtreeHash(subtree_hash));
+}
+
+void IQTree::saveSubtreePartialLh() {
+    NodeVector nodes1, nodes2;
+    getBranches(nodes1, nodes2);
+    unordered_map<PhyloNeighbor*, pair<uint64_t, uint64_t> > hashes;
+    vector<PhyloNeighbor*> saved;
+    subtree_lh_index.clear();
+    split_length_cache.clear();
+    subtree_lh_float = float_partial_lh;
+    for (size_t i = 0; i < nodes1.size(); i++) {
+        PhyloNeighbor *nei[2] = {(PhyloNeighbor*)nodes1[i]->findNeighbor(nodes2[i]),
+            (PhyloNeighbor*)nodes2[i]->findNeighbor(nodes1[i])};
+        computeSubtreeHash(nei[0], (PhyloNode*)nodes1[i], hashes);
+        computeSubtreeHash(nei[1], (PhyloNode*)nodes2[i], hashes);
+        split_length_cache[min(hashes[nei[0]].first, hashes[nei[1]].first)] = nei[0]->length;
+        for (int j = 0; j < 2; j++) {
+            if (nei[j]->node->isLeaf() || !(nei[j]->partial_lh_computed & 1) ||
+                ((nei[j]->partial_lh_computed & 4) != 0) != subtree_lh_float ||
+                !nei[j]->partial_lh || !nei[j]->scale_num)
+                continue;
+            uint64_t subtree_hash = hashes[nei[j]].second;
+            if (subtree_lh_index.find(subtree_hash) != subtree_lh_index.end())
+                continue;
+            subtree_lh_index[subtree_hash] = saved.size();
+            saved.push_back(nei[j]);
+        }
+    }
+
+    size_t lh_size = getPartialLhSize();
+    size_t scale_size = getScaleNumSize();
+    size_t lh_offset = getPartialLhOffset();
+    size_t scale_offset = getScaleNumOffset();
+    if (saved.size() > subtree_lh_slots) {
+        if (subtree_lh_cache)
+            aligned_free(subtree_lh_cache);
+        if (subtree_scale_cache)
+            aligned_free(subtree_scale_cache);
+        subtree_lh_slots = saved.size();
+        subtree_lh_cache = aligned_alloc<double>(lh_size * subtree_lh_slots);
+        subtree_scale_cache = aligned_alloc<UBYTE>(scale_size * subtree_lh_slots);
+    }
+    subtree_scale_factor.resize(saved.size());
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (int slot = 0; slot < saved.size(); slot++) {
+        memcpy(subtree_lh_cache + slot*lh_size, saved[slot]->partial_lh + lh_offset, lh_size*sizeof(double));
+        memcpy(subtree_scale_cache + slot*scale_size, saved[slot]->scale_num + scale_offset, scale_size*sizeof(UBYTE));
+        subtree_scale_factor[slot] = saved[slot]->lh_scale_factor;
+    }
+}
+
+int IQTree::restoreSubtreePartialLh(bool reuse_length) {
+    if (split_length_cache.empty())
+        return 0;
+    // saved vectors were stored in the other precision
+    bool reuse_lh = (subtree_lh_float == float_partial_lh);
+    NodeVector nodes1, nodes2;
+    getBranches(nodes1, nodes2);
+    unordered_map<PhyloNeighbor*, pair<uint64_t, uint64_t> > hashes;
+    size_t i;
+    if (reuse_length) {
+        for (i = 0; i < nodes1.size(); i++) {
+            PhyloNeighbor *nei1 = (PhyloNeighbor*)nodes1[i]->findNeighbor(nodes2[i]);
+            PhyloNeighbor *nei2 = (PhyloNeighbor*)nodes2[i]->findNeighbor(nodes1[i]);
+            computeSubtreeHash(nei1, (PhyloNode*)nodes1[i], hashes);
+            computeSubtreeHash(nei2, (PhyloNode*)nodes2[i], hashes);
+            auto it = split_length_cache.find(min(hashes[nei1].first, hashes[nei2].first));
+            if (it != split_length_cache.end())
+                nei1->length = nei2->length = it->second;
+        }
+        // subtree hashes depend on the branch lengths just changed
+        hashes.clear();
+    }
+
+    vector<pair<PhyloNeighbor*, int> > restored;
+    for (i = 0; i < nodes1.size(); i++) {
+        PhyloNeighbor *nei[2] = {(PhyloNeighbor*)nodes1[i]->findNeighbor(nodes2[i]),
+            (PhyloNeighbor*)nodes2[i]->findNeighbor(nodes1[i])};
+        computeSubtreeHash(nei[0], (PhyloNode*)nodes1[i], hashes);
+        computeSubtreeHash(nei[1], (PhyloNode*)nodes2[i], hashes);
+        for (int j = 0; j < 2; j++) {
+            if (!reuse_lh || nei[j]->node->isLeaf() || !nei[j]->partial_lh || !nei[j]->scale_num)
+                continue;
+            auto it = subtree_lh_index.find(hashes[nei[j]].second);
+            if (it != subtree_lh_index.end())
+                restored.push_back(make_pair(nei[j], it->second));
+        }
+    }
+
+    size_t lh_size = getPartialLhSize();
+    size_t scale_size = getScaleNumSize();
+    size_t lh_offset = getPartialLhOffset();
+    size_t scale_offset = getScaleNumOffset();
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (int k = 0; k < restored.size(); k++) {
+        PhyloNeighbor *nei = restored[k].first;
+        size_t slot = restored[k].second;
+        memcpy(nei->partial_lh + lh_offset, subtree_lh_cache + slot*lh_size, lh_size*sizeof(double));
+        memcpy(nei->scale_num + scale_offset, subtree_scale_cache + slot*scale_size, scale_size*sizeof(UBYTE));
+        nei->lh_scale_factor = subtree_scale_factor[slot];
+        nei->partial_lh_computed |= 1;
+        if (subtree_lh_float)
+            nei->partial_lh_computed |= 4;
+        else
+            nei->partial_lh_computed &= ~4;
+    }
+    return restored.size();
+}
+
+void IQTree::clearSubtreePartialLh() {
+    if (subtree_lh_cache)
+        aligned_free(subtree_lh_cache);
+    if (subtree_scale_cache)
+        aligned_free(subtree_scale_cache);
+    subtree_lh_cache = NULL;
+    subtree_scale_cache = NULL;
+    subtree_lh_slots = 0;
+    subtree_lh_index.clear();
+    subtree_scale_factor.clear();
+    split_length_cache.clear();
+}
+
 void IQTree::pllConvertUFBootData2IQTree(){
     // duplication_counter
     duplication_counter = pllUFBootDataPtr->duplication_counter;
@@ -4132,9 +4599,9 @@ void IQTree::pllConvertUFBootData2IQTree(){
 //        treels_logl.push_back(pllUFBootDataPtr->treels_logl[i]);
 
     //boot_trees
-    boot_trees.clear();
+    boot_tree_ids.resize(params->gbo_replicates, -1);
     for(int i = 0; i < params->gbo_replicates; i++)
-        boot_trees.push_back(pllUFBootDataPtr->boot_trees[i]);
+        setBootTree(i, pllUFBootDataPtr->boot_trees[i]);
 
 }
 
@@ -4426,13 +4893,13 @@ void IQTree::syncCurrentTree() {
                     candidateset_changed[w] = true;
         }
 
-        if (boot_samples.size() > 0) {
+        if (hasBootSamples()) {
             restoreUFBoot(checkpoint);
         }
 
         // send candidate trees to worker
         checkpoint->clear();
-        if (boot_samples.size() > 0)
+        if (hasBootSamples())
             CKP_SAVE(logl_cutoff);
         if (candidateset_changed[worker]) {
             CandidateSet cset = candidateTrees.getBestCandidateTrees(Params::getInstance().popSize);
@@ -4448,7 +4915,7 @@ void IQTree::syncCurrentTree() {
         score = curScore;
         CKP_SAVE(tree);
         CKP_SAVE(score);
-        if (boot_samples.size() > 0) {
+        if (hasBootSamples()) {
             saveUFBoot(checkpoint);
         }
         MPIHelper::getInstance().sendCheckpoint(checkpoint, PROC_MASTER);
@@ -4466,7 +4933,7 @@ void IQTree::syncCurrentTree() {
             for (CandidateSet::iterator it = cset.begin(); it != cset.end(); it++)
                 addTreeToCandidateSet(it->second.tree, it->second.score, false, MPIHelper::getInstance().getProcessID());
             MPIHelper::getInstance().increaseTreeReceived(cset.size());
-            if (boot_samples.size() > 0)
+            if (hasBootSamples())
                 CKP_RESTORE(logl_cutoff);
         }
     }
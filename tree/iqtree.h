@@ -774,14 +774,89 @@ public:
     /** vector of bootstrap alignments generated */
     vector<BootValType* > boot_samples;
 
+    /** bootstrap pattern frequencies as 8-bit counts (--ufboot-compact), replaces boot_samples */
+    vector<uint8_t* > boot_weights;
+
+    /** per replicate, patterns with frequency above 255 and the excess over 255 (--ufboot-compact) */
+    vector<vector<pair<int,int> > > boot_weight_overflow;
+
+    /** @return true if the UFBoot replicates were generated */
+    bool hasBootSamples() {
+        return !boot_samples.empty() || !boot_weights.empty();
+    }
+
+    /**
+        store the pattern frequencies of a bootstrap replicate
+        @param sample replicate ID
+        @param freqs pattern frequencies of the replicate
+     */
+    void setBootSampleWeights(int sample, IntVector &freqs);
+
+    /**
+        @param sample replicate ID
+        @param ptn pattern ID
+        @return frequency of pattern ptn in replicate sample
+     */
+    int getBootSampleWeight(int sample, size_t ptn);
+
+    /**
+        compute the RELL log-likelihood of a range of patterns on a bootstrap replicate
+        @param pattern_lh pattern log-likelihoods of the range, aligned
+        @param sample replicate ID
+        @param ptn first pattern of the range, multiple of the vector size
+        @param len number of patterns in the range
+        @return sum of pattern_lh weighted by the replicate pattern frequencies
+     */
+    double computeBootRell(BootValType *pattern_lh, int sample, size_t ptn, int len);
+
     /** starting sample for UFBoot, used for MPI */
     int sample_start;
 
     /** end sample for UFBoot, used for MPI */
     int sample_end;
 
-    /** newick string of corresponding bootstrap trees */
-    StrVector boot_trees;
+    /**
+        distinct newick strings of the bootstrap trees and their IDs: replicates with
+        the same best tree share one string, canonical by WT_TAXON_ID | WT_SORT_TAXA
+     */
+    StringIntMap boot_tree_index;
+
+    /** newick string of each ID in boot_tree_index, pointing to the map keys */
+    vector<const string*> boot_tree_strs;
+
+    /** ID of the best tree of each replicate, -1 if there is none yet */
+    IntVector boot_tree_ids;
+
+    /**
+        @param tree_str newick string of a bootstrap tree
+        @return ID of tree_str in boot_tree_index, added if not yet there; not thread-safe
+     */
+    int addBootTree(const string &tree_str);
+
+    /**
+        @param sample replicate ID
+        @return newick string of the best tree of replicate sample, empty if none
+     */
+    const string &getBootTree(int sample);
+
+    /** set the best tree of replicate sample */
+    void setBootTree(int sample, const string &tree_str) {
+        boot_tree_ids[sample] = addBootTree(tree_str);
+    }
+
+    /**
+        @param[out] weights number of replicates with each tree ID as best tree
+     */
+    void getBootTreeWeights(IntVector &weights);
+
+    /**
+        initialize a tree set with the distinct bootstrap trees, each weighted by its number of replicates
+        @param trees (OUT) tree set
+     */
+    void getBootTreeSet(MTreeSet &trees);
+
+    /** remove the trees that are no longer the best tree of any replicate, renumbering the IDs */
+    void compactBootTrees();
 
     /** bootstrap tree strings with branch lengths, for -wbtl option */
 //    StrVector boot_trees_brlen;
@@ -795,6 +870,30 @@ public:
     /** corresponding log-likelihood on original alignment */
     DoubleVector boot_orig_logl;
 
+    /**
+        pattern log-likelihoods of visited trees waiting for the RELL evaluation (--rell-batch),
+        one zero-padded row of get_safe_upper_limit_float(nptn) entries per tree
+     */
+    BootValType *rell_batch_lh;
+
+    /** number of rows of rell_batch_lh: --rell-batch, capped by the RAM */
+    size_t rell_batch_size;
+
+    /** pattern log-likelihoods in double precision of the tree being saved */
+    double *rell_batch_ptnlh;
+
+    /** newick strings of the trees in rell_batch_lh, added to boot_tree_index by flushRellBatch() if adopted */
+    StrVector rell_batch_trees;
+
+    /** log-likelihoods of the trees in rell_batch_lh */
+    DoubleVector rell_batch_logl;
+
+    /**
+        evaluate the trees buffered by saveCurrentTree() against all bootstrap replicates
+        as a blocked matrix product and update the UFBoot trees, in the order the trees were visited
+     */
+    void flushRellBatch();
+
     /** Set of splits occurring in bootstrap trees */
     vector<SplitGraph*> boot_splits;
 
@@ -836,6 +935,55 @@ public:
      */
     void computeRootstrapUnrooted(MTreeSet &trees, const char* outgroup, bool use_taxid);
 
+    /****** reuse of likelihoods between the trees of a tree set (--tree-reuse) ******/
+
+    /**
+        save the branch lengths and the computed partial likelihoods of the current tree,
+        keyed by split and by directed subtree (topology and branch lengths below the node)
+     */
+    void saveSubtreePartialLh();
+
+    /**
+        restore saved partial likelihoods into the current tree, to be called after
+        initializeAllPartialLh() on a new tree
+        @param reuse_length true to first copy the saved length of every shared split
+        @return number of partial likelihood vectors restored
+     */
+    int restoreSubtreePartialLh(bool reuse_length);
+
+    /** free the memory of saveSubtreePartialLh() */
+    void clearSubtreePartialLh();
+
+    /**
+        compute the split and subtree hashes of a directed branch and all branches below it
+        @param dad_branch branch from dad to the subtree
+        @param dad node above the subtree
+        @param[in,out] hashes split hash (XOR of taxon keys) and subtree hash of each visited branch
+     */
+    void computeSubtreeHash(PhyloNeighbor *dad_branch, PhyloNode *dad,
+        unordered_map<PhyloNeighbor*, pair<uint64_t, uint64_t> > &hashes);
+
+    /** slot in subtree_lh_cache of each saved partial likelihood vector, keyed by subtree hash */
+    unordered_map<uint64_t, int> subtree_lh_index;
+
+    /** saved partial likelihood vectors, getPartialLhSize() entries per slot */
+    double *subtree_lh_cache;
+
+    /** saved scaling numbers, getScaleNumSize() entries per slot */
+    UBYTE *subtree_scale_cache;
+
+    /** saved likelihood scaling factor of each slot */
+    DoubleVector subtree_scale_factor;
+
+    /** number of slots allocated in subtree_lh_cache */
+    int subtree_lh_slots;
+
+    /** TRUE if the saved vectors are stored in single precision (--float-lh) */
+    bool subtree_lh_float;
+
+    /** saved branch lengths keyed by split hash, normalised over the two sides of the split */
+    unordered_map<uint64_t, double> split_length_cache;
+
     int getDelete() const;
     void setDelete(int _delete);
 
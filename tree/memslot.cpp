@@ -25,6 +25,10 @@
 const int MEM_LOCKED = 1;
 const int MEM_SPECIAL = 2;
 
+MemSlotVector::MemSlotVector() : free_count(0), inflation(0),
+    num_hits(0), num_misses(0), num_recomputes(0), num_evictions(0) {
+}
+
 void MemSlotVector::init(PhyloTree *tree, int num_slot) {
     if (Params::getInstance().lh_mem_save != LM_MEM_SAVE)
         return;
@@ -32,10 +36,13 @@ void MemSlotVector::init(PhyloTree *tree, int num_slot) {
     resize(num_slot);
     size_t lh_size = tree->getPartialLhSize();
     size_t scale_size = tree->getScaleNumSize();
+    // shifted back to the first pattern, only the pattern slice of this MPI process is allocated
+    size_t lh_offset = tree->getPartialLhOffset();
+    size_t scale_offset = tree->getScaleNumOffset();
     reset();
     for (iterator it = begin(); it != end(); it++) {
-        it->partial_lh = tree->central_partial_lh + lh_size*(it-begin());
-        it->scale_num = tree->central_scale_num + scale_size*(it-begin());
+        it->partial_lh = tree->central_partial_lh + lh_size*(it-begin()) - lh_offset;
+        it->scale_num = tree->central_scale_num + scale_size*(it-begin()) - scale_offset;
     }
 }
 
@@ -45,17 +52,16 @@ void MemSlotVector::reset() {
     for (iterator it = begin(); it != end(); it++) {
         it->status = 0;
         it->nei = NULL;
+        it->priority = 0;
     }
-    nei_id_map.clear();
     free_count = 0;
+    inflation = 0;
 }
 
 
 MemSlotVector::iterator MemSlotVector::findNei(PhyloNeighbor *nei) {
-    auto it = nei_id_map.find(nei);
-    ASSERT(it != nei_id_map.end());
-//    assert(at(it->second).nei == nei);
-    return begin()+it->second;
+    ASSERT(nei->mem_slot_id >= 0 && (size_t)nei->mem_slot_id < size());
+    return begin()+nei->mem_slot_id;
 }
 
 void MemSlotVector::addNei(PhyloNeighbor *nei, iterator it) {
@@ -63,7 +69,13 @@ void MemSlotVector::addNei(PhyloNeighbor *nei, iterator it) {
     nei->partial_lh = it->partial_lh;
     nei->scale_num = it->scale_num;
     it->nei = nei;
-    nei_id_map[nei] = it-begin();
+    nei->mem_slot_id = it-begin();
+    touch(it);
+}
+
+void MemSlotVector::touch(iterator it) {
+    // recomputing a partial_lh costs up to one partial_lh per taxon of the subtree
+    it->priority = inflation + max(it->nei->size, 1);
 }
 
 
@@ -75,15 +87,16 @@ void MemSlotVector::addSpecialNei(PhyloNeighbor *nei) {
     ms.nei = nei;
     ms.partial_lh = nei->partial_lh;
     ms.scale_num = nei->scale_num;
+    ms.priority = 0;
     push_back(ms);
-    nei_id_map[nei] = size()-1;
+    nei->mem_slot_id = size()-1;
 }
 
 void MemSlotVector::eraseSpecialNei() {
     if (Params::getInstance().lh_mem_save != LM_MEM_SAVE)
         return;
+    // the special neighbors are already deleted, do not touch them
     while (back().status & MEM_SPECIAL) {
-        nei_id_map.erase(back().nei);
         pop_back();
     }
 }
@@ -99,9 +112,19 @@ bool MemSlotVector::lock(PhyloNeighbor *nei) {
         return false;
     ASSERT((id->status & MEM_LOCKED) == 0);
     id->status |= MEM_LOCKED;
+    touch(id);
     return true;
 }
 
+bool MemSlotVector::reuse(PhyloNeighbor *nei) {
+    if (Params::getInstance().lh_mem_save != LM_MEM_SAVE)
+        return false;
+    if (nei->node->isLeaf())
+        return false;
+    num_hits++;
+    return lock(nei);
+}
+
 void MemSlotVector::unlock(PhyloNeighbor *nei) {
     if (Params::getInstance().lh_mem_save != LM_MEM_SAVE)
         return;
@@ -134,6 +157,11 @@ int MemSlotVector::allocate(PhyloNeighbor *nei) {
     if (Params::getInstance().lh_mem_save != LM_MEM_SAVE)
         return -1;
 
+    num_misses++;
+    // nei still points to the memory of a slot taken away from it
+    if (nei->partial_lh)
+        num_recomputes++;
+
     // first find a free slot
     if (free_count < size() && (at(free_count).status & MEM_SPECIAL) == 0) {
         iterator it = begin() + free_count;
@@ -143,23 +171,23 @@ int MemSlotVector::allocate(PhyloNeighbor *nei) {
         return it-begin();
     }
 
-    int min_size = INT_MAX;
+    int64_t min_priority = INT64_MAX;
     iterator best = end();
 
-
-    // no free slot found, find an unlocked slot with minimal size
+    // no free slot found, find the unlocked slot with the lowest priority
     for (iterator it = begin(); it != end(); it++)
-        if ((it->status & MEM_LOCKED) == 0 && (it->status & MEM_SPECIAL) == 0 && min_size > it->nei->size) {
+        if ((it->status & MEM_LOCKED) == 0 && (it->status & MEM_SPECIAL) == 0 && min_priority > it->priority) {
             best = it;
-            min_size = it->nei->size;
-            // 2 is the minimum size
-            if (min_size == 2)
-                break;
+            min_priority = it->priority;
         }
 
     if (best == end())
         return -1;
 
+    // slots used later than best are now cheaper to keep
+    inflation = min_priority;
+    num_evictions++;
+
     // clear mem assigned to it->nei
     best->nei->clearPartialLh();
 
@@ -174,14 +202,21 @@ void MemSlotVector::update(PhyloNeighbor *nei) {
         return;
 
     iterator it = findNei(nei);
+    num_misses++;
 //    if (it->status & MEM_SPECIAL)
 //        return;
     if (it->nei != nei) {
+        // the slot was taken away from nei
+        num_recomputes++;
+        num_evictions++;
+
         // clear mem assigned to it->nei
         it->nei->clearPartialLh();
 
         // assign mem to nei
         addNei(nei, it);
+    } else {
+        touch(it);
     }
 }
 
@@ -215,8 +250,8 @@ void MemSlotVector::takeover(PhyloNeighbor *nei, PhyloNeighbor *taken_nei) {
     iterator id = findNei(taken_nei);
 //    if (id->status & MEM_SPECIAL)
 //        return;
-    nei_id_map.erase(nei_id_map.find(taken_nei));
-    nei_id_map[nei] = id - begin();
+    taken_nei->mem_slot_id = -1;
+    nei->mem_slot_id = id - begin();
     if (id->nei == taken_nei) {
         id->nei = nei;
     }
@@ -232,8 +267,7 @@ void MemSlotVector::replace(PhyloNeighbor *new_nei, PhyloNeighbor *old_nei) {
     it->partial_lh = new_nei->partial_lh;
     it->scale_num = new_nei->scale_num;
     it->status = MEM_LOCKED + MEM_SPECIAL;
-    nei_id_map[new_nei] = it-begin();
-//    nei_id_map.erase(old_nei);
+    new_nei->mem_slot_id = it-begin();
     cout << "slot " << distance(begin(), it) << " replaced" << endl;
 }
 
@@ -242,13 +276,19 @@ void MemSlotVector::restore(PhyloNeighbor *new_nei, PhyloNeighbor *old_nei) {
         return;
     iterator it = findNei(new_nei);
     ASSERT(it->nei == new_nei);
-    ASSERT(nei_id_map[old_nei] == it-begin());
+    ASSERT(old_nei->mem_slot_id == it-begin());
     it->nei = it->saved_nei;
     it->saved_nei = NULL;
     it->partial_lh = old_nei->partial_lh;
     it->scale_num = old_nei->scale_num;
     it->status = 0;
-    nei_id_map.erase(new_nei);
-//    nei_id_map[old_nei] = it;
+    new_nei->mem_slot_id = -1;
     cout << "slot " << distance(begin(), it) << " restored" << endl;
 }
+
+void MemSlotVector::report(ostream &out) {
+    int64_t total = num_hits + num_misses;
+    out << "Partial likelihood memory slots: " << size() << ", reused: " << num_hits
+        << " (" << (total ? 100.0 * num_hits / total : 0.0) << "%), computed: " << num_misses
+        << ", recomputed after eviction: " << num_recomputes << ", evictions: " << num_evictions << endl;
+}
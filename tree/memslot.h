@@ -36,6 +36,9 @@ struct MemSlot {
     UBYTE *scale_num; // scale_num assigned to this slot
 
     PhyloNeighbor *saved_nei;
+
+    /** eviction priority, the unlocked slot with the lowest one is evicted first */
+    int64_t priority;
 };
 
 /**
@@ -44,6 +47,8 @@ struct MemSlot {
 class MemSlotVector : public vector<MemSlot> {
 public:
 
+    MemSlotVector();
+
     /** initialize with a specified number of slots */
     void init(PhyloTree *tree, int num_slot);
 
@@ -57,6 +62,13 @@ public:
     /** unlock the memory assigned to nei */
     void unlock(PhyloNeighbor *nei);
 
+    /**
+        lock the memory assigned to nei, whose partial_lh is reused without recomputing it
+        @param nei neighbor to lock
+        @return TRUE if successfully locked, FALSE otherwise
+    */
+    bool reuse(PhyloNeighbor *nei);
+
     /** test if the memory assigned to nei is locked or not */
     bool locked(PhyloNeighbor *nei);
 
@@ -93,18 +105,41 @@ public:
     /** restore neighbor, after calling replace */
     void restore(PhyloNeighbor *new_nei, PhyloNeighbor *old_nei);
 
-protected:
+    /** @return number of partial_lh reused from their slot */
+    int64_t getNumHits() { return num_hits; }
 
+    /** @return number of partial_lh that had to be computed */
+    int64_t getNumMisses() { return num_misses; }
 
-    /** 
-        map from neighbor to slot ID for fast lookup
-        IMPORTANT: mapping to ID instead of (unsafe) iterator
+    /** @return number of partial_lh computed again after their slot was evicted */
+    int64_t getNumRecomputes() { return num_recomputes; }
+
+    /** @return number of slots taken away from a neighbor */
+    int64_t getNumEvictions() { return num_evictions; }
+
+    /** print the counters above */
+    void report(ostream &out);
+
+protected:
+
+    /**
+        set the eviction priority of a slot when it is used, following the
+        GreedyDual-Size policy: recently used slots and slots of large subtrees,
+        whose partial_lh is expensive to recompute, are kept longer
     */
-    unordered_map<PhyloNeighbor*, int> nei_id_map;
+    void touch(iterator it);
 
     /** counter of free slot ID */
     int free_count;
 
+    /** priority of the last evicted slot, added to the priority of slots being used */
+    int64_t inflation;
+
+    int64_t num_hits;
+    int64_t num_misses;
+    int64_t num_recomputes;
+    int64_t num_evictions;
+
 };
 
 
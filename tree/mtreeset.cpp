@@ -116,31 +116,32 @@ void MTreeSet::init(StrVector &treels, bool &is_rooted) {
     if (!it->empty())
 	{
 		count++;
-		MTree *tree = newTree();
-		stringstream ss(*it);
-		bool myrooted = is_rooted;
-		tree->readTree(ss, myrooted);
-		NodeVector taxa;
-		tree->getTaxa(taxa);
-		for (NodeVector::iterator taxit = taxa.begin(); taxit != taxa.end(); taxit++) {
-			if ((*taxit)->name == ROOT_NAME) {
-				(*taxit)->id = taxa.size() - 1;
-			}
-			else {
-				(*taxit)->id = atoi((*taxit)->name.c_str());
-			}
-		}
-		//at(it->second) = tree;
-		push_back(tree);
-		tree_weights.push_back(1);
-		//cout << "Tree " << it->second << ": ";
-		//tree->printTree(cout, WT_NEWLINE);
+		addTree(*it, is_rooted);
 	}
 	if (verbose_mode >= VB_MED)
 		cout << count << " tree(s) converted" << endl;
 	//tree_weights.resize(size(), 1);
 }
 
+void MTreeSet::addTree(const string &tree_str, bool &is_rooted, int weight) {
+	MTree *tree = newTree();
+	stringstream ss(tree_str);
+	bool myrooted = is_rooted;
+	tree->readTree(ss, myrooted);
+	NodeVector taxa;
+	tree->getTaxa(taxa);
+	for (NodeVector::iterator taxit = taxa.begin(); taxit != taxa.end(); taxit++) {
+		if ((*taxit)->name == ROOT_NAME) {
+			(*taxit)->id = taxa.size() - 1;
+		}
+		else {
+			(*taxit)->id = atoi((*taxit)->name.c_str());
+		}
+	}
+	push_back(tree);
+	tree_weights.push_back(weight);
+}
+
 void MTreeSet::init(vector<string> &trees, vector<string> &taxonNames, bool &is_rooted) {
 	int count = 0;
 	for (vector<string>::iterator it = trees.begin(); it != trees.end(); it++) {
@@ -169,66 +170,13 @@ void MTreeSet::readTrees(const char *infile, bool &is_rooted, int burnin, int ma
 	IntVector *weights, bool compressed) 
 {
 	cout << "Reading tree(s) file " << infile << " ..." << endl;
-	int count, omitted;
-/*	IntVector ok_trees;
-	if (trees_id) {
-		int max_id = *max_element(trees_id->begin(), trees_id->end());
-		ok_trees.resize(max_id+1, 0);
-		for (IntVector::iterator it = trees_id->begin(); it != trees_id->end(); it++)
-			ok_trees[*it] = 1;
-		cout << "Restricting to " << trees_id->size() << " trees" << endl;
-	}*/
 	try {
 		istream *in;
 		if (compressed) in = new igzstream; else in = new ifstream;
 		in->exceptions(ios::failbit | ios::badbit);
 		
 		if (compressed) ((igzstream*)in)->open(infile); else ((ifstream*)in)->open(infile);
-		if (burnin > 0) {
-			int cnt = 0;
-			while (cnt < burnin && !in->eof()) {
-				char ch;
-				(*in) >> ch;
-				if (ch == ';') cnt++;
-			}
-			cout << cnt << " beginning tree(s) discarded" << endl;
-			if (in->eof())
-				throw "Burnin value is too large.";
-		}
-		for (count = 1, omitted = 0; !in->eof() && count <= max_count; count++) {
-			if (!weights || weights->at(count-1)) {
-				//cout << "Reading tree " << count << " ..." << endl;
-				MTree *tree = newTree();
-				bool myrooted = is_rooted;
-				//tree->userFile = (char*) infile;
-				tree->readTree(*in, myrooted);
-				push_back(tree);
-				if (weights) 
-					tree_weights.push_back(weights->at(count-1)); 
-				else tree_weights.push_back(1);
-				//cout << "Tree contains " << tree->leafNum - tree->rooted << 
-				//" taxa and " << tree->nodeNum-1-tree->rooted << " branches" << endl;
-			} else {
-				// omit the tree
-				//push_back(NULL);
-				//in->exceptions(ios::badbit);
-				while (!in->eof()) {
-					char ch;
-					if (!((*in) >> ch)) break;
-					if (ch == ';') break;
-				}
-				omitted++;
-			} 
-			char ch;
-			in->exceptions(ios::goodbit);
-			(*in) >> ch;
-			if (in->eof()) break;
-			in->unget();
-			in->exceptions(ios::failbit | ios::badbit);
-
-		}
-		cout << size() << " tree(s) loaded (" << countRooted() << " rooted and " << countUnrooted() << " unrooted)" << endl;
-		if (omitted) cout << omitted << " tree(s) omitted" << endl;
+		readTrees(*in, is_rooted, burnin, max_count, weights);
 		//in->exceptions(ios::failbit | ios::badbit);
 		if (compressed) ((igzstream*)in)->close(); else ((ifstream*)in)->close();
 		// following line was missing which caused small memory leak
@@ -240,6 +188,66 @@ void MTreeSet::readTrees(const char *infile, bool &is_rooted, int burnin, int ma
 	}
 }
 
+void MTreeSet::readTrees(istream &in, bool &is_rooted, int burnin, int max_count,
+	IntVector *weights)
+{
+	int count, omitted;
+/*	IntVector ok_trees;
+	if (trees_id) {
+		int max_id = *max_element(trees_id->begin(), trees_id->end());
+		ok_trees.resize(max_id+1, 0);
+		for (IntVector::iterator it = trees_id->begin(); it != trees_id->end(); it++)
+			ok_trees[*it] = 1;
+		cout << "Restricting to " << trees_id->size() << " trees" << endl;
+	}*/
+	in.exceptions(ios::failbit | ios::badbit);
+	if (burnin > 0) {
+		int cnt = 0;
+		while (cnt < burnin && !in.eof()) {
+			char ch;
+			in >> ch;
+			if (ch == ';') cnt++;
+		}
+		cout << cnt << " beginning tree(s) discarded" << endl;
+		if (in.eof())
+			throw "Burnin value is too large.";
+	}
+	for (count = 1, omitted = 0; !in.eof() && count <= max_count; count++) {
+		if (!weights || weights->at(count-1)) {
+			//cout << "Reading tree " << count << " ..." << endl;
+			MTree *tree = newTree();
+			bool myrooted = is_rooted;
+			//tree->userFile = (char*) infile;
+			tree->readTree(in, myrooted);
+			push_back(tree);
+			if (weights) 
+				tree_weights.push_back(weights->at(count-1)); 
+			else tree_weights.push_back(1);
+			//cout << "Tree contains " << tree->leafNum - tree->rooted << 
+			//" taxa and " << tree->nodeNum-1-tree->rooted << " branches" << endl;
+		} else {
+			// omit the tree
+			//push_back(NULL);
+			//in.exceptions(ios::badbit);
+			while (!in.eof()) {
+				char ch;
+				if (!(in >> ch)) break;
+				if (ch == ';') break;
+			}
+			omitted++;
+		} 
+		char ch;
+		in.exceptions(ios::goodbit);
+		in >> ch;
+		if (in.eof()) break;
+		in.unget();
+		in.exceptions(ios::failbit | ios::badbit);
+
+	}
+	cout << size() << " tree(s) loaded (" << countRooted() << " rooted and " << countUnrooted() << " unrooted)" << endl;
+	if (omitted) cout << omitted << " tree(s) omitted" << endl;
+}
+
 void MTreeSet::checkConsistency() {
     equal_taxon_set = true;
 	if (empty()) 
@@ -560,47 +568,56 @@ void MTreeSet::computeRFDist(double *rfdist, int mode, double weight_threshold)
 	front()->getTaxaName(taxname);
 
 
-	// converting trees into split system then stored in SplitIntMap for efficiency
-	for (iterator it = begin(); it != end(); it++) {
+	// converting trees into split system then stored in SplitIntMap for efficiency;
+	// each tree is converted exactly once, independently of the others
+	int ntrees = size();
+	hs_vec.resize(ntrees);
+	sg_vec.resize(ntrees);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+	for (int id = 0; id < ntrees; id++) {
 		SplitGraph *sg = new SplitGraph();
 		SplitIntMap *hs = new SplitIntMap();
 
-		(*it)->convertSplits(taxname, *sg);
+		at(id)->convertSplits(taxname, *sg);
 		// make sure that taxon 0 is included
 		for (SplitGraph::iterator sit = sg->begin(); sit != sg->end(); sit++) {
 			if (!(*sit)->containTaxon(0)) (*sit)->invert();
 			hs->insertSplit((*sit), 1);
 		}
-		hs_vec.push_back(hs);
-		sg_vec.push_back(sg);
+		hs_vec[id] = hs;
+		sg_vec[id] = sg;
 	}
 
-	// now start the RF computation
-	int id = 0;
-	for (vector<SplitIntMap*>::iterator hsit = hs_vec.begin(); hsit+1 != hs_vec.end(); hsit++, id++) {
-		vector<SplitIntMap*>::iterator end_it = hs_vec.end();
-		if (mode == RF_ADJACENT_PAIR) end_it = hsit+2;
-		int id2 = id+1;
-		for (vector<SplitIntMap*>::iterator hsit2 = hsit+1; hsit2 != end_it; hsit2++, id2++) {
+	// now start the RF computation; split maps are only read from here on,
+	// and every pair writes its own entries, so rows can go to different threads
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+	for (int id = 0; id < ntrees-1; id++) {
+		int end_id = (mode == RF_ADJACENT_PAIR) ? id+2 : ntrees;
+		for (int id2 = id+1; id2 < end_id; id2++) {
+			SplitIntMap *hs = hs_vec[id], *hs2 = hs_vec[id2];
 			int diff_splits = 0;
 			SplitIntMap::iterator spit;
-			for (spit = (*hsit2)->begin(); spit != (*hsit2)->end(); spit++) {
-				if (spit->first->getWeight() >= weight_threshold && !(*hsit)->findSplit(spit->first)) diff_splits++;
+			for (spit = hs2->begin(); spit != hs2->end(); spit++) {
+				if (spit->first->getWeight() >= weight_threshold && !hs->findSplit(spit->first)) diff_splits++;
 			}
-			for (spit = (*hsit)->begin(); spit != (*hsit)->end(); spit++) {
-				if (spit->first->getWeight() >= weight_threshold && !(*hsit2)->findSplit(spit->first)) diff_splits++;
+			for (spit = hs->begin(); spit != hs->end(); spit++) {
+				if (spit->first->getWeight() >= weight_threshold && !hs2->findSplit(spit->first)) diff_splits++;
 			}
-			//int rf_val = (*hsit)->size() + (*hsit2)->size() - 2*common_splits;
+			//int rf_val = hs->size() + hs2->size() - 2*common_splits;
 			int rf_val = diff_splits;
 			if (mode == RF_ADJACENT_PAIR) 
 				rfdist[id] = rf_val;
 			else {
-				rfdist[id*size() + id2] = rfdist[id2*size() + id] = rf_val;
+				rfdist[(size_t)id*ntrees + id2] = rfdist[(size_t)id2*ntrees + id] = rf_val;
 			}
 		}
 	}
 	// delete memory 
-	for (id = size()-1; id >= 0; id--) {
+	for (int id = ntrees-1; id >= 0; id--) {
 		delete hs_vec[id];
 		delete sg_vec[id];
 	}
@@ -632,61 +649,53 @@ void MTreeSet::computeRFDist(double *rfdist, MTreeSet *treeset2, bool k_by_k,
 	front()->getTaxaName(taxname);
 
 
-	iterator it;
-	// converting trees into split system then stored in SplitIntMap for efficiency
-	for (iterator it = begin(); it != end(); it++) {
-		SplitGraph *sg = new SplitGraph();
-		SplitIntMap *hs = new SplitIntMap();
-		NodeVector nodes;
-
-		(*it)->convertSplits(taxname, *sg, &nodes);
-		// make sure that taxon 0 is included
-		int i = 0;
-		for (SplitGraph::iterator sit = sg->begin(); sit != sg->end(); sit++, i++) {
-			if (!(*sit)->containTaxon(0)) (*sit)->invert();
-			hs->insertSplit((*sit), i);
-		}
-		hs_vec.push_back(hs);
-		sg_vec.push_back(sg);
-		nodes_vec.push_back(nodes);
-	}
-
-	// converting trees into split system then stored in SplitIntMap for efficiency
-	for (it = treeset2->begin(); it != treeset2->end(); it++) {
+	// converting trees of both sets into split system then stored in SplitIntMap for efficiency;
+	// each tree is converted exactly once, independently of the others
+	int ntrees = size();
+	int col_size = treeset2->size();
+	hs_vec.resize(ntrees + col_size);
+	sg_vec.resize(ntrees + col_size);
+	nodes_vec.resize(ntrees + col_size);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+	for (int id = 0; id < ntrees + col_size; id++) {
 		SplitGraph *sg = new SplitGraph();
 		SplitIntMap *hs = new SplitIntMap();
-		NodeVector nodes;
+		MTree *tree = (id < ntrees) ? at(id) : treeset2->at(id - ntrees);
 
-		(*it)->convertSplits(taxname, *sg, &nodes);
+		tree->convertSplits(taxname, *sg, &nodes_vec[id]);
 		// make sure that taxon 0 is included
 		int i = 0;
 		for (SplitGraph::iterator sit = sg->begin(); sit != sg->end(); sit++, i++) {
 			if (!(*sit)->containTaxon(0)) (*sit)->invert();
 			hs->insertSplit((*sit), i);
 		}
-		hs_vec.push_back(hs);
-		sg_vec.push_back(sg);
-		nodes_vec.push_back(nodes);
+		hs_vec[id] = hs;
+		sg_vec[id] = sg;
 	}
 
-	// now start the RF computation
-	int id = 0;
-	int col_size = hs_vec.size() - size();
-	for (vector<SplitGraph*>::iterator hsit = sg_vec.begin(); id < size(); hsit++, id++) {
-		int id2 = 0;
-        vector<SplitIntMap*>::iterator start_it = (hs_vec.begin() + size());
-        vector<SplitIntMap*>::iterator end_it = (hs_vec.end());
+	// now start the RF computation; rows are independent unless the detailed
+	// split occurrences are printed to shared output files
+	bool normalize_tree_dist = Params::getInstance().normalize_tree_dist;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) if(!info_file && !tree_file)
+#endif
+	for (int id = 0; id < ntrees; id++) {
+		SplitGraph *sg = sg_vec[id];
+		int start_id2 = 0, end_id2 = col_size;
         if (k_by_k) {
             // only distance between k-th tree
-            start_it = start_it + id;
-            end_it = start_it + 1;
+            start_id2 = id;
+            end_id2 = id + 1;
         }
 
-		for (vector<SplitIntMap*>::iterator hsit2 = start_it; hsit2 != end_it; hsit2++, id2++) {
+		for (int id2 = start_id2; id2 < end_id2; id2++) {
+			SplitIntMap *hs2 = hs_vec[ntrees + id2];
 			int common_splits = 0;
 			int i = 0;
-			for (SplitGraph::iterator spit = (*hsit)->begin(); spit != (*hsit)->end(); spit++, i++) {
-				if ((*hsit2)->findSplit(*spit)) {
+			for (SplitGraph::iterator spit = sg->begin(); spit != sg->end(); spit++, i++) {
+				if (hs2->findSplit(*spit)) {
 					common_splits++;
 					if (info_file && (*spit)->trivial()<0) oinfo << " " << nodes_vec[id][i]->name;
 				} else {
@@ -696,37 +705,37 @@ void MTreeSet::computeRFDist(double *rfdist, MTreeSet *treeset2, bool k_by_k,
 						nodes_vec[id][i]->name = "-" + nodes_vec[id][i]->name;*/
 				} 
 			}
-			double rf_val = (*hsit)->size() + (*hsit2)->size() - 2*common_splits;
-            if (Params::getInstance().normalize_tree_dist) {
-                int non_trivial = (*hsit)->size() - (*hsit)->getNTrivialSplits();
-                non_trivial += (*hsit2)->size() - ((*hsit2)->begin())->first->getNTaxa();
+			double rf_val = sg->size() + hs2->size() - 2*common_splits;
+            if (normalize_tree_dist) {
+                int non_trivial = sg->size() - sg->getNTrivialSplits();
+                non_trivial += hs2->size() - (hs2->begin())->first->getNTaxa();
                 rf_val /= non_trivial;
             }
             if (k_by_k)
                 rfdist[id] = rf_val;
             else
-                rfdist[id*col_size + id2] = rf_val;
+                rfdist[(size_t)id*col_size + id2] = rf_val;
 			if (info_file) oinfo << endl;
 			if (tree_file) { at(id)->printTree(otree); otree << endl; }
 			for (i = 0; i < nodes_vec[id].size(); i++)
 				if (nodes_vec[id][i]->name[0] == '-') nodes_vec[id][i]->name.erase(0,1);
 		}
 		if (!incomp_splits || k_by_k) continue;
-		id2 = 0;
 		// count incompatible splits
-		for (vector<SplitGraph*>::iterator hsit3 = sg_vec.begin()+size(); hsit3 != sg_vec.end(); hsit3++, id2++) {
+		for (int id2 = 0; id2 < col_size; id2++) {
+			SplitGraph *sg3 = sg_vec[ntrees + id2];
 			int num_incomp = 0;
 			SplitGraph::iterator spit;
-			for (spit = (*hsit)->begin(); spit != (*hsit)->end(); spit++) 
-				if (!(*hsit3)->compatible(*spit)) num_incomp++;
-			for (spit = (*hsit3)->begin(); spit != (*hsit3)->end(); spit++) 
-				if (!(*hsit)->compatible(*spit)) num_incomp++;
+			for (spit = sg->begin(); spit != sg->end(); spit++) 
+				if (!sg3->compatible(*spit)) num_incomp++;
+			for (spit = sg3->begin(); spit != sg3->end(); spit++) 
+				if (!sg->compatible(*spit)) num_incomp++;
 					
-			incomp_splits[id*col_size + id2] = num_incomp;
+			incomp_splits[(size_t)id*col_size + id2] = num_incomp;
 		}
 	}
 	// delete memory 
-	for (id = hs_vec.size()-1; id >= 0; id--) {
+	for (int id = hs_vec.size()-1; id >= 0; id--) {
 		delete hs_vec[id];
 		delete sg_vec[id];
 	}
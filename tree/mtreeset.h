@@ -60,6 +60,14 @@ public:
 
 	void init(StrVector &treels, bool &is_rooted);
 
+	/**
+		add a tree read from a NEWICK string whose taxon names are taxon IDs
+		@param tree_str NEWICK tree string
+		@param is_rooted (IN/OUT) true if tree is rooted
+		@param weight weight of the tree
+	*/
+	void addTree(const string &tree_str, bool &is_rooted, int weight = 1);
+
 	/**
 	 *  Add trees from \a trees to the tree set
 	 *
@@ -80,6 +88,17 @@ public:
 	void readTrees(const char *userTreeFile, bool &is_rooted, int burnin, int max_count,
 		IntVector *weights = NULL, bool compressed = false);
 
+	/**
+		read the trees from an input stream in newick format
+		@param in the input stream, e.g. a stringstream of NEWICK strings
+		@param is_rooted (IN/OUT) true if tree is rooted
+		@param burnin the number of beginning trees to be discarded
+		@param max_count max number of trees to load
+		@throw ios::failure or const char* on a read or parse error
+	*/
+	void readTrees(istream &in, bool &is_rooted, int burnin, int max_count,
+		IntVector *weights = NULL);
+
 	/**
 		assign the leaf IDs with their names for all trees
 
@@ -69,6 +69,23 @@ Numeric PhyloTree::dotProductSIMD(Numeric *x, Numeric *y, int size) {
     return horizontal_add(res);
 }
 
+template <class Numeric, class VectorClass>
+Numeric PhyloTree::dotProductCountSIMD(Numeric *x, uint8_t *y, int size) {
+    // widen the 8-bit counts block by block into an aligned buffer that stays in L1
+    const int BLOCK = 256;
+    alignas(64) Numeric buf[BLOCK];
+    VectorClass res(0.0);
+    for (int i = 0; i < size; i += BLOCK) {
+        int len = min(BLOCK, size - i);
+        len = ((len + VectorClass::size() - 1) / VectorClass::size()) * VectorClass::size();
+        for (int j = 0; j < len; j++)
+            buf[j] = y[i+j];
+        for (int j = 0; j < len; j += VectorClass::size())
+            res = mul_add(VectorClass().load_a(&x[i+j]), VectorClass().load_a(&buf[j]), res);
+    }
+    return horizontal_add(res);
+}
+
 /************************************************************************************************
  *
  *   Highly optimized vectorized versions of likelihood functions
@@ -1484,6 +1501,10 @@ void PhyloTree::computePartialParsimonyFastSIMD(PhyloNeighbor *dad_branch, Phylo
         memset(dad_branch->partial_pars, 255, pars_size*sizeof(UINT));
         size_t nsites = (aln->num_parsimony_sites+NUM_BITS-1)/NUM_BITS;
         dad_branch->partial_pars[nstates*VCSIZE*nsites] = 0;
+    } else if (node->isLeaf() && dad && shared_tip_pars) {
+        // external node with bit vectors built once by newTipParsimony()
+        size_t pars_size = getBitsBlockSize();
+        memcpy(dad_branch->partial_pars, shared_tip_pars + node->id*pars_size, pars_size*sizeof(UINT));
     } else if (node->isLeaf() && dad) {
         // external node
         vector<Alignment*> *partitions = NULL;
@@ -1815,6 +1836,37 @@ int PhyloTree::computeParsimonyBranchFastSIMD(PhyloNeighbor *dad_branch, PhyloNo
     return score;
 }
 
+template<class VectorClass>
+int PhyloTree::computeParsimonyInsertionFastSIMD(UINT *node_pars, UINT *dad_pars, UINT *subtree_pars) {
+    int nstates = aln->getMaxNumStates();
+    const int NUM_BITS = VectorClass::size() * UINT_BITS;
+    int nsites = (aln->num_parsimony_sites + NUM_BITS - 1)/NUM_BITS;
+    int entry_size = nstates * VectorClass::size();
+
+    int scoreid = nsites*entry_size;
+    UINT score = node_pars[scoreid] + dad_pars[scoreid] + subtree_pars[scoreid];
+
+    for (int site = 0; site < nsites; site++) {
+        size_t offset = entry_size*site;
+        VectorClass *x = (VectorClass*)(node_pars + offset);
+        VectorClass *y = (VectorClass*)(dad_pars + offset);
+        VectorClass *t = (VectorClass*)(subtree_pars + offset);
+        int i;
+        // substitutions between the two sides of the branch
+        VectorClass w = x[0] & y[0];
+        for (i = 1; i < nstates; i++)
+            w |= x[i] & y[i];
+        w = ~w;
+        // substitutions between the new internal node and the inserted subtree
+        VectorClass v = 0;
+        for (i = 0; i < nstates; i++)
+            v |= ((x[i] & y[i]) | (w & (x[i] | y[i]))) & t[i];
+        v = ~v;
+        score += fast_popcount(w) + fast_popcount(v);
+    }
+    return score;
+}
+
 /****************************************************************************
  Sankoff parsimony function
  ****************************************************************************/
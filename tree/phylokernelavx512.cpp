@@ -21,17 +21,32 @@
 #define KERNEL_FIX_STATES
 #include "phylokernelnew.h"
 #include "phylokernelnonrev.h"
+#include "phylokernelfloat.h"
 
 
 #if !defined ( __AVX512F__ ) && !defined ( __AVX512__ )
 #error "You must compile this file with AVX512 enabled!"
 #endif
 
+void PhyloTree::setParsimonyKernelAVX512() {
+    if (cost_matrix) {
+        // Sankoff kernel
+        computeParsimonyBranchPointer = &PhyloTree::computeParsimonyBranchSankoffSIMD<Vec16ui>;
+        computePartialParsimonyPointer = &PhyloTree::computePartialParsimonySankoffSIMD<Vec16ui>;
+        computeParsimonyInsertionPointer = NULL;
+        return;
+    }
+    // Fitch kernel: bit vectors stay 256-bit wide
+    setParsimonyKernelAVX();
+}
+
 void PhyloTree::setDotProductAVX512() {
 #ifdef BOOT_VAL_FLOAT
 		dotProduct = &PhyloTree::dotProductSIMD<float, Vec16f>;
+		dotProductCount = &PhyloTree::dotProductCountSIMD<float, Vec16f>;
 #else
 		dotProduct = &PhyloTree::dotProductSIMD<double, Vec8d>;
+		dotProductCount = &PhyloTree::dotProductCountSIMD<double, Vec8d>;
 #endif
         dotProductDouble = &PhyloTree::dotProductSIMD<double, Vec8d>;
 }
@@ -39,7 +54,7 @@ void PhyloTree::setDotProductAVX512() {
 void PhyloTree::setLikelihoodKernelAVX512() {
     vector_size = 8;
     bool site_model = model_factory && model_factory->model->isSiteSpecificModel();
-//    setParsimonyKernelAVX();
+    setParsimonyKernelAVX512();
     computeLikelihoodDervMixlenPointer = NULL;
 
     if (site_model && safe_numeric) {
@@ -90,18 +105,43 @@ void PhyloTree::setLikelihoodKernelAVX512() {
 
     if ((model_factory && !model_factory->model->isReversible()) || params->kernel_nonrev) {
         // if nonreversible model
+        if (safe_numeric)
         switch (aln->num_states) {
         case 4:
-            computeLikelihoodBranchPointer  = &PhyloTree::computeNonrevLikelihoodBranchSIMD <Vec8d, 4, true>;
-            computeLikelihoodDervPointer    = &PhyloTree::computeNonrevLikelihoodDervSIMD   <Vec8d, 4, true>;
-            computePartialLikelihoodPointer = &PhyloTree::computeNonrevPartialLikelihoodSIMD<Vec8d, 4, true>;
+            computeLikelihoodBranchPointer  = &PhyloTree::computeNonrevLikelihoodBranchSIMD <Vec8d, SAFE_LH, 4, true>;
+            computeLikelihoodDervPointer    = &PhyloTree::computeNonrevLikelihoodDervSIMD   <Vec8d, SAFE_LH, 4, true>;
+            computePartialLikelihoodPointer = &PhyloTree::computeNonrevPartialLikelihoodSIMD<Vec8d, SAFE_LH, 4, true>;
+            break;
+        case 20:
+            computeLikelihoodBranchPointer  = &PhyloTree::computeNonrevLikelihoodBranchSIMD <Vec8d, SAFE_LH, 20, true>;
+            computeLikelihoodDervPointer    = &PhyloTree::computeNonrevLikelihoodDervSIMD   <Vec8d, SAFE_LH, 20, true>;
+            computePartialLikelihoodPointer = &PhyloTree::computeNonrevPartialLikelihoodSIMD<Vec8d, SAFE_LH, 20, true>;
             break;
         default:
-            computeLikelihoodBranchPointer  = &PhyloTree::computeNonrevLikelihoodBranchGenericSIMD <Vec8d>;
-            computeLikelihoodDervPointer    = &PhyloTree::computeNonrevLikelihoodDervGenericSIMD   <Vec8d>;
-            computePartialLikelihoodPointer = &PhyloTree::computeNonrevPartialLikelihoodGenericSIMD<Vec8d>;
+            computeLikelihoodBranchPointer  = &PhyloTree::computeNonrevLikelihoodBranchGenericSIMD <Vec8d, SAFE_LH, true>;
+            computeLikelihoodDervPointer    = &PhyloTree::computeNonrevLikelihoodDervGenericSIMD   <Vec8d, SAFE_LH, true>;
+            computePartialLikelihoodPointer = &PhyloTree::computeNonrevPartialLikelihoodGenericSIMD<Vec8d, SAFE_LH, true>;
             break;
+        } else {
+            switch (aln->num_states) {
+                case 4:
+                    computeLikelihoodBranchPointer  = &PhyloTree::computeNonrevLikelihoodBranchSIMD <Vec8d, NORM_LH, 4, true>;
+                    computeLikelihoodDervPointer    = &PhyloTree::computeNonrevLikelihoodDervSIMD   <Vec8d, NORM_LH, 4, true>;
+                    computePartialLikelihoodPointer = &PhyloTree::computeNonrevPartialLikelihoodSIMD<Vec8d, NORM_LH, 4, true>;
+                    break;
+                case 20:
+                    computeLikelihoodBranchPointer  = &PhyloTree::computeNonrevLikelihoodBranchSIMD <Vec8d, NORM_LH, 20, true>;
+                    computeLikelihoodDervPointer    = &PhyloTree::computeNonrevLikelihoodDervSIMD   <Vec8d, NORM_LH, 20, true>;
+                    computePartialLikelihoodPointer = &PhyloTree::computeNonrevPartialLikelihoodSIMD<Vec8d, NORM_LH, 20, true>;
+                    break;
+                default:
+                    computeLikelihoodBranchPointer  = &PhyloTree::computeNonrevLikelihoodBranchGenericSIMD <Vec8d, NORM_LH, true>;
+                    computeLikelihoodDervPointer    = &PhyloTree::computeNonrevLikelihoodDervGenericSIMD   <Vec8d, NORM_LH, true>;
+                    computePartialLikelihoodPointer = &PhyloTree::computeNonrevPartialLikelihoodGenericSIMD<Vec8d, NORM_LH, true>;
+                    break;
+            }
         }
+
         computeLikelihoodFromBufferPointer = NULL;
         return;        
     }
@@ -152,5 +192,22 @@ void PhyloTree::setLikelihoodKernelAVX512() {
         ASSERT(0);
 		break;
 	}
+
+    if (float_partial_lh) {
+        // partial likelihoods stored in single precision (--float-lh)
+        switch(aln->num_states) {
+        case 4:
+            computeLikelihoodBranchPointer  = &PhyloTree::computeLikelihoodBranchFloatSIMD <Vec8d, 4, true>;
+            computePartialLikelihoodPointer = &PhyloTree::computePartialLikelihoodFloatSIMD<Vec8d, 4, true>;
+            break;
+        case 20:
+            computeLikelihoodBranchPointer  = &PhyloTree::computeLikelihoodBranchFloatSIMD <Vec8d, 20, true>;
+            computePartialLikelihoodPointer = &PhyloTree::computePartialLikelihoodFloatSIMD<Vec8d, 20, true>;
+            break;
+        default:
+            ASSERT(0);
+            break;
+        }
+    }
 }
 
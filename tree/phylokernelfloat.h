@@ -0,0 +1,830 @@
+/*
+ * phylokernelfloat.h
+ * Likelihood kernels storing partial likelihood vectors in single precision (--float-lh)
+ *
+ * Vectors keep the layout of phylokernelnew.h, only each entry is a float. Children
+ * are converted to double vectors, all arithmetic is done in double precision and
+ * the result is rounded to float when it is stored. Scaling uses the thresholds
+ * SCALING_THRESHOLD_FLOAT, so that entries stay within the range of a float.
+ * Only the reversible kernel with normal scaling, no site-specific model and
+ * 4 or 20 states is supported, see PhyloTree::setLikelihoodKernel().
+ *
+ * Only the AVX-512 kernel uses it: with narrower vectors the conversions cost
+ * more than the halved memory traffic saves.
+ *
+ * This file must be included after phylokernelnew.h with KERNEL_FIX_STATES.
+ */
+
+#ifndef PHYLOKERNELFLOAT_H_
+#define PHYLOKERNELFLOAT_H_
+
+#include "phylotree.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace std;
+
+/*******************************************************
+ *
+ * Conversion between single precision storage and double vectors.
+ * Two double vectors are stored in one float vector.
+ *
+ ******************************************************/
+
+#if MAX_VECTOR_SIZE >= 512
+static inline void loadFloatPair(float *src, Vec8d &lo, Vec8d &hi) {
+    Vec16f vf = Vec16f().load_a(src);
+    lo = extend_low(vf);
+    hi = extend_high(vf);
+}
+
+static inline void storeFloatPair(float *dst, Vec8d const &lo, Vec8d const &hi) {
+    compress(lo, hi).store_a(dst);
+}
+#endif
+
+/**
+    convert N single precision vectors to double vectors, N must be even
+    @param src N*VectorClass::size() floats
+    @param[out] dst N double vectors
+*/
+template <class VectorClass>
+static inline void loadFloatVec(float *src, VectorClass *dst, size_t N) {
+    for (size_t i = 0; i < N; i+=2)
+        loadFloatPair(src + i*VectorClass::size(), dst[i], dst[i+1]);
+}
+
+/**
+    round N double vectors to single precision, N must be even
+    @param src N double vectors
+    @param[out] dst N*VectorClass::size() floats
+*/
+template <class VectorClass>
+static inline void storeFloatVec(VectorClass *src, float *dst, size_t N) {
+    for (size_t i = 0; i < N; i+=2)
+        storeFloatPair(dst + i*VectorClass::size(), src[i], src[i+1]);
+}
+
+/**
+    dotProduct of a double and a single precision vector:
+    X = A[0]*B[0] + ... + A[N-1]*B[N-1], N must be even
+    @param A double vector of size N
+    @param B single precision vector of size N
+    @param[out] X dot-product
+*/
+template <class VectorClass, const size_t N>
+static inline void dotProductFloatVec(VectorClass *A, float *B, VectorClass &X) {
+    VectorClass B0, B1, X1;
+    loadFloatPair(B, B0, B1);
+    X = A[0]*B0;
+    X1 = A[1]*B1;
+    for (size_t i = 2; i < N; i+=2) {
+        loadFloatPair(B + i*VectorClass::size(), B0, B1);
+        X = mul_add(A[i], B0, X);
+        X1 = mul_add(A[i+1], B1, X1);
+    }
+    X += X1;
+}
+
+/**
+    dotProduct of a scalar array and two single precision vectors:
+    X = A[0]*B[0]*C[0] + ... + A[N-1]*B[N-1]*C[N-1], N must be even
+    @param A array of size N
+    @param B single precision vector of size N
+    @param C single precision vector of size N
+    @param[out] X dot-product
+*/
+template <class VectorClass, const size_t N>
+static inline void dotProduct3FloatVec(double *A, float *B, float *C, VectorClass &X) {
+    VectorClass B0, B1, C0, C1, X1;
+    loadFloatPair(B, B0, B1);
+    loadFloatPair(C, C0, C1);
+    X = (A[0]*B0)*C0;
+    X1 = (A[1]*B1)*C1;
+    for (size_t i = 2; i < N; i+=2) {
+        loadFloatPair(B + i*VectorClass::size(), B0, B1);
+        loadFloatPair(C + i*VectorClass::size(), C0, C1);
+        X = mul_add(A[i]*B0, C0, X);
+        X1 = mul_add(A[i+1]*B1, C1, X1);
+    }
+    X += X1;
+}
+
+/**
+    scale partial likelihoods of the non-constant patterns whose maximum is below SCALING_THRESHOLD_FLOAT.
+    A pattern is scaled as many times as needed to bring its maximum back into the range of a float.
+    @param lh_max maximum absolute partial likelihood per pattern
+    @param invar ptn_invar of the patterns
+    @param partial_lh block double vectors of the patterns
+    @param scale_num scaling counters of the patterns
+    @param block number of vectors per pattern
+    @return false if a scaling counter overflows
+*/
+template <class VectorClass>
+static inline bool scaleFloatLikelihood(VectorClass &lh_max, double *invar, VectorClass *partial_lh, UBYTE *scale_num,
+    size_t block)
+{
+    auto underflown = (lh_max < SCALING_THRESHOLD_FLOAT) & (VectorClass().load_a(invar) == 0.0);
+    if (!horizontal_or(underflown))
+        return true;
+    bool ok = true;
+    // power of two per pattern, multiplying by it is as exact as ldexp
+    VectorClass factor(1.0);
+    double *factor_ptr = (double*)&factor;
+    for (size_t x = 0; x < VectorClass::size(); x++) {
+        if (!underflown[x])
+            continue;
+        double max_x = lh_max.extract(x);
+        int steps = 0;
+        while (max_x < SCALING_THRESHOLD_FLOAT && max_x > 0.0) {
+            max_x = ldexp(max_x, SCALING_THRESHOLD_EXP_FLOAT);
+            steps++;
+        }
+        if (scale_num[x] + steps > 255) {
+            ok = false;
+            steps = 255 - scale_num[x];
+        }
+        scale_num[x] += steps;
+        // 2^(steps*64) overflows a double beyond 15 steps, only for patterns close to zero
+        for (; steps > 15; steps -= 15) {
+            double *lh = (double*)partial_lh + x;
+            for (size_t i = 0; i < block; i++)
+                lh[i*VectorClass::size()] = ldexp(lh[i*VectorClass::size()], 15*SCALING_THRESHOLD_EXP_FLOAT);
+        }
+        factor_ptr[x] = ldexp(1.0, steps*SCALING_THRESHOLD_EXP_FLOAT);
+    }
+    for (size_t i = 0; i < block; i++)
+        partial_lh[i] *= factor;
+    return ok;
+}
+
+/*******************************************************
+ *
+ * partial likelihood with single precision storage
+ *
+ ******************************************************/
+
+template <class VectorClass, const int nstates, const bool FMA>
+void PhyloTree::computePartialLikelihoodFloatSIMD(TraversalInfo &info, size_t ptn_lower, size_t ptn_upper, int packet_id)
+{
+    PhyloNeighbor *dad_branch = info.dad_branch;
+    PhyloNode *dad = info.dad;
+	ASSERT(dad);
+    PhyloNode *node = (PhyloNode*)(dad_branch->node);
+
+	if (node->isLeaf()) {
+		return;
+	}
+
+    size_t orig_nptn = aln->size();
+    size_t max_orig_nptn = roundUpToMultiple(orig_nptn, VectorClass::size());
+    size_t nptn = max_orig_nptn+model_factory->unobserved_ptns.size();
+    size_t ncat = site_rate->getNRate();
+    size_t ncat_mix = (model_factory->fused_mix_rate) ? ncat : ncat*model->getNMixtures();
+    size_t mix_addr[ncat_mix];
+    size_t denom = (model_factory->fused_mix_rate) ? 1 : ncat;
+    for (size_t c = 0; c < ncat_mix; c++) {
+        mix_addr[c] = (c/denom)*nstates*nstates;
+    }
+    size_t block = nstates * ncat_mix;
+    double *inv_evec = model->getInverseEigenvectors();
+    ASSERT(inv_evec);
+    size_t num_leaves = 0;
+    bool stable = true;
+
+	// internal node
+	PhyloNeighbor *left = NULL, *right = NULL; // left & right are two neighbors leading to 2 subtrees
+	FOR_NEIGHBOR_IT(node, dad, it) {
+        PhyloNeighbor *nei = (PhyloNeighbor*)(*it);
+        // make sure that the partial_lh of children are different!
+        ASSERT(dad_branch->partial_lh != nei->partial_lh);
+		if (!left) left = nei; else right = nei;
+        if (nei->node->isLeaf())
+            num_leaves++;
+	}
+
+    // per packet: left and right child and dad in double precision, and one category
+    size_t thread_buf_size = (3*block+nstates)*VectorClass::size();
+    double *buffer_partial_lh_ptr = buffer_partial_lh + (getBufferPartialLhSize() - thread_buf_size*num_packets);
+    VectorClass *vec_left = (VectorClass*)(buffer_partial_lh_ptr + thread_buf_size * packet_id);
+    VectorClass *vec_right = vec_left + block;
+    VectorClass *vec_dad = vec_right + block;
+    VectorClass *partial_lh_tmp = vec_dad + block;
+    double *echildren = NULL;
+    double *partial_lh_leaves = NULL;
+
+    if (Params::getInstance().buffer_mem_save) {
+        echildren = aligned_alloc<double>(get_safe_upper_limit(block*nstates*(node->degree()-1)));
+        if (num_leaves > 0)
+            partial_lh_leaves = aligned_alloc<double>(get_safe_upper_limit((aln->STATE_UNKNOWN+1)*block*num_leaves));
+        double *buffer_tmp = aligned_alloc<double>(nstates);
+        computePartialInfo<VectorClass, nstates>(info, (VectorClass*)buffer_tmp, echildren, partial_lh_leaves);
+        aligned_free(buffer_tmp);
+    } else {
+        echildren = info.echildren;
+        partial_lh_leaves = info.partial_lh_leaves;
+    }
+
+    double *eleft = echildren, *eright = echildren + block*nstates;
+
+	if (!left->node->isLeaf() && right->node->isLeaf()) {
+		PhyloNeighbor *tmp = left;
+		left = right;
+		right = tmp;
+        double *etmp = eleft;
+        eleft = eright;
+        eright = etmp;
+	}
+
+    auto unknown = aln->STATE_UNKNOWN;
+
+    if (node->degree() > 3) {
+        /*--------------------- multifurcating node ------------------*/
+
+        for (size_t ptn = ptn_lower; ptn < ptn_upper; ptn+=VectorClass::size()) {
+            for (size_t i = 0; i < block; i++) {
+                vec_dad[i] = 1.0;
+            }
+            UBYTE *scale_dad = dad_branch->scale_num + ptn;
+            memset(scale_dad, 0, sizeof(UBYTE)*VectorClass::size());
+
+            double *partial_lh_leaf = partial_lh_leaves;
+            double *echild = echildren;
+
+            FOR_NEIGHBOR_IT(node, dad, it) {
+                PhyloNeighbor *child = (PhyloNeighbor*)*it;
+                if (child->node->isLeaf()) {
+                    // external node
+                    auto stateRow = this->getConvertedSequenceByNumber(child->node->id);
+                    for (size_t i = 0; i < VectorClass::size(); i++) {
+                        int state;
+                        if (ptn+i < orig_nptn) {
+                            if (stateRow!=nullptr) {
+                                state = stateRow[ptn+i];
+                            } else {
+                                state = (aln->at(ptn+i))[child->node->id];
+                            }
+                        } else if (ptn+i < max_orig_nptn) {
+                            state = unknown;
+                        } else if (ptn+i < nptn) {
+                            state = model_factory->unobserved_ptns[ptn+i-max_orig_nptn][child->node->id];
+                        } else {
+                            state = unknown;
+                        }
+                        double *child_lh = partial_lh_leaf + block*state;
+                        double *this_vec_tip = (double*)vec_left + i;
+                        for (size_t c = 0; c < block; c++) {
+                            *this_vec_tip = child_lh[c];
+                            this_vec_tip += VectorClass::size();
+                        }
+                    }
+                    for (size_t c = 0; c < block; c++) {
+                        vec_dad[c] *= vec_left[c];
+                    }
+                    partial_lh_leaf += (aln->STATE_UNKNOWN+1)*block;
+                } else {
+                    // internal node
+                    loadFloatVec((float*)child->partial_lh + ptn*block, vec_left, block);
+                    for (size_t i = 0; i < VectorClass::size(); i++) {
+                        if (scale_dad[i] + child->scale_num[ptn+i] > 255)
+                            stable = false;
+                        scale_dad[i] += child->scale_num[ptn+i];
+                    }
+                    VectorClass *partial_lh = vec_dad;
+                    VectorClass *partial_lh_child = vec_left;
+                    double *echild_ptr = echild;
+                    for (size_t c = 0; c < ncat_mix; c++) {
+                        for (size_t x = 0; x < nstates; x++) {
+                            VectorClass vchild;
+                            dotProductVec<VectorClass, double, nstates, FMA>(echild_ptr, partial_lh_child, vchild);
+                            echild_ptr += nstates;
+                            partial_lh[x] *= vchild;
+                        }
+                        partial_lh += nstates;
+                        partial_lh_child += nstates;
+                    }
+                }
+                echild += block*nstates;
+
+                /***** now do likelihood rescaling ******/
+                VectorClass lh_max = 0.0;
+                for (size_t x = 0; x < block; x++)
+                    lh_max = max(lh_max,abs(vec_dad[x]));
+                if (!scaleFloatLikelihood(lh_max, &ptn_invar[ptn], vec_dad, scale_dad, block))
+                    stable = false;
+            } // FOR_NEIGHBOR
+
+            // compute dot-product with inv_eigenvector
+            for (size_t c = 0; c < ncat_mix; c++) {
+                productVecMat<VectorClass, double, nstates, FMA>(vec_dad + c*nstates, inv_evec + mix_addr[c], vec_right + c*nstates);
+            }
+            storeFloatVec(vec_right, (float*)dad_branch->partial_lh + ptn*block, block);
+        } // for ptn
+
+        // end multifurcating treatment
+    } else if (left->node->isLeaf() && right->node->isLeaf()) {
+
+        /*--------------------- TIP-TIP (cherry) case ------------------*/
+
+        double *partial_lh_left = partial_lh_leaves;
+        double *partial_lh_right = partial_lh_leaves + (aln->STATE_UNKNOWN+1)*block;
+
+		// scale number must be ZERO
+	    memset(dad_branch->scale_num + ptn_lower, 0, (ptn_upper-ptn_lower) * sizeof(UBYTE));
+
+        auto leftStateRow  = this->getConvertedSequenceByNumber(left->node->id);
+        auto rightStateRow = this->getConvertedSequenceByNumber(right->node->id);
+
+        for (size_t ptn = ptn_lower; ptn < ptn_upper; ptn+=VectorClass::size()) {
+            // load data for tip
+            for (size_t x = 0; x < VectorClass::size(); x++) {
+                int leftState;
+                int rightState;
+                if (ptn+x < orig_nptn) {
+                    if (leftStateRow!=nullptr) {
+                        leftState = leftStateRow[ptn+x];
+                    } else {
+                        leftState = (aln->at(ptn+x))[left->node->id];
+                    }
+                    if (rightStateRow!=nullptr) {
+                        rightState =  rightStateRow[ptn+x];
+                    } else {
+                        rightState = (aln->at(ptn+x))[right->node->id];
+                    }
+                } else if (ptn+x < max_orig_nptn) {
+                    leftState = unknown;
+                    rightState = unknown;
+                } else if (ptn+x < nptn) {
+                    leftState  = model_factory->unobserved_ptns[ptn+x-max_orig_nptn][left->node->id];
+                    rightState = model_factory->unobserved_ptns[ptn+x-max_orig_nptn][right->node->id];
+                } else {
+                    leftState  = unknown;
+                    rightState = unknown;
+                }
+                double* tip_left  = partial_lh_left  + block*leftState;
+                double* tip_right = partial_lh_right + block*rightState;
+                double* this_vec_left = (double*)vec_left+x;
+                double* this_vec_right = (double*)vec_right+x;
+                for (size_t i = 0; i < block; i++) {
+                    *this_vec_left = tip_left[i];
+                    *this_vec_right = tip_right[i];
+                    this_vec_left += VectorClass::size();
+                    this_vec_right += VectorClass::size();
+                }
+            }
+
+            VectorClass lh_max = 0.0;
+            VectorClass *vleft = vec_left;
+            VectorClass *vright = vec_right;
+            VectorClass *partial_lh = vec_dad;
+            for (size_t c = 0; c < ncat_mix; c++) {
+                // compute real partial likelihood vector
+                for (size_t x = 0; x < nstates; x++) {
+                    partial_lh_tmp[x] = vleft[x] * vright[x];
+                }
+                // compute dot-product with inv_eigenvector
+                productVecMat<VectorClass, double, nstates, FMA>(partial_lh_tmp, inv_evec + mix_addr[c], partial_lh, lh_max);
+                vleft += nstates;
+                vright += nstates;
+                partial_lh += nstates;
+            }
+            if (!scaleFloatLikelihood(lh_max, &ptn_invar[ptn], vec_dad, dad_branch->scale_num + ptn, block))
+                stable = false;
+            storeFloatVec(vec_dad, (float*)dad_branch->partial_lh + ptn*block, block);
+		} // FOR LOOP
+
+	} else if (left->node->isLeaf() && !right->node->isLeaf()) {
+
+        /*--------------------- TIP-INTERNAL NODE case ------------------*/
+
+		// only take scale_num from the right subtree
+		memcpy(dad_branch->scale_num + ptn_lower, right->scale_num + ptn_lower, (ptn_upper-ptn_lower) * sizeof(UBYTE));
+
+        double *partial_lh_left = partial_lh_leaves;
+        auto leftStateRow = this->getConvertedSequenceByNumber(left->node->id);
+
+        for (size_t ptn = ptn_lower; ptn < ptn_upper; ptn+=VectorClass::size()) {
+            // load data for tip
+            for (size_t x = 0; x < VectorClass::size(); x++) {
+                int state;
+                if (ptn+x < orig_nptn) {
+                    if (leftStateRow!=nullptr) {
+                        state =  leftStateRow[ptn+x];
+                    } else {
+                        state = (aln->at(ptn+x))[left->node->id];
+                    }
+                } else if (ptn+x < max_orig_nptn) {
+                    state = unknown;
+                } else if (ptn+x < nptn) {
+                    state = model_factory->unobserved_ptns[ptn+x-max_orig_nptn][left->node->id];
+                } else {
+                    state = unknown;
+                }
+                double *tip = partial_lh_left + block*state;
+                double *this_vec_left = (double*)vec_left+x;
+                for (size_t i = 0; i < block; i++) {
+                    *this_vec_left = tip[i];
+                    this_vec_left += VectorClass::size();
+                }
+            }
+            loadFloatVec((float*)right->partial_lh + ptn*block, vec_right, block);
+
+            VectorClass lh_max = 0.0;
+            VectorClass *vleft = vec_left;
+            VectorClass *partial_lh_right = vec_right;
+            VectorClass *partial_lh = vec_dad;
+            double *eright_ptr = eright;
+            for (size_t c = 0; c < ncat_mix; c++) {
+                // compute real partial likelihood vector
+                for (size_t x = 0; x < nstates; x++) {
+                    VectorClass vright;
+                    dotProductVec<VectorClass, double, nstates, FMA>(eright_ptr, partial_lh_right, vright);
+                    eright_ptr += nstates;
+                    partial_lh_tmp[x] = vleft[x] * vright;
+                }
+                // compute dot-product with inv_eigenvector
+                productVecMat<VectorClass, double, nstates, FMA>(partial_lh_tmp, inv_evec + mix_addr[c], partial_lh, lh_max);
+                vleft += nstates;
+                partial_lh_right += nstates;
+                partial_lh += nstates;
+            }
+            if (!scaleFloatLikelihood(lh_max, &ptn_invar[ptn], vec_dad, dad_branch->scale_num + ptn, block))
+                stable = false;
+            storeFloatVec(vec_dad, (float*)dad_branch->partial_lh + ptn*block, block);
+		} // big for loop over ptn
+
+	} else {
+
+        /*--------------------- INTERNAL-INTERNAL NODE case ------------------*/
+
+		for (size_t ptn = ptn_lower; ptn < ptn_upper; ptn+=VectorClass::size()) {
+            UBYTE *scale_dad   = dad_branch->scale_num + ptn;
+            UBYTE *scale_left  = left->scale_num + ptn;
+            UBYTE *scale_right = right->scale_num + ptn;
+            for (size_t i = 0; i < VectorClass::size(); i++) {
+                if (scale_left[i] + scale_right[i] > 255)
+                    stable = false;
+                scale_dad[i] = scale_left[i] + scale_right[i];
+            }
+            loadFloatVec((float*)left->partial_lh + ptn*block, vec_left, block);
+            loadFloatVec((float*)right->partial_lh + ptn*block, vec_right, block);
+
+            VectorClass lh_max = 0.0;
+            VectorClass *partial_lh_left = vec_left;
+            VectorClass *partial_lh_right = vec_right;
+            VectorClass *partial_lh = vec_dad;
+            double *eleft_ptr = eleft;
+            double *eright_ptr = eright;
+			for (size_t c = 0; c < ncat_mix; c++) {
+                // compute real partial likelihood vector
+                for (size_t x = 0; x < nstates; x++) {
+                    dotProductDualVec<VectorClass, double, nstates, FMA>(eleft_ptr, partial_lh_left, eright_ptr, partial_lh_right, partial_lh_tmp[x]);
+                    eleft_ptr += nstates;
+                    eright_ptr += nstates;
+                }
+                // compute dot-product with inv_eigenvector
+                productVecMat<VectorClass, double, nstates, FMA>(partial_lh_tmp, inv_evec + mix_addr[c], partial_lh, lh_max);
+                partial_lh_left += nstates;
+                partial_lh_right += nstates;
+                partial_lh += nstates;
+			}
+            if (!scaleFloatLikelihood(lh_max, &ptn_invar[ptn], vec_dad, scale_dad, block))
+                stable = false;
+            storeFloatVec(vec_dad, (float*)dad_branch->partial_lh + ptn*block, block);
+        } // big for loop over ptn
+    }
+
+    if (!stable)
+        float_lh_unstable = true;
+
+    if (Params::getInstance().buffer_mem_save) {
+        aligned_free(partial_lh_leaves);
+        aligned_free(echildren);
+    }
+}
+
+/*******************************************************
+ *
+ * theta_all for the derivatives from single precision vectors
+ *
+ ******************************************************/
+
+template <class VectorClass, const int nstates, const bool FMA>
+void PhyloTree::computeLikelihoodBufferFloatSIMD(PhyloNeighbor *dad_branch, PhyloNode *dad,
+                                                 size_t ptn_lower, size_t ptn_upper, int packet_id)
+{
+    PhyloNode *node = (PhyloNode*) dad_branch->node;
+    PhyloNeighbor *node_branch = (PhyloNeighbor*) node->findNeighbor(dad);
+
+    size_t orig_nptn = aln->size();
+    size_t max_orig_nptn = roundUpToMultiple(orig_nptn,VectorClass::size());
+    size_t nptn = max_orig_nptn+model_factory->unobserved_ptns.size();
+    size_t ncat = site_rate->getNRate();
+    size_t ncat_mix = (model_factory->fused_mix_rate) ? ncat : ncat*model->getNMixtures();
+    size_t block = ncat_mix * nstates;
+    size_t tip_block = nstates * model->getNMixtures();
+    size_t mix_addr_nstates[ncat_mix];
+    size_t denom = (model_factory->fused_mix_rate) ? 1 : ncat;
+    for (size_t c = 0; c < ncat_mix; c++) {
+        mix_addr_nstates[c] = (c/denom)*nstates;
+    }
+
+    // reserve 3*block for computeLikelihoodDerv
+    double *buffer_partial_lh_ptr = buffer_partial_lh + 3*get_safe_upper_limit(block);
+
+    // first compute partial_lh
+    for (auto it = traversal_info.begin(); it != traversal_info.end(); it++) {
+        computePartialLikelihood(*it, ptn_lower, ptn_upper, packet_id);
+    }
+
+    if (dad->isLeaf()) {
+        // special treatment for TIP-INTERNAL NODE case
+        double *vec_tip = buffer_partial_lh_ptr + tip_block * VectorClass::size() * packet_id;
+        auto stateRow = this->getConvertedSequenceByNumber(dad->id);
+        auto unknown  = aln->STATE_UNKNOWN;
+
+        for (size_t ptn = ptn_lower; ptn < ptn_upper; ptn+=VectorClass::size()) {
+            float *partial_lh_dad = (float*)dad_branch->partial_lh + ptn*block;
+            VectorClass *theta = (VectorClass*)(theta_all + ptn*block);
+            //load tip vector
+            for (size_t i = 0; i < VectorClass::size(); i++) {
+                int state;
+                if (ptn+i < orig_nptn) {
+                    if (stateRow!=nullptr) {
+                        state =  stateRow[ptn+i];
+                    } else {
+                        state = (aln->at(ptn+i))[dad->id];
+                    }
+                } else if (ptn+i < max_orig_nptn) {
+                    state = unknown;
+                } else if (ptn+i < nptn) {
+                    state = model_factory->unobserved_ptns[ptn+i-max_orig_nptn][dad->id];
+                } else {
+                    state = unknown;
+                }
+                double *this_tip_partial_lh = tip_partial_lh + tip_block*state;
+                double *this_vec_tip = vec_tip+i;
+                for (size_t c = 0; c < tip_block; c++) {
+                    *this_vec_tip = this_tip_partial_lh[c];
+                    this_vec_tip += VectorClass::size();
+                }
+            }
+            for (size_t c = 0; c < ncat_mix; c++) {
+                VectorClass *lh_tip = (VectorClass*)(vec_tip + mix_addr_nstates[c]*VectorClass::size());
+                for (size_t i = 0; i < nstates; i+=2) {
+                    VectorClass lh_dad0, lh_dad1;
+                    loadFloatPair(partial_lh_dad + i*VectorClass::size(), lh_dad0, lh_dad1);
+                    theta[i] = lh_tip[i] * lh_dad0;
+                    theta[i+1] = lh_tip[i+1] * lh_dad1;
+                }
+                partial_lh_dad += nstates*VectorClass::size();
+                theta += nstates;
+            }
+            for (size_t i = 0; i < VectorClass::size(); i++) {
+                buffer_scale_all[ptn+i] = dad_branch->scale_num[ptn+i];
+            }
+            VectorClass *buf = (VectorClass*)(buffer_scale_all+ptn);
+            *buf *= LOG_SCALING_THRESHOLD_FLOAT;
+        } // FOR PTN LOOP
+    } else {
+        //------- both dad and node are internal nodes  --------//
+        for (size_t ptn = ptn_lower; ptn < ptn_upper; ptn+=VectorClass::size()) {
+            VectorClass *theta = (VectorClass*)(theta_all + ptn*block);
+            float *partial_lh_node = (float*)node_branch->partial_lh + ptn*block;
+            float *partial_lh_dad = (float*)dad_branch->partial_lh + ptn*block;
+            for (size_t i = 0; i < block; i+=2) {
+                VectorClass lh_node0, lh_node1, lh_dad0, lh_dad1;
+                loadFloatPair(partial_lh_node + i*VectorClass::size(), lh_node0, lh_node1);
+                loadFloatPair(partial_lh_dad + i*VectorClass::size(), lh_dad0, lh_dad1);
+                theta[i] = lh_node0 * lh_dad0;
+                theta[i+1] = lh_node1 * lh_dad1;
+            }
+            for (size_t i = 0; i < VectorClass::size(); i++) {
+                buffer_scale_all[ptn+i] = dad_branch->scale_num[ptn+i] + node_branch->scale_num[ptn+i];
+            }
+            VectorClass *buf = (VectorClass*)(buffer_scale_all+ptn);
+            *buf *= LOG_SCALING_THRESHOLD_FLOAT;
+        } // FOR ptn
+    } // internal node
+}
+
+/*******************************************************
+ *
+ * log-likelihood on a branch from single precision vectors,
+ * accumulated in double precision
+ *
+ ******************************************************/
+
+template <class VectorClass, const int nstates, const bool FMA>
+double PhyloTree::computeLikelihoodBranchFloatSIMD(PhyloNeighbor *dad_branch, PhyloNode *dad)
+{
+    PhyloNode *node = (PhyloNode*) dad_branch->node;
+    PhyloNeighbor *node_branch = (PhyloNeighbor*) node->findNeighbor(dad);
+    if (!central_partial_lh)
+        initializeAllPartialLh();
+    if (node->isLeaf()) {
+    	PhyloNode *tmp_node = dad;
+    	dad = node;
+    	node = tmp_node;
+    	PhyloNeighbor *tmp_nei = dad_branch;
+    	dad_branch = node_branch;
+    	node_branch = tmp_nei;
+    }
+
+    computeTraversalInfo<VectorClass, nstates>(node, dad, false);
+
+    size_t ncat = site_rate->getNRate();
+    size_t ncat_mix = (model_factory->fused_mix_rate) ? ncat : ncat*model->getNMixtures();
+
+    size_t block = ncat_mix * nstates;
+    size_t tip_block = nstates * model->getNMixtures();
+    size_t orig_nptn = aln->size();
+    size_t max_orig_nptn = roundUpToMultiple(orig_nptn, VectorClass::size());
+    size_t nptn = max_orig_nptn+model_factory->unobserved_ptns.size();
+
+    size_t mix_addr_nstates[ncat_mix];
+    size_t denom = (model_factory->fused_mix_rate) ? 1 : ncat;
+
+    double *eval = model->getEigenvalues();
+    ASSERT(eval);
+
+    double *buffer_partial_lh_ptr = buffer_partial_lh;
+    double *val = buffer_partial_lh_ptr;
+    buffer_partial_lh_ptr += get_safe_upper_limit(block);
+    for (size_t c = 0; c < ncat_mix; c++) {
+        size_t mycat = c%ncat;
+        size_t m = c/denom;
+        mix_addr_nstates[c] = m*nstates;
+        double *eval_ptr = eval + mix_addr_nstates[c];
+        double len = site_rate->getRate(mycat)*dad_branch->getLength(mycat);
+        double prop = site_rate->getProp(mycat) * model->getMixtureWeight(m);
+        double *this_val = val + c*nstates;
+        for (size_t i = 0; i < nstates; i++)
+            this_val[i] = exp(eval_ptr[i]*len) * prop;
+    }
+
+    double all_tree_lh(0.0);
+
+    vector<size_t> limits;
+    size_t slice_lower, slice_upper;
+    getPatternSlice(nptn, VectorClass::size(), slice_lower, slice_upper);
+    computeBounds<VectorClass>(num_threads, num_packets, slice_upper, limits, slice_lower);
+
+    if (dad->isLeaf()) {
+    	// special treatment for TIP-INTERNAL NODE case
+        double *partial_lh_node = buffer_partial_lh_ptr;
+        buffer_partial_lh_ptr += get_safe_upper_limit((aln->STATE_UNKNOWN+1)*block);
+
+        // precompute information from one tip
+        for (int state = 0; state <= aln->STATE_UNKNOWN; state++) {
+            double *lh_node = partial_lh_node +state*block;
+            double *val_tmp = val;
+            double *this_tip_partial_lh = tip_partial_lh + state*tip_block;
+            for (size_t c = 0; c < ncat_mix; c++) {
+                double *lh_tip = this_tip_partial_lh + mix_addr_nstates[c];
+                for (size_t i = 0; i < nstates; i++) {
+                      lh_node[i] = val_tmp[i] * lh_tip[i];
+                }
+                lh_node += nstates;
+                val_tmp += nstates;
+            }
+        }
+
+        auto stateRow = this->getConvertedSequenceByNumber(dad->id);
+        auto unknown  = aln->STATE_UNKNOWN;
+    	// now do the real computation
+#ifdef _OPENMP
+#pragma omp parallel for  schedule(dynamic,1) num_threads(num_threads) reduction(+:all_tree_lh)
+#endif
+        for (int packet_id = 0; packet_id < num_packets; packet_id++) {
+            VectorClass vc_tree_lh(0.0);
+            size_t ptn_lower = limits[packet_id];
+            size_t ptn_upper = limits[packet_id+1];
+
+            // reset memory for _pattern_lh_cat
+            memset(_pattern_lh_cat + ptn_lower*ncat_mix, 0, sizeof(double)*(ptn_upper-ptn_lower)*ncat_mix);
+
+            // first compute partial_lh
+            for (vector<TraversalInfo>::iterator it = traversal_info.begin(); it != traversal_info.end(); it++) {
+                computePartialLikelihood(*it, ptn_lower, ptn_upper, packet_id);
+            }
+            double *vec_tip = buffer_partial_lh_ptr + block*VectorClass::size() * packet_id;
+
+            for (size_t ptn = ptn_lower; ptn < ptn_upper; ptn+=VectorClass::size()) {
+                VectorClass lh_ptn(0.0);
+                VectorClass *lh_cat = (VectorClass*)(_pattern_lh_cat + ptn*ncat_mix);
+                float *partial_lh_dad = (float*)dad_branch->partial_lh + ptn*block;
+                VectorClass *lh_node = (VectorClass*)vec_tip;
+
+                //load tip vector
+                for (size_t i = 0; i < VectorClass::size(); i++) {
+                    int state;
+                    if (ptn+i < orig_nptn) {
+                        if (stateRow!=nullptr) {
+                            state =  stateRow[ptn+i];
+                        } else {
+                            state = (aln->at(ptn+i))[dad->id];
+                        }
+                    } else if (ptn+i < max_orig_nptn) {
+                        state = unknown;
+                    } else if (ptn+i < nptn) {
+                        state = model_factory->unobserved_ptns[ptn+i-max_orig_nptn][dad->id];
+                    } else {
+                        state = aln->STATE_UNKNOWN;
+                    }
+                    double *lh_tip = partial_lh_node + block*state;
+                    double *this_vec_tip = vec_tip+i;
+                    for (size_t c = 0; c < block; c++) {
+                        *this_vec_tip = lh_tip[c];
+                        this_vec_tip += VectorClass::size();
+                    }
+                }
+                // compute likelihood per category
+                for (size_t c = 0; c < ncat_mix; c++) {
+                    dotProductFloatVec<VectorClass, nstates>(lh_node, partial_lh_dad, lh_cat[c]);
+                    lh_ptn += lh_cat[c];
+                    lh_node += nstates;
+                    partial_lh_dad += nstates*VectorClass::size();
+                }
+
+                // compute scaling factor per pattern
+                VectorClass vc_min_scale(0.0);
+                double* vc_min_scale_ptr = (double*)&vc_min_scale;
+                for (size_t i = 0; i < VectorClass::size(); i++) {
+                    vc_min_scale_ptr[i] = dad_branch->scale_num[ptn+i];
+                }
+                vc_min_scale *= LOG_SCALING_THRESHOLD_FLOAT;
+
+                // Sum later to avoid underflow of invariant sites
+                lh_ptn = abs(lh_ptn) + VectorClass().load_a(&ptn_invar[ptn]);
+                if (ptn < orig_nptn) {
+                    lh_ptn = log(lh_ptn) + vc_min_scale;
+                    lh_ptn.store_a(&_pattern_lh[ptn]);
+                    vc_tree_lh = mul_add(lh_ptn, VectorClass().load_a(&ptn_freq[ptn]), vc_tree_lh);
+                }
+            } // FOR PTN
+            all_tree_lh += horizontal_add(vc_tree_lh);
+        } // FOR packet
+    } else {
+    	//-------- both dad and node are internal nodes -----------/
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic,1) num_threads(num_threads) reduction(+:all_tree_lh)
+#endif
+        for (int packet_id = 0; packet_id < num_packets; packet_id++) {
+            size_t ptn_lower = limits[packet_id];
+            size_t ptn_upper = limits[packet_id+1];
+
+            // reset memory for _pattern_lh_cat
+            memset(_pattern_lh_cat + ptn_lower*ncat_mix, 0, sizeof(double)*(ptn_upper-ptn_lower)*ncat_mix);
+
+            // first compute partial_lh
+            for (auto it = traversal_info.begin(); it != traversal_info.end(); it++) {
+                computePartialLikelihood(*it, ptn_lower, ptn_upper, packet_id);
+            }
+
+            VectorClass vc_tree_lh(0.0);
+            for (size_t ptn = ptn_lower; ptn < ptn_upper; ptn+=VectorClass::size()) {
+                VectorClass lh_ptn(0.0);
+                VectorClass *lh_cat = (VectorClass*)(_pattern_lh_cat + ptn*ncat_mix);
+                float *partial_lh_dad = (float*)dad_branch->partial_lh + ptn*block;
+                float *partial_lh_node = (float*)node_branch->partial_lh + ptn*block;
+
+                // compute likelihood per category
+                double *val_tmp = val;
+                for (size_t c = 0; c < ncat_mix; c++) {
+                    dotProduct3FloatVec<VectorClass, nstates>(val_tmp, partial_lh_node, partial_lh_dad, lh_cat[c]);
+                    lh_ptn += lh_cat[c];
+                    partial_lh_node += nstates*VectorClass::size();
+                    partial_lh_dad += nstates*VectorClass::size();
+                    val_tmp += nstates;
+                }
+
+                // compute the scaling factor per pattern
+                VectorClass vc_min_scale(0.0);
+                double* vc_min_scale_ptr = (double*)&vc_min_scale;
+                for (size_t i = 0; i < VectorClass::size(); i++) {
+                    vc_min_scale_ptr[i] = dad_branch->scale_num[ptn+i] + node_branch->scale_num[ptn+i];
+                }
+                vc_min_scale *= LOG_SCALING_THRESHOLD_FLOAT;
+
+                // Sum later to avoid underflow of invariant sites
+                lh_ptn = abs(lh_ptn) + VectorClass().load_a(&ptn_invar[ptn]);
+                if (ptn < orig_nptn) {
+                    lh_ptn = log(lh_ptn) + vc_min_scale;
+                    lh_ptn.store_a(&_pattern_lh[ptn]);
+                    vc_tree_lh = mul_add(lh_ptn, VectorClass().load_a(&ptn_freq[ptn]), vc_tree_lh);
+                }
+            } // FOR LOOP ptn
+            all_tree_lh += horizontal_add(vc_tree_lh);
+        } // FOR thread
+    } // else
+
+    // an underflown pattern in single precision is recomputed in double precision by the caller
+    if (!std::isfinite(all_tree_lh))
+        float_lh_unstable = true;
+    return all_tree_lh;
+}
+
+#endif /* PHYLOKERNELFLOAT_H_ */
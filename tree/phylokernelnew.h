@@ -1111,11 +1111,12 @@ void PhyloTree::computePartialInfo(TraversalInfo &info, VectorClass* buffer, dou
 
 #ifndef KERNEL_FIX_STATES
 template<class VectorClass>
-inline void computeBounds(int threads, int packets, size_t elements, vector<size_t> &limits) {
+inline void computeBounds(int threads, int packets, size_t elements, vector<size_t> &limits, size_t first = 0) {
     //It is assumed that threads divides packets evenly
+    //Elements from first (a multiple of the vector size) to elements are divided
     limits.reserve(packets+1);
     elements = roundUpToMultiple(elements, VectorClass::size());
-    size_t block_start = 0;
+    size_t block_start = first;
     
     for (int wave = packets/threads; wave>=1; --wave) {
         size_t elementsThisWave = (elements-block_start);
@@ -1206,6 +1207,9 @@ void PhyloTree::computeTraversalInfo(PhyloNode *node, PhyloNode *dad, bool compu
     if (traversal_info.empty())
         return;
 
+    if (params->lh_scratch_dir)
+        prefetchPartialLh(dad_branch, node_branch);
+
     if (!model->isSiteSpecificModel()) {
 
         int num_info = traversal_info.size();
@@ -1265,7 +1269,9 @@ void PhyloTree::computeTraversalInfo(PhyloNode *node, PhyloNode *dad, bool compu
         vector<size_t> limits;
         size_t orig_nptn = roundUpToMultiple(aln->size(), VectorClass::size());
         size_t nptn      = roundUpToMultiple(orig_nptn+model_factory->unobserved_ptns.size(),VectorClass::size());
-        computeBounds<VectorClass>(num_threads, num_packets, nptn, limits);
+        size_t slice_lower, slice_upper;
+        getPatternSlice(nptn, VectorClass::size(), slice_lower, slice_upper);
+        computeBounds<VectorClass>(num_threads, num_packets, slice_upper, limits, slice_lower);
 
         #ifdef _OPENMP
         #pragma omp parallel for schedule(dynamic,1) num_threads(num_threads)
@@ -2293,7 +2299,9 @@ void PhyloTree::computeLikelihoodDervGenericSIMD(PhyloNeighbor *dad_branch, Phyl
 
     double *buffer_partial_lh_ptr = buffer_partial_lh;
     vector<size_t> limits;
-    computeBounds<VectorClass>(num_threads, num_packets, nptn, limits);
+    size_t slice_lower, slice_upper;
+    getPatternSlice(nptn, VectorClass::size(), slice_lower, slice_upper);
+    computeBounds<VectorClass>(num_threads, num_packets, slice_upper, limits, slice_lower);
 
 	ASSERT(theta_all);
 
@@ -2383,7 +2391,15 @@ void PhyloTree::computeLikelihoodDervGenericSIMD(PhyloNeighbor *dad_branch, Phyl
 
         if (!theta_computed)
         #ifdef KERNEL_FIX_STATES
-            computeLikelihoodBufferSIMD<VectorClass, SAFE_NUMERIC, nstates, FMA, SITE_MODEL>(dad_branch, dad, ptn_lower, ptn_upper, packet_id);
+        {
+        #if MAX_VECTOR_SIZE >= 512
+            // single precision partial likelihoods only come with the AVX-512 kernel
+            if (!SAFE_NUMERIC && !SITE_MODEL && float_partial_lh)
+                computeLikelihoodBufferFloatSIMD<VectorClass, nstates, FMA>(dad_branch, dad, ptn_lower, ptn_upper, packet_id);
+            else
+        #endif
+                computeLikelihoodBufferSIMD<VectorClass, SAFE_NUMERIC, nstates, FMA, SITE_MODEL>(dad_branch, dad, ptn_lower, ptn_upper, packet_id);
+        }
         #else
             computeLikelihoodBufferGenericSIMD<VectorClass, SAFE_NUMERIC, FMA, SITE_MODEL>(dad_branch, dad, ptn_lower, ptn_upper, packet_id);
         #endif
@@ -2735,7 +2751,9 @@ double PhyloTree::computeLikelihoodBranchGenericSIMD(PhyloNeighbor *dad_branch,
     double all_prob_const(0.0);
 
     vector<size_t> limits;
-    computeBounds<VectorClass>(num_threads, num_packets, nptn, limits);
+    size_t slice_lower, slice_upper;
+    getPatternSlice(nptn, VectorClass::size(), slice_lower, slice_upper);
+    computeBounds<VectorClass>(num_threads, num_packets, slice_upper, limits, slice_lower);
 
     if (dad->isLeaf()) {
     	// special treatment for TIP-INTERNAL NODE case
@@ -3085,7 +3103,7 @@ double PhyloTree::computeLikelihoodBranchGenericSIMD(PhyloNeighbor *dad_branch,
     // arbitrarily fix tree_lh if underflown for some sites
     if (!std::isfinite(tree_lh)) {
         tree_lh = 0.0;
-        for (size_t ptn = 0; ptn < orig_nptn; ptn++) {
+        for (size_t ptn = slice_lower; ptn < min(slice_upper, orig_nptn); ptn++) {
           if (!std::isfinite(_pattern_lh[ptn])) {
                 _pattern_lh[ptn] = LOG_SCALING_THRESHOLD*4; // log(2^(-1024))
             }
@@ -3268,11 +3286,13 @@ double PhyloTree::computeLikelihoodFromBufferGenericSIMD()
     }
 
     double all_tree_lh(0.0), all_prob_const(0.0);
+    size_t slice_lower, slice_upper;
+    getPatternSlice(nptn, VectorClass::size(), slice_lower, slice_upper);
 
     #ifdef _OPENMP
     #pragma omp parallel for num_threads(num_threads) reduction(+:all_tree_lh,all_prob_const)
     #endif
-    for (size_t ptn = 0; ptn < nptn; ptn+=VectorClass::size()) {
+    for (size_t ptn = slice_lower; ptn < slice_upper; ptn+=VectorClass::size()) {
         VectorClass lh_ptn(0.0);
         VectorClass *theta = (VectorClass*)(theta_all + ptn*block);
         if (SITE_MODEL) {
@@ -3336,7 +3356,7 @@ double PhyloTree::computeLikelihoodFromBufferGenericSIMD()
     // arbitrarily fix tree_lh if underflown for some sites
     if (!std::isfinite(tree_lh)) {
         tree_lh = 0.0;
-        for (size_t ptn = 0; ptn < orig_nptn; ++ptn) {
+        for (size_t ptn = slice_lower; ptn < min(slice_upper, orig_nptn); ++ptn) {
             if (!std::isfinite(_pattern_lh[ptn])) {
                 _pattern_lh[ptn] = LOG_SCALING_THRESHOLD*4; // log(2^(-1024))
             }
@@ -3445,7 +3465,9 @@ void PhyloTree::computeLikelihoodDervMixlenGenericSIMD(PhyloNeighbor *dad_branch
 
     double *buffer_partial_lh_ptr = buffer_partial_lh;
     vector<size_t> limits;
-    computeBounds<VectorClass>(num_threads, num_packets, nptn, limits);
+    size_t slice_lower, slice_upper;
+    getPatternSlice(nptn, VectorClass::size(), slice_lower, slice_upper);
+    computeBounds<VectorClass>(num_threads, num_packets, slice_upper, limits, slice_lower);
 
 	ASSERT(theta_all);
 
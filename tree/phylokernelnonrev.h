@@ -662,7 +662,9 @@ void PhyloTree::computeNonrevLikelihoodDervGenericSIMD(PhyloNeighbor *dad_branch
     double all_df(0.0), all_ddf(0.0);
     double all_prob_const(0.0), all_df_const(0.0), all_ddf_const(0.0);
     vector<size_t> limits;
-    computeBounds<VectorClass>(num_threads, num_packets, nptn, limits);
+    size_t slice_lower, slice_upper;
+    getPatternSlice(nptn, VectorClass::size(), slice_lower, slice_upper);
+    computeBounds<VectorClass>(num_threads, num_packets, slice_upper, limits, slice_lower);
 
     if (dad->isLeaf()) {
          // make sure that we do not estimate the virtual branch length from the root
@@ -1088,7 +1090,9 @@ double PhyloTree::computeNonrevLikelihoodBranchGenericSIMD(PhyloNeighbor *dad_br
     bool isASC = model_factory->unobserved_ptns.size() > 0;
 
     vector<size_t> limits;
-    computeBounds<VectorClass>(num_threads, num_packets, nptn, limits);
+    size_t slice_lower, slice_upper;
+    getPatternSlice(nptn, VectorClass::size(), slice_lower, slice_upper);
+    computeBounds<VectorClass>(num_threads, num_packets, slice_upper, limits, slice_lower);
 
     double *trans_mat = buffer_partial_lh;
     double *buffer_partial_lh_ptr = buffer_partial_lh + block*nstates;
@@ -1483,7 +1487,7 @@ double PhyloTree::computeNonrevLikelihoodBranchGenericSIMD(PhyloNeighbor *dad_br
     // arbitrarily fix tree_lh if underflown for some sites
     if (!std::isfinite(tree_lh)) {
         tree_lh = 0.0;
-        for (size_t ptn = 0; ptn < orig_nptn; ptn++) {
+        for (size_t ptn = slice_lower; ptn < min(slice_upper, orig_nptn); ptn++) {
             if (!std::isfinite(_pattern_lh[ptn])) {
                 _pattern_lh[ptn] = LOG_SCALING_THRESHOLD*4; // log(2^(-1024))
             }
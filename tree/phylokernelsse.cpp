@@ -29,18 +29,22 @@ void PhyloTree::setParsimonyKernelSSE() {
         // Sankoff kernel
         computeParsimonyBranchPointer = &PhyloTree::computeParsimonyBranchSankoffSIMD<Vec4ui>;
         computePartialParsimonyPointer = &PhyloTree::computePartialParsimonySankoffSIMD<Vec4ui>;
+        computeParsimonyInsertionPointer = NULL;
         return;
     }
     // Fitch kernel
 	computeParsimonyBranchPointer = &PhyloTree::computeParsimonyBranchFastSIMD<Vec4ui>;
     computePartialParsimonyPointer = &PhyloTree::computePartialParsimonyFastSIMD<Vec4ui>;
+    computeParsimonyInsertionPointer = &PhyloTree::computeParsimonyInsertionFastSIMD<Vec4ui>;
 }
 
 void PhyloTree::setDotProductSSE() {
 #ifdef BOOT_VAL_FLOAT
 		dotProduct = &PhyloTree::dotProductSIMD<float, Vec4f>;
+		dotProductCount = &PhyloTree::dotProductCountSIMD<float, Vec4f>;
 #else
 		dotProduct = &PhyloTree::dotProductSIMD<double, Vec2d>;
+		dotProductCount = &PhyloTree::dotProductCountSIMD<double, Vec2d>;
 #endif
         dotProductDouble = &PhyloTree::dotProductSIMD<double, Vec2d>;
 }
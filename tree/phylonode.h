@@ -52,6 +52,7 @@ public:
         partial_pars = NULL;
         direction = UNDEFINED_DIRECTION;
         size = 0;
+        mem_slot_id = -1;
     }
 
     /**
@@ -68,6 +69,7 @@ public:
         partial_pars = NULL;
         direction = UNDEFINED_DIRECTION;
         size = 0;
+        mem_slot_id = -1;
     }
 
     /**
@@ -82,6 +84,7 @@ public:
         partial_pars = NULL;
         direction = nei->direction;
         size = nei->size;
+        mem_slot_id = -1;
     }
 
     
@@ -150,7 +153,8 @@ public:
 private:
 
     /**
-        true if the partial likelihood was computed
+        bit 1: the partial likelihood was computed, bit 2: the partial parsimony was computed,
+        bit 4: the partial likelihood is stored in single precision (--float-lh)
      */
     int partial_lh_computed;
 
@@ -182,6 +186,9 @@ private:
     /** size of subtree below this neighbor in terms of number of taxa */
     int size;
 
+    /** ID of the memory slot last assigned to this neighbor, -1 if none (see MemSlotVector) */
+    int mem_slot_id;
+
 };
 
 /**
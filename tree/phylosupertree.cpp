@@ -226,8 +226,69 @@ void PhyloSuperTree::changeLikelihoodKernel(LikelihoodKernel lk) {
 
 void PhyloSuperTree::setNumThreads(int num_threads) {
     PhyloTree::setNumThreads((size() >= num_threads) ? num_threads : 1);
-    for (iterator it = begin(); it != end(); it++)
-        (*it)->setNumThreads((size() >= num_threads) ? 1 : num_threads);
+    part_threads.clear();
+    if (Params::getInstance().part_sched && num_threads > 1 && size() >= num_threads) {
+        // thread budget proportional to the computation cost, as in computePartitionOrder()
+        int i, ntrees = size();
+        DoubleVector cost(ntrees);
+        double total_cost = 0.0;
+        for (i = 0; i < ntrees; i++) {
+            Alignment *part_aln = at(i)->aln;
+            cost[i] = ((double)part_aln->getNSeq())*part_aln->getNPattern()*part_aln->num_states;
+            total_cost += cost[i];
+        }
+        part_threads.resize(ntrees, 1);
+        bool multi = false;
+        for (i = 0; i < ntrees; i++) {
+            part_threads[i] = max(1, (int)floor(num_threads * cost[i] / total_cost));
+            if (part_threads[i] > 1)
+                multi = true;
+        }
+        if (!multi)
+            part_threads.clear();
+    }
+    for (int i = 0; i < size(); i++) {
+        if (!part_threads.empty())
+            at(i)->setNumThreads(part_threads[i]);
+        else
+            at(i)->setNumThreads((size() >= num_threads) ? 1 : num_threads);
+    }
+    if (!part_threads.empty() && verbose_mode >= VB_MED) {
+        cout << "Thread budget of partitions:";
+        for (int i = 0; i < size(); i++)
+            if (part_threads[i] > 1)
+                cout << " " << at(i)->aln->name << ":" << part_threads[i];
+        cout << endl;
+    }
+}
+
+int PhyloSuperTree::beginPartitionLoop() {
+    if (part_threads.empty())
+        return num_threads;
+    // partitions with a budget of b threads take b-1 threads away from the loop
+    int loop_threads = num_threads;
+    for (int i = 0; i < size(); i++)
+        loop_threads -= part_threads[i] - 1;
+#ifdef _OPENMP
+    omp_set_nested(true);
+    omp_set_max_active_levels(2);
+#endif
+    return max(loop_threads, 1);
+}
+
+void PhyloSuperTree::endPartitionLoop() {
+#ifdef _OPENMP
+    if (!part_threads.empty())
+        omp_set_nested(false);
+#endif
+}
+
+void PhyloSuperTree::beginPartitionTask(int part) {
+#ifdef _OPENMP
+    // only affects the calling thread, i.e. nested regions opened by this partition
+    if (!part_threads.empty())
+        omp_set_num_threads(part_threads[part]);
+#endif
 }
 
 void PhyloSuperTree::printResultTree(string suffix) {
@@ -712,14 +773,19 @@ double PhyloSuperTree::computeLikelihood(double *pattern_lh) {
 		}
 	} else {
         if (part_order.empty()) computePartitionOrder();
+        int loop_threads = beginPartitionLoop();
+		ThreadSettings thread_settings;
 		#ifdef _OPENMP
-		#pragma omp parallel for reduction(+: tree_lh) schedule(dynamic) if(num_threads > 1)
+		#pragma omp parallel for reduction(+: tree_lh) schedule(dynamic) num_threads(loop_threads) if(num_threads > 1)
 		#endif
 		for (int j = 0; j < ntrees; j++) {
+            thread_settings.apply();
             int i = part_order[j];
+            beginPartitionTask(i);
 			part_info[i].cur_score = at(i)->computeLikelihood();
 			tree_lh += part_info[i].cur_score;
 		}
+        endPartitionLoop();
 	}
 	return tree_lh;
 }
@@ -773,16 +839,21 @@ double PhyloSuperTree::optimizeAllBranches(int my_iterations, double tolerance,
 	double tree_lh = 0.0;
 	int ntrees = size();
     if (part_order.empty()) computePartitionOrder();
+    int loop_threads = beginPartitionLoop();
+	ThreadSettings thread_settings;
 	#ifdef _OPENMP
-	#pragma omp parallel for reduction(+: tree_lh) schedule(dynamic) if(num_threads > 1)
+	#pragma omp parallel for reduction(+: tree_lh) schedule(dynamic) num_threads(loop_threads) if(num_threads > 1)
 	#endif
 	for (int j = 0; j < ntrees; j++) {
+        thread_settings.apply();
         int i = part_order[j];
+        beginPartitionTask(i);
 		part_info[i].cur_score = at(i)->optimizeAllBranches(my_iterations, tolerance/min(ntrees,10), maxNRStep);
 		tree_lh += part_info[i].cur_score;
 		if (verbose_mode >= VB_MAX)
 			at(i)->printTree(cout, WT_BR_LEN + WT_NEWLINE);
 	}
+    endPartitionLoop();
 
 	if (my_iterations >= 100) computeBranchLengths();
 	return tree_lh;
@@ -911,10 +982,12 @@ NNIMove PhyloSuperTree::getBestNNIForBran(PhyloNode *node1, PhyloNode *node2, NN
 	int local_totalNNIs = 0, local_evalNNIs = 0;
 
     if (part_order.empty()) computePartitionOrder();
+	ThreadSettings thread_settings;
 	#ifdef _OPENMP
 	#pragma omp parallel for reduction(+: nni_score1, nni_score2, local_totalNNIs, local_evalNNIs) private(part) schedule(dynamic) if(num_threads>1)
 	#endif
 	for (int treeid = 0; treeid < ntrees; treeid++) {
+        thread_settings.apply();
         part = part_order_by_nptn[treeid];
 		bool is_nni = true;
 		local_totalNNIs++;
@@ -365,6 +365,31 @@ public:
     /* compute part_order vector */
     void computePartitionOrder();
 
+    /**
+        thread budget of each partition with --part-sched: large partitions get a share of
+        the threads proportional to their computation cost, all others one thread.
+        Empty if each partition runs with one thread.
+    */
+    IntVector part_threads;
+
+    /**
+        prepare a parallel loop over partitions: with thread budgets, enable nested parallelism
+        so that large partitions run their likelihood kernels with several threads
+        @return number of threads for the partition loop, such that all threads in use
+        never exceed num_threads
+    */
+    int beginPartitionLoop();
+
+    /** restore the OpenMP settings changed by beginPartitionLoop() */
+    void endPartitionLoop();
+
+    /**
+        called by the thread that takes partition part from the partition loop,
+        restricts nested parallel regions to the thread budget of this partition
+        @param part partition ID
+    */
+    void beginPartitionTask(int part);
+
     /**
             get the name of the model
     */
@@ -279,10 +279,12 @@ void PhyloSuperTreePlen::optimizeOneBranch(PhyloNode *node1, PhyloNode *node2, b
 
     if (part_order.empty()) computePartitionOrder();
 	// bug fix: assign cur_score into part_info
+    ThreadSettings thread_settings;
     #ifdef _OPENMP
     #pragma omp parallel for private(part) schedule(dynamic) if(num_threads > 1)
     #endif    
     for (int partid = 0; partid < size(); partid++) {
+        thread_settings.apply();
         part = part_order_by_nptn[partid];
         if (((SuperNeighbor*)current_it)->link_neighbors[part]) {
             part_info[part].cur_score = at(part)->computeLikelihoodFromBuffer();
@@ -319,10 +321,12 @@ double PhyloSuperTreePlen::computeFunction(double value) {
 	ASSERT(nei1 && nei2);
 
     if (part_order.empty()) computePartitionOrder();
+	ThreadSettings thread_settings;
     #ifdef _OPENMP
     #pragma omp parallel for reduction(+: tree_lh) schedule(dynamic) if(num_threads > 1)
     #endif    
 	for (int partid = 0; partid < ntrees; partid++) {
+            thread_settings.apply();
             int part = part_order_by_nptn[partid];
 			PhyloNeighbor *nei1_part = nei1->link_neighbors[part];
 			PhyloNeighbor *nei2_part = nei2->link_neighbors[part];
@@ -377,10 +381,12 @@ void PhyloSuperTreePlen::computeFuncDerv(double value, double &df_ret, double &d
 	ASSERT(nei1 && nei2);
 
     if (part_order.empty()) computePartitionOrder();
+	ThreadSettings thread_settings;
     #ifdef _OPENMP
     #pragma omp parallel for reduction(+: df, ddf) schedule(dynamic) if(num_threads > 1)
     #endif    
 	for (int partid = 0; partid < ntrees; partid++) {
+        thread_settings.apply();
         int part = part_order_by_nptn[partid];
         double df_aux, ddf_aux;
         PhyloNeighbor *nei1_part = nei1->link_neighbors[part];
@@ -1736,8 +1742,8 @@ void PhyloSuperTreePlen::initializeAllPartialLh() {
 	// allocate central memory for all partitions
 	if (!central_partial_lh) {
         try {
-        	central_partial_lh = aligned_alloc<double>(total_partial_lh_entries);
-        	central_scale_num = aligned_alloc<UBYTE>(total_scale_num_entries);
+        	central_partial_lh = allocateCentralPartialLh(total_partial_lh_entries);
+        	central_scale_num = allocateCentralScaleNum(total_scale_num_entries);
         } catch (std::bad_alloc &ba) {
         	outError("Not enough memory for partial likelihood vectors (bad_alloc)");
         }
@@ -199,8 +199,10 @@ double PhyloSuperTreeUnlinked::treeLengthInternal( double epsilon, Node *node, N
 pair<int, int> PhyloSuperTreeUnlinked::doNNISearch(bool write_info) {
     int NNIs = 0, NNI_steps = 0;
     double score = 0.0;
+    ThreadSettings thread_settings;
 #pragma omp parallel for schedule(dynamic) num_threads(num_threads) if (num_threads > 1) reduction(+: NNIs, NNI_steps, score)
     for (int i = 0; i < size(); i++) {
+        thread_settings.apply();
         IQTree *part_tree = (IQTree*)at(part_order[i]);
         Checkpoint *ckp = new Checkpoint;
         getCheckpoint()->getSubCheckpoint(ckp, part_tree->aln->name);
@@ -241,8 +243,11 @@ double PhyloSuperTreeUnlinked::doTreeSearch() {
     bool saved_print_ufboot_trees = params->print_ufboot_trees;
     params->print_ufboot_trees = false;
 
+    ThreadSettings thread_settings;
 #pragma omp parallel for schedule(dynamic) num_threads(num_threads) if (num_threads > 1) reduction(+: tree_lh)
     for (int i = 0; i < size(); i++) {
+        // verbose_mode is per thread, so the worker threads are silenced here
+        thread_settings.apply();
         IQTree *part_tree = (IQTree*)at(part_order[i]);
         Checkpoint *ckp = new Checkpoint;
         getCheckpoint()->getSubCheckpoint(ckp, part_tree->aln->name);
@@ -292,10 +297,19 @@ void PhyloSuperTreeUnlinked::writeUFBootTrees(Params &params) {
     ofstream out(filename.c_str());
     
     for (auto tree = begin(); tree != end(); tree++) {
+        IQTree *part_tree = (IQTree*)*tree;
         MTreeSet trees;
-
-        trees.init(((IQTree*)*tree)->boot_trees, (*tree)->rooted);
-        for (i = 0; i < trees.size(); i++) {
+        IntVector weights;
+
+        part_tree->getBootTreeWeights(weights);
+        part_tree->getBootTreeSet(trees);
+        // newick string to print for each tree ID
+        StrVector tree_strs(weights.size());
+        int id = 0;
+        for (i = 0; i < trees.size(); i++, id++) {
+            // trees holds the IDs with at least one replicate, in increasing order
+            while (weights[id] == 0)
+                id++;
             NodeVector taxa;
             // change the taxa name from ID to real name
             trees[i]->getOrderedTaxa(taxa);
@@ -305,13 +319,17 @@ void PhyloSuperTreeUnlinked::writeUFBootTrees(Params &params) {
                 // reinsert removed seqs into each tree
                 trees[i]->insertTaxa(removed_seqs, twin_seqs);
             }
-            // now print to file
-            for (j = 0; j < trees.tree_weights[i]; j++)
-                if (params.print_ufboot_trees == 1)
-                    trees[i]->printTree(out, WT_NEWLINE);
-                else
-                    trees[i]->printTree(out, WT_NEWLINE + WT_BR_LEN);
+            stringstream ss;
+            if (params.print_ufboot_trees == 1)
+                trees[i]->printTree(ss, WT_NEWLINE);
+            else
+                trees[i]->printTree(ss, WT_NEWLINE + WT_BR_LEN);
+            tree_strs[id] = ss.str();
         }
+        // now print to file, one line per replicate in replicate order
+        for (i = 0; i < part_tree->boot_tree_ids.size(); i++)
+            if (part_tree->boot_tree_ids[i] >= 0)
+                out << tree_strs[part_tree->boot_tree_ids[i]];
     }
     cout << "UFBoot trees printed to " << filename << endl;
     out.close();
@@ -330,10 +348,12 @@ int PhyloSuperTreeUnlinked::testAllBranches(int threshold, double best_score, do
     ptn_lh[0] = pattern_lh;
     for (id = 1; id < size(); id++)
         ptn_lh[id] = ptn_lh[id-1] + at(id-1)->getAlnNPattern();
+    ThreadSettings thread_settings;
 #ifdef _OPENMP
 #pragma omp parallel for reduction(+: num_low_support)
 #endif
     for (int id = 0; id < size(); id++) {
+        thread_settings.apply();
         num_low_support += at(id)->testAllBranches(threshold, at(id)->getCurScore(), ptn_lh[id],
                             reps, lbp_reps, aLRT_test, aBayes_test);
     }
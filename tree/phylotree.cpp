@@ -83,6 +83,8 @@ void PhyloTree::init() {
     nni_partial_lh = NULL;
     tip_partial_lh = NULL;
     tip_partial_pars = NULL;
+    shared_tip_pars = NULL;
+    computeParsimonyInsertionPointer = NULL;
     tip_partial_lh_computed = 0;
     ptn_freq_computed = false;
     central_scale_num = NULL;
@@ -100,12 +102,16 @@ void PhyloTree::init() {
     theta_all = NULL;
     buffer_scale_all = NULL;
     buffer_partial_lh = NULL;
+    float_partial_lh = false;
+    float_lh_disabled = false;
+    float_lh_unstable = false;
     ptn_freq = NULL;
     ptn_freq_pars = NULL;
     ptn_invar = NULL;
     subTreeDistComputed = false;
     dist_matrix = NULL;
     var_matrix = NULL;
+    dist_lower = NULL;
     params = NULL;
     setLikelihoodKernel(LK_SSE2);  // FOR TUNG: you forgot to initialize this variable!
     setNumThreads(1);
@@ -231,8 +237,7 @@ PhyloTree::~PhyloTree() {
     doneComputingDistances();
     aligned_free(nni_scale_num);
     aligned_free(nni_partial_lh);
-    aligned_free(central_partial_lh);
-    aligned_free(central_scale_num);
+    freeCentralPartialLh();
     aligned_free(central_partial_pars);
     aligned_free(cost_matrix);
 
@@ -258,6 +263,9 @@ PhyloTree::~PhyloTree() {
     delete[] var_matrix;
     var_matrix = NULL;
 
+    delete[] dist_lower;
+    dist_lower = NULL;
+
     if (pllPartitions)
         myPartitionsDestroy(pllPartitions);
     if (pllAlignment)
@@ -814,7 +822,8 @@ size_t PhyloTree::getBitsBlockSize() {
     // reserve the last entry for parsimony score
 //    return (aln->num_states * aln->size() + UINT_BITS - 1) / UINT_BITS + 1;
     if (cost_matrix) {
-        return get_safe_upper_limit_float(aln->size() * aln->num_states);
+        // the Sankoff kernels run over ordered_pattern padded to the SIMD width
+        return get_safe_upper_limit_float(aln->size()) * aln->num_states;
     }
     size_t len = aln->getMaxNumStates() * ((max(aln->size(), (size_t)aln->num_variant_sites) + SIMD_BITS - 1) / UINT_BITS) + 4;
 #ifdef __AVX512KNL
@@ -874,6 +883,8 @@ size_t PhyloTree::getBufferPartialLhSize() {
 
     buffer_size += get_safe_upper_limit(block *(aln->STATE_UNKNOWN+1));
     buffer_size += (block*2+model->num_states)*VECTOR_SIZE*num_packets;
+    // one more block per packet for converting single precision vectors
+    buffer_size += block*VECTOR_SIZE*num_packets;
 
     // always more buffer for non-rev kernel, in case switching between kernels
     buffer_size += get_safe_upper_limit(block)*(aln->STATE_UNKNOWN+1)*2;
@@ -897,6 +908,8 @@ void PhyloTree::initializeAllPartialLh() {
         get_safe_upper_limit(model_factory->unobserved_ptns.size()));
 
     size_t block_size = mem_size * numStates * site_rate->getNRate() * ((model_factory->fused_mix_rate)? 1 : model->getNMixtures());
+    if (model_factory->unobserved_ptns.size() > 0 && MPIHelper::getInstance().isPatternParallel())
+        outError("--mpi-patterns does not support ascertainment bias correction (+ASC)");
     // make sure _pattern_lh size is divisible by 4 (e.g., 9->12, 14->16)
     if (!_pattern_lh)
         _pattern_lh = aligned_alloc<double>(mem_size);
@@ -936,8 +949,7 @@ void PhyloTree::initializeAllPartialLh() {
 void PhyloTree::deleteAllPartialLh() {
     //Note: aligned_free now sets the pointer to nullptr
     //      (so there's no need to do that explicitly any more)
-    aligned_free(central_partial_lh);
-    aligned_free(central_scale_num);
+    freeCentralPartialLh();
     aligned_free(central_partial_pars);
     aligned_free(nni_scale_num);
     aligned_free(nni_partial_lh);
@@ -963,7 +975,9 @@ uint64_t PhyloTree::getMemoryRequired(size_t ncategory, bool full_mem) {
     int64_t nptn = get_safe_upper_limit(aln->getNPattern()) + get_safe_upper_limit(aln->num_states);
     if (model_factory)
         nptn = get_safe_upper_limit(aln->getNPattern()) + max(get_safe_upper_limit(aln->num_states), get_safe_upper_limit(model_factory->unobserved_ptns.size()));
-    int64_t scale_block_size = nptn;
+    // partial likelihood vectors only hold the pattern slice of this MPI process with --mpi-patterns
+    size_t ptn_lower;
+    int64_t scale_block_size = getPartialLhPatterns(ptn_lower);
     if (site_rate)
         scale_block_size *= site_rate->getNRate();
     else
@@ -1025,10 +1039,8 @@ uint64_t PhyloTree::getMemoryRequiredThreaded(size_t ncategory, bool full_mem) {
 }
 
 void PhyloTree::getMemoryRequired(uint64_t &partial_lh_entries, uint64_t &scale_num_entries, uint64_t &partial_pars_entries) {
-    // +num_states for ascertainment bias correction
-    uint64_t block_size = get_safe_upper_limit(aln->getNPattern()) + get_safe_upper_limit(aln->num_states);
-    if (model_factory)
-        block_size = get_safe_upper_limit(aln->getNPattern()) + max(get_safe_upper_limit(aln->num_states), get_safe_upper_limit(model_factory->unobserved_ptns.size()));
+    size_t ptn_lower;
+    uint64_t block_size = getPartialLhPatterns(ptn_lower);
     size_t scale_size = block_size;
     block_size = block_size * aln->num_states;
     if (site_rate) {
@@ -1053,8 +1065,8 @@ void PhyloTree::getMemoryRequired(uint64_t &partial_lh_entries, uint64_t &scale_
 
 void PhyloTree::initializeAllPartialLh(int &index, int &indexlh, PhyloNode *node, PhyloNode *dad) {
     uint64_t pars_block_size = getBitsBlockSize();
-    // +num_states for ascertainment bias correction
-    size_t nptn = get_safe_upper_limit(aln->size())+ max(get_safe_upper_limit(aln->num_states), get_safe_upper_limit(model_factory->unobserved_ptns.size()));
+    size_t ptn_lower;
+    size_t nptn = getPartialLhPatterns(ptn_lower);
     uint64_t block_size;
     uint64_t scale_block_size = nptn * site_rate->getNRate() * ((model_factory->fused_mix_rate)? 1 : model->getNMixtures());
     block_size = scale_block_size * model->num_states;
@@ -1082,7 +1094,7 @@ void PhyloTree::initializeAllPartialLh(int &index, int &indexlh, PhyloNode *node
             if (verbose_mode >= VB_MAX)
                 cout << "Allocating " << mem_size * sizeof(double) << " bytes for partial likelihood vectors" << endl;
             try {
-                central_partial_lh = aligned_alloc<double>(mem_size);
+                central_partial_lh = allocateCentralPartialLh(mem_size);
             } catch (std::bad_alloc &ba) {
                 outError("Not enough memory for partial likelihood vectors (bad_alloc)");
             }
@@ -1103,7 +1115,7 @@ void PhyloTree::initializeAllPartialLh(int &index, int &indexlh, PhyloNode *node
             if (verbose_mode >= VB_MAX)
                 cout << "Allocating " << mem_size * sizeof(UBYTE) << " bytes for scale num vectors" << endl;
             try {
-                central_scale_num = aligned_alloc<UBYTE>(mem_size);
+                central_scale_num = allocateCentralScaleNum(mem_size);
             } catch (std::bad_alloc &ba) {
                 outError("Not enough memory for scale num vectors (bad_alloc)");
             }
@@ -1146,8 +1158,8 @@ void PhyloTree::initializeAllPartialLh(int &index, int &indexlh, PhyloNode *node
             if (!node->isLeaf()) { // only allocate memory to internal node
                 nei->partial_lh = NULL; // do not allocate memory for tip, use tip_partial_lh instead
                 nei->scale_num = NULL;
-                nei2->scale_num = central_scale_num + ((indexlh) * scale_block_size);
-                nei2->partial_lh = central_partial_lh + (indexlh * block_size);
+                nei2->scale_num = central_scale_num + ((indexlh) * scale_block_size) - getScaleNumOffset();
+                nei2->partial_lh = central_partial_lh + (indexlh * block_size) - getPartialLhOffset();
                 indexlh++;
             } else {
                 nei->partial_lh = NULL; 
@@ -1185,25 +1197,116 @@ double *PhyloTree::newPartialLh() {
     return aligned_alloc<double>(getPartialLhSize());
 }
 
-size_t PhyloTree::getPartialLhSize() {
+double *PhyloTree::allocateCentralPartialLh(uint64_t entries) {
+    if (params && params->lh_scratch_dir) {
+        double *mem = (double*)partial_lh_scratch.open(params->lh_scratch_dir, entries * sizeof(double));
+        if (mem) {
+            if (verbose_mode >= VB_MED)
+                cout << "Partial likelihood vectors stored in a scratch file in " << params->lh_scratch_dir << endl;
+            return mem;
+        }
+        outWarning("Could not create a scratch file of " + convertInt64ToString(entries * sizeof(double) / 1048576)
+                   + " MB in " + params->lh_scratch_dir + ", using RAM for partial likelihood vectors");
+    }
+    return aligned_alloc<double>(entries);
+}
+
+UBYTE *PhyloTree::allocateCentralScaleNum(uint64_t entries) {
+    if (params && params->lh_scratch_dir) {
+        UBYTE *mem = (UBYTE*)scale_num_scratch.open(params->lh_scratch_dir, entries * sizeof(UBYTE));
+        if (mem)
+            return mem;
+    }
+    return aligned_alloc<UBYTE>(entries);
+}
+
+void PhyloTree::freeCentralPartialLh() {
+    if (partial_lh_scratch.isOpen()) {
+        partial_lh_scratch.close();
+        central_partial_lh = NULL;
+    } else {
+        aligned_free(central_partial_lh);
+    }
+    if (scale_num_scratch.isOpen()) {
+        scale_num_scratch.close();
+        central_scale_num = NULL;
+    } else {
+        aligned_free(central_scale_num);
+    }
+}
+
+void PhyloTree::prefetchPartialLh(PhyloNeighbor *dad_branch, PhyloNeighbor *node_branch) {
+    size_t lh_bytes = getPartialLhBytes();
+    size_t scale_bytes = getScaleNumBytes();
+    size_t lh_offset = getPartialLhOffset();
+    size_t scale_offset = getScaleNumOffset();
+    // children are read and dad_branch is written, in the order of traversal_info
+    for (auto it = traversal_info.begin(); it != traversal_info.end(); it++) {
+        PhyloNode *node = (PhyloNode*)it->dad_branch->node;
+        FOR_NEIGHBOR_IT(node, it->dad, child) {
+            PhyloNeighbor *nei = (PhyloNeighbor*)*child;
+            if (!nei->node->isLeaf() && nei->partial_lh) {
+                ScratchMapping::prefetch(nei->partial_lh + lh_offset, lh_bytes);
+                ScratchMapping::prefetch(nei->scale_num + scale_offset, scale_bytes);
+            }
+        }
+        ScratchMapping::prefetch(it->dad_branch->partial_lh + lh_offset, lh_bytes);
+        ScratchMapping::prefetch(it->dad_branch->scale_num + scale_offset, scale_bytes);
+    }
+    PhyloNeighbor *branches[] = {dad_branch, node_branch};
+    for (auto nei : branches) {
+        if (!nei->node->isLeaf() && nei->partial_lh) {
+            ScratchMapping::prefetch(nei->partial_lh + lh_offset, lh_bytes);
+            ScratchMapping::prefetch(nei->scale_num + scale_offset, scale_bytes);
+        }
+    }
+}
+
+size_t PhyloTree::getPartialLhPatterns(size_t &ptn_lower) {
+    ptn_lower = 0;
+    if (MPIHelper::getInstance().isPatternParallel()) {
+        size_t ptn_upper;
+        getPatternSlice(roundUpToMultiple(aln->size(), PATTERN_SLICE_ALIGN), PATTERN_SLICE_ALIGN, ptn_lower, ptn_upper);
+        return ptn_upper - ptn_lower;
+    }
     // +num_states for ascertainment bias correction
-    size_t block_size = get_safe_upper_limit(aln->size())+max(get_safe_upper_limit(aln->num_states),
-        get_safe_upper_limit(model_factory->unobserved_ptns.size()));
+    return get_safe_upper_limit(aln->size()) + max(get_safe_upper_limit(aln->num_states),
+        get_safe_upper_limit(model_factory ? model_factory->unobserved_ptns.size() : 0));
+}
+
+size_t PhyloTree::getPartialLhSize() {
+    size_t ptn_lower;
+    size_t block_size = getPartialLhPatterns(ptn_lower);
     block_size *= model->num_states * site_rate->getNRate() * ((model_factory->fused_mix_rate)? 1 : model->getNMixtures());
     return block_size;
 }
 
+size_t PhyloTree::getPartialLhOffset() {
+    size_t ptn_lower;
+    getPartialLhPatterns(ptn_lower);
+    return ptn_lower * model->num_states * site_rate->getNRate() * ((model_factory->fused_mix_rate)? 1 : model->getNMixtures());
+}
+
 size_t PhyloTree::getPartialLhBytes() {
     // +num_states for ascertainment bias correction
     return getPartialLhSize() * sizeof(double);
 }
 
 size_t PhyloTree::getScaleNumSize() {
-    size_t block_size = get_safe_upper_limit(aln->size())+max(get_safe_upper_limit(aln->num_states),
-        get_safe_upper_limit(model_factory->unobserved_ptns.size()));
+    size_t ptn_lower;
+    size_t block_size = getPartialLhPatterns(ptn_lower);
     return (block_size) * site_rate->getNRate() * ((model_factory->fused_mix_rate)? 1 : model->getNMixtures());
 }
 
+size_t PhyloTree::getScaleNumOffset() {
+    size_t ptn_lower;
+    getPartialLhPatterns(ptn_lower);
+    // the safe kernels keep one entry per pattern and category, the others one per pattern
+    if (safe_numeric)
+        return ptn_lower * site_rate->getNRate() * ((model_factory->fused_mix_rate)? 1 : model->getNMixtures());
+    return ptn_lower;
+}
+
 size_t PhyloTree::getScaleNumBytes() {
     return getScaleNumSize()*sizeof(UBYTE);
 }
@@ -1263,6 +1366,8 @@ double PhyloTree::computeLikelihood(double *pattern_lh) {
          outError("Scaling error ", __func__);
          }*/
     }
+    if (pattern_lh)
+        gatherPatternSlices(pattern_lh, aln->getNPattern());
     curScore = score;
     return score;
 }
@@ -1337,6 +1442,11 @@ double PhyloTree::computePatternLhCat(SiteLoglType wsl) {
     double score;
 
     score = computeLikelihoodBranch(current_it, (PhyloNode*)current_it_back->node);
+    if (MPIHelper::getInstance().isPatternParallel()) {
+        size_t ncat = site_rate->getNRate();
+        if (!model_factory->fused_mix_rate) ncat *= model->getNMixtures();
+        gatherPatternSlices(_pattern_lh_cat, ((aln->size()+vector_size-1)/vector_size)*vector_size, ncat);
+    }
     // TODO: SIMD aware
     transformPatternLhCat();
     /*
@@ -1480,6 +1590,7 @@ void PhyloTree::computePatternLikelihood(double *ptn_lh, double *cur_logl, doubl
     } else {
         memmove(ptn_lh, _pattern_lh, nptn * sizeof(double));
     }
+    gatherPatternSlices(ptn_lh, nptn);
 
     if (!ptn_lh_cat)
         return;
@@ -1518,6 +1629,7 @@ void PhyloTree::computePatternLikelihood(double *ptn_lh, double *cur_logl, doubl
     
     // New kernel
     int ptn;
+    double log_scaling = float_partial_lh ? LOG_SCALING_THRESHOLD_FLOAT : LOG_SCALING_THRESHOLD;
     PhyloNeighbor *nei1 = current_it;
     PhyloNeighbor *nei2 = current_it_back;
     if (!nei1->node->isLeaf() && nei2->node->isLeaf()) {
@@ -1544,7 +1656,7 @@ void PhyloTree::computePatternLikelihood(double *ptn_lh, double *cur_logl, doubl
         } else {
             // normal scaling
             for (ptn = 0; ptn < nptn; ptn++) {
-                double scale = nei2_scale[ptn] * LOG_SCALING_THRESHOLD;
+                double scale = nei2_scale[ptn] * log_scaling;
                 for (i = 0; i < ncat; i++)
                     out_lh_cat[i] = log(lh_cat[i]) + scale;
                 lh_cat += ncat;
@@ -1571,7 +1683,7 @@ void PhyloTree::computePatternLikelihood(double *ptn_lh, double *cur_logl, doubl
         } else {
             // normal scaling
             for (ptn = 0; ptn < nptn; ptn++) {
-                double scale = (nei1_scale[ptn] + nei2_scale[ptn]) * LOG_SCALING_THRESHOLD;
+                double scale = (nei1_scale[ptn] + nei2_scale[ptn]) * log_scaling;
                 for (i = 0; i < ncat; i++)
                     out_lh_cat[i] = log(lh_cat[i]) + scale;
                 lh_cat += ncat;
@@ -1579,6 +1691,7 @@ void PhyloTree::computePatternLikelihood(double *ptn_lh, double *cur_logl, doubl
             }
         }
     }
+    gatherPatternSlices(ptn_lh_cat, nptn, ncat);
 
 //    if (cur_logl) {
 //        double check_score = 0.0;
@@ -2409,17 +2522,24 @@ double PhyloTree::computeCorrectedBayesianBranchLength(PhyloNeighbor *dad_branch
     return correctBranchLengthF81(observedBran, site_rate->getGammaShape());
 }
 
-void PhyloTree::computeAllBayesianBranchLengths(Node *node, Node *dad) {
+void PhyloTree::computeAllBayesianBranchLengths(Node *node, Node *dad, bool recompute_lh) {
 
     if (!node) {
         node = root;
+        // computeBayesianBranchLength() reads partial_lh in double precision
+        if (float_partial_lh) {
+            disableFloatPartialLh("Bayesian branch lengths need double precision partial likelihoods");
+            recompute_lh = true;
+        }
     }
     FOR_NEIGHBOR_IT(node, dad, it){
+        if (recompute_lh)
+            computeLikelihoodBranch((PhyloNeighbor*) (*it), (PhyloNode*) node);
         double branch_length = computeBayesianBranchLength((PhyloNeighbor*) (*it), (PhyloNode*) node);
         (*it)->length = branch_length;
         // set the backward branch length
         (*it)->node->findNeighbor(node)->length = (*it)->length;
-        computeAllBayesianBranchLengths((*it)->node, node);
+        computeAllBayesianBranchLengths((*it)->node, node, recompute_lh);
     }
 }
 
@@ -3648,7 +3768,10 @@ double PhyloTree::computeDist(Params &params, Alignment *alignment, double* &dis
 }
 
 void PhyloTree::printDistanceFile() {
-    aln->printDist(dist_file.c_str(), dist_matrix);
+    if (dist_lower)
+        aln->printDist(dist_file.c_str(), dist_lower);
+    else
+        aln->printDist(dist_file.c_str(), dist_matrix);
     distanceFileWritten = dist_file.c_str();
 }
 
@@ -3691,6 +3814,109 @@ double PhyloTree::computeObsDist(Params &params, Alignment *alignment, double* &
     return longest_dist;
 }
 
+/** number of sequences per side of the square tiles of computeDistLowerTriangle */
+const size_t DIST_TILE_SIZE = 64;
+
+double PhyloTree::computeDistLowerTriangle(Params &params, Alignment *alignment) {
+    this->params = &params;
+    aln = alignment;
+    size_t nseqs = aln->getNSeq();
+    if (!dist_lower) {
+        dist_lower = new float[nseqs*(nseqs-1)/2];
+    }
+    double begin_time = getRealTime();
+    prepareToComputeDistances();
+
+    // with -experimental, observed distances of the converted sequences come from
+    // the SIMD Hamming kernel (as in AlignmentPairwise::recomputeDist)
+    const char* sequences   = nullptr;
+    const int*  frequencies = nullptr;
+    size_t      seq_len     = 0;
+    double      total_freq  = 0.0;
+#if !defined(__ARM_NEON)
+    if (hasMatrixOfConvertedSequences() && aln->STATE_UNKNOWN < 128) {
+        sequences   = getConvertedSequenceByNumber(0);
+        frequencies = getConvertedSequenceNonConstFrequencies();
+        seq_len     = getConvertedSequenceLength();
+        for (size_t i = 0; i < seq_len; ++i) {
+            total_freq += frequencies[i];
+        }
+    }
+#endif
+    char unknown = static_cast<char>(aln->STATE_UNKNOWN);
+
+    // tiles (row_tile, col_tile) with col_tile <= row_tile, numbered row by row
+    size_t ntiles = (nseqs + DIST_TILE_SIZE - 1) / DIST_TILE_SIZE;
+    size_t tile_count = ntiles*(ntiles+1)/2;
+    DoubleVector tile_longest(tile_count, 0.0);
+    progress_display progress(nseqs*(nseqs-1)/2, "Calculating distance matrix");
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic)
+    #endif
+    for (size_t tile = 0; tile < tile_count; ++tile) {
+        #ifdef _OPENMP
+            AlignmentPairwise* processor = distanceProcessors[omp_get_thread_num()];
+        #else
+            AlignmentPairwise* processor = distanceProcessors[0];
+        #endif
+        size_t row_tile = (size_t)((sqrt(8.0*tile+1.0)-1.0)/2.0);
+        while (row_tile*(row_tile+1)/2 > tile) {
+            --row_tile;
+        }
+        while ((row_tile+1)*(row_tile+2)/2 <= tile) {
+            ++row_tile;
+        }
+        size_t col_start = (tile - row_tile*(row_tile+1)/2) * DIST_TILE_SIZE;
+        size_t row_start = row_tile * DIST_TILE_SIZE;
+        size_t row_stop  = min(row_start + DIST_TILE_SIZE, nseqs);
+        double longest   = 0.0;
+        size_t pairs     = 0;
+        for (size_t seq1 = row_start; seq1 < row_stop; ++seq1) {
+            float* dist_row = dist_lower + seq1*(seq1-1)/2;
+            size_t col_stop = min(col_start + DIST_TILE_SIZE, seq1);
+            for (size_t seq2 = col_start; seq2 < col_stop; ++seq2, ++pairs) {
+                double d2l = 1.0;
+                double initial_dist = 0.0;
+                double dist;
+                if (sequences) {
+                    double unknown_freq = 0.0;
+                    double hamming = hammingDistance(unknown, sequences + seq1*seq_len
+                                                     , sequences + seq2*seq_len, seq_len
+                                                     , frequencies, unknown_freq);
+                    if (0 < hamming) {
+                        initial_dist = hamming / (total_freq - unknown_freq);
+                    }
+                }
+                if (sequences && params.compute_obs_dist) {
+                    dist = initial_dist;
+                } else {
+                    if (sequences) {
+                        initial_dist = aln->computeJCDistanceFromObservedDistance(initial_dist);
+                    }
+                    dist = processor->recomputeDist(seq1, seq2, initial_dist, d2l);
+                }
+                dist_row[seq2] = dist;
+                if (dist > longest) {
+                    longest = dist;
+                }
+            }
+        }
+        tile_longest[tile] = longest;
+        progress += pairs;
+    }
+    progress.done();
+    doneComputingDistances();
+    double longest_dist = 0.0;
+    for (size_t tile = 0; tile < tile_count; ++tile) {
+        longest_dist = max(longest_dist, tile_longest[tile]);
+    }
+    if (verbose_mode >= VB_MED) {
+        cout << "Distance calculation time: "
+        << getRealTime() - begin_time << " seconds" << endl;
+    }
+    return longest_dist;
+}
+
 /****************************************************************************
  compute BioNJ tree, a more accurate extension of Neighbor-Joining
  ****************************************************************************/
@@ -3712,7 +3938,8 @@ void PhyloTree::computeBioNJ(Params &params) {
     for (int thread=0; thread<2; ++thread) {
 #endif
         if (thread==0) {
-            if (!params.dist_file) {
+            //--dist-float: the distance file is only written if asked for (or if the builder needs it)
+            if (!params.dist_file && (!dist_lower || params.write_dist_file)) {
                 //This will take longer
                 double write_begin_time = getRealTime();
                 printDistanceFile();
@@ -3724,6 +3951,19 @@ void PhyloTree::computeBioNJ(Params &params) {
                     << getRealTime() - write_begin_time << " seconds " << endl;
                 }
             }
+        } else if (dist_lower) {
+            //--dist-float: hand the single precision lower triangle to the builder
+            double start_time = getRealTime();
+            wasDoneInMemory = treeBuilder->constructTreeFromLowerTriangle
+            ( this->aln->getSeqNames(), dist_lower, bionj_file);
+            if (wasDoneInMemory && verbose_mode >= VB_MED) {
+                #ifdef _OPENMP
+                    #pragma omp critical (io)
+                #endif
+                cout << "Computing " << treeBuilder->getName() << " tree"
+                    << " (from in-memory lower triangle) distance matrix took "
+                    << (getRealTime()-start_time) << " sec." << endl;
+            }
         } else if (this->dist_matrix!=nullptr) {
             double start_time = getRealTime();
             wasDoneInMemory = treeBuilder->constructTreeInMemory
@@ -3744,7 +3984,10 @@ void PhyloTree::computeBioNJ(Params &params) {
         #pragma omp barrier
         omp_set_nested(false);
     #endif
-        
+    if (!wasDoneInMemory && dist_lower && !params.dist_file && !params.write_dist_file) {
+        // the builder cannot take the lower triangle, it reads the distance file instead
+        printDistanceFile();
+    }
     if (!wasDoneInMemory) {
         double start_time = getRealTime();
         treeBuilder->constructTree(dist_file, bionj_file);
@@ -3766,6 +4009,197 @@ void PhyloTree::computeBioNJ(Params &params) {
     }
 }
 
+/**
+    replace the leaf names (the labels following '(' or ',') of a newick string
+    that are keys of the replacement map
+*/
+static string replaceNewickLeaves(const string &newick, const unordered_map<string, string> &replacement) {
+    string result;
+    result.reserve(newick.length());
+    size_t i = 0, len = newick.length();
+    while (i < len) {
+        char c = newick[i++];
+        result += c;
+        if (c != '(' && c != ',')
+            continue;
+        size_t start = i;
+        while (i < len && newick[i] != '(' && newick[i] != ')' && newick[i] != ':'
+               && newick[i] != ',' && newick[i] != ';')
+            i++;
+        string label = newick.substr(start, i - start);
+        auto it = replacement.find(label);
+        result += (it == replacement.end()) ? label : it->second;
+    }
+    return result;
+}
+
+/**
+    print the subtree below node (away from dad) with branch lengths,
+    but without the length of the branch node-dad
+*/
+static void printPlacementSubtree(ostream &out, Node *node, Node *dad) {
+    if (node->isLeaf()) {
+        out << node->name;
+        return;
+    }
+    out << "(";
+    bool first = true;
+    FOR_NEIGHBOR_IT(node, dad, it) {
+        if (!first)
+            out << ",";
+        printPlacementSubtree(out, (*it)->node, node);
+        out << ":" << (*it)->length;
+        first = false;
+    }
+    out << ")";
+}
+
+string PhyloTree::computePlacementNewick(Params &params, IntVector &taxa) {
+    size_t m = taxa.size();
+    ASSERT(m >= 3);
+    if (m <= params.place_block) {
+        // small enough: all pairwise distances, then the usual start tree builder
+        vector<double> dist(m*m, 0.0);
+        #ifdef _OPENMP
+        #pragma omp parallel for schedule(dynamic)
+        #endif
+        for (int i = 0; i < (int)m; i++)
+            for (size_t j = i+1; j < m; j++)
+                dist[i*m+j] = dist[j*m+i] = aln->computeDist(taxa[i], taxa[j]);
+        StrVector names(m);
+        for (size_t i = 0; i < m; i++)
+            names[i] = convertIntToString(taxa[i]);
+        string newick;
+        auto treeBuilder = StartTree::Factory::getTreeBuilderByName(params.start_tree_subtype_name);
+        if (!treeBuilder || !treeBuilder->constructTreeStringInMemory(names, dist.data(), newick)) {
+            // e.g. BIONJ-2009 only works from a distance file
+            treeBuilder = StartTree::Factory::getTreeBuilderByName
+                (StartTree::Factory::getNameOfDefaultTreeBuilder());
+            treeBuilder->beSilent();
+            if (!treeBuilder->constructTreeStringInMemory(names, dist.data(), newick))
+                outError("Could not construct start tree for -t PLACE");
+        }
+        newick.erase(newick.find_last_of(')') + 1);
+        return newick;
+    }
+
+    // sample the representatives, at most place_block of them so that they
+    // are joined directly, and fewer than m so that every group shrinks
+    IntVector shuffled(taxa);
+    my_random_shuffle(shuffled.begin(), shuffled.end());
+    size_t num_reps = min((size_t)params.place_reps, min((size_t)params.place_block, m-1));
+    IntVector reps(shuffled.begin(), shuffled.begin() + num_reps);
+    size_t num_others = m - num_reps;
+
+    // each other sequence goes with its nearest representative
+    IntVector nearest(num_others);
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic, 64)
+    #endif
+    for (int i = 0; i < (int)num_others; i++) {
+        int seq = shuffled[num_reps + i];
+        int best = 0;
+        double best_dist = aln->computeDist(seq, reps[0]);
+        for (size_t r = 1; r < num_reps; r++) {
+            double d = aln->computeDist(seq, reps[r]);
+            if (d < best_dist) {
+                best_dist = d;
+                best = r;
+            }
+        }
+        nearest[i] = best;
+    }
+    vector<IntVector> groups(num_reps);
+    for (size_t i = 0; i < num_others; i++)
+        groups[nearest[i]].push_back(shuffled[num_reps + i]);
+
+    // split the groups that are too large into chunks, each built separately and hung
+    // from the same representative: e.g. near-identical sequences all nearest to one
+    // representative would otherwise shrink the group by only num_reps-1 per level
+    size_t max_chunk = max(m/2, (size_t)params.place_block - 1);
+
+    if (verbose_mode >= VB_MED)
+        cout << "Placing " << num_others << " sequences around " << num_reps << " representatives" << endl;
+
+    // the tree of the representatives is the backbone; each representative
+    // leaf is then replaced by the tree of its group, hung from the representative
+    string backbone = computePlacementNewick(params, reps);
+    unordered_map<string, string> clades;
+    for (size_t r = 0; r < num_reps; r++) {
+        if (groups[r].empty())
+            continue;
+        string rep_name = convertIntToString(reps[r]);
+        stringstream clade;
+        clade.precision(10);
+        if (groups[r].size() == 1) {
+            double half = 0.5 * aln->computeDist(reps[r], groups[r][0]);
+            clade << "(" << rep_name << ":" << half << "," << groups[r][0] << ":" << half << ")";
+            clades[rep_name] = clade.str();
+            continue;
+        }
+        clade << rep_name;
+        for (size_t first = 0; first < groups[r].size(); first += max_chunk) {
+            size_t last = min(first + max_chunk, groups[r].size());
+            if (last - first == 1) {
+                double half = 0.5 * aln->computeDist(reps[r], groups[r][first]);
+                string inner = clade.str();
+                clade.str("");
+                clade << "(" << inner << ":" << half << "," << groups[r][first] << ":" << half << ")";
+                continue;
+            }
+            IntVector group;
+            group.reserve(last - first + 1);
+            group.push_back(reps[r]);
+            group.insert(group.end(), groups[r].begin() + first, groups[r].begin() + last);
+            stringstream group_tree(computePlacementNewick(params, group) + ";");
+            MTree subtree;
+            bool is_rooted = false;
+            subtree.readTree(group_tree, is_rooted);
+            Node *rep_leaf = subtree.findLeafName(rep_name);
+            ASSERT(rep_leaf);
+            Neighbor *rep_nei = rep_leaf->neighbors[0];
+            string inner = clade.str();
+            clade.str("");
+            clade << "(" << inner << ":" << rep_nei->length << ",";
+            printPlacementSubtree(clade, rep_nei->node, rep_leaf);
+            clade << ":0)";
+        }
+        clades[rep_name] = clade.str();
+    }
+    return replaceNewickLeaves(backbone, clades);
+}
+
+void PhyloTree::computePlacementTree(Params &params) {
+    size_t nseq = aln->getNSeq();
+    if (nseq < 3)
+        outError(ERR_FEW_TAXA);
+    string tree_file = params.out_prefix;
+    tree_file += ".placetree";
+    auto treeBuilder = StartTree::Factory::getTreeBuilderByName(params.start_tree_subtype_name);
+    if (treeBuilder && verbose_mode < VB_MED) {
+        // one builder run per group: do not report each of them
+        treeBuilder->beSilent();
+    }
+    IntVector taxa(nseq);
+    for (size_t i = 0; i < nseq; i++)
+        taxa[i] = i;
+    string newick = computePlacementNewick(params, taxa);
+
+    // leaves are sequence IDs so far
+    unordered_map<string, string> seq_names;
+    for (size_t i = 0; i < nseq; i++)
+        seq_names[convertIntToString(i)] = aln->getSeqName(i);
+    ofstream out(tree_file.c_str());
+    out << replaceNewickLeaves(newick, seq_names) << ";" << endl;
+    out.close();
+
+    bool non_empty_tree = (root != NULL);
+    readTreeFile(tree_file.c_str());
+    if (non_empty_tree) {
+        initializeAllPartialLh();
+    }
+}
+
 int PhyloTree::setNegativeBranch(bool force, double newlen, Node *node, Node *dad) {
     if (!node) node = root;
     int fixed = 0;
@@ -4121,8 +4555,8 @@ NNIMove PhyloTree::getBestNNIForBran(PhyloNode *node1, PhyloNode *node2, NNIMove
         *saved_it[id] = saved_nei[id]->newNeighbor();
 
         if (((PhyloNeighbor*)saved_nei[id])->partial_lh) {
-            ((PhyloNeighbor*) (*saved_it[id]))->partial_lh = nni_partial_lh + mem_id*partial_lh_size;
-            ((PhyloNeighbor*) (*saved_it[id]))->scale_num = nni_scale_num + mem_id*scale_num_size;
+            ((PhyloNeighbor*) (*saved_it[id]))->partial_lh = nni_partial_lh + mem_id*partial_lh_size - getPartialLhOffset();
+            ((PhyloNeighbor*) (*saved_it[id]))->scale_num = nni_scale_num + mem_id*scale_num_size - getScaleNumOffset();
             mem_id++;
             mem_slots.addSpecialNei((PhyloNeighbor*)*saved_it[id]);
         }
@@ -5909,8 +6343,10 @@ bool PhyloTree::computeTraversalInfo(PhyloNeighbor *dad_branch, PhyloNode *dad,
     size_t nstates = aln->num_states;
     PhyloNode *node = (PhyloNode*)dad_branch->node;
 
-    if ((dad_branch->partial_lh_computed & 1) || node->isLeaf()) {
-        return mem_slots.lock(dad_branch);
+    // a vector stored in the other precision than the current kernel has to be recomputed
+    if (((dad_branch->partial_lh_computed & 1) && ((dad_branch->partial_lh_computed & 4) != 0) == float_partial_lh)
+        || node->isLeaf()) {
+        return mem_slots.reuse(dad_branch);
     }
 
     size_t num_leaves = 0;
@@ -5940,6 +6376,10 @@ bool PhyloTree::computeTraversalInfo(PhyloNeighbor *dad_branch, PhyloNode *dad,
         }
     }
     dad_branch->partial_lh_computed |= 1;
+    if (float_partial_lh)
+        dad_branch->partial_lh_computed |= 4;
+    else
+        dad_branch->partial_lh_computed &= ~4;
 
     // prepare information for this branch
     TraversalInfo info(dad_branch, dad);
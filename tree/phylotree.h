@@ -46,6 +46,7 @@
 #include "utils/checkpoint.h"
 #include "constrainttree.h"
 #include "memslot.h"
+#include "utils/mappedfile.h"
 #include "utils/progress.h"
 
 class AlignmentPairwise;
@@ -79,8 +80,18 @@ const double TOL_LIKELIHOOD_PARAMOPT = 0.001; // BQM: newly introduced for Model
 //#define LOG_SCALING_THRESHOLD log(SCALING_THRESHOLD)
 #define LOG_SCALING_THRESHOLD -177.4456782233459932741
 
+// scaling of partial likelihoods stored in single precision (--float-lh)
+#define SCALING_THRESHOLD_EXP_FLOAT 64
+// 2^{-64}
+#define SCALING_THRESHOLD_FLOAT 5.421010862427522170037e-20
+#define LOG_SCALING_THRESHOLD_FLOAT -44.36141955583649980270
+
 const int SPR_DEPTH = 2;
 
+/** pattern slices of --mpi-patterns are aligned to the widest vector of doubles (AVX-512),
+    so that they are the same for all likelihood kernels */
+const size_t PATTERN_SLICE_ALIGN = 8;
+
 //using namespace Eigen;
 
 #ifndef ROUND_UP_TO_MULTIPLE
@@ -603,6 +614,13 @@ public:
     typedef BootValType (PhyloTree::*DotProductType)(BootValType *x, BootValType *y, int size);
     DotProductType dotProduct;
 
+    /** dot product of x with 8-bit integer weights y, both padded to the vector size */
+    template <class Numeric, class VectorClass>
+    Numeric dotProductCountSIMD(Numeric *x, uint8_t *y, int size);
+
+    typedef BootValType (PhyloTree::*DotProductCountType)(BootValType *x, uint8_t *y, int size);
+    DotProductCountType dotProductCount;
+
     typedef double (PhyloTree::*DotProductDoubleType)(double *x, double *y, int size);
     DotProductDoubleType dotProductDouble;
 
@@ -675,6 +693,15 @@ public:
     void computePartialParsimonySankoffSIMD(PhyloNeighbor *dad_branch, PhyloNode *dad);
 
     void computeReversePartialParsimony(PhyloNode *node, PhyloNode *dad);
+    /**
+            collect the directed branches below dad_branch whose partial parsimony is not computed,
+            grouped by level: a branch of level k only depends on branches of levels < k
+            @param levels level of each branch visited so far
+            @param stale_levels (OUT) the branches and their dads, stale_levels[k-1] for level k
+            @return level of dad_branch, 0 if its partial parsimony is computed
+     */
+    int collectStalePartialPars(PhyloNeighbor *dad_branch, PhyloNode *dad, unordered_map<PhyloNeighbor*, int> &levels,
+        vector<vector<pair<PhyloNeighbor*, PhyloNode*> > > &stale_levels);
 
     typedef int (PhyloTree::*ComputeParsimonyBranchType)(PhyloNeighbor *, PhyloNode *, int *);
     ComputeParsimonyBranchType computeParsimonyBranchPointer;
@@ -694,6 +721,28 @@ public:
 
     template<class VectorClass>
     int computeParsimonyBranchSankoffSIMD(PhyloNeighbor *dad_branch, PhyloNode *dad, int *branch_subst = NULL);
+
+    typedef int (PhyloTree::*ComputeParsimonyInsertionType)(UINT *, UINT *, UINT *);
+    ComputeParsimonyInsertionType computeParsimonyInsertionPointer;
+
+    /**
+            compute the Fitch parsimony score of the tree after inserting a subtree into a branch,
+            without changing the tree, so that several threads can score different branches at once
+            @param node_pars partial_pars of the subtree on one side of the branch
+            @param dad_pars partial_pars of the subtree on the other side of the branch
+            @param subtree_pars partial_pars of the inserted subtree
+            @return parsimony score of the tree after the insertion
+     */
+    int computeParsimonyInsertionFast(UINT *node_pars, UINT *dad_pars, UINT *subtree_pars);
+    template<class VectorClass>
+    int computeParsimonyInsertionFastSIMD(UINT *node_pars, UINT *dad_pars, UINT *subtree_pars);
+
+    /**
+            build the Fitch bit vectors of all sequences with the current parsimony kernel,
+            to be shared by all trees on this alignment via shared_tip_pars
+            @return block of nseq*getBitsBlockSize() entries to be freed by the caller, NULL for Sankoff parsimony
+     */
+    UINT *newTipParsimony();
     
 //    void printParsimonyStates(PhyloNeighbor *dad_branch = NULL, PhyloNode *dad = NULL);
 
@@ -702,6 +751,7 @@ public:
     virtual void setParsimonyKernelAVX() {}
 #else
     virtual void setParsimonyKernelAVX();
+    void setParsimonyKernelAVX512();
 #endif
 
     virtual void setParsimonyKernelSSE();
@@ -767,6 +817,32 @@ public:
      */
     virtual void deleteAllPartialLh();
 
+    /**
+            allocate central_partial_lh, in a scratch file if params->lh_scratch_dir is set
+            @param entries number of doubles
+            @return the memory, NULL if it cannot be allocated
+     */
+    double *allocateCentralPartialLh(uint64_t entries);
+
+    /**
+            allocate central_scale_num, in a scratch file if params->lh_scratch_dir is set
+            @param entries number of UBYTEs
+            @return the memory, NULL if it cannot be allocated
+     */
+    UBYTE *allocateCentralScaleNum(uint64_t entries);
+
+    /**
+            de-allocate central_partial_lh and central_scale_num, allocated by the functions above
+     */
+    void freeCentralPartialLh();
+
+    /**
+            ask the OS to read from the scratch file the partial_lh and scale_num that
+            traversal_info is about to compute or read, see --lh-scratch
+            @param dad_branch, node_branch the branch whose likelihood is then computed
+     */
+    void prefetchPartialLh(PhyloNeighbor *dad_branch, PhyloNeighbor *node_branch);
+
     /**
             initialize partial_lh vector of all PhyloNeighbors, allocating central_partial_lh
             @param node the current node
@@ -801,6 +877,13 @@ public:
     size_t getPartialLhBytes();
     size_t getPartialLhSize();
 
+    /**
+            number of entries of partial_lh before the pattern slice of this MPI process (--mpi-patterns).
+            Only the slice is allocated and partial_lh points this far before it,
+            so that kernels index patterns from 0. partial_lh + getPartialLhOffset() is the allocated block.
+     */
+    size_t getPartialLhOffset();
+
     /**
             allocate memory for a scale num vector
      */
@@ -810,6 +893,17 @@ public:
     size_t getScaleNumBytes();
     size_t getScaleNumSize();
 
+    /** number of entries of scale_num before the pattern slice of this MPI process, see getPartialLhOffset() */
+    size_t getScaleNumOffset();
+
+    /**
+            patterns stored in partial likelihood and scale num vectors: all patterns
+            (with room for the unobserved patterns of +ASC), or the slice of this MPI process with --mpi-patterns
+            @param[out] ptn_lower first stored pattern
+            @return number of stored patterns
+     */
+    size_t getPartialLhPatterns(size_t &ptn_lower);
+
     /**
      * this stores partial_lh for each state at the leaves of the tree because they are the same between leaves
      * e.g. (1,0,0,0) for A,  (0,0,0,1) for T
@@ -818,6 +912,10 @@ public:
     int tip_partial_lh_computed;
     UINT *tip_partial_pars;
 
+    /** Fitch bit vectors of all sequences built by newTipParsimony() and copied into
+        the leaf branches instead of being rebuilt from the patterns; not owned by this tree */
+    UINT *shared_tip_pars;
+
     bool ptn_freq_computed;
 
     /** site log-likelihood buffer for robust phylogeny idea */
@@ -916,6 +1014,10 @@ public:
     template <class VectorClass, const bool SAFE_NUMERIC, const bool FMA = false, const bool SITE_MODEL = false>
     void computePartialLikelihoodGenericSIMD(TraversalInfo &info, size_t ptn_lower, size_t ptn_upper, int thread_id);
 
+    /** partial likelihood kernel storing vectors in single precision, see float_partial_lh */
+    template <class VectorClass, const int nstates, const bool FMA = false>
+    void computePartialLikelihoodFloatSIMD(TraversalInfo &info, size_t ptn_lower, size_t ptn_upper, int thread_id);
+
     /*
     template <class VectorClass, const int VCSIZE, const int nstates>
     void computeMixratePartialLikelihoodEigenSIMD(PhyloNeighbor *dad_branch, PhyloNode *dad = NULL);
@@ -931,6 +1033,23 @@ public:
             computing likelihood on a branch
      ****************************************************************************/
 
+    /**
+            compute the range of patterns whose likelihood this MPI process computes, see --mpi-patterns
+            @param nptn number of patterns, a multiple of vsize
+            @param vsize vector size of the kernel, a divisor of PATTERN_SLICE_ALIGN
+            @param[out] ptn_lower first pattern of this process
+            @param[out] ptn_upper end of the pattern range of this process
+     */
+    void getPatternSlice(size_t nptn, size_t vsize, size_t &ptn_lower, size_t &ptn_upper);
+
+    /**
+            collect per-pattern values computed by all MPI processes, see --mpi-patterns
+            @param[in,out] values nptn*width values, only the slice of this process is valid on input
+            @param nptn number of patterns
+            @param width number of values per pattern
+     */
+    void gatherPatternSlices(double *values, size_t nptn, size_t width = 1);
+
     /**
             compute tree likelihood on a branch. used to optimize branch length
             @param dad_branch the branch leading to the subtree
@@ -969,6 +1088,10 @@ public:
     template <class VectorClass, const bool SAFE_NUMERIC, const bool FMA = false, const bool SITE_MODEL = false>
     double computeLikelihoodBranchGenericSIMD(PhyloNeighbor *dad_branch, PhyloNode *dad);
 
+    /** branch likelihood kernel reading single precision vectors, see float_partial_lh */
+    template <class VectorClass, const int nstates, const bool FMA = false>
+    double computeLikelihoodBranchFloatSIMD(PhyloNeighbor *dad_branch, PhyloNode *dad);
+
     /*
     template <class VectorClass, const int VCSIZE, const int nstates>
     double computeMixrateLikelihoodBranchEigenSIMD(PhyloNeighbor *dad_branch, PhyloNode *dad);
@@ -1295,6 +1418,10 @@ public:
     template <class VectorClass, const bool SAFE_NUMERIC, const bool FMA = false, const bool SITE_MODEL = false>
     void computeLikelihoodBufferGenericSIMD(PhyloNeighbor *dad_branch, PhyloNode *dad, size_t ptn_lower, size_t ptn_upper, int thread_id);
 
+    /** compute theta_all from single precision vectors, see float_partial_lh */
+    template <class VectorClass, const int nstates, const bool FMA = false>
+    void computeLikelihoodBufferFloatSIMD(PhyloNeighbor *dad_branch, PhyloNode *dad, size_t ptn_lower, size_t ptn_upper, int thread_id);
+
 
     template <class VectorClass, const bool SAFE_NUMERIC, const int nstates, const bool FMA = false, const bool SITE_MODEL = false>
     void computeLikelihoodDervSIMD(PhyloNeighbor *dad_branch, PhyloNode *dad, double *df, double *ddf);
@@ -1527,6 +1654,24 @@ public:
 
     bool theta_computed;
 
+    /**
+        TRUE if the likelihood kernel stores partial likelihood vectors in single precision (--float-lh).
+        Vectors keep their double precision slots, bit 4 of partial_lh_computed tags single precision ones
+     */
+    bool float_partial_lh;
+
+    /** TRUE if single precision vectors were given up for this tree after numerical problems */
+    bool float_lh_disabled;
+
+    /** set by the single precision kernels if the result cannot be trusted */
+    bool float_lh_unstable;
+
+    /**
+        switch to double precision partial likelihood vectors for the rest of the run
+        @param reason why single precision is given up, printed as a warning
+     */
+    void disableFloatPartialLh(const char *reason);
+
     /**
      *	NSTATES x NUMCAT x (number of patterns) array
      *	Used to store precomputed values when optimizing branch length
@@ -1737,6 +1882,16 @@ public:
      */
     double computeObsDist(Params &params, Alignment *alignment, double* &dist_mat);
 
+    /**
+            compute the distance matrix into dist_lower (--dist-float), allocating it if necessary.
+            Pairs are computed in square tiles of sequences distributed over the threads;
+            no variance matrix is computed.
+            @param params program parameters
+            @param alignment input alignment
+            @return the longest distance
+     */
+    double computeDistLowerTriangle(Params &params, Alignment *alignment);
+
     /**
             correct the distances to follow metric property of triangle inequalities.
             Using the Floyd alogrithm.
@@ -1755,6 +1910,23 @@ public:
      */
     void computeBioNJ(Params &params);
 
+    /**
+            compute a start tree without the full distance matrix (-t PLACE):
+            a sample of representatives is joined, every other sequence goes with
+            its nearest representative, and the groups are resolved recursively;
+            only groups of at most params.place_block sequences get all pairwise distances
+            @param params program parameters
+     */
+    void computePlacementTree(Params &params);
+
+    /**
+            called by computePlacementTree to resolve one group of sequences
+            @param params program parameters
+            @param taxa IDs of the sequences (at least 3)
+            @return unrooted newick string (without ';') with sequence IDs as leaf names
+     */
+    string computePlacementNewick(Params &params, IntVector &taxa);
+
     /**
         called by fixNegativeBranch to fix one branch
         @param branch_length new branch length
@@ -1794,8 +1966,9 @@ public:
     // OBSOLETE: assignRandomBranchLengths no longer needed, use fixNegativeBranch instead!
 //    int assignRandomBranchLengths(bool force = false, Node *node = NULL, Node *dad = NULL);
 
-    /* compute Bayesian branch lengths based on ancestral sequence reconstruction */
-    void computeAllBayesianBranchLengths(Node *node = NULL, Node *dad = NULL);
+    /* compute Bayesian branch lengths based on ancestral sequence reconstruction,
+       recompute_lh: recompute partial likelihoods cleared when giving up single precision */
+    void computeAllBayesianBranchLengths(Node *node = NULL, Node *dad = NULL, bool recompute_lh = false);
 
     /**
         generate random tree
@@ -2060,6 +2233,13 @@ public:
      */
     double *var_matrix;
 
+    /**
+     * Lower triangle of the distance matrix in single precision (--dist-float),
+     * row by row without the diagonal: the distance between sequences i and j < i
+     * is at i*(i-1)/2 + j. NULL if dist_matrix is used instead.
+     */
+    float *dist_lower;
+
     /** distance matrix file */
     string dist_file;
     
@@ -2382,6 +2562,10 @@ protected:
     UBYTE *central_scale_num;
     UBYTE *nni_scale_num; // used for NNI functions
 
+    /** scratch files holding central_partial_lh and central_scale_num, if params->lh_scratch_dir is set */
+    ScratchMapping partial_lh_scratch;
+    ScratchMapping scale_num_scratch;
+
     /**
             the main memory storing all partial parsimony states for all neighbors of the tree.
             The variable partial_pars in PhyloNeighbor will be assigned to a region inside this variable.
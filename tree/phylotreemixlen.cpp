@@ -734,6 +734,12 @@ void PhyloTreeMixlen::computeFuncDerv(double value, double &df, double &ddf) {
     current_it_back->setLength(cur_mixture, value);
 
     (this->*computeLikelihoodDervMixlenPointer)(current_it, (PhyloNode*) current_it_back->node, df, ddf);
+    if (MPIHelper::getInstance().isPatternParallel()) {
+        double derv[2] = {df, ddf};
+        MPIHelper::getInstance().sumPatternSlices(derv, 2);
+        df = derv[0];
+        ddf = derv[1];
+    }
 
 	df = -df;
     ddf = -ddf;
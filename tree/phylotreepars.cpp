@@ -11,6 +11,10 @@
 //#include "vectorclass/vectorclass.h"
 #include "phylosupertree.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #if defined (__GNUC__) || defined(__clang__)
 #define vml_popcnt __builtin_popcount
 #else
@@ -52,6 +56,10 @@ void PhyloTree::computePartialParsimonyFast(PhyloNeighbor *dad_branch, PhyloNode
         memset(dad_branch->partial_pars, 255, pars_size*sizeof(UINT));
         size_t nsites = (aln->num_parsimony_sites+UINT_BITS-1)/UINT_BITS;
         dad_branch->partial_pars[nstates*nsites] = 0;
+    } else if (node->isLeaf() && dad && shared_tip_pars) {
+        // external node with bit vectors built once by newTipParsimony()
+        size_t pars_size = getBitsBlockSize();
+        memcpy(dad_branch->partial_pars, shared_tip_pars + node->id*pars_size, pars_size*sizeof(UINT));
     } else if (node->isLeaf() && dad) {
         // external node
         int leafid = node->id;
@@ -302,6 +310,56 @@ int PhyloTree::computeParsimonyBranchFast(PhyloNeighbor *dad_branch, PhyloNode *
     return score;
 }
 
+int PhyloTree::computeParsimonyInsertionFast(UINT *node_pars, UINT *dad_pars, UINT *subtree_pars) {
+    int nsites = (aln->num_parsimony_sites + UINT_BITS-1) / UINT_BITS;
+    int nstates = aln->getMaxNumStates();
+
+    int scoreid = nsites*nstates;
+    UINT score = node_pars[scoreid] + dad_pars[scoreid] + subtree_pars[scoreid];
+
+    for (int site = 0; site < nsites; ++site) {
+        size_t offset = nstates * site;
+        UINT *x = node_pars + offset;
+        UINT *y = dad_pars + offset;
+        UINT *t = subtree_pars + offset;
+        int i;
+        // substitutions between the two sides of the branch
+        UINT w = x[0] & y[0];
+        for (i = 1; i < nstates; i++)
+            w |= x[i] & y[i];
+        w = ~w;
+        // substitutions between the new internal node and the inserted subtree
+        UINT v = 0;
+        for (i = 0; i < nstates; i++)
+            v |= ((x[i] & y[i]) | (w & (x[i] | y[i]))) & t[i];
+        v = ~v;
+        score += vml_popcnt(w) + vml_popcnt(v);
+    }
+    return score;
+}
+
+UINT *PhyloTree::newTipParsimony() {
+    if (cost_matrix)
+        return NULL; // Sankoff kernel uses tip_partial_pars
+    size_t nseq = aln->getNSeq();
+    size_t pars_size = getBitsBlockSize();
+    UINT *tip_pars = aligned_alloc<UINT>(nseq*pars_size);
+    UINT *saved_tip_pars = shared_tip_pars;
+    shared_tip_pars = NULL;
+    // a leaf only needs a dad to be computed by the kernel
+    PhyloNode *dad = (PhyloNode*)newNode(nseq);
+    for (size_t i = 0; i < nseq; i++) {
+        PhyloNode *leaf = (PhyloNode*)newNode(i, aln->getSeqName(i).c_str());
+        PhyloNeighbor leaf_branch(leaf, -1.0);
+        leaf_branch.partial_pars = tip_pars + i*pars_size;
+        (this->*computePartialParsimonyPointer)(&leaf_branch, dad);
+        delete leaf;
+    }
+    delete dad;
+    shared_tip_pars = saved_tip_pars;
+    return tip_pars;
+}
+
 void PhyloTree::computeAllPartialPars(PhyloNode *node, PhyloNode *dad) {
 	if (!node) node = (PhyloNode*)root;
 	FOR_NEIGHBOR_IT(node, dad, it) {
@@ -1126,6 +1184,25 @@ void PhyloTree::insertNode2Branch(Node* added_node, Node* target_node, Node* tar
     ass_node->clearReversePartialLh((PhyloNode*)added_node);
 }
 
+int PhyloTree::collectStalePartialPars(PhyloNeighbor *dad_branch, PhyloNode *dad, unordered_map<PhyloNeighbor*, int> &levels,
+    vector<vector<pair<PhyloNeighbor*, PhyloNode*> > > &stale_levels)
+{
+    if (dad_branch->partial_lh_computed & 2)
+        return 0;
+    auto found = levels.find(dad_branch);
+    if (found != levels.end())
+        return found->second;
+    PhyloNode *node = (PhyloNode*)dad_branch->node;
+    int level = 1;
+    FOR_NEIGHBOR_IT(node, dad, it)
+        level = max(level, collectStalePartialPars((PhyloNeighbor*)(*it), node, levels, stale_levels) + 1);
+    levels[dad_branch] = level;
+    if (stale_levels.size() < level)
+        stale_levels.resize(level);
+    stale_levels[level-1].push_back(make_pair(dad_branch, dad));
+    return level;
+}
+
 int PhyloTree::computeParsimonyTree(const char *out_prefix, Alignment *alignment, int *rand_stream) {
     aln = alignment;
     size_t nseq = aln->getNSeq();
@@ -1214,13 +1291,60 @@ int PhyloTree::computeParsimonyTree(const char *out_prefix, Alignment *alignment
         added_node->addNeighbor((Node*) 1, -1.0);
         added_node->addNeighbor((Node*) 2, -1.0);
 
-        for (int nodeid = 0; nodeid < nodes1.size(); nodeid++) {
-        
-            int score = addTaxonMPFast(new_taxon, added_node, nodes1[nodeid], nodes2[nodeid]);
-            if (score < best_pars_score) {
-                best_pars_score = score;
-                target_node = (PhyloNode*)nodes1[nodeid];
-                target_dad = (PhyloNode*)nodes2[nodeid];
+        bool parallel_search = false;
+#ifdef _OPENMP
+        // score all branches in parallel if not already inside a parallel region
+        // (e.g. building several parsimony trees at once)
+        parallel_search = computeParsimonyInsertionPointer && num_threads > 1 && !omp_in_parallel() &&
+            nodes1.size() > num_threads*10;
+#endif
+        if (parallel_search) {
+            // compute all partial_pars first, the insertion scores then only read them
+            size_t nbranches = nodes1.size();
+            vector<UINT*> node_pars(nbranches), dad_pars(nbranches);
+            unordered_map<PhyloNeighbor*, int> levels;
+            vector<vector<pair<PhyloNeighbor*, PhyloNode*> > > stale_levels;
+            for (size_t nodeid = 0; nodeid < nbranches; nodeid++) {
+                PhyloNeighbor *node_nei = (PhyloNeighbor*)nodes2[nodeid]->findNeighbor(nodes1[nodeid]);
+                PhyloNeighbor *dad_nei = (PhyloNeighbor*)nodes1[nodeid]->findNeighbor(nodes2[nodeid]);
+                collectStalePartialPars(node_nei, (PhyloNode*)nodes2[nodeid], levels, stale_levels);
+                collectStalePartialPars(dad_nei, (PhyloNode*)nodes1[nodeid], levels, stale_levels);
+                node_pars[nodeid] = node_nei->partial_pars;
+                dad_pars[nodeid] = dad_nei->partial_pars;
+            }
+            PhyloNeighbor *subtree_nei = (PhyloNeighbor*)added_node->findNeighbor(new_taxon);
+            collectStalePartialPars(subtree_nei, added_node, levels, stale_levels);
+            // the branches of one level are independent; a single branch is left to the
+            // parallel loop over sites inside the kernel
+            for (auto &stale : stale_levels) {
+#ifdef _OPENMP
+                #pragma omp parallel for schedule(dynamic) num_threads(num_threads) if(stale.size() > 1)
+#endif
+                for (size_t i = 0; i < stale.size(); i++)
+                    computePartialParsimony(stale[i].first, stale[i].second);
+            }
+            UINT *subtree_pars = subtree_nei->partial_pars;
+            IntVector scores(nbranches);
+#ifdef _OPENMP
+            #pragma omp parallel for schedule(static) num_threads(num_threads)
+#endif
+            for (size_t nodeid = 0; nodeid < nbranches; nodeid++)
+                scores[nodeid] = (this->*computeParsimonyInsertionPointer)(node_pars[nodeid], dad_pars[nodeid], subtree_pars);
+            // take the first best branch as in the serial search
+            for (size_t nodeid = 0; nodeid < nbranches; nodeid++)
+                if (scores[nodeid] < best_pars_score) {
+                    best_pars_score = scores[nodeid];
+                    target_node = (PhyloNode*)nodes1[nodeid];
+                    target_dad = (PhyloNode*)nodes2[nodeid];
+                }
+        } else {
+            for (int nodeid = 0; nodeid < nodes1.size(); nodeid++) {
+                int score = addTaxonMPFast(new_taxon, added_node, nodes1[nodeid], nodes2[nodeid]);
+                if (score < best_pars_score) {
+                    best_pars_score = score;
+                    target_node = (PhyloNode*)nodes1[nodeid];
+                    target_dad = (PhyloNode*)nodes2[nodeid];
+                }
             }
         }
         
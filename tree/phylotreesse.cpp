@@ -34,6 +34,7 @@
 
 #include "model/modelmarkov.h"
 #include "model/modelset.h"
+#include "utils/MPIHelper.h"
 
 /* BQM: to ignore all-gapp subtree at an alignment site */
 //#define IGNORE_GAP_LH
@@ -58,8 +59,15 @@ void PhyloTree::setParsimonyKernel(LikelihoodKernel lk) {
         if (lk < LK_SSE2) {
             computeParsimonyBranchPointer = &PhyloTree::computeParsimonyBranchSankoff;
             computePartialParsimonyPointer = &PhyloTree::computePartialParsimonySankoff;
+            computeParsimonyInsertionPointer = NULL;
             return;
         }
+#ifdef __AVX512KNL
+        if (lk >= LK_AVX512) {
+            setParsimonyKernelAVX512();
+            return;
+        }
+#endif
         if (lk >= LK_AVX) {
             setParsimonyKernelAVX();
             return;
@@ -75,6 +83,7 @@ void PhyloTree::setParsimonyKernel(LikelihoodKernel lk) {
     if (lk < LK_SSE2) {
         computeParsimonyBranchPointer = &PhyloTree::computeParsimonyBranchFast;
         computePartialParsimonyPointer = &PhyloTree::computePartialParsimonyFast;
+        computeParsimonyInsertionPointer = &PhyloTree::computeParsimonyInsertionFast;
     	return;
     }
     if (lk >= LK_AVX) {
@@ -94,6 +103,16 @@ void PhyloTree::setLikelihoodKernel(LikelihoodKernel lk) {
     vector_size = 1;
     safe_numeric = (params && (params->lk_safe_scaling || leafNum >= params->numseq_safe_scaling)) ||
         (aln && aln->num_states != 4 && aln->num_states != 20);
+    // single precision partial likelihoods only for the plain reversible AVX-512 kernel
+#ifdef __AVX512KNL
+    float_partial_lh = params && params->float_lh && !float_lh_disabled && aln && !safe_numeric && lk >= LK_AVX512 &&
+        model_factory && model_factory->model->isReversible() && !params->kernel_nonrev &&
+        !model_factory->model->isSiteSpecificModel() && !model_factory->model->isMixture() && !isMixlen() &&
+        model_factory->getASC() == ASC_NONE && params->robust_phy_keep >= 1.0 && !params->robust_median &&
+        !MPIHelper::getInstance().isPatternParallel();
+#else
+    float_partial_lh = false;
+#endif
 
     //--- parsimony kernel ---
     setParsimonyKernel(lk);
@@ -119,6 +138,7 @@ void PhyloTree::setLikelihoodKernel(LikelihoodKernel lk) {
 //		dotProduct = &PhyloTree::dotProductSIMD<float, Vec1f>;
 #else
 		dotProduct = &PhyloTree::dotProductSIMD<double, Vec1d>;
+		dotProductCount = &PhyloTree::dotProductCountSIMD<double, Vec1d>;
 #endif
         dotProductDouble = &PhyloTree::dotProductSIMD<double, Vec1d>;
 #endif
@@ -213,26 +233,95 @@ void PhyloTree::computePartialLikelihood(TraversalInfo &info, size_t ptn_left, s
 	(this->*computePartialLikelihoodPointer)(info, ptn_left, ptn_right, packet_id);
 }
 
-double PhyloTree::computeLikelihoodBranch(PhyloNeighbor *dad_branch, PhyloNode *dad) {
-	return (this->*computeLikelihoodBranchPointer)(dad_branch, dad);
+void PhyloTree::getPatternSlice(size_t nptn, size_t vsize, size_t &ptn_lower, size_t &ptn_upper) {
+    MPIHelper &mpi = MPIHelper::getInstance();
+    ASSERT(PATTERN_SLICE_ALIGN % vsize == 0);
+    // the same slices for every vector size, as the partial likelihood vectors are allocated for them
+    size_t ngroups = (nptn+PATTERN_SLICE_ALIGN-1)/PATTERN_SLICE_ALIGN;
+    size_t nprocs = mpi.getNumPatternProcesses();
+    size_t proc = mpi.getPatternProcessID();
+    ptn_lower = min(ngroups*proc/nprocs*PATTERN_SLICE_ALIGN, nptn);
+    ptn_upper = min(ngroups*(proc+1)/nprocs*PATTERN_SLICE_ALIGN, nptn);
+}
+
+void PhyloTree::gatherPatternSlices(double *values, size_t nptn, size_t width) {
+    MPIHelper &mpi = MPIHelper::getInstance();
+    if (!mpi.isPatternParallel())
+        return;
+    // the slices of getPatternSlice(), cut at nptn
+    size_t ngroups = (nptn+PATTERN_SLICE_ALIGN-1)/PATTERN_SLICE_ALIGN;
+    size_t nprocs = mpi.getNumPatternProcesses();
+    vector<size_t> bounds(nprocs+1);
+    for (size_t proc = 0; proc <= nprocs; proc++)
+        bounds[proc] = min(ngroups*proc/nprocs*PATTERN_SLICE_ALIGN, nptn);
+    mpi.gatherPatternSlices(values, bounds, width);
+}
+
+void PhyloTree::disableFloatPartialLh(const char *reason) {
+    if (!float_partial_lh)
+        return;
+    outWarning(string(reason) + ", switching to double precision partial likelihoods");
+    float_lh_disabled = true;
+    float_lh_unstable = false;
+    setLikelihoodKernel(sse);
+    // all vectors are recomputed in double precision, but keep the current branch for the buffer
+    PhyloNeighbor *saved_it = current_it, *saved_it_back = current_it_back;
+    clearAllPartialLH();
+    current_it = saved_it;
+    current_it_back = saved_it_back;
+    theta_computed = false;
+}
 
+double PhyloTree::computeLikelihoodBranch(PhyloNeighbor *dad_branch, PhyloNode *dad) {
+	double tree_lh = (this->*computeLikelihoodBranchPointer)(dad_branch, dad);
+    if (float_lh_unstable) {
+        disableFloatPartialLh("Numerical underflow in single precision partial likelihoods");
+        tree_lh = (this->*computeLikelihoodBranchPointer)(dad_branch, dad);
+    }
+    if (MPIHelper::getInstance().isPatternParallel())
+        MPIHelper::getInstance().sumPatternSlices(&tree_lh, 1);
+    return tree_lh;
 }
 
 void PhyloTree::computeLikelihoodDerv(PhyloNeighbor *dad_branch, PhyloNode *dad, double *df, double *ddf) {
 	(this->*computeLikelihoodDervPointer)(dad_branch, dad, df, ddf);
+    if (float_lh_unstable) {
+        disableFloatPartialLh("Numerical underflow in single precision partial likelihoods");
+        (this->*computeLikelihoodDervPointer)(dad_branch, dad, df, ddf);
+    }
+    if (!MPIHelper::getInstance().isPatternParallel())
+        return;
+    if (isMixlen()) {
+        // df also holds the log-likelihood in its last entry
+        size_t nmixlen = getMixlen();
+        MPIHelper::getInstance().sumPatternSlices(df, nmixlen+1);
+        MPIHelper::getInstance().sumPatternSlices(ddf, nmixlen*nmixlen);
+    } else {
+        double derv[2] = {*df, *ddf};
+        MPIHelper::getInstance().sumPatternSlices(derv, 2);
+        *df = derv[0];
+        *ddf = derv[1];
+    }
 }
 
 
 double PhyloTree::computeLikelihoodFromBuffer() {
 	ASSERT(current_it && current_it_back);
 
+    double tree_lh;
     // TODO: buffer stuff for mixlen model
 	if (computeLikelihoodFromBufferPointer && optimize_by_newton)
-		return (this->*computeLikelihoodFromBufferPointer)();
+		tree_lh = (this->*computeLikelihoodFromBufferPointer)();
 	else {
-		return (this->*computeLikelihoodBranchPointer)(current_it, (PhyloNode*)current_it_back->node);
+		tree_lh = (this->*computeLikelihoodBranchPointer)(current_it, (PhyloNode*)current_it_back->node);
+        if (float_lh_unstable) {
+            disableFloatPartialLh("Numerical underflow in single precision partial likelihoods");
+            tree_lh = (this->*computeLikelihoodBranchPointer)(current_it, (PhyloNode*)current_it_back->node);
+        }
     }
-
+    if (MPIHelper::getInstance().isPatternParallel())
+        MPIHelper::getInstance().sumPatternSlices(&tree_lh, 1);
+    return tree_lh;
 }
 
 double PhyloTree::dotProductDoubleCall(double *x, double *y, int size) {
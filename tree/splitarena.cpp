@@ -0,0 +1,194 @@
+/*
+ * splitarena.cpp
+ *
+ * Bit-packed storage of the splits of many trees, for computing
+ * Robinson-Foulds distances between large tree sets
+ */
+
+#include "splitarena.h"
+#include "mtreeset.h"
+#include "pda/splitgraph.h"
+
+/** number of trees per side of the square tiles in computeRFDistBlock */
+const int RF_TILE_SIZE = 32;
+
+/** finalizer of splitmix64, spreads the bits of the word hash */
+static inline uint64_t mixHash(uint64_t h) {
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+/** packed splits of one tree before they are copied into the arena */
+struct PackedTreeSplits {
+    vector<uint64_t> words;
+    vector<uint64_t> hashes;
+    vector<char> counted;
+};
+
+SplitArena::SplitArena(MTreeSet &trees, double weight_threshold, MTree *taxa_tree) {
+    ASSERT(!trees.empty());
+    if (!taxa_tree)
+        taxa_tree = trees.front();
+    ntaxa = taxa_tree->leafNum;
+    nwords = (ntaxa + 63) / 64;
+    int ntrees = trees.size();
+
+    vector<string> taxname(ntaxa);
+    taxa_tree->getTaxaName(taxname);
+
+    vector<PackedTreeSplits> packed(ntrees);
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for (int id = 0; id < ntrees; id++) {
+        ASSERT(trees[id]->leafNum == ntaxa);
+        SplitGraph sg;
+        trees[id]->convertSplits(taxname, sg);
+
+        // pack the non-trivial splits, normalised to contain taxon 0
+        int nsplits = 0;
+        vector<uint64_t> tree_words;
+        vector<uint64_t> tree_hashes;
+        vector<char> tree_counted;
+        vector<uint64_t> split_words(nwords);
+        uint64_t last_mask = (ntaxa % 64) ? ((1ULL << (ntaxa % 64)) - 1) : ~0ULL;
+        for (SplitGraph::iterator sit = sg.begin(); sit != sg.end(); sit++) {
+            Split *sp = *sit;
+            int ntaxa_in_split = sp->countTaxa();
+            if (ntaxa_in_split <= 1 || ntaxa_in_split >= ntaxa - 1)
+                continue;
+            for (int w = 0; w < nwords; w++) {
+                uint64_t lo = (2*w < (int)sp->size()) ? (*sp)[2*w] : 0;
+                uint64_t hi = (2*w+1 < (int)sp->size()) ? (*sp)[2*w+1] : 0;
+                split_words[w] = lo | (hi << 32);
+            }
+            if (!(split_words[0] & 1)) {
+                for (int w = 0; w < nwords; w++)
+                    split_words[w] = ~split_words[w];
+                split_words[nwords-1] &= last_mask;
+            }
+            uint64_t hash = 0;
+            for (int w = 0; w < nwords; w++)
+                hash = mixHash(hash ^ split_words[w]);
+            tree_words.insert(tree_words.end(), split_words.begin(), split_words.end());
+            tree_hashes.push_back(hash);
+            tree_counted.push_back(sp->getWeight() >= weight_threshold);
+            nsplits++;
+        }
+
+        // sort the splits of the tree by hash
+        IntVector order(nsplits);
+        for (int i = 0; i < nsplits; i++)
+            order[i] = i;
+        sort(order.begin(), order.end(), [&](int a, int b) { return tree_hashes[a] < tree_hashes[b]; });
+        PackedTreeSplits &tree_packed = packed[id];
+        tree_packed.words.resize((size_t)nsplits * nwords);
+        tree_packed.hashes.resize(nsplits);
+        tree_packed.counted.resize(nsplits);
+        for (int i = 0; i < nsplits; i++) {
+            copy(tree_words.begin() + (size_t)order[i]*nwords, tree_words.begin() + (size_t)(order[i]+1)*nwords,
+                tree_packed.words.begin() + (size_t)i*nwords);
+            tree_packed.hashes[i] = tree_hashes[order[i]];
+            tree_packed.counted[i] = tree_counted[order[i]];
+        }
+    }
+
+    // move all trees into the contiguous arena
+    tree_start.resize(ntrees + 1);
+    tree_start[0] = 0;
+    for (int id = 0; id < ntrees; id++)
+        tree_start[id+1] = tree_start[id] + packed[id].hashes.size();
+    words.resize(tree_start[ntrees] * nwords);
+    hashes.resize(tree_start[ntrees]);
+    counted.resize(tree_start[ntrees]);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (int id = 0; id < ntrees; id++) {
+        copy(packed[id].words.begin(), packed[id].words.end(), words.begin() + tree_start[id]*nwords);
+        copy(packed[id].hashes.begin(), packed[id].hashes.end(), hashes.begin() + tree_start[id]);
+        copy(packed[id].counted.begin(), packed[id].counted.end(), counted.begin() + tree_start[id]);
+        vector<uint64_t>().swap(packed[id].words);
+    }
+}
+
+bool SplitArena::equalSplit(size_t i, const SplitArena &other, size_t j) const {
+    const uint64_t *a = &words[i*nwords];
+    const uint64_t *b = &other.words[j*nwords];
+    uint64_t diff = 0;
+    // no early exit, so that the loop is vectorised
+    for (int w = 0; w < nwords; w++)
+        diff |= a[w] ^ b[w];
+    return diff == 0;
+}
+
+double SplitArena::computeRFDist(int tree, const SplitArena &other, int tree2, bool normalize) const {
+    ASSERT(other.ntaxa == ntaxa);
+    size_t i = tree_start[tree], iend = tree_start[tree+1];
+    size_t j = other.tree_start[tree2], jend = other.tree_start[tree2+1];
+    int ncounted = 0, ncounted2 = 0;
+    for (size_t k = i; k < iend; k++)
+        ncounted += counted[k];
+    for (size_t k = j; k < jend; k++)
+        ncounted2 += other.counted[k];
+
+    // merge the two sorted hash lists; runs of equal hashes are checked split by split
+    int common = 0, common2 = 0;
+    while (i < iend && j < jend) {
+        uint64_t hash = hashes[i], hash2 = other.hashes[j];
+        if (hash < hash2) {
+            i++;
+        } else if (hash > hash2) {
+            j++;
+        } else {
+            for (size_t k = j; k < jend && other.hashes[k] == hash; k++)
+                if (equalSplit(i, other, k)) {
+                    common += counted[i];
+                    common2 += other.counted[k];
+                    break;
+                }
+            i++;
+        }
+    }
+    double rf_val = (ncounted - common) + (ncounted2 - common2);
+    if (normalize)
+        rf_val /= (iend - tree_start[tree]) + (jend - other.tree_start[tree2]);
+    return rf_val;
+}
+
+void SplitArena::computeRFDistBlock(int row_start, int row_end, const SplitArena &other,
+    double *rfdist, bool normalize) const
+{
+    int nrows = row_end - row_start;
+    int ncols = other.getNTrees();
+    int nrow_tiles = (nrows + RF_TILE_SIZE - 1) / RF_TILE_SIZE;
+    int ncol_tiles = (ncols + RF_TILE_SIZE - 1) / RF_TILE_SIZE;
+    bool symmetric = (&other == this);
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for (int tile = 0; tile < nrow_tiles * ncol_tiles; tile++) {
+        int row_begin = row_start + (tile / ncol_tiles) * RF_TILE_SIZE;
+        int col_begin = (tile % ncol_tiles) * RF_TILE_SIZE;
+        int row_stop = min(row_begin + RF_TILE_SIZE, row_end);
+        int col_stop = min(col_begin + RF_TILE_SIZE, ncols);
+        for (int row = row_begin; row < row_stop; row++)
+            for (int col = col_begin; col < col_stop; col++) {
+                // the lower triangle within the block is filled from the upper one below
+                if (symmetric && col < row && col >= row_start)
+                    continue;
+                rfdist[(size_t)(row - row_start)*ncols + col] = computeRFDist(row, other, col, normalize);
+            }
+    }
+    if (!symmetric)
+        return;
+    for (int row = row_start; row < row_end; row++)
+        for (int col = row_start; col < row; col++)
+            rfdist[(size_t)(row - row_start)*ncols + col] = rfdist[(size_t)(col - row_start)*ncols + row];
+}
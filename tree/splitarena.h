@@ -0,0 +1,105 @@
+/*
+ * splitarena.h
+ *
+ * Bit-packed storage of the splits of many trees, for computing
+ * Robinson-Foulds distances between large tree sets
+ */
+
+#ifndef SPLITARENA_H
+#define SPLITARENA_H
+
+#include "utils/tools.h"
+#include <stdint.h>
+
+class MTreeSet;
+class MTree;
+
+/**
+    Splits of all trees of a tree set, stored in one contiguous arena instead of
+    one heap-allocated Split per branch. Every split is normalised to contain
+    taxon 0 and packed into nwords 64-bit words, with a 64-bit hash. The splits
+    of each tree are sorted by hash, so two trees are compared by one linear
+    merge of their hash lists; equal hashes are confirmed on the packed words.
+    Trivial splits are not stored as they are shared by all trees with the same
+    taxon set and cancel out in the distance.
+*/
+class SplitArena {
+public:
+
+    /**
+        convert all trees of a tree set into packed splits, trees in parallel
+        @param trees tree set with consistent taxon IDs (see MTreeSet::checkConsistency)
+        @param weight_threshold splits with weight (branch length) below this
+            are not counted when they are missing from the other tree
+        @param taxa_tree tree defining the taxon order, the first tree of trees by default;
+            give the first tree of the other set when two tree sets are compared
+    */
+    SplitArena(MTreeSet &trees, double weight_threshold = -1000, MTree *taxa_tree = NULL);
+
+    /**
+        @return number of trees
+    */
+    int getNTrees() const { return tree_start.size() - 1; }
+
+    /**
+        @return number of taxa
+    */
+    int getNTaxa() const { return ntaxa; }
+
+    /**
+        @return number of non-trivial splits of a tree
+        @param tree tree ID
+    */
+    int getNSplits(int tree) const { return tree_start[tree+1] - tree_start[tree]; }
+
+    /**
+        @return Robinson-Foulds distance between a tree of this arena and a tree of another arena
+        @param tree tree ID in this arena
+        @param other arena of the second tree, may be this arena
+        @param tree2 tree ID in other
+        @param normalize true to divide by the total number of non-trivial splits
+    */
+    double computeRFDist(int tree, const SplitArena &other, int tree2, bool normalize = false) const;
+
+    /**
+        compute the Robinson-Foulds distances between a block of trees of this arena
+        and all trees of another arena. The block is cut into square tiles of trees
+        distributed over OpenMP threads, so that the splits of a tile stay in cache.
+        If other is this arena, pairs within the block are computed only once.
+        @param row_start first tree of the block
+        @param row_end one past the last tree of the block
+        @param other arena of the column trees, may be this arena
+        @param[out] rfdist (row_end-row_start) x other.getNTrees() matrix, row-major
+        @param normalize true to divide by the total number of non-trivial splits
+    */
+    void computeRFDistBlock(int row_start, int row_end, const SplitArena &other,
+        double *rfdist, bool normalize = false) const;
+
+protected:
+
+    /**
+        @return true if split i of this arena and split j of other have the same taxa
+    */
+    bool equalSplit(size_t i, const SplitArena &other, size_t j) const;
+
+    /** number of taxa */
+    int ntaxa;
+
+    /** number of 64-bit words per split */
+    int nwords;
+
+    /** packed splits of all trees, nwords words per split, one tree after another */
+    vector<uint64_t> words;
+
+    /** hash of every split, sorted within each tree */
+    vector<uint64_t> hashes;
+
+    /** 1 if a split is counted when missing from the other tree (its weight passes the threshold) */
+    vector<char> counted;
+
+    /** index of the first split of every tree, followed by the total number of splits */
+    vector<size_t> tree_start;
+
+};
+
+#endif
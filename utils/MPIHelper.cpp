@@ -4,6 +4,9 @@
 
 #include "MPIHelper.h"
 #include "timeutil.h"
+#ifdef _IQTREE_MPI
+#include <unistd.h>
+#endif
 
 /**
  *  Initialize the single getInstance of MPIHelper
@@ -36,6 +39,14 @@ void MPIHelper::init(int argc, char *argv[]) {
 
 void MPIHelper::finalize() {
 #ifdef _IQTREE_MPI
+    if (!patternOutputDir.empty()) {
+        // remove the duplicate output files of this process
+        StrVector filenames;
+        getFilesInDir(patternOutputDir.c_str(), filenames);
+        for (auto &filename : filenames)
+            remove((patternOutputDir + "/" + filename).c_str());
+        rmdir(patternOutputDir.c_str());
+    }
     MPI_Finalize();
 #endif
 }
@@ -56,6 +67,77 @@ void MPIHelper::syncRandomSeed() {
 #endif
 }
 
+void MPIHelper::initPatternParallel() {
+#ifdef _IQTREE_MPI
+    Params &params = Params::getInstance();
+    if (getNumProcesses() == 1)
+        return;
+    // all processes must take the same decisions, which rules out anything
+    // depending on timing or on per-pattern values outside the own slice
+    if (params.partition_file)
+        outError("--mpi-patterns does not support partition models, please use a concatenated alignment");
+    if (params.num_threads == 0)
+        outError("--mpi-patterns does not support -T AUTO, please specify the number of threads");
+    if (params.stop_condition == SC_REAL_TIME)
+        outError("--mpi-patterns does not support -maxtime");
+    if (params.pll)
+        outError("--mpi-patterns does not support -pll");
+    if (params.robust_phy_keep < 1.0 || params.robust_median)
+        outError("--mpi-patterns does not support robust phylogeny");
+    if (params.print_ancestral_sequence != AST_NONE || params.ancestral_site_concordance)
+        outError("--mpi-patterns does not support ancestral sequence reconstruction");
+    // these read partial likelihoods of all patterns, but each process only holds its slice
+    if (params.bayes_branch_length)
+        outError("--mpi-patterns does not support Bayesian branch lengths");
+    if (params.tree_spr)
+        outError("--mpi-patterns does not support the SPR search");
+
+    numPatternProcesses = getNumProcesses();
+    patternProcessID = getProcessID();
+    // from now on every process behaves as the master of a single-process run
+    setNumProcesses(1);
+    setProcessID(PROC_MASTER);
+
+    if (patternProcessID > 0) {
+        // redirect the output files of other processes, they duplicate those of the first process
+        const char *tmp = getenv("TMPDIR");
+        string templ = string(tmp ? tmp : "/tmp") + "/iqtree_rank" + convertIntToString(patternProcessID) + "_XXXXXX";
+        vector<char> path(templ.begin(), templ.end());
+        path.push_back(0);
+        if (mkdtemp(path.data()) == NULL)
+            outError("Cannot create output directory ", templ);
+        patternOutputDir = path.data();
+        string prefix = params.out_prefix;
+        size_t pos = prefix.find_last_of("/\\");
+        if (pos != string::npos)
+            prefix = prefix.substr(pos+1);
+        patternOutputPrefix = patternOutputDir + "/" + prefix;
+        params.out_prefix = (char*)patternOutputPrefix.c_str();
+    }
+#endif
+}
+
+void MPIHelper::sumPatternSlices(double *values, int size) {
+#ifdef _IQTREE_MPI
+    MPI_Allreduce(MPI_IN_PLACE, values, size, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+#endif
+}
+
+void MPIHelper::gatherPatternSlices(double *values, const vector<size_t> &bounds, int width) {
+#ifdef _IQTREE_MPI
+    vector<int> counts(numPatternProcesses), displs(numPatternProcesses);
+    for (int i = 0; i < numPatternProcesses; i++) {
+        counts[i] = bounds[i+1] - bounds[i];
+        displs[i] = bounds[i];
+    }
+    MPI_Datatype pattern_type;
+    MPI_Type_contiguous(width, MPI_DOUBLE, &pattern_type);
+    MPI_Type_commit(&pattern_type);
+    MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, values, counts.data(), displs.data(), pattern_type, MPI_COMM_WORLD);
+    MPI_Type_free(&pattern_type);
+#endif
+}
+
 int MPIHelper::countSameHost() {
 #ifdef _IQTREE_MPI
     // detect if processes are in the same host
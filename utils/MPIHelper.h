@@ -90,6 +90,46 @@ public:
 
     /** synchronize random seed from master to all workers */
     void syncRandomSeed();
+
+    /**
+        switch to pattern-parallel mode (--mpi-patterns): every process runs the same
+        analysis as a single process would, but computes the likelihood only for its
+        slice of site patterns. Only the first process prints and writes output files.
+    */
+    void initPatternParallel();
+
+    /** @return TRUE if site patterns are split across processes, see --mpi-patterns */
+    bool isPatternParallel() const {
+        return numPatternProcesses > 1;
+    }
+
+    int getNumPatternProcesses() const {
+        return numPatternProcesses;
+    }
+
+    int getPatternProcessID() const {
+        return patternProcessID;
+    }
+
+    /** @return TRUE if this process prints to screen and log file */
+    bool isOutputProcess() const {
+        return isMaster() && patternProcessID == 0;
+    }
+
+    /**
+        wrapper for MPI_Allreduce to sum values over the pattern slices of all processes
+        @param[in,out] values values of this process, replaced by the sums
+        @param size number of values
+    */
+    void sumPatternSlices(double *values, int size);
+
+    /**
+        wrapper for MPI_Allgatherv to collect per-pattern values from all processes
+        @param[in,out] values values of all patterns, only those of this process are valid on input
+        @param bounds pattern slice of each process, process i has [bounds[i], bounds[i+1])
+        @param width number of values per pattern
+    */
+    void gatherPatternSlices(double *values, const vector<size_t> &bounds, int width);
     
     /** count the number of host with the same name as the current host */
     int countSameHost();
@@ -157,7 +197,7 @@ private:
     int cleanUpMessages();
 
 private:
-    MPIHelper() { }; // Disable constructor
+    MPIHelper() : numPatternProcesses(1), patternProcessID(0) { }; // Disable constructor
     MPIHelper(MPIHelper const &) { }; // Disable copy constructor
     void operator=(MPIHelper const &) { }; // Disable assignment
 
@@ -165,6 +205,18 @@ private:
 
     int numProcesses;
 
+    /** number of processes sharing the site patterns, see --mpi-patterns */
+    int numPatternProcesses;
+
+    /** rank of this process among those sharing the site patterns */
+    int patternProcessID;
+
+    /** directory of the output files of non-first processes in pattern-parallel mode */
+    string patternOutputDir;
+
+    /** output prefix of non-first processes in pattern-parallel mode */
+    string patternOutputPrefix;
+
 public:
     int getNumTreeReceived() const {
         return numTreeReceived;
@@ -83,9 +83,13 @@
 #include <vector>                    //for std::vector
 #include <string>                    //sequence names stored as std::string
 #include <fstream>
+#include <sstream>                   //for std::stringstream
 #include <iostream>                  //for std::istream
 #include <vectorclass/vectorclass.h> //for Vec4d and Vec4db vector classes
 #include "progress.h"                //for progress_display
+#ifdef _OPENMP
+#include <omp.h>                     //for omp_get_thread_num
+#endif
 
 typedef float   NJFloat;
 typedef Vec8f   FloatVector;
@@ -108,7 +112,7 @@ public:
     size_t  imbalance;
     Position() : row(0), column(0), value(0), imbalance(0) {}
     Position(size_t r, size_t c, T v, size_t imbalance)
-        : row(r), column(c), value(v) {}
+        : row(r), column(c), value(v), imbalance(imbalance) {}
     Position& operator = (const Position &rhs) {
         row       = rhs.row;
         column    = rhs.column;
@@ -193,6 +197,15 @@ public:
         cluster.countOfExteriorNodes += at(c).countOfExteriorNodes;
         return cluster;
     }
+    template <class F> static void openTreeOutput(F& out, const std::string &treeFilePath) {
+        out.open(treeFilePath.c_str(), std::ios_base::out);
+    }
+    template <class F> static void closeTreeOutput(F& out) {
+        out.close();
+    }
+    //newick strings are written in memory, there is no file to open or close
+    static void openTreeOutput(std::stringstream& out, const std::string &treeFilePath) {}
+    static void closeTreeOutput(std::stringstream& out) {}
     template <class F> bool writeTreeToFile(const std::string &treeFilePath, F& out) const {
         struct Place
         {
@@ -211,7 +224,7 @@ public:
         
         out.exceptions(std::ios::failbit | std::ios::badbit);
         try {
-            out.open(treeFilePath.c_str(), std::ios_base::out);
+            openTreeOutput(out, treeFilePath);
             out.precision(8);
             
             std::vector<Place> stack;
@@ -255,7 +268,7 @@ public:
                 }
             } while (0 < stack.size());
             out << ";" << std::endl;
-            out.close();
+            closeTreeOutput(out);
             return true;
         } catch (std::ios::failure &) {
             std::cerr << "IO error"
@@ -475,13 +488,21 @@ public:
             //Move the data in the array closer to the front.
             //This also helps (but: only very slightly. 5%ish?).
             size_t   w = widthNeededFor(n);
-            T* destRow = data;
+            T* destRow = matrixAlign(data); //where rows[0] starts
             for (size_t r=1; r<n; ++r) {
                 destRow += w;
                 const T* sourceRow = rows[r];
-                #pragma omp parallel for
-                for (size_t c=0; c<n; ++c) {
-                    destRow[c] = sourceRow[c];
+                if (sourceRow < destRow + n) {
+                    //Overlapping: the copy has to go front to back,
+                    //so it can't be split between threads.
+                    for (size_t c=0; c<n; ++c) {
+                        destRow[c] = sourceRow[c];
+                    }
+                } else {
+                    #pragma omp parallel for
+                    for (size_t c=0; c<n; ++c) {
+                        destRow[c] = sourceRow[c];
+                    }
                 }
                 rows[r] = destRow;
             }
@@ -587,6 +608,37 @@ public:
         calculateRowTotals();
         return true;
     }
+    virtual bool loadMatrixFromLowerTriangle(const std::vector<std::string>& names,
+                                             const float* lowerTriangle) {
+        //Assumptions: as for loadMatrix, but only the distances below
+        //  the diagonal are given, row by row: the distance between
+        //  taxon row and taxon col<row is lowerTriangle[row*(row-1)/2+col].
+        //  Each row is filled by one thread, reading its upper part
+        //  down the column of the triangle.
+        setSize(names.size());
+        clusters.clear();
+        for (auto it = names.begin(); it != names.end(); ++it) {
+            clusters.addCluster(*it);
+        }
+        rowToCluster.resize(n, 0);
+        for (size_t r=0; r<n; ++r) {
+            rowToCluster[r]=r;
+        }
+        #pragma omp parallel for
+        for (size_t row=0; row<n; ++row) {
+            const float* source = lowerTriangle + row*(row-1)/2;
+            T*           dest   = rows[row];
+            for (size_t col=0; col<row; ++col) {
+                dest[col] = (T) source[col];
+            }
+            dest[row] = 0;
+            for (size_t col=row+1; col<n; ++col) {
+                dest[col] = (T) lowerTriangle[col*(col-1)/2+row]; //U-R
+            }
+        }
+        calculateRowTotals();
+        return true;
+    }
     virtual bool constructTree() {
         Position<T> best;
         std::string taskName = "Constructing " + getAlgorithmName() + " tree";
@@ -606,12 +658,20 @@ public:
     bool writeTreeFile(const std::string &treeFilePath) const {
         return clusters.writeTreeFile(isOutputToBeZipped, treeFilePath);
     }
+    bool writeTreeString(std::string &newick) const {
+        std::stringstream out;
+        if (!clusters.writeTreeToFile("newick string", out)) {
+            return false;
+        }
+        newick = out.str();
+        return true;
+    }
 protected:
     virtual void setSize(size_t rank) {
         super::setSize(rank);
         rowToCluster.clear();
     }
-    void getMinimumEntry(Position<T> &best) {
+    virtual void getMinimumEntry(Position<T> &best) {
         getRowMinima();
         best.value = infiniteDistance;
         for (size_t r=0; r<n; ++r) {
@@ -670,6 +730,7 @@ protected:
         size_t tCount  = aCount + bCount;
         double lambda  = (double)aCount / (double)tCount;
         double mu      = 1.0 - lambda;
+        #pragma omp parallel for
         for (size_t i=0; i<n; ++i) {
             if (i!=a && i!=b) {
                 T Dai      = rows[a][i];
@@ -836,6 +897,12 @@ public:
         variance = *this;
         return rc;
     }
+    virtual bool loadMatrixFromLowerTriangle(const std::vector<std::string>& names,
+                                             const float* lowerTriangle) {
+        bool rc = super::loadMatrixFromLowerTriangle(names, lowerTriangle);
+        variance = *this;
+        return rc;
+    }
     inline T chooseLambda(size_t a, size_t b, T Vab) {
         //Assumed 0<=a<b<n
         T lambda = 0;
@@ -902,6 +969,7 @@ public:
 template <class T=NJFloat, class super=BIONJMatrix<T>>
 class BoundingMatrix: public super
 {
+protected:
     using super::n;
     using super::rows;
     using super::rowMinima;
@@ -992,7 +1060,7 @@ public:
             progress_display show_progress(n*(n+1)/2, taskName.c_str(), "", "");
             while (3<n) {
                 Position<T> best;
-                super::getMinimumEntry(best);
+                this->getMinimumEntry(best);
                 cluster(best.column, best.row);
                 if ( n == nextPurge ) {
                     #pragma omp parallel for
@@ -1087,6 +1155,7 @@ public:
         entryToCluster.removeRowOnly(b);
         
         //Recalculate cluster totals.
+        #pragma omp parallel for
         for (size_t wipe = 0; wipe<clusterC; ++wipe) {
             clusterTotals[wipe] = -infiniteDistance;
             //A trick.  This way we don't need to check if clusters
@@ -1098,6 +1167,7 @@ public:
             //when calculating entries in Q, if clusters are still
             //"live" (have corresponding rows in the D matrix).
         }
+        #pragma omp parallel for
         for (size_t r = 0; r<n; ++r) {
             size_t cluster = rowToCluster[r];
             clusterTotals[cluster] = rowTotals[r];
@@ -1161,7 +1231,7 @@ public:
             w += ( rowOrderChosen[r] ? 0 : 1 );
         }
     }
-    virtual void getRowMinima() const {
+    void calculateScaledClusterTotals() const {
         //
         //Note: Rather than multiplying distances by (n-2)
         //      repeatedly, it is cheaper to work with cluster
@@ -1183,6 +1253,9 @@ public:
                 }
             }
         }
+    }
+    virtual void getRowMinima() const {
+        calculateScaledClusterTotals();
         T qBest = infiniteDistance;
             //upper bound on minimum Q[row,col]
             //  = D[row,col] - R[row]*tMultipler - R[col]*tMultiplier
@@ -1255,6 +1328,7 @@ template <class T=NJFloat, class super=BIONJMatrix<T>, class V=FloatVector, clas
     //      It can subclass either NJMatrix or BIONJMatrix.
     //      It cannot subclass UPGMA_Matrix.
     //
+protected:
     using super::n;
     using super::rows;
     using super::rowMinima;
@@ -1395,10 +1469,172 @@ public:
     }
 };
 
+template <class T=NJFloat, class super=NJMatrix<T>>
+class ParallelMatrix: public super
+{
+    //
+    //Note: selects the pair of rows to join with one best candidate
+    //      per thread (each thread looks at a share of the row minima).
+    //      The candidates are then merged in (value, row, column) order,
+    //      so that which of several equally good joins is chosen
+    //      doesn't depend on the order in which the rows were scanned,
+    //      or on the number of threads.
+    //
+protected:
+    using super::n;
+    using super::rowMinima;
+public:
+    ParallelMatrix() : super() {
+    }
+    virtual std::string getAlgorithmName() const {
+        return "Parallel-" + super::getAlgorithmName();
+    }
+protected:
+    static bool isBetterJoin(const Position<T>& here, const Position<T>& best) {
+        if (here.row == here.column || infiniteDistance <= here.value) {
+            return false;
+        }
+        if (here.value != best.value) {
+            return here.value < best.value;
+        }
+        if (here.row != best.row) {
+            return here.row < best.row;
+        }
+        return here.column < best.column;
+    }
+    virtual void getMinimumEntry(Position<T> &best) {
+        this->getRowMinima();
+        #ifdef _OPENMP
+            int threadCount = omp_get_max_threads();
+        #else
+            int threadCount = 1;
+        #endif
+        std::vector< Position<T> > threadBest(threadCount, Position<T>(0, 0, infiniteDistance, 0));
+        #pragma omp parallel for
+        for (size_t r=0; r<n; ++r) {
+            #ifdef _OPENMP
+                int t = omp_get_thread_num();
+            #else
+                int t = 0;
+            #endif
+            if (isBetterJoin(rowMinima[r], threadBest[t])) {
+                threadBest[t] = rowMinima[r];
+            }
+        }
+        best = Position<T>(0, 0, infiniteDistance, 0);
+        for (int t=0; t<threadCount; ++t) {
+            if (isBetterJoin(threadBest[t], best)) {
+                best = threadBest[t];
+            }
+        }
+    }
+};
+
+template <class T=NJFloat, class super=BIONJMatrix<T>>
+class ParallelBoundingMatrix: public ParallelMatrix<T, BoundingMatrix<T, super>>
+{
+    //
+    //Note: BoundingMatrix::getRowMinima shares one bound (qBest) between
+    //      all the threads, so which rows get cut short (and which of
+    //      several equally good joins is found) depends on thread timing.
+    //      Here, each thread keeps its own bound (seeded from the
+    //      first row in the scan order), and ties are kept if they
+    //      have a lower (row, column), so every row that could hold
+    //      the best join reports it, whatever the number of threads.
+    //
+    typedef ParallelMatrix<T, BoundingMatrix<T, super>> parent;
+    using parent::n;
+    using parent::rowMinima;
+    using parent::rowTotals;
+    using parent::rowToCluster;
+    using parent::clusterToRow;
+    using parent::scaledClusterTotals;
+    using parent::scaledMaxEarlierClusterTotal;
+    using parent::rowScanOrder;
+    using parent::entriesSorted;
+    using parent::entryToCluster;
+public:
+    ParallelBoundingMatrix() : parent() {
+    }
+protected:
+    virtual void getRowMinima() const {
+        this->calculateScaledClusterTotals();
+        this->decideOnRowScanningOrder();
+        rowMinima.resize(n);
+        if (n==0) {
+            return;
+        }
+        size_t firstRow = rowScanOrder[0];
+        rowMinima[0]    = getRowMinimumWithTies
+                          ( firstRow
+                          , scaledMaxEarlierClusterTotal[rowToCluster[firstRow]]
+                          , infiniteDistance );
+        T qStart = rowMinima[0].value;
+        #pragma omp parallel
+        {
+            T qBest = qStart; //this thread's upper bound on minimum Q[row,col]
+            #pragma omp for schedule(static,1)
+            for (size_t r=1; r<n; ++r) {
+                size_t row     = rowScanOrder[r];
+                size_t cluster = rowToCluster[row];
+                rowMinima[r]   = getRowMinimumWithTies
+                                 ( row, scaledMaxEarlierClusterTotal[cluster], qBest );
+                if (rowMinima[r].value < qBest) {
+                    qBest = rowMinima[r].value;
+                }
+            }
+        }
+    }
+    Position<T> getRowMinimumWithTies(size_t row, T maxTot, T qBest) const {
+        T nless2      = ( n - 2 );
+        T tMultiplier = ( n <= 2 ) ? 0 : ( 1.0 / nless2 );
+        auto    tot   = scaledClusterTotals.data();
+        T rowTotal    = rowTotals[row] * tMultiplier; //scaled by (1/(n-2)).
+        T rowBound    = qBest + maxTot + rowTotal;
+                //Distances equal to the bound are still checked
+                //(they might be ties for the best join).
+
+        Position<T> pos(row, 0, infiniteDistance, 0);
+        const T*   rowData   = entriesSorted.rows[row];
+        const int* toCluster = entryToCluster.rows[row];
+        T Drc;
+        for (size_t i=0; (Drc=rowData[i])<infiniteDistance && Drc<=rowBound; ++i) {
+            size_t cluster  = toCluster[i];
+            int    otherRow = clusterToRow[cluster];
+            if (otherRow == notMappedToRow) {
+                continue;
+            }
+            T      Qrc    = Drc - tot[cluster] - rowTotal;
+            size_t other  = static_cast<size_t>(otherRow);
+            size_t hiRow  = (other < row) ? row : other;
+            size_t loRow  = (other < row) ? other : row;
+            bool   better = Qrc < pos.value
+                         || ( Qrc == pos.value
+                              && ( hiRow < pos.row
+                                   || ( hiRow == pos.row && loRow < pos.column ) ) );
+            if (better) {
+                pos.row    = hiRow;
+                pos.column = loRow;
+                pos.value  = Qrc;
+                if (Qrc < qBest ) {
+                    qBest    = Qrc;
+                    rowBound = qBest + maxTot + rowTotal;
+                }
+            }
+        }
+        return pos;
+    }
+};
+
 typedef BoundingMatrix<NJFloat, NJMatrix<NJFloat>>      RapidNJ;
 typedef BoundingMatrix<NJFloat, BIONJMatrix<NJFloat>>   RapidBIONJ;
 typedef VectorizedMatrix<NJFloat, NJMatrix<NJFloat>>    VectorNJ;
 typedef VectorizedMatrix<NJFloat, BIONJMatrix<NJFloat>> VectorBIONJ;
+typedef ParallelBoundingMatrix<NJFloat, NJMatrix<NJFloat>>    ParallelRapidNJ;
+typedef ParallelBoundingMatrix<NJFloat, BIONJMatrix<NJFloat>> ParallelRapidBIONJ;
+typedef ParallelMatrix<NJFloat, VectorNJ>                     ParallelVectorNJ;
+typedef ParallelMatrix<NJFloat, VectorBIONJ>                  ParallelVectorBIONJ;
+typedef ParallelMatrix<NJFloat, VectorizedUPGMA_Matrix<NJFloat>> ParallelVectorUPGMA;
 
 void addBioNJ2020TreeBuilders(Factory& f) {
     f.advertiseTreeBuilder( new Builder<NJMatrix<NJFloat>>    ("NJ",      "Neighbour Joining (Saitou, Nei [1987])"));
@@ -1410,6 +1646,11 @@ void addBioNJ2020TreeBuilders(Factory& f) {
     f.advertiseTreeBuilder( new Builder<UPGMA_Matrix<NJFloat>>("UPGMA",    "UPGMA (Sokal, Michener [1958])"));
     f.advertiseTreeBuilder( new Builder<VectorizedUPGMA_Matrix<NJFloat>>("UPGMA-V", "Vectorized UPGMA (Sokal, Michener [1958])"));
     f.advertiseTreeBuilder( new Builder<BoundingMatrix<double>> ("NJ-R-D", "Double precision Rapid Neighbour Joining"));
+    f.advertiseTreeBuilder( new Builder<ParallelRapidNJ>      ("NJ-R-P",    "Rapid Neighbour Joining, deterministic multithreaded join selection"));
+    f.advertiseTreeBuilder( new Builder<ParallelRapidBIONJ>   ("BIONJ-R-P", "Rapid BIONJ, deterministic multithreaded join selection"));
+    f.advertiseTreeBuilder( new Builder<ParallelVectorNJ>     ("NJ-V-P",    "Vectorized Neighbour Joining, deterministic multithreaded join selection"));
+    f.advertiseTreeBuilder( new Builder<ParallelVectorBIONJ>  ("BIONJ-V-P", "Vectorized BIONJ, deterministic multithreaded join selection"));
+    f.advertiseTreeBuilder( new Builder<ParallelVectorUPGMA>  ("UPGMA-V-P", "Vectorized UPGMA, deterministic multithreaded join selection"));
     const char* defaultName = "RapidNJ";
     f.advertiseTreeBuilder( new Builder<RapidNJ>                (defaultName, "Rapid Neighbour Joining (Simonsen, Mailund, Pedersen [2011]) (default)"));  //Default.
     f.setNameOfDefaultTreeBuilder(defaultName);
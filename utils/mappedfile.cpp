@@ -0,0 +1,210 @@
+//
+//  mappedfile.cpp
+//  iqtree
+//
+
+#include "mappedfile.h"
+#include <vector>
+#if defined _WIN32 || defined WIN32 || defined WIN64
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <stdlib.h>
+#endif
+
+// an empty file cannot be mapped, it is represented by this empty buffer
+static const char empty_file[1] = {0};
+
+MappedFile::MappedFile(): address(NULL), length(0) {
+#if defined _WIN32 || defined WIN32 || defined WIN64
+    file_handle = NULL;
+    map_handle  = NULL;
+#endif
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+#if defined _WIN32 || defined WIN32 || defined WIN64
+
+bool MappedFile::open(const char *filename) {
+    close();
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size)) {
+        CloseHandle(file);
+        return false;
+    }
+    length = (size_t)file_size.QuadPart;
+    if (length == 0) {
+        CloseHandle(file);
+        address = empty_file;
+        return true;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL) {
+        CloseHandle(file);
+        length = 0;
+        return false;
+    }
+    address = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (address == NULL) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        length = 0;
+        return false;
+    }
+    file_handle = file;
+    map_handle  = mapping;
+    return true;
+}
+
+void MappedFile::close() {
+    if (address != NULL && address != empty_file) {
+        UnmapViewOfFile(address);
+        CloseHandle((HANDLE)map_handle);
+        CloseHandle((HANDLE)file_handle);
+    }
+    address     = NULL;
+    length      = 0;
+    file_handle = NULL;
+    map_handle  = NULL;
+}
+
+const char *MappedFile::release(const char *begin, const char *end) {
+    return begin;
+}
+
+#else
+
+bool MappedFile::open(const char *filename) {
+    close();
+    int fd = ::open(filename, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || !S_ISREG(file_stat.st_mode)) {
+        ::close(fd);
+        return false;
+    }
+    length = (size_t)file_stat.st_size;
+    if (length == 0) {
+        ::close(fd);
+        address = empty_file;
+        return true;
+    }
+    void *mapped = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping stays valid after the descriptor is closed
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        length = 0;
+        return false;
+    }
+    address = (const char*)mapped;
+    return true;
+}
+
+void MappedFile::close() {
+    if (address != NULL && address != empty_file) {
+        munmap((void*)address, length);
+    }
+    address = NULL;
+    length  = 0;
+}
+
+const char *MappedFile::release(const char *begin, const char *end) {
+    static const size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    size_t first = ((size_t)(begin - address) + page_size - 1) / page_size * page_size;
+    size_t last  = (size_t)(end - address) / page_size * page_size;
+    if (last <= first) {
+        return begin;
+    }
+    madvise((void*)(address + first), last - first, MADV_DONTNEED);
+    return address + last;
+}
+
+#endif
+
+bool MappedFile::isGzipped() const {
+    return length >= 2 && (unsigned char)address[0] == 0x1f
+        && (unsigned char)address[1] == 0x8b;
+}
+
+ScratchMapping::ScratchMapping(): address(NULL), length(0) {
+}
+
+ScratchMapping::~ScratchMapping() {
+    close();
+}
+
+#if defined _WIN32 || defined WIN32 || defined WIN64
+
+void *ScratchMapping::open(const char *dir, size_t size) {
+    close();
+    return NULL;
+}
+
+void ScratchMapping::close() {
+}
+
+void ScratchMapping::prefetch(const void *begin, size_t size) {
+}
+
+#else
+
+void *ScratchMapping::open(const char *dir, size_t size) {
+    close();
+    std::string path = std::string(dir) + "/iqtree_scratch_XXXXXX";
+    std::vector<char> name(path.begin(), path.end());
+    name.push_back(0);
+    int fd = mkstemp(name.data());
+    if (fd < 0) {
+        return NULL;
+    }
+    // the file disappears with the mapping, also if the program is killed
+    unlink(name.data());
+    // reserve the disk space now, running out of it while writing to the mapping is fatal
+#if defined __APPLE__
+    int reserve_error = ftruncate(fd, size);
+#else
+    int reserve_error = posix_fallocate(fd, 0, size);
+#endif
+    if (size == 0 || reserve_error != 0) {
+        ::close(fd);
+        return NULL;
+    }
+    void *mapped = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        return NULL;
+    }
+    address = (char*)mapped;
+    length  = size;
+    return address;
+}
+
+void ScratchMapping::close() {
+    if (address != NULL) {
+        munmap(address, length);
+    }
+    address = NULL;
+    length  = 0;
+}
+
+void ScratchMapping::prefetch(const void *begin, size_t size) {
+    static const size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    size_t first = (size_t)begin / page_size * page_size;
+    // an error, e.g. for a range that is not mapped, only means there is nothing to read ahead
+    madvise((void*)first, (size_t)begin + size - first, MADV_WILLNEED);
+}
+
+#endif
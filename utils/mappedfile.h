@@ -0,0 +1,104 @@
+//
+//  mappedfile.h
+//  iqtree
+//
+//  Read-only view of a whole file, memory-mapped where the platform
+//  supports it, so that large inputs are paged in by the OS on demand
+//  instead of being copied onto the heap; and writable scratch memory
+//  backed by a temporary file, for buffers larger than the RAM.
+//
+
+#ifndef mappedfile_h
+#define mappedfile_h
+
+#include <stddef.h>
+#include <string>
+
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    /**
+        map a file into memory
+        @param filename file name
+        @return false if the file cannot be opened or mapped
+    */
+    bool open(const char *filename);
+
+    /** unmap the file */
+    void close();
+
+    /**
+        tell the OS that the pages lying entirely in a range of the file
+        are not needed any more; they are read again if accessed later
+        @param begin first byte of the range
+        @param end one past the last byte of the range
+        @return end of the released pages, or begin if no page was released
+    */
+    const char *release(const char *begin, const char *end);
+
+    /** @return first byte of the file */
+    const char *data() const { return address; }
+
+    /** @return number of bytes of the file */
+    size_t size() const { return length; }
+
+    /** @return true if the file starts with the gzip magic bytes */
+    bool isGzipped() const;
+
+private:
+    const char *address;
+    size_t length;
+#if defined _WIN32 || defined WIN32 || defined WIN64
+    void *file_handle;
+    void *map_handle;
+#endif
+    // not copyable
+    MappedFile(const MappedFile &);
+    MappedFile &operator=(const MappedFile &);
+};
+
+/**
+    Writable memory backed by a temporary file instead of the RAM and swap,
+    so that the OS pages it in and out of the file on demand.
+    The file is removed as soon as it is created, its space is freed when the
+    memory is unmapped or the program ends.
+*/
+class ScratchMapping {
+public:
+    ScratchMapping();
+    ~ScratchMapping();
+
+    /**
+        create the file and map it into memory
+        @param dir directory of the file, preferably on a fast local disk
+        @param size number of bytes
+        @return the mapped memory, aligned to a page, or NULL if the file cannot be
+            created or mapped, e.g. not enough disk space or not supported on this platform
+    */
+    void *open(const char *dir, size_t size);
+
+    /** unmap the memory, removing the file */
+    void close();
+
+    /** @return true if the memory is mapped */
+    bool isOpen() const { return address != NULL; }
+
+    /**
+        tell the OS that a range of memory is going to be accessed soon,
+        so that it reads it from the file in the background
+        @param begin first byte of the range, in this or any other mapping
+        @param size number of bytes of the range
+    */
+    static void prefetch(const void *begin, size_t size);
+
+private:
+    char *address;
+    size_t length;
+    // not copyable
+    ScratchMapping(const ScratchMapping &);
+    ScratchMapping &operator=(const ScratchMapping &);
+};
+
+#endif /* mappedfile_h */
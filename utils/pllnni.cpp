@@ -38,17 +38,18 @@
 /* program options */
 int nni0;
 int nni5;
-extern VerboseMode verbose_mode;
-int NNI_MAX_NR_STEP = 10;
+/** NNI_MAX_NR_STEP set by parseArg() of the iqtree2 program, copied to threads by ThreadSettings */
+int program_nni_max_nr_step = 10;
+thread_local int NNI_MAX_NR_STEP = 10;
 
 /* program options */
-extern Params *globalParams;
-extern Alignment *globalAlignment;
+extern thread_local Params *globalParams;
+extern thread_local Alignment *globalAlignment;
 
 /**
  * map from newick tree string to frequencies that a tree is revisited during tree search
  */
-StringIntMap pllTreeCounter;
+thread_local StringIntMap pllTreeCounter;
 
 
 /*
@@ -57,7 +58,7 @@ StringIntMap pllTreeCounter;
  * ****************************************************************************
  */
 
-pllUFBootData * pllUFBootDataPtr = NULL;
+thread_local pllUFBootData * pllUFBootDataPtr = NULL;
 
 
 int compareDouble(const void * a, const void * b) {
@@ -70,7 +71,7 @@ int compareDouble(const void * a, const void * b) {
 }
 
 pllNNIMove *getNNIList(pllInstance* tr) {
-	static pllNNIMove* nniList;
+	static thread_local pllNNIMove* nniList;
 	if (nniList == NULL) {
 		nniList = (pllNNIMove*) malloc(2 * (tr->mxtips - 3) * sizeof(pllNNIMove));
 		ASSERT(nniList != NULL);
@@ -79,7 +80,7 @@ pllNNIMove *getNNIList(pllInstance* tr) {
 }
 
 pllNNIMove *getNonConflictNNIList(pllInstance* tr) {
-	static pllNNIMove* nonConfNNIList;
+	static thread_local pllNNIMove* nonConfNNIList;
 	if (nonConfNNIList == NULL) {
 		nonConfNNIList = (pllNNIMove*) malloc((tr->mxtips - 3) * sizeof(pllNNIMove));
 		ASSERT(nonConfNNIList != NULL);
@@ -189,7 +190,7 @@ void quicksort_nni(pllNNIMove* arr,int left, int right) {
 
 //TODO: Workaround for memory leak problem when calling setupTopol within doNNISearch
 topol *_setupTopol(pllInstance* tr) {
-	static topol* tree;
+	static thread_local topol* tree;
 	if (tree == NULL)
 		tree = setupTopol(tr->mxtips);
 	return tree;
@@ -26,12 +26,14 @@
 #include <iostream> //for std::cout
 #include <math.h>   //for floor
 #include "operatingsystem.h" //for isStandardOutputATerminal
+#include <atomic>   //for std::atomic
 
 
 namespace {
-bool displayingProgress = true;
+std::atomic<bool> displayingProgress(true);
     //You can turn off progress displays via progress_display::setProgressDisplay.
-bool isTerminal = false;
+    //Atomic, as every parseArg() sets it, also those of concurrent libiqtree2 analyses.
+std::atomic<bool> isTerminal(false);
 }
 
 progress_display::progress_display( double workToDo, const char* doingWhat
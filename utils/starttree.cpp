@@ -20,6 +20,7 @@
 #include "starttree.h"
 #include <iostream> //for std::cout
 #include <sstream>  //for std::stringstream
+#include <mutex>    //for std::call_once
 
 namespace StartTree {
 
@@ -42,12 +43,14 @@ size_t Factory::getBuilderCount() {
 
 Factory& Factory::getInstance() {
     static Factory instance;
-    if (instance.getBuilderCount()==0) {
+    //Once only, even if several threads (e.g. concurrent libiqtree2 analyses) get here at once
+    static std::once_flag buildersAdded;
+    std::call_once(buildersAdded, []() {
         addBioNJ2009TreeBuilders(instance);
         addBioNJ2020TreeBuilders(instance);
         BuilderInterface *bench = new BenchmarkingTreeBuilder(instance, "BENCHMARK", "Benchmark");
         instance.addBuilder(bench->getName(), bench);
-    }
+    });
     return instance;
 }
 
@@ -126,38 +129,66 @@ void BenchmarkingTreeBuilder::setZippedOutput(bool zipIt) {
     isOutputToBeZipped = zipIt;
 }
 
+template <class C> bool benchmarkByThreadCount(BuilderInterface* builder, C construct) {
+    //Times construct() with 1, 2, ... (up to the maximum number of)
+    //threads, and writes out the times (and, for 2 or more threads,
+    //the speedup relative to 1 thread), on one line for the builder.
+    #ifdef _OPENMP
+        int maxThreads = omp_get_max_threads();
+        omp_set_num_threads(1);
+    #endif
+    builder->beSilent();
+    double startTime = getRealTime();
+    bool   succeeded = construct();
+    double elapsed   = getRealTime() - startTime;
+    if (succeeded) {
+        std::cout.precision(6);
+        std::cout << builder->getName() << " \t" << elapsed;
+        #ifdef _OPENMP
+        double serialTime = elapsed;
+        for (int t=2; t<=maxThreads; ++t) {
+            omp_set_num_threads(t);
+            startTime  = getRealTime();
+            succeeded &= construct();
+            elapsed    = getRealTime() - startTime;
+            std::cout << "\t" << elapsed;
+            if (0 < elapsed) {
+                std::cout << " (x" << (serialTime / elapsed) << ")";
+            }
+        }
+        #endif
+        std::cout << std::endl;
+    }
+    #ifdef _OPENMP
+        omp_set_num_threads(maxThreads);
+    #endif
+    return succeeded;
+}
+
 bool BenchmarkingTreeBuilder::constructTreeInMemory
     ( const std::vector<std::string> &sequenceNames
     , double *distanceMatrix
     , const std::string & newickTreeFilePath) {
-        bool ok = false;
-        #ifdef _OPENMP
-            int maxThreads = omp_get_max_threads();
-        #endif
         for (auto it=builders.begin(); it!=builders.end(); ++it) {
-            double startTime = getRealTime();
-            #ifdef _OPENMP
-                omp_set_num_threads(1);
-            #endif
-            (*it)->beSilent();
-            bool succeeded = (*it)->constructTreeInMemory(sequenceNames, distanceMatrix, newickTreeFilePath);
-            double elapsed = getRealTime() - startTime;
-            if (succeeded) {
-                ok = true;
-                std::cout.precision(6);
-                std::cout << (*it)->getName() << " \t" << elapsed;
-                #ifdef _OPENMP
-                for (int t=2; t<=maxThreads; ++t) {
-                    omp_set_num_threads(t);
-                    startTime = getRealTime();
-                    ok &= (*it)->constructTreeInMemory(sequenceNames, distanceMatrix, newickTreeFilePath);
-                    elapsed = getRealTime() - startTime;
-                    std::cout << "\t" << (elapsed);
-                }
-                #endif
-                std::cout << std::endl;
-            }
+            BuilderInterface* builder = *it;
+            benchmarkByThreadCount(builder, [&]() {
+                return builder->constructTreeInMemory(sequenceNames, distanceMatrix, newickTreeFilePath);
+            });
         }
         return true;
     }
+
+bool BenchmarkingTreeBuilder::constructTreeFromLowerTriangle
+    ( const std::vector<std::string> &sequenceNames
+    , const float *lowerTriangle
+    , const std::string & newickTreeFilePath) {
+        bool ok = false;
+        for (auto it=builders.begin(); it!=builders.end(); ++it) {
+            BuilderInterface* builder = *it;
+            ok |= benchmarkByThreadCount(builder, [&]() {
+                return builder->constructTreeFromLowerTriangle(sequenceNames, lowerTriangle, newickTreeFilePath);
+            });
+        }
+        return ok;
+    }
 };
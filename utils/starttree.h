@@ -42,6 +42,21 @@ namespace StartTree
             ( const std::vector<std::string> &sequenceNames
              , double *distanceMatrix
              , const std::string & newickTreeFilePath) = 0;
+        //lowerTriangle holds the distances below the diagonal,
+        //row by row: (row, col<row) at row*(row-1)/2+col.
+        virtual bool constructTreeFromLowerTriangle
+            ( const std::vector<std::string> &sequenceNames
+             , const float *lowerTriangle
+             , const std::string & newickTreeFilePath) = 0;
+        //like constructTreeInMemory, but the tree is returned
+        //as a newick string rather than written to a file.
+        //Returns false if the builder cannot do that.
+        virtual bool constructTreeStringInMemory
+            ( const std::vector<std::string> &sequenceNames
+             , double *distanceMatrix
+             , std::string & newickTree) {
+            return false;
+        }
         virtual const std::string& getName() = 0;
         virtual const std::string& getDescription() = 0;
         virtual void beSilent() {}
@@ -80,7 +95,8 @@ namespace StartTree
         //      1. a constructor that takes the name of an ".mldist"
         //         distance matrix file as a parameter;
         //      2. a constructTree() member function; and
-        //      3. a writeTreeFile() member function.
+        //      3. a writeTreeFile() member function; and
+        //      4. a writeTreeString() member function.
         //
     protected:
         const std::string name;
@@ -144,6 +160,29 @@ namespace StartTree
                 builder.setZippedOutput(isOutputToBeZipped);
                 return builder.writeTreeFile(newickTreeFilePath);
         }
+        virtual bool constructTreeStringInMemory
+            ( const std::vector<std::string> &sequenceNames
+            , double *distanceMatrix
+            , std::string & newickTree) {
+                B builder;
+                if (!builder.loadMatrix(sequenceNames, distanceMatrix)) {
+                    return false;
+                }
+                constructTreeWith(builder);
+                return builder.writeTreeString(newickTree);
+        }
+        virtual bool constructTreeFromLowerTriangle
+            ( const std::vector<std::string> &sequenceNames
+            , const float *lowerTriangle
+            , const std::string & newickTreeFilePath) {
+                B builder;
+                if (!builder.loadMatrixFromLowerTriangle(sequenceNames, lowerTriangle)) {
+                    return false;
+                }
+                constructTreeWith(builder);
+                builder.setZippedOutput(isOutputToBeZipped);
+                return builder.writeTreeFile(newickTreeFilePath);
+        }
     };
 
     class BenchmarkingTreeBuilder: public BuilderInterface
@@ -164,6 +203,10 @@ namespace StartTree
             ( const std::vector<std::string> &sequenceNames
             , double *distanceMatrix
              , const std::string & newickTreeFilePath);
+        virtual bool constructTreeFromLowerTriangle
+            ( const std::vector<std::string> &sequenceNames
+            , const float *lowerTriangle
+             , const std::string & newickTreeFilePath);
         virtual void setZippedOutput(bool zipIt);
     };
 }
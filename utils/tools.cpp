@@ -52,7 +52,14 @@
 #include "MPIHelper.h"
 #include "alignment/alignment.h"
 
-VerboseMode verbose_mode;
+/** verbose_mode set by parseArg() of the iqtree2 program, copied to threads by ThreadSettings */
+static VerboseMode program_verbose_mode = VB_QUIET;
+
+thread_local VerboseMode verbose_mode = VB_QUIET;
+
+/** NNI_MAX_NR_STEP set by parseArg() of the iqtree2 program, defined in pllnni.cpp */
+extern int program_nni_max_nr_step;
+
 extern void printCopyright(ostream &out);
 
 #if defined(WIN32)
@@ -67,13 +74,23 @@ extern void printCopyright(ostream &out);
         Output an error to screen, then exit program
         @param error error message
  */
+/** true if outError() on this thread should throw instead of exiting */
+static thread_local bool throw_on_error = false;
+
+void setThrowOnError(bool throw_error) {
+    throw_on_error = throw_error;
+}
+
 void outError(const char *error, bool quit) {
 	if (error == ERR_NO_MEMORY) {
         print_stacktrace(cerr);
 	}
 	cerr << error << endl;
-    if (quit)
+    if (quit) {
+        if (throw_on_error)
+            throw std::runtime_error(error);
     	exit(2);
+    }
 }
 
 /**
@@ -1287,6 +1304,32 @@ void parseArg(int argc, char *argv[], Params &params) {
                 params.experimental = true;
                 continue;
             }
+            if (strcmp(argv[cnt], "--dist-float") == 0) {
+                params.dist_float = true;
+                continue;
+            }
+            if (strcmp(argv[cnt], "--write-dist") == 0) {
+                params.write_dist_file = true;
+                continue;
+            }
+            if (strcmp(argv[cnt], "--place-reps") == 0) {
+                cnt++;
+                if (cnt >= argc)
+                    throw "Use --place-reps <number_of_representatives>";
+                params.place_reps = convert_int(argv[cnt]);
+                if (params.place_reps < 3)
+                    throw "--place-reps must be at least 3";
+                continue;
+            }
+            if (strcmp(argv[cnt], "--place-block") == 0) {
+                cnt++;
+                if (cnt >= argc)
+                    throw "Use --place-block <number_of_sequences>";
+                params.place_block = convert_int(argv[cnt]);
+                if (params.place_block < 3)
+                    throw "--place-block must be at least 3";
+                continue;
+            }
             if (strcmp(argv[cnt], "--no-experimental") == 0) {
                 params.experimental = false;
                 continue;
@@ -1815,6 +1858,10 @@ void parseArg(int argc, char *argv[], Params &params) {
                 params.phylip_sequential_format = true;
                 continue;
             }
+            if (strcmp(argv[cnt], "--aln-cache") == 0) {
+                params.aln_cache = true;
+                continue;
+            }
             if (strcmp(argv[cnt], "--symtest") == 0) {
                 params.symtest = SYMTEST_MAXDIV;
                 continue;
@@ -1927,6 +1974,24 @@ void parseArg(int argc, char *argv[], Params &params) {
 				params.do_au_test = true;
 				continue;
 			}
+			if (strcmp(argv[cnt], "--au-bins") == 0) {
+				cnt++;
+				if (cnt >= argc)
+					throw "Use --au-bins <num_bins>";
+				params.au_bins = convert_int(argv[cnt]);
+				if (params.au_bins < 0)
+					throw "--au-bins must not be negative";
+				continue;
+			}
+			if (strcmp(argv[cnt], "--tree-reuse") == 0) {
+				cnt++;
+				if (cnt >= argc)
+					throw "Use --tree-reuse <num_candidates>";
+				params.tree_reuse = convert_int(argv[cnt]);
+				if (params.tree_reuse < 0)
+					throw "--tree-reuse must not be negative";
+				continue;
+			}
 			if (strcmp(argv[cnt], "-sp") == 0 || strcmp(argv[cnt], "-Q") == 0) {
 				cnt++;
 				if (cnt >= argc)
@@ -2426,6 +2491,13 @@ void parseArg(int argc, char *argv[], Params &params) {
                 params.alisim_only_unroot_tree = true;
                 continue;
             }
+            if (strcmp(argv[cnt], "--bin-to-fasta") == 0) {
+                cnt++;
+                if (cnt >= argc)
+                    throw "Use --bin-to-fasta <BINARY_ALIGNMENT_FILE>";
+                params.alisim_binary_to_fasta = argv[cnt];
+                continue;
+            }
             if (strcmp(argv[cnt], "--branch-distribution") == 0) {
                 cnt++;
                 if (cnt >= argc)
@@ -2497,11 +2569,13 @@ void parseArg(int argc, char *argv[], Params &params) {
 			if (strcmp(argv[cnt], "-starttree") == 0) {
 				cnt++;
 				if (cnt >= argc)
-					throw "Use -starttree BIONJ|PARS|PLLPARS";
+					throw "Use -starttree BIONJ|PARS|PLLPARS|PLACE";
                 else if (strcmp(argv[cnt], "PARS") == 0)
 					params.start_tree = STT_PARSIMONY;
 				else if (strcmp(argv[cnt], "PLLPARS") == 0)
 					params.start_tree = STT_PLL_PARSIMONY;
+				else if (strcmp(argv[cnt], "PLACE") == 0)
+					params.start_tree = STT_PLACEMENT;
                 else if (START_TREE_RECOGNIZED(argv[cnt])) {
                     params.start_tree_subtype_name = argv[cnt];
                     params.start_tree = STT_BIONJ;
@@ -2535,7 +2609,7 @@ void parseArg(int argc, char *argv[], Params &params) {
 			if (strcmp(argv[cnt], "-af") == 0 || strcmp(argv[cnt], "--out-format") == 0) {
 				cnt++;
 				if (cnt >= argc)
-					throw "Use -af phy|fasta";
+					throw "Use -af phy|fasta|bin";
                 string format = argv[cnt];
                 transform(format.begin(), format.end(), format.begin(), ::toupper);
 				if (strcmp(format.c_str(), "PHY") == 0)
@@ -2546,6 +2620,8 @@ void parseArg(int argc, char *argv[], Params &params) {
                     params.aln_output_format = IN_NEXUS;
                 else if (strcmp(format.c_str(), "MAPLE") == 0)
                     params.aln_output_format = IN_MAPLE;
+                else if (strcmp(format.c_str(), "BIN") == 0)
+                    params.aln_output_format = IN_ALIBIN;
 				else
 					throw "Unknown output format";
 				continue;
@@ -2840,6 +2916,11 @@ void parseArg(int argc, char *argv[], Params &params) {
 				continue;
 			}
 
+			if (strcmp(argv[cnt], "--float-lh") == 0) {
+				params.float_lh = true;
+				continue;
+			}
+
 			if (strcmp(argv[cnt], "-safe-seq") == 0) {
 				cnt++;
 				if (cnt >= argc)
@@ -3622,6 +3703,19 @@ void parseArg(int argc, char *argv[], Params &params) {
 					throw "Epsilon must be positive";
 				continue;
 			}
+			if (strcmp(argv[cnt], "--rell-batch") == 0) {
+				cnt++;
+				if (cnt >= argc)
+					throw "Use --rell-batch <num_trees>";
+				params.rell_batch = convert_int(argv[cnt]);
+				if (params.rell_batch < 1)
+					throw "--rell-batch must be positive";
+				continue;
+			}
+			if (strcmp(argv[cnt], "--ufboot-compact") == 0) {
+				params.ufboot_compact = true;
+				continue;
+			}
 			if (strcmp(argv[cnt], "-wbt") == 0 || strcmp(argv[cnt], "--wbt") == 0 || strcmp(argv[cnt], "--boot-trees") == 0) {
 				params.print_ufboot_trees = 1;
 				continue;
@@ -3753,6 +3847,23 @@ void parseArg(int argc, char *argv[], Params &params) {
                 params.buffer_mem_save = false;
                 continue;
             }
+            if (strcmp(argv[cnt], "--lh-scratch") == 0) {
+                cnt++;
+                if (cnt >= argc)
+                    throw "Use --lh-scratch <directory>";
+                if (!isDirectory(argv[cnt]))
+                    throw "--lh-scratch must be an existing directory";
+                params.lh_scratch_dir = argv[cnt];
+                continue;
+            }
+            if (strcmp(argv[cnt], "--mpi-patterns") == 0) {
+                params.mpi_patterns = true;
+                continue;
+            }
+            if (strcmp(argv[cnt], "--part-sched") == 0) {
+                params.part_sched = true;
+                continue;
+            }
 //			if (strcmp(argv[cnt], "-storetrees") == 0) {
 //				params.store_candidate_trees = true;
 //				continue;
@@ -4274,11 +4385,13 @@ void parseArg(int argc, char *argv[], Params &params) {
                 }
 				cnt++;
 				if (cnt >= argc)
-					throw "Use -t,-te <start_tree | BIONJ | PARS | PLLPARS | RANDOM>";
+					throw "Use -t,-te <start_tree | BIONJ | PARS | PLLPARS | PLACE | RANDOM>";
 				else if (strcmp(argv[cnt], "PARS") == 0)
 					params.start_tree = STT_PARSIMONY;
 				else if (strcmp(argv[cnt], "PLLPARS") == 0)
 					params.start_tree = STT_PLL_PARSIMONY;
+				else if (strcmp(argv[cnt], "PLACE") == 0)
+					params.start_tree = STT_PLACEMENT;
                 else if (strcmp(argv[cnt], "RANDOM") == 0 || strcmp(argv[cnt], "RAND") == 0)
                 {
 					params.start_tree = STT_RANDOM_TREE;
@@ -4825,6 +4938,18 @@ void parseArg(int argc, char *argv[], Params &params) {
                 continue;
             }
             
+            if (strcmp(argv[cnt], "--parallel-datasets") == 0) {
+                params.alisim_parallel_datasets = true;
+                
+                continue;
+            }
+            
+            if (strcmp(argv[cnt], "--aln-archive") == 0) {
+                params.alisim_archive = true;
+                
+                continue;
+            }
+            
             if (strcmp(argv[cnt], "--length") == 0) {
                 cnt++;
                 if (cnt >= argc)
@@ -5050,6 +5175,8 @@ void parseArg(int argc, char *argv[], Params &params) {
             params.out_prefix = params.ngs_file;
         else if (params.ngs_mapped_reads)
             params.out_prefix = params.ngs_mapped_reads;
+        else if (!params.user_file && !params.alisim_binary_to_fasta.empty())
+            params.out_prefix = (char*) params.alisim_binary_to_fasta.c_str();
         else
             params.out_prefix = params.user_file;
     }
@@ -5058,7 +5185,8 @@ void parseArg(int argc, char *argv[], Params &params) {
         if (params.partition_merge == MERGE_NONE)
             params.partition_merge = MERGE_RCLUSTERF;
     
-    if (params.alisim_active && !params.aln_file && !params.user_file && !params.partition_file && params.tree_gen == NONE)
+    // converting a binary alignment (--bin-to-fasta) needs neither a tree nor an alignment
+    if (params.alisim_active && params.alisim_binary_to_fasta.empty() && !params.aln_file && !params.user_file && !params.partition_file && params.tree_gen == NONE)
         outError("A tree filepath is a mandatory input to execute AliSim when neither Inference mode nor Random mode (generating a random tree) is inactive. Use -t <TREE_FILEPATH> ; or Activate the inference mode by -s <ALIGNMENT_FILE> ; or Activate Random mode by -t RANDOM{<MODEL>,<NUM_TAXA>} where <MODEL> is yh, u, cat, bal, bd{<birth_rate>,<death_rate>} stands for Yule-Harding, Uniform, Caterpillar, Balanced, Birth-Death model respectively.");
     // terminate if using AliSim with -ft or -fs site-specific model (ModelSet)
     // computeTransMatix has not yet implemented for ModelSet
@@ -5099,6 +5227,12 @@ void parseArg(int argc, char *argv[], Params &params) {
 //        params.out_prefix = (char *) newPrefix.c_str();
 //    }
 
+    // settings of the iqtree2 program, copied to threads by ThreadSettings (Params::setThreadInstance() and OpenMP regions);
+    // analyses with their own Params (libiqtree2) keep them to the calling thread
+    if (!Params::hasThreadInstance()) {
+        program_verbose_mode = verbose_mode;
+        program_nni_max_nr_step = NNI_MAX_NR_STEP;
+    }
 }
 
 void usage(char* argv[]) {
@@ -5211,12 +5345,19 @@ void usage_alisim(){
     << "                            are randomly generated and overridden." << endl
     << "  --branch-scale SCALE      Specify a value to scale all branch lengths" << endl
     << "  --single-output           Output all alignments into a single file" << endl
+    << "  --aln-archive             Output all alignments into a single file (compressed separately" << endl
+    << "                            with -gz), listing the offset and size of each one in FILE.idx" << endl
+    << "  --parallel-datasets       Simulate several alignments at once, one alignment per thread" << endl
+    << "                            (use with -T and --num-alignments)" << endl
     << "  --write-all               Enable outputting internal sequences" << endl
     << "  --seed NUM                Random seed number (default: CPU clock)" << endl
     << "                            Be careful to make the AliSim reproducible," << endl
     << "                            users should specify the seed number" << endl
     << "  -gz                       Enable output compression but taking longer running time" << endl
-    << "  -af phy|fasta             Set the output format (default: phylip)" << endl
+    << "  -af phy|fasta|bin         Set the output format (default: phylip)" << endl
+    << "                            bin: packed binary alignment (.alibin)" << endl
+    << "  --bin-to-fasta FILE       Convert a packed binary alignment into FASTA format" << endl
+    << "                            (output: <OUTPUT_PREFIX>.fa)" << endl
     << "  User Manual is available at http://www.iqtree.org/doc/alisim" << endl;
 }
 
@@ -5228,12 +5369,22 @@ void usage_iqtree(char* argv[], bool full_command) {
     << "  -s FILE[,...,FILE]   PHYLIP/FASTA/NEXUS/CLUSTAL/MSF alignment file(s)" << endl
     << "  -s DIR               Directory of alignment files" << endl
     << "  --seqtype STRING     BIN, DNA, AA, NT2AA, CODON, MORPH (default: auto-detect)" << endl
+    << "  --aln-cache          Cache alignment patterns in FILE.alncache for later runs" << endl
     << "  -t FILE|PARS|RAND    Starting tree (default: 99 parsimony and BIONJ)" << endl
+    << "  --dist-float         Lower-triangle float distance matrix kept in memory" << endl
+    << "  --write-dist         Write .mldist/.obsdist file also with --dist-float" << endl
+    << "  -t PLACE             Start tree without a full distance matrix (huge data)" << endl
+    << "  --place-reps NUM     Representatives per level for -t PLACE (default: 100)" << endl
+    << "  --place-block NUM    Largest all-pairs block for -t PLACE (default: 1000)" << endl
     << "  -o TAX[,...,TAX]     Outgroup taxon (list) for writing .treefile" << endl
     << "  --prefix STRING      Prefix for all output files (default: aln/partition)" << endl
     << "  --seed NUM           Random seed number, normally used for debugging purpose" << endl
     << "  --safe               Safe likelihood kernel to avoid numerical underflow" << endl
+    << "  --float-lh           Store partial likelihoods in single precision (AVX-512)" << endl
     << "  --mem NUM[G|M|%]     Maximal RAM usage in GB | MB | %" << endl
+    << "  --lh-scratch DIR     Keep partial likelihoods in a scratch file in DIR, not RAM" << endl
+    << "  --mpi-patterns       MPI version: split site patterns across processes" << endl
+    << "  --part-sched         Share threads among partitions by their computation cost" << endl
     << "  --runs NUM           Number of indepedent runs (default: 1)" << endl
     << "  -v, --verbose        Verbose mode, printing more messages to screen" << endl
     << "  -V, --version        Display version number" << endl
@@ -5294,6 +5445,8 @@ void usage_iqtree(char* argv[], bool full_command) {
     << "  --nstep NUM          Iterations for UFBoot stopping rule (default: 100)" << endl
     << "  --bcor NUM           Minimum correlation coefficient (default: 0.99)" << endl
     << "  --beps NUM           RELL epsilon to break tie (default: 0.5)" << endl
+    << "  --rell-batch NUM     Evaluate RELL for NUM visited trees at once (default: 1)" << endl
+    << "  --ufboot-compact     Store UFBoot replicates as 8-bit pattern counts" << endl
     << "  --bnni               Optimize UFBoot trees by NNI on bootstrap alignment" << endl
     << endl << "NON-PARAMETRIC BOOTSTRAP/JACKKNIFE:" << endl
     << "  -b, --boot NUM       Replicates for bootstrap + ML tree + consensus tree" << endl
@@ -5431,6 +5584,9 @@ void usage_iqtree(char* argv[], bool full_command) {
     << "  --test NUM           Replicates for topology test" << endl
     << "  --test-weight        Perform weighted KH and SH tests" << endl
     << "  --test-au            Approximately unbiased (AU) test (Shimodaira 2002)" << endl
+    << "  --au-bins NUM        Stream AU test replicates into NUM-bin histograms" << endl
+    << "  --tree-reuse NUM     Reuse likelihoods of shared subtrees, reorder trees" << endl
+    << "                       among NUM candidates (1: keep input order)" << endl
     << "  --sitelh             Write site log-likelihoods to .sitelh file" << endl
 
     << endl << "ANCESTRAL STATE RECONSTRUCTION:" << endl
@@ -5831,7 +5987,17 @@ int finish_random() {
 
 /******************/
 
-int *randstream;
+thread_local int *randstream = NULL;
+
+/** randstream slot of the main program thread, shared by threads without their own stream */
+static int **main_randstream = NULL;
+
+/** @return the random stream to use when the caller did not pass one */
+static int *defaultRandStream() {
+    if (randstream || !main_randstream)
+        return randstream;
+    return *main_randstream;
+}
 
 int init_random(int seed, bool write_info, int** rstream) {
     //    srand((unsigned) time(NULL));
@@ -5844,6 +6010,8 @@ int init_random(int seed, bool write_info, int** rstream) {
         *rstream = init_sprng(0, 1, seed, SPRNG_DEFAULT); /*init stream*/
     } else {
         randstream = init_sprng(0, 1, seed, SPRNG_DEFAULT); /*init stream*/
+        if (!main_randstream && !Params::hasThreadInstance())
+            main_randstream = &randstream;
         if (verbose_mode >= VB_MED) {
             print_sprng(randstream);
         }
@@ -5857,6 +6025,8 @@ int init_random(int seed, bool write_info, int** rstream) {
         *rstream = init_sprng(PP_Myid, PP_NumProcs, seed, SPRNG_DEFAULT); /*initialize stream*/
     } else {
         randstream = init_sprng(PP_Myid, PP_NumProcs, seed, SPRNG_DEFAULT); /*initialize stream*/
+        if (!main_randstream && !Params::hasThreadInstance())
+            main_randstream = &randstream;
         if (verbose_mode >= VB_MED) {
             cout << "(" << PP_Myid << ") !!! random seed set to " << seed << " !!!" << endl;
             print_sprng(randstream);
@@ -5898,7 +6068,7 @@ double random_double(int *rstream) {
     if (rstream)
         return sprng(rstream);
     else
-        return sprng(randstream);
+        return sprng(defaultRandStream());
 #else /* NO_SPRNG */
     return randomunitintervall();
 #endif /* NO_SPRNG */
@@ -5907,7 +6077,7 @@ double random_double(int *rstream) {
     if (rstream)
         return sprng(rstream);
     else
-        return sprng(randstream);
+        return sprng(defaultRandStream());
 #else /* NO_SPRNG */
     int m;
     for (m = 1; m < PP_NumProcs; m++)
@@ -6365,11 +6535,47 @@ void trimString(string &str) {
 
 
 
+ThreadSettings::ThreadSettings()
+    : verbose_mode(::verbose_mode), nni_max_nr_step(NNI_MAX_NR_STEP) {
+}
+
+ThreadSettings ThreadSettings::program() {
+    ThreadSettings settings;
+    settings.verbose_mode = program_verbose_mode;
+    settings.nni_max_nr_step = program_nni_max_nr_step;
+    return settings;
+}
+
+void ThreadSettings::apply() const {
+    ::verbose_mode = verbose_mode;
+    NNI_MAX_NR_STEP = nni_max_nr_step;
+}
+
+/** Params bound to the calling thread, if any */
+static thread_local Params *thread_params = NULL;
+
 Params& Params::getInstance() {
+    if (thread_params)
+        return *thread_params;
     static Params instance;
     return instance;
 }
 
+void Params::setThreadInstance(Params *params) {
+    // a thread newly bound to its Params starts with the settings of the iqtree2 program
+    if (params && !thread_params)
+        ThreadSettings::program().apply();
+    thread_params = params;
+}
+
+bool Params::hasThreadInstance() {
+    return thread_params != NULL;
+}
+
+Params *Params::newInstance() {
+    return new Params();
+}
+
 json Params::to_json() const {
     json j;
     // Serialize member variables into the json object
@@ -6434,6 +6640,7 @@ json Params::to_json() const {
     j["out_prefix"] = std::string(this->out_prefix);  // char*
     j["aln_file"] = std::string(this->aln_file);  // char*
     j["phylip_sequential_format"] = this->phylip_sequential_format;  // bool
+    j["aln_cache"] = this->aln_cache;  // bool
     ::to_json(j["symtest"], this->symtest); // SymTest enum
     j["symtest_only"] = this->symtest_only;  // bool
     j["symtest_remove"] = this->symtest_remove;  // int
@@ -6447,6 +6654,8 @@ json Params::to_json() const {
     j["topotest_optimize_model"] = this->topotest_optimize_model;  // bool
     j["do_weighted_test"] = this->do_weighted_test;  // bool
     j["do_au_test"] = this->do_au_test;  // bool
+    j["au_bins"] = this->au_bins;  // int
+    j["tree_reuse"] = this->tree_reuse;  // int
     j["partition_file"] = std::string(this->partition_file);  // char*
     j["partition_type"] = this->partition_type;  // int
     ::to_json(j["partition_merge"], this->partition_merge); // PartitionMerge enum
@@ -6510,6 +6719,10 @@ json Params::to_json() const {
     j["dist_file"] = std::string(this->dist_file);  // char*
     j["compute_obs_dist"] = this->compute_obs_dist;  // bool
     j["compute_jc_dist"] = this->compute_jc_dist;  // bool
+    j["dist_float"] = this->dist_float;  // bool
+    j["write_dist_file"] = this->write_dist_file;  // bool
+    j["place_reps"] = this->place_reps;  // int
+    j["place_block"] = this->place_block;  // int
     j["experimental"] = this->experimental;  // bool
     j["compute_ml_dist"] = this->compute_ml_dist;  // bool
     j["compute_ml_tree"] = this->compute_ml_tree;  // bool
@@ -6638,6 +6851,7 @@ json Params::to_json() const {
     j["localbp_replicates"] = this->localbp_replicates;  // int
     ::to_json(j["SSE"], this->SSE); // LikelihoodKernel enum
     j["lk_safe_scaling"] = this->lk_safe_scaling;  // bool
+    j["float_lh"] = this->float_lh;  // bool
     j["numseq_safe_scaling"] = this->numseq_safe_scaling;  // int
     j["kernel_nonrev"] = this->kernel_nonrev;  // bool
     ::to_json(j["print_site_lh"], this->print_site_lh); // SiteLoglType enum
@@ -6686,6 +6900,8 @@ json Params::to_json() const {
     j["upper_bound_frac"] = this->upper_bound_frac;  // double
     j["gbo_replicates"] = this->gbo_replicates;  // int
     j["ufboot_epsilon"] = this->ufboot_epsilon;  // double
+    j["rell_batch"] = this->rell_batch;  // int
+    j["ufboot_compact"] = this->ufboot_compact;  // bool
     j["check_gbo_sample_size"] = this->check_gbo_sample_size;  // bool
     j["use_rell_method"] = this->use_rell_method;  // bool
     j["use_elw_method"] = this->use_elw_method;  // bool
@@ -6733,6 +6949,9 @@ json Params::to_json() const {
     ::to_json(j["lh_mem_save"], this->lh_mem_save); // LhMemSave enum
     j["buffer_mem_save"] = this->buffer_mem_save;  // bool
     j["max_mem_size"] = this->max_mem_size;  // double
+    j["lh_scratch_dir"] = std::string(this->lh_scratch_dir ? this->lh_scratch_dir : "");  // char*
+    j["mpi_patterns"] = this->mpi_patterns;  // bool
+    j["part_sched"] = this->part_sched;  // bool
     j["print_splits_file"] = this->print_splits_file;  // bool
     j["print_splits_nex_file"] = this->print_splits_nex_file;  // bool
     j["ignore_identical_seqs"] = this->ignore_identical_seqs;  // bool
@@ -6802,6 +7021,8 @@ json Params::to_json() const {
     j["alisim_mixture_at_sub_level"] = this->alisim_mixture_at_sub_level;  // bool
     j["alisim_branch_scale"] = this->alisim_branch_scale;  // double
     j["alisim_single_output"] = this->alisim_single_output;  // bool
+    j["alisim_parallel_datasets"] = this->alisim_parallel_datasets;  // bool
+    j["alisim_archive"] = this->alisim_archive;  // bool
     ::to_json(j["alisim_rate_heterogeneity"], this->alisim_rate_heterogeneity); // ASSIGNMENT_TYPE enum
     ::to_json(j["alisim_stationarity_heterogeneity"], this->alisim_stationarity_heterogeneity); // ASSIGNMENT_TYPE enum
     j["tmp_data_filename"] = this->tmp_data_filename;  // string
@@ -6815,6 +7036,7 @@ json Params::to_json() const {
     j["include_pre_mutations"] = this->include_pre_mutations;  // bool
     j["alignment_id"] = this->alignment_id;  // int
     j["mutation_file"] = this->mutation_file;  // string
+    j["alisim_binary_to_fasta"] = this->alisim_binary_to_fasta;  // string
     j["site_starting_index"] = this->site_starting_index;  // int
     // ... handle other parameters here ...
     return j;
@@ -6931,6 +7153,7 @@ void Params::from_json(const json& j) {
         std::strcpy(this->aln_file, str.c_str());
     } // char*
     if (j.contains("phylip_sequential_format")) this->phylip_sequential_format = j["phylip_sequential_format"].get<bool>(); // bool
+    if (j.contains("aln_cache")) this->aln_cache = j["aln_cache"].get<bool>(); // bool
     if (j.contains("symtest")) ::from_json(j["symtest"], this->symtest); // SymTest enum
     if (j.contains("symtest_only")) this->symtest_only = j["symtest_only"].get<bool>(); // bool
     if (j.contains("symtest_remove")) this->symtest_remove = j["symtest_remove"].get<int>(); // int
@@ -6944,6 +7167,8 @@ void Params::from_json(const json& j) {
     if (j.contains("topotest_optimize_model")) this->topotest_optimize_model = j["topotest_optimize_model"].get<bool>(); // bool
     if (j.contains("do_weighted_test")) this->do_weighted_test = j["do_weighted_test"].get<bool>(); // bool
     if (j.contains("do_au_test")) this->do_au_test = j["do_au_test"].get<bool>(); // bool
+    if (j.contains("au_bins")) this->au_bins = j["au_bins"].get<int>(); // int
+    if (j.contains("tree_reuse")) this->tree_reuse = j["tree_reuse"].get<int>(); // int
     if (j.contains("partition_file")) {
         std::string str = j["partition_file"].get<std::string>();
         if (this->partition_file != nullptr) {
@@ -7113,6 +7338,10 @@ void Params::from_json(const json& j) {
     if (j.contains("boundary_modifier")) this->boundary_modifier = j["boundary_modifier"].get<double>(); // double
     if (j.contains("compute_obs_dist")) this->compute_obs_dist = j["compute_obs_dist"].get<bool>(); // bool
     if (j.contains("compute_jc_dist")) this->compute_jc_dist = j["compute_jc_dist"].get<bool>(); // bool
+    if (j.contains("dist_float")) this->dist_float = j["dist_float"].get<bool>(); // bool
+    if (j.contains("write_dist_file")) this->write_dist_file = j["write_dist_file"].get<bool>(); // bool
+    if (j.contains("place_reps")) this->place_reps = j["place_reps"].get<int>(); // int
+    if (j.contains("place_block")) this->place_block = j["place_block"].get<int>(); // int
     if (j.contains("experimental")) this->experimental = j["experimental"].get<bool>(); // bool
     if (j.contains("compute_ml_dist")) this->compute_ml_dist = j["compute_ml_dist"].get<bool>(); // bool
     if (j.contains("compute_ml_tree")) this->compute_ml_tree = j["compute_ml_tree"].get<bool>(); // bool
@@ -7342,6 +7571,7 @@ void Params::from_json(const json& j) {
     if (j.contains("localbp_replicates")) this->localbp_replicates = j["localbp_replicates"].get<int>();
     if (j.contains("SSE")) this->SSE = j["SSE"].get<LikelihoodKernel>();
     if (j.contains("lk_safe_scaling")) this->lk_safe_scaling = j["lk_safe_scaling"].get<bool>();
+    if (j.contains("float_lh")) this->float_lh = j["float_lh"].get<bool>();
     if (j.contains("numseq_safe_scaling")) this->numseq_safe_scaling = j["numseq_safe_scaling"].get<int>();
     if (j.contains("kernel_nonrev")) this->kernel_nonrev = j["kernel_nonrev"].get<bool>();
     if (j.contains("print_site_lh")) this->print_site_lh = j["print_site_lh"].get<SiteLoglType>();
@@ -7442,6 +7672,8 @@ void Params::from_json(const json& j) {
     if (j.contains("upper_bound_frac")) this->upper_bound_frac = j["upper_bound_frac"].get<double>();
     if (j.contains("gbo_replicates")) this->gbo_replicates = j["gbo_replicates"].get<int>();
     if (j.contains("ufboot_epsilon")) this->ufboot_epsilon = j["ufboot_epsilon"].get<double>();
+    if (j.contains("rell_batch")) this->rell_batch = j["rell_batch"].get<int>();
+    if (j.contains("ufboot_compact")) this->ufboot_compact = j["ufboot_compact"].get<bool>();
     if (j.contains("check_gbo_sample_size")) this->check_gbo_sample_size = j["check_gbo_sample_size"].get<bool>();
     if (j.contains("use_rell_method")) this->use_rell_method = j["use_rell_method"].get<bool>();
     if (j.contains("use_elw_method")) this->use_elw_method = j["use_elw_method"].get<bool>();
@@ -7524,6 +7756,19 @@ void Params::from_json(const json& j) {
     //TODO if (j.contains("lh_mem_save")) this->lh_mem_save = j["lh_mem_save"].get<LhMemSave>();
     if (j.contains("buffer_mem_save")) this->buffer_mem_save = j["buffer_mem_save"].get<bool>();
     if (j.contains("max_mem_size")) this->max_mem_size = j["max_mem_size"].get<double>();
+    if (j.contains("lh_scratch_dir")) {
+        std::string str = j["lh_scratch_dir"].get<std::string>();
+        if (this->lh_scratch_dir != nullptr) {
+            delete[] this->lh_scratch_dir; // Deallocate existing memory
+        }
+        this->lh_scratch_dir = nullptr;
+        if (!str.empty()) {
+            this->lh_scratch_dir = new char[str.length() + 1];
+            std::strcpy(this->lh_scratch_dir, str.c_str());
+        }
+    }
+    if (j.contains("mpi_patterns")) this->mpi_patterns = j["mpi_patterns"].get<bool>();
+    if (j.contains("part_sched")) this->part_sched = j["part_sched"].get<bool>();
     if (j.contains("print_splits_file")) this->print_splits_file = j["print_splits_file"].get<bool>();
     if (j.contains("print_splits_nex_file")) this->print_splits_nex_file = j["print_splits_nex_file"].get<bool>();
     if (j.contains("ignore_identical_seqs")) this->ignore_identical_seqs = j["ignore_identical_seqs"].get<bool>();
@@ -7632,6 +7877,8 @@ void Params::from_json(const json& j) {
     if (j.contains("alisim_mixture_at_sub_level")) this->alisim_mixture_at_sub_level = j["alisim_mixture_at_sub_level"].get<bool>();
     if (j.contains("alisim_branch_scale")) this->alisim_branch_scale = j["alisim_branch_scale"].get<double>();
     if (j.contains("alisim_single_output")) this->alisim_single_output = j["alisim_single_output"].get<bool>();
+    if (j.contains("alisim_parallel_datasets")) this->alisim_parallel_datasets = j["alisim_parallel_datasets"].get<bool>();
+    if (j.contains("alisim_archive")) this->alisim_archive = j["alisim_archive"].get<bool>();
     //TODO ::from_json(j["alisim_rate_heterogeneity"], this->alisim_rate_heterogeneity);
     //TODO ::from_json(j["alisim_stationarity_heterogeneity"], this->alisim_stationarity_heterogeneity);
     if (j.contains("tmp_data_filename")) this->tmp_data_filename = j["tmp_data_filename"].get<std::string>();
@@ -7645,6 +7892,7 @@ void Params::from_json(const json& j) {
     if (j.contains("include_pre_mutations")) this->include_pre_mutations = j["include_pre_mutations"].get<bool>();
     if (j.contains("alignment_id")) this->alignment_id = j["alignment_id"].get<int>();
     if (j.contains("mutation_file")) this->mutation_file = j["mutation_file"].get<std::string>();
+    if (j.contains("alisim_binary_to_fasta")) this->alisim_binary_to_fasta = j["alisim_binary_to_fasta"].get<std::string>();
     if (j.contains("site_starting_index")) this->site_starting_index = j["site_starting_index"].get<int>();
     // ... deserialize other members here ...
 }
@@ -7713,6 +7961,7 @@ json Params::get_param(const std::string& name) const {
     else if (name == "out_prefix") j[name] = std::string(this->out_prefix);
     else if (name == "aln_file") j[name] = std::string(this->aln_file);
     else if (name == "phylip_sequential_format") j[name] = this->phylip_sequential_format;
+    else if (name == "aln_cache") j[name] = this->aln_cache;
     else if (name == "symtest") ::to_json(j[name], this->symtest);
     else if (name == "symtest_only") j[name] = this->symtest_only;
     else if (name == "symtest_remove") j[name] = this->symtest_remove;
@@ -7726,6 +7975,8 @@ json Params::get_param(const std::string& name) const {
     else if (name == "topotest_optimize_model") j[name] = this->topotest_optimize_model;
     else if (name == "do_weighted_test") j[name] = this->do_weighted_test;
     else if (name == "do_au_test") j[name] = this->do_au_test;
+    else if (name == "au_bins") j[name] = this->au_bins;
+    else if (name == "tree_reuse") j[name] = this->tree_reuse;
     else if (name == "partition_file") j[name] = std::string(this->partition_file);
     else if (name == "partition_type") j[name] = this->partition_type;
     else if (name == "partition_merge") ::to_json(j[name], this->partition_merge);
@@ -7789,6 +8040,10 @@ json Params::get_param(const std::string& name) const {
     else if (name == "dist_file") j[name] = std::string(this->dist_file);
     else if (name == "compute_obs_dist") j[name] = this->compute_obs_dist;
     else if (name == "compute_jc_dist") j[name] = this->compute_jc_dist;
+    else if (name == "dist_float") j[name] = this->dist_float;
+    else if (name == "write_dist_file") j[name] = this->write_dist_file;
+    else if (name == "place_reps") j[name] = this->place_reps;
+    else if (name == "place_block") j[name] = this->place_block;
     else if (name == "experimental") j[name] = this->experimental;
     else if (name == "compute_ml_dist") j[name] = this->compute_ml_dist;
     else if (name == "compute_ml_tree") j[name] = this->compute_ml_tree;
@@ -7919,6 +8174,7 @@ json Params::get_param(const std::string& name) const {
     else if (name == "localbp_replicates") j[name] = this->localbp_replicates;
     else if (name == "SSE") ::to_json(j[name], this->SSE);
     else if (name == "lk_safe_scaling") j[name] = this->lk_safe_scaling;
+    else if (name == "float_lh") j[name] = this->float_lh;
     else if (name == "numseq_safe_scaling") j[name] = this->numseq_safe_scaling;
     else if (name == "kernel_nonrev") j[name] = this->kernel_nonrev;
     else if (name == "print_site_lh") ::to_json(j[name], this->print_site_lh);
@@ -7967,6 +8223,8 @@ json Params::get_param(const std::string& name) const {
     else if (name == "upper_bound_frac") j[name] = this->upper_bound_frac;
     else if (name == "gbo_replicates") j[name] = this->gbo_replicates;
     else if (name == "ufboot_epsilon") j[name] = this->ufboot_epsilon;
+    else if (name == "rell_batch") j[name] = this->rell_batch;
+    else if (name == "ufboot_compact") j[name] = this->ufboot_compact;
     else if (name == "check_gbo_sample_size") j[name] = this->check_gbo_sample_size;
     else if (name == "use_rell_method") j[name] = this->use_rell_method;
     else if (name == "use_elw_method") j[name] = this->use_elw_method;
@@ -8015,6 +8273,9 @@ json Params::get_param(const std::string& name) const {
     else if (name == "lh_mem_save") ::to_json(j[name], this->lh_mem_save);
     else if (name == "buffer_mem_save") j[name] = this->buffer_mem_save;
     else if (name == "max_mem_size") j[name] = this->max_mem_size;
+    else if (name == "lh_scratch_dir") j[name] = std::string(this->lh_scratch_dir ? this->lh_scratch_dir : "");
+    else if (name == "mpi_patterns") j[name] = this->mpi_patterns;
+    else if (name == "part_sched") j[name] = this->part_sched;
     else if (name == "print_splits_file") j[name] = this->print_splits_file;
     else if (name == "print_splits_nex_file") j[name] = this->print_splits_nex_file;
     else if (name == "ignore_identical_seqs") j[name] = this->ignore_identical_seqs;
@@ -8086,6 +8347,8 @@ json Params::get_param(const std::string& name) const {
     else if (name == "alisim_mixture_at_sub_level") j[name] = this->alisim_mixture_at_sub_level;
     else if (name == "alisim_branch_scale") j[name] = this->alisim_branch_scale;
     else if (name == "alisim_single_output") j[name] = this->alisim_single_output;
+    else if (name == "alisim_parallel_datasets") j[name] = this->alisim_parallel_datasets;
+    else if (name == "alisim_archive") j[name] = this->alisim_archive;
     else if (name == "alisim_rate_heterogeneity") ::to_json(j[name], this->alisim_rate_heterogeneity);
     else if (name == "alisim_stationarity_heterogeneity") ::to_json(j[name], this->alisim_stationarity_heterogeneity);
     else if (name == "tmp_data_filename") j[name] = std::string(this->tmp_data_filename);
@@ -8099,6 +8362,7 @@ json Params::get_param(const std::string& name) const {
     else if (name == "include_pre_mutations") j[name] = this->include_pre_mutations;
     else if (name == "alignment_id") j[name] = this->alignment_id;
     else if (name == "mutation_file") j[name] = std::string(this->mutation_file);
+    else if (name == "alisim_binary_to_fasta") j[name] = std::string(this->alisim_binary_to_fasta);
     else if (name == "site_starting_index") j[name] = this->site_starting_index;
     // ... handle other parameters here ...
     else throw std::invalid_argument("Unknown parameter name");
@@ -8137,6 +8401,10 @@ void Params::setDefault(){
     this->dist_file = NULL;
     this->compute_obs_dist = false;
     this->compute_jc_dist = true;
+    this->dist_float = false;
+    this->write_dist_file = false;
+    this->place_reps = 100;
+    this->place_block = 1000;
     this->experimental = true;
     this->compute_ml_dist = true;
     this->compute_ml_tree = true;
@@ -8201,6 +8469,7 @@ void Params::setDefault(){
 
     this->aln_file = NULL;
     this->phylip_sequential_format = false;
+    this->aln_cache = false;
     this->symtest = SYMTEST_NONE;
     this->symtest_only = false;
     this->symtest_remove = 0;
@@ -8214,6 +8483,8 @@ void Params::setDefault(){
     this->topotest_optimize_model = false;
     this->do_weighted_test = false;
     this->do_au_test = false;
+    this->au_bins = 0;
+    this->tree_reuse = 0;
     this->siteLL_file = NULL; //added by MA
     this->partition_file = NULL;
     this->partition_type = BRLEN_OPTIMIZE;
@@ -8323,6 +8594,7 @@ void Params::setDefault(){
     this->SSE = LK_AVX_FMA;
 #endif
     this->lk_safe_scaling = false;
+    this->float_lh = false;
     this->numseq_safe_scaling = 2000;
     this->kernel_nonrev = false;
     this->print_site_lh = WSL_NONE;
@@ -8368,6 +8640,8 @@ void Params::setDefault(){
 
     this->gbo_replicates = 0;
 	this->ufboot_epsilon = 0.5;
+    this->rell_batch = 1;
+    this->ufboot_compact = false;
     this->check_gbo_sample_size = 0;
     this->use_rell_method = true;
     this->use_elw_method = false;
@@ -8448,6 +8722,9 @@ void Params::setDefault(){
 	this->print_branch_lengths = false;
 	this->lh_mem_save = LM_PER_NODE; // auto detect
     this->buffer_mem_save = false;
+    this->lh_scratch_dir = NULL;
+    this->mpi_patterns = false;
+    this->part_sched = false;
 	this->start_tree = STT_PLL_PARSIMONY;
     this->start_tree_subtype_name = StartTree::Factory::getNameOfDefaultTreeBuilder();
 
@@ -8566,6 +8843,8 @@ void Params::setDefault(){
     this->alisim_rate_heterogeneity = POSTERIOR_MEAN;
     this->alisim_stationarity_heterogeneity = POSTERIOR_MEAN;
     this->alisim_single_output = false;
+    this->alisim_parallel_datasets = false;
+    this->alisim_archive = false;
     this->keep_seq_order = false;
     this->mem_limit_factor = 0;
     this->delete_output = false;
@@ -8577,6 +8856,7 @@ void Params::setDefault(){
     this->alignment_id = 0;
     this->include_pre_mutations = false;
     this->mutation_file = "";
+    this->alisim_binary_to_fasta = "";
     this->site_starting_index = 0;
 
 
@@ -9293,7 +9573,7 @@ int nFreqParams(StateFreqType freq_type) {
 }
  
 double binomial_coefficient_log(unsigned int N, unsigned int n) {
-  static DoubleVector logv;
+  static thread_local DoubleVector logv;
   if (logv.size() <= 0) {
     logv.push_back(0.0);
     logv.push_back(0.0);
@@ -9351,6 +9631,8 @@ string getOutputNameWithExt(const InputType& format, const string& output_filepa
             return output_filepath + ".fa";
         case IN_PHYLIP:
             return output_filepath + ".phy";
+        case IN_ALIBIN:
+            return output_filepath + ".alibin";
         default:
             return output_filepath + ".phy";
     }
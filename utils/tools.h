@@ -367,6 +367,12 @@ typedef vector<bool> BoolVector;
  */
 typedef vector<char> CharVector;
 
+/**
+        states of a sequence simulated by AliSim, one byte per state:
+        every data type supported by AliSim (up to 64 codons) and its unknown state (at most 126) fit in a byte
+ */
+typedef vector<uint8_t> SimStateVector;
+
 /**
         vector of string
  */
@@ -580,7 +586,7 @@ const int SW_AVG_PRESENT = 4; // take the split weight average over all trees th
         input type, tree or splits graph
  */
 enum InputType {
-    IN_NEWICK, IN_NEXUS, IN_FASTA, IN_PHYLIP, IN_COUNTS, IN_CLUSTAL, IN_MSF, IN_MAPLE, IN_OTHER
+    IN_NEWICK, IN_NEXUS, IN_FASTA, IN_PHYLIP, IN_COUNTS, IN_CLUSTAL, IN_MSF, IN_MAPLE, IN_ALIBIN, IN_OTHER
 };
 
   // TODO DS: SAMPLING_SAMPLED is DEPRECATED and it is not possible to run PoMo with SAMPLING_SAMPLED.
@@ -596,9 +602,10 @@ enum VerboseMode {
 };
 
 /**
-        verbose level on the screen
+        verbose level on the screen of the calling thread; threads that never ran
+        parseArg() (e.g. OpenMP workers) get it copied by ThreadSettings
  */
-extern VerboseMode verbose_mode;
+extern thread_local VerboseMode verbose_mode;
 
 /**
         consensus reconstruction type
@@ -916,7 +923,7 @@ inline void from_json(const json& j, LEAST_SQUARE_VAR& value) {
     else throw std::runtime_error("LEAST_SQUARE_VAR: unknown value " + str);
  }
 enum START_TREE_TYPE {
-	STT_BIONJ, STT_PARSIMONY, STT_PLL_PARSIMONY, STT_RANDOM_TREE, STT_USER_TREE
+	STT_BIONJ, STT_PARSIMONY, STT_PLL_PARSIMONY, STT_RANDOM_TREE, STT_USER_TREE, STT_PLACEMENT
 };
 /**
  * Serialize START_TREE_TYPE to json 
@@ -929,6 +936,7 @@ inline void to_json(json& j, const START_TREE_TYPE& value) {
         case STT_PLL_PARSIMONY: j = "STT_PLL_PARSIMONY"; break;
         case STT_RANDOM_TREE: j = "STT_RANDOM_TREE"; break;
         case STT_USER_TREE: j = "STT_USER_TREE"; break;
+        case STT_PLACEMENT: j = "STT_PLACEMENT"; break;
     }
 }
 /**
@@ -942,6 +950,7 @@ inline void from_json(const json& j, START_TREE_TYPE& value) {
     else if (str == "STT_PLL_PARSIMONY") value = STT_PLL_PARSIMONY;
     else if (str == "STT_RANDOM_TREE") value = STT_RANDOM_TREE;
     else if (str == "STT_USER_TREE") value = STT_USER_TREE;
+    else if (str == "STT_PLACEMENT") value = STT_PLACEMENT;
     else throw std::runtime_error("START_TREE_TYPE: unknown value " + str);
 }
 
@@ -1208,8 +1217,29 @@ const double MAX_GAMMA_SHAPE = 1000.0;
 const double TOL_GAMMA_SHAPE = 0.001;
 
 
-/** maximum number of newton-raphson steps for NNI branch evaluation */
-extern int NNI_MAX_NR_STEP;
+/** maximum number of newton-raphson steps for NNI branch evaluation, per thread like verbose_mode */
+extern thread_local int NNI_MAX_NR_STEP;
+
+/**
+        per-thread settings (verbose_mode, NNI_MAX_NR_STEP) captured on one thread and
+        applied to another, e.g. at the start of an OpenMP region running tree code:
+            ThreadSettings thread_settings;
+            #pragma omp parallel for
+            for (...) { thread_settings.apply(); ... }
+ */
+struct ThreadSettings {
+    VerboseMode verbose_mode;
+    int nni_max_nr_step;
+
+    /** capture the settings of the calling thread */
+    ThreadSettings();
+
+    /** @return the settings published by parseArg() of the iqtree2 program */
+    static ThreadSettings program();
+
+    /** copy the settings to the calling thread */
+    void apply() const;
+};
 
 /*--------------------------------------------------------------*/
 /*--------------------------------------------------------------*/
@@ -1221,7 +1251,27 @@ extern int NNI_MAX_NR_STEP;
  */
 class Params {
 public:
+    /**
+        @return the Params bound to the calling thread by setThreadInstance(),
+        or the process-wide instance if none is bound
+     */
     static Params& getInstance();
+    /**
+        bind params to the calling thread, so that getInstance() on this thread
+        returns it instead of the process-wide instance. Used by libiqtree2 to run
+        several analyses concurrently in one process.
+        @param params parameters to bind, NULL to restore the process-wide instance
+     */
+    static void setThreadInstance(Params *params);
+    /**
+        @return true if a Params object is bound to the calling thread
+     */
+    static bool hasThreadInstance();
+    /**
+        @return a new Params object independent of the process-wide instance,
+        to be deleted by the caller
+     */
+    static Params *newInstance();
     json to_json() const;
     void from_json(const json& j);
     json get_param(const std::string& name) const;
@@ -1529,6 +1579,10 @@ public:
     /** true if sequential phylip format is used, default: false (interleaved format) */
     bool phylip_sequential_format;
 
+    /** true to keep the site patterns of the alignment in a binary cache file next to it,
+        reused on later runs as long as the alignment file is unchanged */
+    bool aln_cache;
+
     /**
      SYMTEST_NONE to not perform test of symmetry of Jermiin et al. (default)
      SYMTEST_MAXDIV to perform symmetry test on the pair with maximum divergence
@@ -1583,6 +1637,20 @@ public:
     /** true to do the approximately unbiased (AU) test */
     bool do_au_test;
 
+    /**
+        number of histogram bins per tree and scale for the streaming AU test,
+        0 (default) to keep all replicate statistics
+     */
+    int au_bins;
+
+    /**
+        for the tree set evaluation: reuse branch lengths and partial likelihoods of
+        identical subtrees from the previously evaluated tree. 0 (default) to disable,
+        1 to keep the input order, larger values to reorder the trees by choosing the
+        next tree among this many candidates by the smallest Robinson-Foulds distance
+     */
+    int tree_reuse;
+
     /**
             file specifying partition model
      */
@@ -1879,6 +1947,29 @@ public:
      */
     bool compute_ml_dist;
 
+    /**
+            TRUE to keep only the lower triangle of the distance matrix in single precision
+            and hand it to the start tree builder in memory, default: FALSE
+     */
+    bool dist_float;
+
+    /**
+            TRUE to write the distance matrix file also with dist_float, default: FALSE
+     */
+    bool write_dist_file;
+
+    /**
+            number of representative sequences sampled at each level of the
+            distance-matrix-free start tree (-t PLACE), default: 100
+     */
+    int place_reps;
+
+    /**
+            largest group of sequences for which -t PLACE computes all pairwise
+            distances and runs the start tree builder directly, default: 1000
+     */
+    int place_block;
+
     /**
             TRUE to compute the maximum-likelihood tree
      */
@@ -2468,6 +2559,12 @@ public:
     /** minimum number of sequences to always use safe scaling, default: 2000 */
     int numseq_safe_scaling;
 
+    /**
+        TRUE to store partial likelihood vectors in single precision (--float-lh) with the AVX-512 kernel,
+        falls back to double precision if numerical problems occur, default: FALSE
+     */
+    bool float_lh;
+
     /** TRUE to force using non-reversible likelihood kernel */
     bool kernel_nonrev;
 
@@ -2692,6 +2789,18 @@ public:
 	 */
 	double ufboot_epsilon;
 
+    /**
+        number of visited trees whose pattern log-likelihoods are buffered and evaluated
+        against the bootstrap replicates at once (blocked matrix product), 1 for no buffering
+     */
+    int rell_batch;
+
+    /**
+        TRUE to store UFBoot replicate pattern frequencies as 8-bit counts
+        (counts above 255 kept in a per-replicate overflow list) instead of BootValType
+     */
+    bool ufboot_compact;
+
     /**
             TRUE to check with different max_candidate_trees
      */
@@ -2886,6 +2995,18 @@ public:
     /** maximum size of memory allowed to use */
     double max_mem_size;
 
+    /** directory of a scratch file holding the partial likelihood vectors, instead of the RAM,
+        e.g. on a fast local disk for alignments whose partial likelihoods do not fit in RAM */
+    char *lh_scratch_dir;
+
+    /** TRUE to split the site patterns across MPI processes, each computing the likelihood
+        of its slice, instead of running independent tree searches per process */
+    bool mpi_patterns;
+
+    /** TRUE to give large partitions a thread budget proportional to their computation cost
+        in the parallel loops over partitions, instead of one thread per partition */
+    bool part_sched;
+
 	/* TRUE to print .splits file in star-dot format */
 	bool print_splits_file;
     
@@ -3167,6 +3288,16 @@ public:
     */
     bool alisim_single_output;
     
+    /**
+    *  TRUE to simulate several replicate alignments at once, one alignment per thread
+    */
+    bool alisim_parallel_datasets;
+    
+    /**
+    *  TRUE to output all replicate alignments into a single archive file, indexed by <archive>.idx
+    */
+    bool alisim_archive;
+    
     /**
     *  Type to assign rate heterogeneity to sites (default: posterior mean)
     */
@@ -3232,6 +3363,11 @@ public:
     */
     std::string mutation_file;
     
+    /**
+    *  packed binary alignment (written by AliSim with -af bin) to be converted into FASTA format
+    */
+    std::string alisim_binary_to_fasta;
+    
     /**
     *  site starting index (for predefined mutations in AliSim)
     */
@@ -3350,6 +3486,13 @@ void outError(const char *error, string msg, bool quit = true);
 void outWarning(const char *warn);
 void outWarning(string warn);
 
+/**
+        make outError() on the calling thread throw std::runtime_error instead of
+        terminating the process, so that library callers can recover
+        @param throw_error true to throw, false to exit (default)
+ */
+void setThrowOnError(bool throw_error);
+
 
 /** safe version of std::getline to deal with files from different platforms */ 
 std::istream& safeGetline(std::istream& is, std::string& t);
@@ -3806,7 +3949,11 @@ double computePValueChiSquare(double x, int df);
 /* random number generator */
 /*--------------------------------------------------------------*/
 
-extern int *randstream;
+/**
+        random stream of the calling thread; threads that never called init_random()
+        (e.g. OpenMP workers) share the stream of the main program thread
+ */
+extern thread_local int *randstream;
 
 /**
  * initialize the random number generator